@@ -1,5 +1,6 @@
 #include "allegro5/allegro_acodec.h"
 #include "allegro5/allegro_audio.h"
+#include "allegro5/internal/aintern_audio.h"
 #include "allegro5/internal/aintern_acodec_cfg.h"
 #include "acodec.h"
 
@@ -19,6 +20,7 @@ bool al_init_acodec_addon(void)
    bool ret = true;
 
    ret &= al_register_sample_loader(".wav", _al_load_wav);
+   ret &= _al_register_sample_loader_flags(".wav", _al_load_wav_flags);
    ret &= al_register_sample_saver(".wav", _al_save_wav);
    ret &= al_register_audio_stream_loader(".wav", _al_load_wav_audio_stream);
 
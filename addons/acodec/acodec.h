@@ -4,6 +4,7 @@
 #include "allegro5/internal/aintern_acodec_cfg.h"
 
 ALLEGRO_SAMPLE *_al_load_wav(const char *filename);
+ALLEGRO_SAMPLE *_al_load_wav_flags(const char *filename, int flags);
 ALLEGRO_SAMPLE *_al_load_wav_f(ALLEGRO_FILE *fp);
 ALLEGRO_AUDIO_STREAM *_al_load_wav_audio_stream(const char *filename,
    size_t buffer_count, unsigned int samples);
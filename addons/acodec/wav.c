@@ -276,21 +276,112 @@ static void wav_stream_close(ALLEGRO_AUDIO_STREAM *stream)
 }
 
 
+/* wav_load_sample:
+ *  Reads the whole of the data chunk into a newly allocated sample.
+ */
+static ALLEGRO_SAMPLE *wav_load_sample(WAVFILE *wavfile)
+{
+   size_t n = wavfile->sample_size * wavfile->samples;
+   size_t got;
+   char *data = al_malloc(n);
+   ALLEGRO_SAMPLE *spl;
+
+   if (!data)
+      return NULL;
+
+   spl = al_create_sample(data, wavfile->samples, wavfile->freq,
+      _al_word_size_to_depth_conf(wavfile->bits / 8),
+      _al_count_to_channel_conf(wavfile->channels), true);
+   if (!spl) {
+      al_free(data);
+      return NULL;
+   }
+
+   /* A truncated file leaves silence at the end. */
+   got = wav_read(wavfile, data, wavfile->samples) * wavfile->sample_size;
+   if (got < n)
+      memset(data + got, 0, n - got);
+
+   return spl;
+}
+
+
+/* wav_map_sample:
+ *  Creates a sample over the data chunk of a memory mapped file, if the data
+ *  can be used as it is.  Returns NULL if the file must be read instead.
+ */
+static ALLEGRO_SAMPLE *wav_map_sample(WAVFILE *wavfile)
+{
+   size_t n = wavfile->sample_size * wavfile->samples;
+   size_t map_size;
+   char *base;
+   ALLEGRO_SAMPLE *spl;
+
+#ifdef ALLEGRO_BIG_ENDIAN
+   /* 16-bit data would need swapping. */
+   if (wavfile->bits != 8)
+      return NULL;
+#endif
+   if (wavfile->dpos % (wavfile->bits / 8) != 0)
+      return NULL;
+
+   base = _al_kcm_map_file(wavfile->f, &map_size);
+   if (!base)
+      return NULL;
+
+   if (wavfile->dpos > map_size || n > map_size - wavfile->dpos) {
+      ALLEGRO_DEBUG("Data chunk runs past the end of the file.\n");
+      _al_kcm_unmap_file(base, map_size);
+      return NULL;
+   }
+
+   spl = al_create_sample(base + wavfile->dpos, wavfile->samples,
+      wavfile->freq, _al_word_size_to_depth_conf(wavfile->bits / 8),
+      _al_count_to_channel_conf(wavfile->channels), true);
+   if (!spl) {
+      _al_kcm_unmap_file(base, map_size);
+      return NULL;
+   }
+
+   spl->map_base = base;
+   spl->map_size = map_size;
+   return spl;
+}
+
+
 /* _al_load_wav:
  *  Reads a RIFF WAV format sample ALLEGRO_FILE, returning an ALLEGRO_SAMPLE
  *  structure, or NULL on error.
  */
 ALLEGRO_SAMPLE *_al_load_wav(const char *filename)
+{
+   return _al_load_wav_flags(filename, 0);
+}
+
+
+/* _al_load_wav_flags:
+ *  Like _al_load_wav, but with ALLEGRO_SAMPLE_MAP_FILE the sample data is
+ *  mapped from the file rather than read, where possible.
+ */
+ALLEGRO_SAMPLE *_al_load_wav_flags(const char *filename, int flags)
 {
    ALLEGRO_FILE *f;
-   ALLEGRO_SAMPLE *spl;
+   ALLEGRO_SAMPLE *spl = NULL;
+   WAVFILE *wavfile;
    ASSERT(filename);
 
    f = al_fopen(filename, "rb");
    if (!f)
       return NULL;
 
-   spl = _al_load_wav_f(f);
+   wavfile = wav_open(f);
+   if (wavfile) {
+      if (flags & ALLEGRO_SAMPLE_MAP_FILE)
+         spl = wav_map_sample(wavfile);
+      if (!spl)
+         spl = wav_load_sample(wavfile);
+      wav_close(wavfile);
+   }
 
    al_fclose(f);
 
@@ -303,22 +394,7 @@ ALLEGRO_SAMPLE *_al_load_wav_f(ALLEGRO_FILE *fp)
    ALLEGRO_SAMPLE *spl = NULL;
 
    if (wavfile) {
-      size_t n = (wavfile->bits / 8) * wavfile->channels * wavfile->samples;
-      char *data = al_malloc(n);
-
-      if (data) {
-         spl = al_create_sample(data, wavfile->samples, wavfile->freq,
-            _al_word_size_to_depth_conf(wavfile->bits / 8),
-            _al_count_to_channel_conf(wavfile->channels), true);
-
-         if (spl) {
-            memset(data, 0, n);
-            wav_read(wavfile, data, wavfile->samples);
-         }
-         else {
-            al_free(data);
-         }
-      }
+      spl = wav_load_sample(wavfile);
       wav_close(wavfile);
    }
 
@@ -6,6 +6,7 @@
 #define AINTERN_AUDIO_H
 
 #include "allegro5/allegro.h"
+#include "allegro5/internal/aintern_list.h"
 #include "allegro5/internal/aintern_vector.h"
 #include "../allegro_audio.h"
 
@@ -84,6 +85,8 @@ struct ALLEGRO_VOICE {
 
    void                 *extra;
                         /* Extra data for use by the driver. */
+
+   _AL_LIST_ITEM        *dtor_item;
 };
 
 
@@ -98,16 +101,50 @@ typedef union {
    void     *ptr;
 } any_buffer_t;
 
+typedef struct _AL_COMPRESSED_SAMPLE _AL_COMPRESSED_SAMPLE;
+
 struct ALLEGRO_SAMPLE {
    ALLEGRO_AUDIO_DEPTH  depth;
    ALLEGRO_CHANNEL_CONF chan_conf;
    unsigned int         frequency;
    int                  len;
+   int                  priority;
+                        /* Used by al_play_sample to choose which instance
+                         * to stop when all reserved instances are busy.
+                         */
    any_buffer_t         buffer;
    bool                 free_buf;
                         /* Whether `buffer' needs to be freed when the sample
                          * is destroyed, or when `buffer' changes.
                          */
+   _AL_LIST_ITEM        *dtor_item;
+                        /* Set for samples from al_create_sample only; copies
+                         * held by sample instances do not own it.
+                         */
+   void                 *map_base;
+   size_t               map_size;
+                        /* If non-NULL, `buffer' points into a file mapping
+                         * starting at `map_base', and freeing the buffer
+                         * means unmapping it.
+                         */
+   _AL_COMPRESSED_SAMPLE *compressed;
+                        /* If non-NULL, `buffer' is decoded on demand from
+                         * the data kept here, and may be evicted from the
+                         * sample cache while no instance is playing it.
+                         */
+   bool                 pinned;
+                        /* Set for copies held by sample instances while
+                         * they hold a reference which keeps the decoded
+                         * data of `compressed' in the cache.  `buffer' is
+                         * NULL in copies which do not.
+                         */
+   bool                 pin_idle;
+                        /* Set by the mixer, with the instance locked, when
+                         * an instance holding a pin plays to the end.  The
+                         * pin then no longer keeps the data in the cache,
+                         * and `buffer' may be stale until it is acquired
+                         * again.
+                         */
 };
 
 /* Read some samples into a mixer buffer.
@@ -177,6 +214,17 @@ struct ALLEGRO_SAMPLE_INSTANCE {
                          * mixers, if any.  Otherwise is NULL.
                          * The gain is premultiplied in.
                          */
+   float                matrix_peak;
+                        /* The largest magnitude in `matrix'.  The mixer
+                         * skips over the sample instead of mixing it if this
+                         * is no greater than its cull gain.
+                         */
+
+   const struct _AL_SINC_TABLE *sinc_table;
+                        /* The exact coefficient table used by the sinc
+                         * resampler, or NULL if the step has no table.
+                         * Set whenever the step is, and owned by the mixer.
+                         */
 
    bool                 is_mixer;
    stream_reader_t      spl_read;
@@ -193,6 +241,9 @@ struct ALLEGRO_SAMPLE_INSTANCE {
    sample_parent_t      parent;
                         /* The object that this sample is attached to, if any.
                          */
+
+   _AL_LIST_ITEM        *dtor_item;
+                        /* Also used for mixers. */
 };
 
 void _al_kcm_destroy_sample(ALLEGRO_SAMPLE_INSTANCE *sample, bool unregister);
@@ -263,6 +314,22 @@ struct ALLEGRO_AUDIO_STREAM {
 
    void                  *extra;
                          /* Extra data for use by the flac/vorbis addons. */
+
+   double                read_ahead_secs;
+                         /* Requested length of decoded data to keep ahead
+                          * of the fragments.  The feeder thread applies
+                          * changes to it.
+                          */
+   struct _AL_READ_AHEAD *read_ahead;
+                         /* The decoded data kept ahead, if any.  Only
+                          * changed by the feeder thread, with the feeder
+                          * and stream mutexes held.
+                          */
+   ALLEGRO_MUTEX         *feeder_mutex;
+                         /* Held while calling into the feeder.  It is
+                          * taken before the stream mutex, so nobody waits
+                          * for a slow feeder with the mixer locked.
+                          */
 };
 
 bool _al_kcm_refill_stream(ALLEGRO_AUDIO_STREAM *stream);
@@ -282,6 +349,7 @@ struct ALLEGRO_MIXER {
                            /* ALLEGRO_MIXER is derived from ALLEGRO_SAMPLE_INSTANCE. */
 
    ALLEGRO_MIXER_QUALITY   quality;
+   float                   cull_gain;
 
    postprocess_callback_t  postprocess_callback;
    void                    *pp_callback_userdata;
@@ -290,10 +358,17 @@ struct ALLEGRO_MIXER {
                            /* Vector of ALLEGRO_SAMPLE_INSTANCE*.  Holds the list of
                             * streams being mixed together.
                             */
+
+   _AL_VECTOR              sinc_tables;
+                           /* Vector of _AL_SINC_TABLE*, built on demand
+                            * for the steps of sinc resampled attachments.
+                            */
 };
 
 extern void _al_kcm_mixer_rejig_sample_matrix(ALLEGRO_MIXER *mixer,
    ALLEGRO_SAMPLE_INSTANCE *spl);
+extern void _al_kcm_mixer_update_sinc_table(ALLEGRO_SAMPLE_INSTANCE *spl);
+extern void _al_kcm_mixer_free_sinc_tables(ALLEGRO_MIXER *mixer);
 extern void _al_kcm_mixer_read(void *source, void **buf, unsigned int *samples,
    ALLEGRO_AUDIO_DEPTH buffer_depth, size_t dest_maxc);
 
@@ -316,8 +391,8 @@ void _al_kcm_emit_stream_events(ALLEGRO_AUDIO_STREAM *stream);
 
 void _al_kcm_init_destructors(void);
 void _al_kcm_shutdown_destructors(void);
-void _al_kcm_register_destructor(void *object, void (*func)(void*));
-void _al_kcm_unregister_destructor(void *object);
+_AL_LIST_ITEM *_al_kcm_register_destructor(void *object, void (*func)(void*));
+void _al_kcm_unregister_destructor(_AL_LIST_ITEM *dtor_item);
 void _al_kcm_foreach_destructor(
       void (*callback)(void *object, void (*func)(void *), void *udata),
       void *userdata);
@@ -329,6 +404,21 @@ ALLEGRO_KCM_AUDIO_FUNC(ALLEGRO_AUDIO_DEPTH, _al_word_size_to_depth_conf, (int wo
 
 ALLEGRO_KCM_AUDIO_FUNC(void, _al_emit_audio_event, (int event_type));
 
+ALLEGRO_KCM_AUDIO_FUNC(bool, _al_register_sample_loader_flags, (const char *ext,
+   ALLEGRO_SAMPLE *(*loader)(const char *filename, int flags)));
+
+void _al_kcm_init_sample_cache(void);
+void _al_kcm_shutdown_sample_cache(void);
+ALLEGRO_SAMPLE *_al_kcm_create_compressed_sample(void *encoded,
+   size_t encoded_size, ALLEGRO_SAMPLE *(*loader)(ALLEGRO_FILE *fp));
+void _al_kcm_destroy_compressed_sample(ALLEGRO_SAMPLE *spl);
+bool _al_kcm_acquire_sample_data(ALLEGRO_SAMPLE_INSTANCE *spl);
+void _al_kcm_release_sample_data(ALLEGRO_SAMPLE_INSTANCE *spl);
+void _al_kcm_idle_sample_data(ALLEGRO_SAMPLE_INSTANCE *spl);
+
+ALLEGRO_KCM_AUDIO_FUNC(void *, _al_kcm_map_file, (ALLEGRO_FILE *f, size_t *size));
+ALLEGRO_KCM_AUDIO_FUNC(void, _al_kcm_unmap_file, (void *base, size_t size));
+
 
 /*
  * Recording
@@ -340,6 +340,7 @@ bool al_install_audio(void)
     * because the user may still create samples.
     */
    _al_kcm_init_destructors();
+   _al_kcm_init_sample_cache();
    _al_add_exit_func(al_uninstall_audio, "al_uninstall_audio");
 
    ret = do_install_audio(ALLEGRO_AUDIO_DRIVER_AUTODETECT);
@@ -355,12 +356,14 @@ void al_uninstall_audio(void)
 {
    if (_al_kcm_driver) {
       _al_kcm_shutdown_default_mixer();
+      _al_kcm_shutdown_sample_cache();
       _al_kcm_shutdown_destructors();
       _al_kcm_driver->close();
       _al_kcm_driver = NULL;
       al_destroy_user_event_source(&audio_event_source);
    }
    else {
+      _al_kcm_shutdown_sample_cache();
       _al_kcm_shutdown_destructors();
    }
 }
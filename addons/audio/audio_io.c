@@ -18,6 +18,7 @@ struct ACODEC_TABLE
 {
    char              ext[MAX_EXTENSION_LENGTH];
    ALLEGRO_SAMPLE *  (*loader)(const char *filename);
+   ALLEGRO_SAMPLE *  (*flags_loader)(const char *filename, int flags);
    bool              (*saver)(const char *filename, ALLEGRO_SAMPLE *spl);
    ALLEGRO_AUDIO_STREAM *(*stream_loader)(const char *filename,
                         size_t buffer_count, unsigned int samples);
@@ -71,6 +72,7 @@ static ACODEC_TABLE *add_acodec_table_entry(const char *ext)
    ent = _al_vector_alloc_back(&acodec_table);
    strcpy(ent->ext, ext);
    ent->loader = NULL;
+   ent->flags_loader = NULL;
    ent->saver = NULL;
    ent->stream_loader = NULL;
    
@@ -109,6 +111,36 @@ bool al_register_sample_loader(const char *ext,
 }
 
 
+/* _al_register_sample_loader_flags:
+ *  Registers a loader which understands the ALLEGRO_SAMPLE_LOAD_FLAGS passed
+ *  to al_load_sample_flags.  Extensions without one fall back to the plain
+ *  loader, which ignores the flags.
+ */
+bool _al_register_sample_loader_flags(const char *ext,
+   ALLEGRO_SAMPLE *(*loader)(const char *filename, int flags))
+{
+   ACODEC_TABLE *ent;
+
+   if (strlen(ext) + 1 >= MAX_EXTENSION_LENGTH) {
+      return false;
+   }
+
+   ent = find_acodec_table_entry(ext);
+   if (!loader) {
+      if (!ent || !ent->flags_loader) {
+         return false; /* Nothing to remove. */
+      }
+   }
+   else if (!ent) {
+      ent = add_acodec_table_entry(ext);
+   }
+
+   ent->flags_loader = loader;
+
+   return true;
+}
+
+
 /* Function: al_register_sample_loader_f
  */
 bool al_register_sample_loader_f(const char *ext,
@@ -267,6 +299,112 @@ ALLEGRO_SAMPLE *al_load_sample(const char *filename)
 }
 
 
+/* load_compressed_sample:
+ *  Reads the whole file into memory, to be decoded by `loader' when needed.
+ */
+static ALLEGRO_SAMPLE *load_compressed_sample(const char *filename,
+   ALLEGRO_SAMPLE *(*loader)(ALLEGRO_FILE *fp))
+{
+   ALLEGRO_FILE *f;
+   ALLEGRO_SAMPLE *spl;
+   int64_t size;
+   void *encoded;
+
+   f = al_fopen(filename, "rb");
+   if (!f)
+      return NULL;
+
+   size = al_fsize(f);
+   if (size <= 0 || (uint64_t)size > SIZE_MAX) {
+      ALLEGRO_WARN("Cannot tell the size of %s\n", filename);
+      al_fclose(f);
+      return NULL;
+   }
+
+   encoded = al_malloc(size);
+   if (!encoded || al_fread(f, encoded, size) != (size_t)size) {
+      al_free(encoded);
+      al_fclose(f);
+      return NULL;
+   }
+   al_fclose(f);
+
+   spl = _al_kcm_create_compressed_sample(encoded, size, loader);
+   if (!spl)
+      al_free(encoded);
+
+   return spl;
+}
+
+
+/* convert_to_default_mixer:
+ *  Converts a freshly loaded sample to the format of the default mixer, if
+ *  there is one and the formats differ.  The original sample is kept if
+ *  the conversion fails.
+ */
+static ALLEGRO_SAMPLE *convert_to_default_mixer(ALLEGRO_SAMPLE *spl)
+{
+   ALLEGRO_MIXER *mixer = al_get_default_mixer();
+   ALLEGRO_SAMPLE *converted;
+   unsigned int freq;
+   ALLEGRO_AUDIO_DEPTH depth;
+   ALLEGRO_CHANNEL_CONF chan_conf;
+
+   if (!mixer)
+      return spl;
+
+   freq = al_get_mixer_frequency(mixer);
+   depth = al_get_mixer_depth(mixer);
+   chan_conf = al_get_mixer_channels(mixer);
+   if (al_get_sample_frequency(spl) == freq
+         && al_get_sample_depth(spl) == depth
+         && al_get_sample_channels(spl) == chan_conf) {
+      return spl;
+   }
+
+   converted = al_convert_sample(spl, freq, depth, chan_conf);
+   if (!converted) {
+      ALLEGRO_WARN("Could not convert sample to the default mixer format.\n");
+      return spl;
+   }
+
+   al_destroy_sample(spl);
+   return converted;
+}
+
+
+/* Function: al_load_sample_flags
+ */
+ALLEGRO_SAMPLE *al_load_sample_flags(const char *filename, int flags)
+{
+   const char *ext;
+   ACODEC_TABLE *ent;
+   ALLEGRO_SAMPLE *spl = NULL;
+
+   ASSERT(filename);
+   ext = strrchr(filename, '.');
+   if (ext == NULL)
+      return NULL;
+
+   ent = find_acodec_table_entry(ext);
+   if ((flags & ALLEGRO_SAMPLE_COMPRESSED) && ent && ent->fs_loader) {
+      return load_compressed_sample(filename, ent->fs_loader);
+   }
+   if (ent && ent->flags_loader) {
+      spl = (ent->flags_loader)(filename, flags);
+   }
+   else if (ent && ent->loader) {
+      spl = (ent->loader)(filename);
+   }
+
+   if (spl && (flags & ALLEGRO_SAMPLE_CONVERT)) {
+      spl = convert_to_default_mixer(spl);
+   }
+
+   return spl;
+}
+
+
 /* Function: al_load_sample_f
  */
 ALLEGRO_SAMPLE *al_load_sample_f(ALLEGRO_FILE* fp, const char *ident)
@@ -0,0 +1,698 @@
+/*         ______   ___    ___
+ *        /\  _  \ /\_ \  /\_ \
+ *        \ \ \L\ \\//\ \ \//\ \      __     __   _ __   ___
+ *         \ \  __ \ \ \ \  \ \ \   /'__`\ /'_ `\/\`'__\/ __`\
+ *          \ \ \/\ \ \_\ \_ \_\ \_/\  __//\ \L\ \ \ \//\ \L\ \
+ *           \ \_\ \_\/\____\/\____\ \____\ \____ \ \_\\ \____/
+ *            \/_/\/_/\/____/\/____/\/____/\/___L\ \/_/ \/___/
+ *                                           /\____/
+ *                                           \_/__/
+ *
+ *      Compressed samples, and the cache of decoded sample data they
+ *      share.
+ *
+ *      See LICENSE.txt for copyright information.
+ */
+
+
+#include <string.h>
+
+#include "allegro5/allegro.h"
+#include "allegro5/allegro_audio.h"
+#include "allegro5/internal/aintern.h"
+#include "allegro5/internal/aintern_atomicops.h"
+#include "allegro5/internal/aintern_audio.h"
+#include "allegro5/internal/aintern_vector.h"
+
+ALLEGRO_DEBUG_CHANNEL("audio")
+
+
+#define DEFAULT_CACHE_SIZE    (64 * 1024 * 1024)
+
+struct _AL_COMPRESSED_SAMPLE {
+   ALLEGRO_SAMPLE *owner;
+   ALLEGRO_SAMPLE *(*loader)(ALLEGRO_FILE *fp);
+
+   /* The file as loaded, which is kept for the life of the sample. */
+   void *encoded;
+   size_t encoded_size;
+
+   /* The decoded data, or NULL if it is not in the cache. */
+   void *pcm;
+   size_t pcm_size;
+
+   bool decoding;    /* being decoded, with the cache unlocked */
+   bool queued;      /* waiting for the decoder thread */
+   int pins;         /* instances using `pcm'; see _al_kcm_acquire_sample_data */
+   volatile _AL_ATOMIC idle_pins;   /* of those, ones which played to the end */
+
+   /* Cache entries, most recently used first. */
+   _AL_COMPRESSED_SAMPLE *prev;
+   _AL_COMPRESSED_SAMPLE *next;
+};
+
+
+/* Everything below is protected by cache_mutex, which only exists while
+ * the audio addon is installed.  Without it there can be no decoder thread
+ * and the cache is only used by the calling thread.  The only other lock
+ * taken while holding it is that of a sample instance, never the other way
+ * round; the mixer marks pins idle without it.
+ */
+static ALLEGRO_MUTEX *cache_mutex = NULL;
+static ALLEGRO_COND *cache_cond = NULL;
+static size_t cache_limit = DEFAULT_CACHE_SIZE;
+static size_t cache_used = 0;
+static _AL_COMPRESSED_SAMPLE *cache_head = NULL;
+static _AL_COMPRESSED_SAMPLE *cache_tail = NULL;
+
+static ALLEGRO_THREAD *decoder_thread = NULL;
+static _AL_VECTOR decode_queue = _AL_VECTOR_INITIALIZER(_AL_COMPRESSED_SAMPLE *);
+
+
+static void maybe_lock_mutex(ALLEGRO_MUTEX *mutex)
+{
+   if (mutex) {
+      al_lock_mutex(mutex);
+   }
+}
+
+
+static void maybe_unlock_mutex(ALLEGRO_MUTEX *mutex)
+{
+   if (mutex) {
+      al_unlock_mutex(mutex);
+   }
+}
+
+
+
+/*
+ * A read-only ALLEGRO_FILE over the encoded data, for the codec loaders.
+ */
+
+typedef struct MEMORY_FILE {
+   const char *data;
+   int64_t size;
+   int64_t pos;
+   bool eof;
+} MEMORY_FILE;
+
+
+static void memory_fclose(ALLEGRO_FILE *f)
+{
+   (void)f;
+}
+
+
+static size_t memory_fread(ALLEGRO_FILE *f, void *ptr, size_t size)
+{
+   MEMORY_FILE *mf = al_get_file_userdata(f);
+   size_t n = size;
+
+   if (mf->pos >= mf->size) {
+      mf->eof = true;
+      return 0;
+   }
+   if ((int64_t)n > mf->size - mf->pos) {
+      n = mf->size - mf->pos;
+      mf->eof = true;
+   }
+   memcpy(ptr, mf->data + mf->pos, n);
+   mf->pos += n;
+   return n;
+}
+
+
+static size_t memory_fwrite(ALLEGRO_FILE *f, const void *ptr, size_t size)
+{
+   (void)f;
+   (void)ptr;
+   (void)size;
+   return 0;
+}
+
+
+static bool memory_fflush(ALLEGRO_FILE *f)
+{
+   (void)f;
+   return true;
+}
+
+
+static int64_t memory_ftell(ALLEGRO_FILE *f)
+{
+   MEMORY_FILE *mf = al_get_file_userdata(f);
+   return mf->pos;
+}
+
+
+static bool memory_fseek(ALLEGRO_FILE *f, int64_t offset, int whence)
+{
+   MEMORY_FILE *mf = al_get_file_userdata(f);
+   int64_t pos;
+
+   switch (whence) {
+      case ALLEGRO_SEEK_SET: pos = offset; break;
+      case ALLEGRO_SEEK_CUR: pos = mf->pos + offset; break;
+      case ALLEGRO_SEEK_END: pos = mf->size + offset; break;
+      default: return false;
+   }
+   if (pos < 0 || pos > mf->size)
+      return false;
+
+   mf->pos = pos;
+   mf->eof = false;
+   return true;
+}
+
+
+static bool memory_feof(ALLEGRO_FILE *f)
+{
+   MEMORY_FILE *mf = al_get_file_userdata(f);
+   return mf->eof;
+}
+
+
+static bool memory_ferror(ALLEGRO_FILE *f)
+{
+   (void)f;
+   return false;
+}
+
+
+static void memory_fclearerr(ALLEGRO_FILE *f)
+{
+   MEMORY_FILE *mf = al_get_file_userdata(f);
+   mf->eof = false;
+}
+
+
+static off_t memory_fsize(ALLEGRO_FILE *f)
+{
+   MEMORY_FILE *mf = al_get_file_userdata(f);
+   return mf->size;
+}
+
+
+static const ALLEGRO_FILE_INTERFACE memory_vtable =
+{
+   NULL,
+   memory_fclose,
+   memory_fread,
+   memory_fwrite,
+   memory_fflush,
+   memory_ftell,
+   memory_fseek,
+   memory_feof,
+   memory_ferror,
+   memory_fclearerr,
+   NULL,
+   memory_fsize
+};
+
+
+/* decode:
+ *  Runs the codec loader over the encoded data and takes the sample data
+ *  from the result.  Does not touch the cache, so may be called unlocked.
+ */
+static ALLEGRO_SAMPLE *decode(const void *encoded, size_t encoded_size,
+   ALLEGRO_SAMPLE *(*loader)(ALLEGRO_FILE *fp))
+{
+   MEMORY_FILE mf;
+   ALLEGRO_FILE *f;
+   ALLEGRO_SAMPLE *spl;
+
+   mf.data = encoded;
+   mf.size = encoded_size;
+   mf.pos = 0;
+   mf.eof = false;
+
+   f = al_create_file_handle(&memory_vtable, &mf);
+   if (!f)
+      return NULL;
+   spl = loader(f);
+   al_fclose(f);
+
+   if (spl && !spl->free_buf) {
+      /* Not ours to keep. */
+      size_t size = spl->len * al_get_channel_count(spl->chan_conf) *
+         al_get_audio_depth_size(spl->depth);
+      void *copy = al_malloc(size);
+      if (copy)
+         memcpy(copy, spl->buffer.ptr, size);
+      spl->buffer.ptr = copy;
+      spl->free_buf = true;
+      if (!copy) {
+         al_destroy_sample(spl);
+         return NULL;
+      }
+   }
+
+   return spl;
+}
+
+
+/* take_buffer:
+ *  Frees a sample returned by decode, keeping its buffer.  No instance can
+ *  refer to it yet, so there is no need to go through al_destroy_sample.
+ *  Must be called with the cache unlocked, as it takes the destructor lock.
+ */
+static void *take_buffer(ALLEGRO_SAMPLE *spl)
+{
+   void *pcm = spl->buffer.ptr;
+
+   _al_kcm_unregister_destructor(spl->dtor_item);
+   al_free(spl);
+   return pcm;
+}
+
+
+
+/*
+ * The cache proper.
+ */
+
+static void cache_unlink(_AL_COMPRESSED_SAMPLE *cs)
+{
+   if (cs->prev)
+      cs->prev->next = cs->next;
+   else
+      cache_head = cs->next;
+   if (cs->next)
+      cs->next->prev = cs->prev;
+   else
+      cache_tail = cs->prev;
+   cs->prev = cs->next = NULL;
+}
+
+
+static void cache_link_head(_AL_COMPRESSED_SAMPLE *cs)
+{
+   cs->prev = NULL;
+   cs->next = cache_head;
+   if (cache_head)
+      cache_head->prev = cs;
+   else
+      cache_tail = cs;
+   cache_head = cs;
+}
+
+
+static void cache_touch(_AL_COMPRESSED_SAMPLE *cs)
+{
+   ASSERT(cs->pcm);
+
+   if (cache_head != cs) {
+      cache_unlink(cs);
+      cache_link_head(cs);
+   }
+}
+
+
+static void cache_insert(_AL_COMPRESSED_SAMPLE *cs, void *pcm)
+{
+   ASSERT(!cs->pcm);
+
+   cs->pcm = pcm;
+   cs->owner->buffer.ptr = pcm;
+   cache_used += cs->pcm_size;
+   cache_link_head(cs);
+}
+
+
+static void cache_evict(_AL_COMPRESSED_SAMPLE *cs)
+{
+   ASSERT(cs->pcm);
+
+   cache_unlink(cs);
+   cache_used -= cs->pcm_size;
+   al_free(cs->pcm);
+   cs->pcm = NULL;
+   cs->owner->buffer.ptr = NULL;
+}
+
+
+/* trim_cache:
+ *  Evicts the least recently used data until the cache is within its limit.
+ *  Data pinned by an instance is never evicted, unless the instance has
+ *  played to the end, nor is that of `keep'; those may push the cache over.
+ *  Instances only read the data while they hold a pin which is not idle,
+ *  so none need to be told.
+ */
+static void trim_cache(_AL_COMPRESSED_SAMPLE *keep)
+{
+   _AL_COMPRESSED_SAMPLE *cs, *prev;
+
+   for (cs = cache_tail; cs && cache_used > cache_limit; cs = prev) {
+      prev = cs->prev;
+      if (cs != keep && cs->pins == cs->idle_pins)
+         cache_evict(cs);
+   }
+}
+
+
+/* decode_locked:
+ *  Makes sure the decoded data of `cs' is in the cache, decoding it with
+ *  the cache unlocked if need be.  Called and returns with the cache locked.
+ */
+static bool decode_locked(_AL_COMPRESSED_SAMPLE *cs)
+{
+   ALLEGRO_SAMPLE *spl;
+   void *pcm = NULL;
+
+   if (cache_mutex) {
+      while (cs->decoding)
+         al_wait_cond(cache_cond, cache_mutex);
+   }
+   if (cs->pcm)
+      return true;
+
+   cs->decoding = true;
+   maybe_unlock_mutex(cache_mutex);
+   spl = decode(cs->encoded, cs->encoded_size, cs->loader);
+   if (spl) {
+      if (spl->len == cs->owner->len
+         && spl->depth == cs->owner->depth
+         && spl->chan_conf == cs->owner->chan_conf)
+      {
+         pcm = take_buffer(spl);
+      }
+      else {
+         ALLEGRO_ERROR("Compressed sample decoded differently.\n");
+         al_destroy_sample(spl);
+      }
+   }
+   maybe_lock_mutex(cache_mutex);
+   cs->decoding = false;
+
+   if (pcm) {
+      cache_insert(cs, pcm);
+      trim_cache(cs);
+   }
+   if (cache_cond)
+      al_broadcast_cond(cache_cond);
+
+   return cs->pcm != NULL;
+}
+
+
+static void *decoder_thread_proc(ALLEGRO_THREAD *thread, void *arg)
+{
+   _AL_COMPRESSED_SAMPLE **slot;
+   _AL_COMPRESSED_SAMPLE *cs;
+   (void)arg;
+
+   al_lock_mutex(cache_mutex);
+   for (;;) {
+      while (_al_vector_is_empty(&decode_queue)
+         && !al_get_thread_should_stop(thread))
+      {
+         al_wait_cond(cache_cond, cache_mutex);
+      }
+      if (al_get_thread_should_stop(thread))
+         break;
+
+      slot = _al_vector_ref_front(&decode_queue);
+      cs = *slot;
+      _al_vector_delete_at(&decode_queue, 0);
+      cs->queued = false;
+      decode_locked(cs);
+   }
+   al_unlock_mutex(cache_mutex);
+
+   return NULL;
+}
+
+
+/* _al_kcm_init_sample_cache:
+ *  Creates the lock for the sample cache.  Called by al_install_audio.
+ */
+void _al_kcm_init_sample_cache(void)
+{
+   if (!cache_mutex) {
+      cache_mutex = al_create_mutex();
+      cache_cond = al_create_cond();
+   }
+}
+
+
+/* _al_kcm_shutdown_sample_cache:
+ *  Stops the decoder thread and destroys the lock.  Compressed samples
+ *  may outlive this; they are then only used from one thread.
+ */
+void _al_kcm_shutdown_sample_cache(void)
+{
+   if (decoder_thread) {
+      al_lock_mutex(cache_mutex);
+      al_set_thread_should_stop(decoder_thread);
+      al_broadcast_cond(cache_cond);
+      al_unlock_mutex(cache_mutex);
+      al_destroy_thread(decoder_thread);
+      decoder_thread = NULL;
+   }
+
+   while (!_al_vector_is_empty(&decode_queue)) {
+      _AL_COMPRESSED_SAMPLE **slot = _al_vector_ref_front(&decode_queue);
+      (*slot)->queued = false;
+      _al_vector_delete_at(&decode_queue, 0);
+   }
+   _al_vector_free(&decode_queue);
+
+   if (cache_mutex) {
+      al_destroy_cond(cache_cond);
+      al_destroy_mutex(cache_mutex);
+      cache_cond = NULL;
+      cache_mutex = NULL;
+   }
+}
+
+
+/* _al_kcm_create_compressed_sample:
+ *  Creates a sample from the contents of a file which `loader' can decode.
+ *  The file is decoded once to find out its format; the sample then takes
+ *  ownership of `encoded'.  Returns NULL on failure, leaving `encoded' to
+ *  the caller.
+ */
+ALLEGRO_SAMPLE *_al_kcm_create_compressed_sample(void *encoded,
+   size_t encoded_size, ALLEGRO_SAMPLE *(*loader)(ALLEGRO_FILE *fp))
+{
+   _AL_COMPRESSED_SAMPLE *cs;
+   ALLEGRO_SAMPLE *decoded;
+   ALLEGRO_SAMPLE *spl;
+   void *pcm;
+   ASSERT(encoded);
+   ASSERT(loader);
+
+   decoded = decode(encoded, encoded_size, loader);
+   if (!decoded)
+      return NULL;
+
+   cs = al_calloc(1, sizeof(*cs));
+   if (!cs) {
+      al_destroy_sample(decoded);
+      return NULL;
+   }
+
+   spl = al_create_sample(decoded->buffer.ptr, decoded->len,
+      decoded->frequency, decoded->depth, decoded->chan_conf, false);
+   if (!spl) {
+      al_free(cs);
+      al_destroy_sample(decoded);
+      return NULL;
+   }
+
+   cs->owner = spl;
+   cs->loader = loader;
+   cs->encoded = encoded;
+   cs->encoded_size = encoded_size;
+   cs->pcm_size = spl->len * al_get_channel_count(spl->chan_conf) *
+      al_get_audio_depth_size(spl->depth);
+   spl->compressed = cs;
+   spl->buffer.ptr = NULL;
+   pcm = take_buffer(decoded);
+
+   maybe_lock_mutex(cache_mutex);
+   cache_insert(cs, pcm);
+   trim_cache(cs);
+   maybe_unlock_mutex(cache_mutex);
+
+   return spl;
+}
+
+
+/* _al_kcm_destroy_compressed_sample:
+ *  Frees everything belonging to a compressed sample, except the
+ *  ALLEGRO_SAMPLE itself.
+ */
+void _al_kcm_destroy_compressed_sample(ALLEGRO_SAMPLE *spl)
+{
+   _AL_COMPRESSED_SAMPLE *cs = spl->compressed;
+   ASSERT(cs);
+
+   maybe_lock_mutex(cache_mutex);
+   if (cache_mutex) {
+      while (cs->decoding)
+         al_wait_cond(cache_cond, cache_mutex);
+   }
+   if (cs->queued)
+      _al_vector_find_and_delete(&decode_queue, &cs);
+   if (cs->pcm)
+      cache_evict(cs);
+   maybe_unlock_mutex(cache_mutex);
+
+   al_free(cs->encoded);
+   al_free(cs);
+   spl->compressed = NULL;
+   spl->buffer.ptr = NULL;
+}
+
+
+/* unidle_pin:
+ *  Makes the pin of `data' keep the decoded data in the cache again.
+ *  Called with the cache and the instance locked.
+ */
+static void unidle_pin(ALLEGRO_SAMPLE *data)
+{
+   if (data->pin_idle) {
+      data->pin_idle = false;
+      _al_sub1_and_fetch(&data->compressed->idle_pins);
+   }
+}
+
+
+/* _al_kcm_acquire_sample_data:
+ *  Points the buffer of the copy held by the instance `spl' at the decoded
+ *  data of its compressed sample, decoding it if it is not in the cache.
+ *  Unless it already has one, the instance takes a pin which keeps the data
+ *  from being evicted until _al_kcm_release_sample_data, or until the mixer
+ *  plays it to the end.  Returns false if decoding fails.
+ */
+bool _al_kcm_acquire_sample_data(ALLEGRO_SAMPLE_INSTANCE *spl)
+{
+   ALLEGRO_SAMPLE *data = &spl->spl_data;
+   _AL_COMPRESSED_SAMPLE *cs = data->compressed;
+   bool ret;
+   ASSERT(cs);
+
+   maybe_lock_mutex(cache_mutex);
+   ret = decode_locked(cs);
+   if (ret) {
+      cache_touch(cs);
+      maybe_lock_mutex(spl->mutex);
+      unidle_pin(data);
+      if (!data->pinned) {
+         cs->pins++;
+         data->pinned = true;
+      }
+      data->buffer.ptr = cs->pcm;
+      maybe_unlock_mutex(spl->mutex);
+   }
+   maybe_unlock_mutex(cache_mutex);
+
+   return ret;
+}
+
+
+/* _al_kcm_release_sample_data:
+ *  Drops the pin taken by _al_kcm_acquire_sample_data, once neither a mixer
+ *  nor a voice reads the buffer of the instance `spl' any more.  The data
+ *  stays in the cache until it is evicted.
+ */
+void _al_kcm_release_sample_data(ALLEGRO_SAMPLE_INSTANCE *spl)
+{
+   ALLEGRO_SAMPLE *data = &spl->spl_data;
+   _AL_COMPRESSED_SAMPLE *cs = data->compressed;
+
+   if (!cs || !data->pinned)
+      return;
+
+   maybe_lock_mutex(cache_mutex);
+   maybe_lock_mutex(spl->mutex);
+   ASSERT(cs->pins > 0);
+   unidle_pin(data);
+   cs->pins--;
+   data->pinned = false;
+   data->buffer.ptr = NULL;
+   maybe_unlock_mutex(spl->mutex);
+   trim_cache(NULL);
+   maybe_unlock_mutex(cache_mutex);
+}
+
+
+/* _al_kcm_idle_sample_data:
+ *  Called by the mixer, with the instance `spl' locked, when it stops at
+ *  the end of its data.  Its pin no longer keeps the data from being
+ *  evicted, so that instances left stopped do not hold on to it; starting
+ *  the instance again acquires the data again.  This does not take the
+ *  cache lock, so the mixer never waits for the cache.
+ */
+void _al_kcm_idle_sample_data(ALLEGRO_SAMPLE_INSTANCE *spl)
+{
+   ALLEGRO_SAMPLE *data = &spl->spl_data;
+
+   if (data->compressed && data->pinned && !data->pin_idle) {
+      data->pin_idle = true;
+      _al_fetch_and_add1(&data->compressed->idle_pins);
+   }
+}
+
+
+/* Function: al_predecode_sample
+ */
+bool al_predecode_sample(ALLEGRO_SAMPLE *spl)
+{
+   _AL_COMPRESSED_SAMPLE *cs;
+   ASSERT(spl);
+
+   cs = spl->compressed;
+   if (!cs)
+      return true;
+
+   if (!cache_mutex) {
+      /* No decoder thread without the audio addon; decode it now. */
+      return decode_locked(cs);
+   }
+
+   al_lock_mutex(cache_mutex);
+   if (cs->pcm) {
+      cache_touch(cs);
+   }
+   else if (!cs->queued && !cs->decoding) {
+      if (!decoder_thread) {
+         decoder_thread = al_create_thread(decoder_thread_proc, NULL);
+         if (!decoder_thread) {
+            al_unlock_mutex(cache_mutex);
+            return false;
+         }
+         al_start_thread(decoder_thread);
+      }
+      *(_AL_COMPRESSED_SAMPLE **)_al_vector_alloc_back(&decode_queue) = cs;
+      cs->queued = true;
+      al_broadcast_cond(cache_cond);
+   }
+   al_unlock_mutex(cache_mutex);
+
+   return true;
+}
+
+
+/* Function: al_set_sample_cache_size
+ */
+void al_set_sample_cache_size(size_t size)
+{
+   maybe_lock_mutex(cache_mutex);
+   cache_limit = size;
+   trim_cache(NULL);
+   maybe_unlock_mutex(cache_mutex);
+}
+
+
+/* Function: al_get_sample_cache_size
+ */
+size_t al_get_sample_cache_size(void)
+{
+   return cache_limit;
+}
+
+
+/* vim: set sts=3 sw=3 et: */
@@ -14,6 +14,7 @@
 #include "allegro5/allegro_audio.h"
 #include "allegro5/internal/aintern_audio.h"
 #include "allegro5/internal/aintern_audio_cfg.h"
+#include "allegro5/internal/aintern_memory.h"
 
 
 static void maybe_lock_mutex(ALLEGRO_MUTEX *mutex)
@@ -84,6 +85,7 @@ static void stream_free(ALLEGRO_SAMPLE_INSTANCE *spl)
          }
 
          _al_vector_free(&mixer->streams);
+         _al_kcm_mixer_free_sinc_tables(mixer);
 
          if (spl->spl_data.buffer.ptr) {
             ASSERT(spl->spl_data.free_buf);
@@ -95,7 +97,8 @@ static void stream_free(ALLEGRO_SAMPLE_INSTANCE *spl)
 
       ASSERT(! spl->spl_data.free_buf);
 
-      al_free(spl);
+      _al_tagged_free(ALLEGRO_MEMORY_TAG_AUDIO, spl,
+         spl->is_mixer ? sizeof(ALLEGRO_MIXER) : sizeof(*spl));
    }
 }
 
@@ -113,6 +116,7 @@ void _al_kcm_detach_from_parent(ALLEGRO_SAMPLE_INSTANCE *spl)
       return;
 
    if (spl->parent.is_voice) {
+      /* This releases the sample data. */
       al_detach_voice(spl->parent.u.voice);
       return;
    }
@@ -138,6 +142,8 @@ void _al_kcm_detach_from_parent(ALLEGRO_SAMPLE_INSTANCE *spl)
       }
    }
 
+   _al_kcm_release_sample_data(spl);
+
    al_free(spl->matrix);
    spl->matrix = NULL;
 }
@@ -149,7 +155,7 @@ ALLEGRO_SAMPLE_INSTANCE *al_create_sample_instance(ALLEGRO_SAMPLE *sample_data)
 {
    ALLEGRO_SAMPLE_INSTANCE *spl;
 
-   spl = al_calloc(1, sizeof(*spl));
+   spl = _al_tagged_calloc(ALLEGRO_MEMORY_TAG_AUDIO, sizeof(*spl));
    if (!spl) {
       _al_set_error(ALLEGRO_GENERIC_ERROR,
          "Out of memory allocating sample object");
@@ -158,6 +164,8 @@ ALLEGRO_SAMPLE_INSTANCE *al_create_sample_instance(ALLEGRO_SAMPLE *sample_data)
 
    if (sample_data) {
       spl->spl_data = *sample_data;
+      if (spl->spl_data.compressed)
+         spl->spl_data.buffer.ptr = NULL;
    }
    spl->spl_data.free_buf = false;
 
@@ -178,7 +186,8 @@ ALLEGRO_SAMPLE_INSTANCE *al_create_sample_instance(ALLEGRO_SAMPLE *sample_data)
    spl->mutex = NULL;
    spl->parent.u.ptr = NULL;
 
-   _al_kcm_register_destructor(spl, (void (*)(void *)) al_destroy_sample_instance);
+   spl->dtor_item = _al_kcm_register_destructor(spl,
+      (void (*)(void *)) al_destroy_sample_instance);
 
    return spl;
 }
@@ -199,7 +208,7 @@ void _al_kcm_destroy_sample(ALLEGRO_SAMPLE_INSTANCE *spl, bool unregister)
 {
    if (spl) {
       if (unregister) {
-         _al_kcm_unregister_destructor(spl);
+         _al_kcm_unregister_destructor(spl->dtor_item);
       }
 
       _al_kcm_detach_from_parent(spl);
@@ -435,6 +444,8 @@ bool al_set_sample_instance_speed(ALLEGRO_SAMPLE_INSTANCE *spl, float val)
       }
 
       maybe_unlock_mutex(spl->mutex);
+
+      _al_kcm_mixer_update_sinc_table(spl);
    }
 
    return true;
@@ -546,6 +557,12 @@ bool al_set_sample_instance_playing(ALLEGRO_SAMPLE_INSTANCE *spl, bool val)
       _al_set_error(ALLEGRO_INVALID_OBJECT, "Sample has no parent");
       return false;
    }
+   if (val && spl->spl_data.compressed && !spl->parent.is_voice) {
+      if (!_al_kcm_acquire_sample_data(spl)) {
+         _al_set_error(ALLEGRO_GENERIC_ERROR, "Failed to decode sample");
+         return false;
+      }
+   }
    if (!spl->spl_data.buffer.ptr) {
       _al_set_error(ALLEGRO_INVALID_OBJECT, "Sample has no data");
       return false;
@@ -560,10 +577,26 @@ bool al_set_sample_instance_playing(ALLEGRO_SAMPLE_INSTANCE *spl, bool val)
 
    /* parent is mixer */
    maybe_lock_mutex(spl->mutex);
+   /* The mixer may have played it to the end since its data was acquired,
+    * which lets the data be evicted.  That cannot happen again while it is
+    * stopped.
+    */
+   while (val && spl->spl_data.pin_idle) {
+      maybe_unlock_mutex(spl->mutex);
+      if (!_al_kcm_acquire_sample_data(spl)) {
+         _al_set_error(ALLEGRO_GENERIC_ERROR, "Failed to decode sample");
+         return false;
+      }
+      maybe_lock_mutex(spl->mutex);
+   }
    spl->is_playing = val;
    if (!val)
       spl->pos = 0;
    maybe_unlock_mutex(spl->mutex);
+
+   /* The mixer no longer reads the data. */
+   if (!val)
+      _al_kcm_release_sample_data(spl);
    return true;
 }
 
@@ -602,6 +635,7 @@ bool al_set_sample(ALLEGRO_SAMPLE_INSTANCE *spl, ALLEGRO_SAMPLE *data)
       if (spl->parent.u.ptr) {
          _al_kcm_detach_from_parent(spl);
       }
+      _al_kcm_release_sample_data(spl);
       spl->spl_data.buffer.ptr = NULL;
       return true;
    }
@@ -610,7 +644,9 @@ bool al_set_sample(ALLEGRO_SAMPLE_INSTANCE *spl, ALLEGRO_SAMPLE *data)
 
    need_reattach = false;
    if (spl->parent.u.ptr != NULL) {
-      if (spl->spl_data.frequency != data->frequency ||
+      /* A voice has the old buffer loaded, which may be released below. */
+      if (spl->parent.is_voice ||
+            spl->spl_data.frequency != data->frequency ||
             spl->spl_data.depth != data->depth ||
             spl->spl_data.chan_conf != data->chan_conf) {
          old_parent = spl->parent;
@@ -619,8 +655,11 @@ bool al_set_sample(ALLEGRO_SAMPLE_INSTANCE *spl, ALLEGRO_SAMPLE *data)
       }
    }
 
+   _al_kcm_release_sample_data(spl);
    spl->spl_data = *data;
    spl->spl_data.free_buf = false;
+   if (spl->spl_data.compressed)
+      spl->spl_data.buffer.ptr = NULL;
    spl->pos = 0;
    spl->loop_start = 0;
    spl->loop_end = data->len;
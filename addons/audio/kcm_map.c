@@ -0,0 +1,129 @@
+/*         ______   ___    ___
+ *        /\  _  \ /\_ \  /\_ \
+ *        \ \ \L\ \\//\ \ \//\ \      __     __   _ __   ___
+ *         \ \  __ \ \ \ \  \ \ \   /'__`\ /'_ `\/\`'__\/ __`\
+ *          \ \ \/\ \ \_\ \_ \_\ \_/\  __//\ \L\ \ \ \//\ \L\ \
+ *           \ \_\ \_\/\____\/\____\ \____\ \____ \ \_\\ \____/
+ *            \/_/\/_/\/____/\/____/\/____/\/___L\ \/_/ \/___/
+ *                                           /\____/
+ *                                           \_/__/
+ *
+ *      Mapping sample files into memory.
+ *
+ *      See LICENSE.txt for copyright information.
+ */
+
+
+#include <stdio.h>
+
+#include "allegro5/allegro.h"
+#include "allegro5/allegro_audio.h"
+#include "allegro5/internal/aintern.h"
+#include "allegro5/internal/aintern_audio.h"
+#include "allegro5/internal/aintern_file.h"
+
+#if defined(ALLEGRO_WINDOWS)
+   #include <io.h>
+   #include <windows.h>
+#elif defined(ALLEGRO_UNIX) || defined(ALLEGRO_MACOSX)
+   #include <sys/mman.h>
+   #include <sys/stat.h>
+   #define KCM_HAVE_MMAP
+#endif
+
+ALLEGRO_DEBUG_CHANNEL("audio")
+
+
+/* _al_kcm_map_file:
+ *  Maps the whole of the file behind `f' into memory, copy-on-write, and
+ *  returns the base address, storing the length of the mapping in `size'.
+ *  Only files opened through the standard stdio interface can be mapped;
+ *  for anything else, or if the mapping fails, NULL is returned and the
+ *  caller should read the file instead.
+ */
+void *_al_kcm_map_file(ALLEGRO_FILE *f, size_t *size)
+{
+   FILE *fp;
+   ASSERT(f);
+   ASSERT(size);
+
+   if (f->vtable != &_al_file_interface_stdio)
+      return NULL;
+   fp = al_get_file_userdata(f);
+
+#if defined(ALLEGRO_WINDOWS)
+   {
+      HANDLE file, mapping;
+      LARGE_INTEGER length;
+      void *base;
+
+      file = (HANDLE)_get_osfhandle(_fileno(fp));
+      if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &length))
+         return NULL;
+      if (length.QuadPart <= 0 || (uint64_t)length.QuadPart > SIZE_MAX)
+         return NULL;
+
+      mapping = CreateFileMapping(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+      if (!mapping) {
+         ALLEGRO_WARN("CreateFileMapping failed.\n");
+         return NULL;
+      }
+      base = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+      /* The view keeps the mapping object alive. */
+      CloseHandle(mapping);
+      if (!base) {
+         ALLEGRO_WARN("MapViewOfFile failed.\n");
+         return NULL;
+      }
+
+      *size = (size_t)length.QuadPart;
+      return base;
+   }
+#elif defined(KCM_HAVE_MMAP)
+   {
+      struct stat st;
+      void *base;
+      int fd = fileno(fp);
+
+      if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+         return NULL;
+      if (st.st_size <= 0 || (uint64_t)st.st_size > SIZE_MAX)
+         return NULL;
+
+      base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+         fd, 0);
+      if (base == MAP_FAILED) {
+         ALLEGRO_WARN("mmap failed.\n");
+         return NULL;
+      }
+
+      *size = st.st_size;
+      return base;
+   }
+#else
+   (void)fp;
+   return NULL;
+#endif
+}
+
+
+/* _al_kcm_unmap_file:
+ *  Releases a mapping made by _al_kcm_map_file.
+ */
+void _al_kcm_unmap_file(void *base, size_t size)
+{
+   ASSERT(base);
+
+#if defined(ALLEGRO_WINDOWS)
+   (void)size;
+   UnmapViewOfFile(base);
+#elif defined(KCM_HAVE_MMAP)
+   munmap(base, size);
+#else
+   (void)base;
+   (void)size;
+#endif
+}
+
+
+/* vim: set sts=3 sw=3 et: */
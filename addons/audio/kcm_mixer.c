@@ -15,6 +15,8 @@
 #include "allegro5/internal/aintern.h"
 #include "allegro5/internal/aintern_audio.h"
 #include "allegro5/internal/aintern_audio_cfg.h"
+#include "allegro5/internal/aintern_memory.h"
+#include "allegro5/internal/aintern_profile.h"
 
 ALLEGRO_DEBUG_CHANNEL("audio")
 
@@ -156,10 +158,14 @@ void _al_kcm_mixer_rejig_sample_matrix(ALLEGRO_MIXER *mixer,
    src_chans = al_get_channel_count(spl->spl_data.chan_conf);
 
    spl->matrix = al_calloc(1, src_chans * dst_chans * sizeof(float));
+   spl->matrix_peak = 0.0f;
 
    for (i = 0; i < dst_chans; i++) {
       for (j = 0; j < src_chans; j++) {
-         spl->matrix[i*src_chans + j] = mat[i*ALLEGRO_MAX_CHANNELS + j];
+         float m = mat[i*ALLEGRO_MAX_CHANNELS + j];
+         spl->matrix[i*src_chans + j] = m;
+         if (fabs(m) > spl->matrix_peak)
+            spl->matrix_peak = fabs(m);
       }
    }
 }
@@ -219,6 +225,7 @@ static bool fix_looped_position(ALLEGRO_SAMPLE_INSTANCE *spl)
          }
          spl->pos = 0;
          spl->is_playing = false;
+         _al_kcm_idle_sample_data(spl);
          return false;
 
       case _ALLEGRO_PLAYMODE_STREAM_ONCE:
@@ -245,6 +252,63 @@ static bool fix_looped_position(ALLEGRO_SAMPLE_INSTANCE *spl)
 #include "kcm_mixer_helpers.inc"
 
 
+/* skip_sample_instance:
+ *  Advances a sample instance as if it had been mixed for `samples' sample
+ *  values, without reading its data.  Used for instances too quiet to hear.
+ *  The position ends up exactly where mixing would have left it.
+ */
+static void skip_sample_instance(ALLEGRO_SAMPLE_INSTANCE *spl,
+   unsigned int samples)
+{
+   int64_t samples_l = samples;
+   int delta, delta_error;
+
+   if (!spl->is_playing)
+      return;
+
+   while (samples_l > 0) {
+      int64_t n, err;
+
+      if (!fix_looped_position(spl))
+         return;
+
+      delta = spl->step > 0 ? spl->step : spl->step - spl->step_denom + 1;
+      delta /= spl->step_denom;
+      delta_error = spl->step - delta * spl->step_denom;
+
+      /* Step up to the sample value which crosses the next loop point,
+       * which is where the mixer would next have to fix the position.
+       */
+      if (spl->step > 0) {
+         int end = (spl->loop == ALLEGRO_PLAYMODE_ONCE)
+            ? spl->spl_data.len : spl->loop_end;
+         int64_t x = (int64_t)(end - spl->pos) * spl->step_denom
+            - spl->pos_bresenham_error;
+         n = (x + spl->step - 1) / spl->step;
+      }
+      else {
+         int64_t y = (int64_t)(spl->pos - spl->loop_start) * spl->step_denom
+            + spl->pos_bresenham_error;
+         n = y / -spl->step + 1;
+      }
+      if (n < 1)
+         n = 1;
+      if (n > samples_l)
+         n = samples_l;
+
+      /* This is what n iterations of the Bresenham loop in MAKE_MIXER
+       * would do.
+       */
+      err = spl->pos_bresenham_error + (int64_t)delta_error * n;
+      spl->pos += delta * n + err / spl->step_denom;
+      spl->pos_bresenham_error = err % spl->step_denom;
+
+      samples_l -= n;
+   }
+   fix_looped_position(spl);
+}
+
+
 static INLINE int32_t clamp(int32_t val, int32_t min, int32_t max)
 {
    /* Clamp to min */
@@ -261,11 +325,401 @@ static INLINE int32_t clamp(int32_t val, int32_t min, int32_t max)
 }
 
 
+/* Windowed sinc interpolation.
+ *
+ * The filter has SINC_TAPS taps and is centred on the fractional position
+ * between the sample values at pos and pos + 1.  Coefficients for arbitrary
+ * positions are interpolated from sinc_table, which holds SINC_PHASES + 1
+ * evenly spaced phases of the filter.  When the step is a fraction with a
+ * small denominator the position only ever takes a few distinct phases, so
+ * an exact table is built for that step instead, whenever the step is set
+ * (see _al_kcm_mixer_update_sinc_table).
+ *
+ * The loops over the taps work on fixed size arrays so that the compiler
+ * can vectorise them.
+ */
+#define SINC_TAPS             16
+#define SINC_PHASES           256
+#define SINC_CUTOFF           0.88
+#define SINC_BETA             6.0
+#define SINC_MAX_EXACT_PHASES 512
+#define SINC_MAX_TABLES       16
+
+#include "kcm_sinc_table.inc"
+
+struct _AL_SINC_TABLE {
+   int step;            /* absolute value; the sign does not matter */
+   int step_denom;
+   int gcd;
+   int phases;
+   float *coeff;
+};
+
+
+static double bessel_i0(double x)
+{
+   double sum = 1.0;
+   double term = 1.0;
+   int k;
+
+   for (k = 1; term > 1e-12 * sum; k++) {
+      term *= (x / (2.0 * k)) * (x / (2.0 * k));
+      sum += term;
+   }
+   return sum;
+}
+
+
+/* This must agree with misc/make_sinc_table.py. */
+static double sinc_kernel(double x, double cutoff)
+{
+   const double r = x / (SINC_TAPS / 2);
+   double y, s, w;
+
+   if (fabs(r) >= 1.0)
+      return 0.0;
+
+   w = bessel_i0(SINC_BETA * sqrt(1.0 - r * r)) / bessel_i0(SINC_BETA);
+   y = cutoff * x;
+   s = (y == 0.0) ? 1.0 : sin(ALLEGRO_PI * y) / (ALLEGRO_PI * y);
+   return cutoff * s * w;
+}
+
+
+static int gcd(int a, int b)
+{
+   while (b != 0) {
+      int t = a % b;
+      a = b;
+      b = t;
+   }
+   return a;
+}
+
+
+/* create_sinc_table:
+ *  Builds the exact coefficient table for a step, or returns NULL if the
+ *  step would need too many phases.
+ */
+static struct _AL_SINC_TABLE *create_sinc_table(int abs_step, int step_denom)
+{
+   struct _AL_SINC_TABLE *table;
+   const int g = gcd(abs_step, step_denom);
+   const int phases = step_denom / g;
+   double cutoff = SINC_CUTOFF;
+   int j, k;
+
+   if (phases > SINC_MAX_EXACT_PHASES)
+      return NULL;
+
+   table = al_malloc(sizeof(*table) + phases * SINC_TAPS * sizeof(float));
+   if (!table)
+      return NULL;
+   table->step = abs_step;
+   table->step_denom = step_denom;
+   table->gcd = g;
+   table->phases = phases;
+   table->coeff = (float *)(table + 1);
+
+   /* Lower the cutoff below the mixer's Nyquist frequency when reading the
+    * sample faster than the mixer frequency.
+    */
+   if (abs_step > step_denom)
+      cutoff *= (double)step_denom / abs_step;
+
+   for (j = 0; j < phases; j++) {
+      const double t = (double)j / phases;
+      double c[SINC_TAPS];
+      double sum = 0.0;
+
+      for (k = 0; k < SINC_TAPS; k++) {
+         c[k] = sinc_kernel((k - (SINC_TAPS / 2 - 1)) - t, cutoff);
+         sum += c[k];
+      }
+      for (k = 0; k < SINC_TAPS; k++) {
+         table->coeff[j * SINC_TAPS + k] = c[k] / sum;
+      }
+   }
+
+   return table;
+}
+
+
+/* find_sinc_table:
+ *  Returns the mixer's exact coefficient table for a step, or NULL.
+ *  This is called with the mixer locked.
+ */
+static struct _AL_SINC_TABLE *find_sinc_table(const ALLEGRO_MIXER *mixer,
+   int abs_step, int step_denom)
+{
+   unsigned int i;
+
+   for (i = 0; i < _al_vector_size(&mixer->sinc_tables); i++) {
+      struct _AL_SINC_TABLE **slot = _al_vector_ref(&mixer->sinc_tables, i);
+      if ((*slot)->step == abs_step && (*slot)->step_denom == step_denom)
+         return *slot;
+   }
+   return NULL;
+}
+
+
+/* _al_kcm_mixer_update_sinc_table:
+ *  Points the sinc_table of a sample instance attached to a mixer at the
+ *  exact coefficient table for its current step, building the table if
+ *  needed.  Tables are shared between all the attachments of the mixer.
+ *  This is called after the step is set, with the mixer unlocked, so that
+ *  the mixer thread never has to build tables itself.
+ */
+void _al_kcm_mixer_update_sinc_table(ALLEGRO_SAMPLE_INSTANCE *spl)
+{
+   ALLEGRO_MIXER *mixer = spl->parent.u.mixer;
+   struct _AL_SINC_TABLE *table;
+   struct _AL_SINC_TABLE *new_table = NULL;
+   struct _AL_SINC_TABLE **slot;
+   bool full;
+   int abs_step;
+   int step_denom;
+
+   ASSERT(mixer);
+   ASSERT(!spl->parent.is_voice);
+
+   if (mixer->quality != ALLEGRO_MIXER_QUALITY_SINC || spl->is_mixer)
+      return;
+
+   maybe_lock_mutex(spl->mutex);
+   abs_step = spl->step < 0 ? -spl->step : spl->step;
+   step_denom = spl->step_denom;
+   table = find_sinc_table(mixer, abs_step, step_denom);
+   full = _al_vector_size(&mixer->sinc_tables) >= SINC_MAX_TABLES;
+   maybe_unlock_mutex(spl->mutex);
+
+   /* Evaluating the kernel takes a while, so do it unlocked. */
+   if (!table && !full)
+      new_table = create_sinc_table(abs_step, step_denom);
+
+   maybe_lock_mutex(spl->mutex);
+   if (new_table) {
+      /* Another thread may have added it in the meantime. */
+      table = find_sinc_table(mixer, abs_step, step_denom);
+      if (!table
+            && _al_vector_size(&mixer->sinc_tables) < SINC_MAX_TABLES
+            && (slot = _al_vector_alloc_back(&mixer->sinc_tables))) {
+         *slot = new_table;
+         table = new_table;
+         new_table = NULL;
+      }
+   }
+   spl->sinc_table = table;
+   maybe_unlock_mutex(spl->mutex);
+
+   al_free(new_table);
+}
+
+
+/* _al_kcm_mixer_free_sinc_tables:
+ *  Frees the exact coefficient tables built for the mixer's attachments.
+ */
+void _al_kcm_mixer_free_sinc_tables(ALLEGRO_MIXER *mixer)
+{
+   unsigned int i;
+
+   for (i = 0; i < _al_vector_size(&mixer->sinc_tables); i++) {
+      struct _AL_SINC_TABLE **slot = _al_vector_ref(&mixer->sinc_tables, i);
+      al_free(*slot);
+   }
+   _al_vector_free(&mixer->sinc_tables);
+}
+
+
+/* sinc_coefficients:
+ *  Returns the filter coefficients for the current fractional position,
+ *  using `tmp' as storage if they have to be interpolated.
+ */
+static INLINE const float *sinc_coefficients(
+   const ALLEGRO_SAMPLE_INSTANCE *spl, float tmp[SINC_TAPS])
+{
+   const struct _AL_SINC_TABLE *table = spl->sinc_table;
+   const int error = spl->pos_bresenham_error;
+   const float *c0, *c1;
+   float ft, f;
+   int p, k;
+
+   /* The table is only replaced after the step is set, so check that it
+    * is still the right one.
+    */
+   if (table
+         && table->step == (spl->step < 0 ? -spl->step : spl->step)
+         && table->step_denom == spl->step_denom
+         && error % table->gcd == 0) {
+      return table->coeff + (error / table->gcd) * SINC_TAPS;
+   }
+
+   ft = (float)error / spl->step_denom * SINC_PHASES;
+   p = (int)ft;
+   if (p >= SINC_PHASES)
+      p = SINC_PHASES - 1;
+   f = ft - p;
+   c0 = sinc_table[p];
+   c1 = sinc_table[p + 1];
+   for (k = 0; k < SINC_TAPS; k++) {
+      tmp[k] = c0[k] + f * (c1[k] - c0[k]);
+   }
+   return tmp;
+}
+
+
+#define SINC_GATHER(EXPR)                                                     \
+   do {                                                                       \
+      for (k = 0; k < SINC_TAPS; k++) {                                       \
+         for (c = 0; c < maxc; c++) {                                         \
+            const int j = idx[k] + c;                                         \
+            x[c][k] = mask[k] * (EXPR);                                       \
+         }                                                                    \
+      }                                                                       \
+   } while (0)
+
+/* sinc_gather:
+ *  Reads the sample values under the filter into `x' as floats, one row per
+ *  channel.  Values past the end of a sample played once are silent, and
+ *  looping samples wrap around.  Audio streams lag by SINC_TAPS / 2 sample
+ *  values so that the filter only covers values already read, which are
+ *  kept in front of each buffer fragment.
+ */
+static INLINE void sinc_gather(const ALLEGRO_SAMPLE_INSTANCE *spl,
+   unsigned int maxc, float x[ALLEGRO_MAX_CHANNELS][SINC_TAPS])
+{
+   int idx[SINC_TAPS];
+   float mask[SINC_TAPS];
+   int first = spl->pos - (SINC_TAPS / 2 - 1);
+   int lo, hi, k;
+   unsigned int c;
+   bool wrap = false;
+
+   switch (spl->loop) {
+      case ALLEGRO_PLAYMODE_ONCE:
+         lo = 0;
+         hi = spl->spl_data.len;
+         break;
+      case ALLEGRO_PLAYMODE_LOOP:
+      case ALLEGRO_PLAYMODE_BIDIR:
+         lo = spl->loop_start;
+         hi = spl->loop_end;
+         wrap = (hi > lo);
+         break;
+      default:
+         first -= SINC_TAPS / 2;
+         lo = first;
+         hi = first + SINC_TAPS;
+         break;
+   }
+
+   for (k = 0; k < SINC_TAPS; k++) {
+      int i = first + k;
+      mask[k] = 1.0f;
+      if (i < lo || i >= hi) {
+         if (wrap) {
+            i = lo + (i - lo) % (hi - lo);
+            if (i < lo)
+               i += hi - lo;
+         }
+         else {
+            i = spl->pos;
+            mask[k] = 0.0f;
+         }
+      }
+      idx[k] = i * (int)maxc;
+   }
+
+   switch (spl->spl_data.depth) {
+      case ALLEGRO_AUDIO_DEPTH_FLOAT32:
+         SINC_GATHER(spl->spl_data.buffer.f32[j]);
+         break;
+      case ALLEGRO_AUDIO_DEPTH_INT24:
+         SINC_GATHER((float) spl->spl_data.buffer.s24[j]
+            / ((float) 0x7FFFFF + 0.5f));
+         break;
+      case ALLEGRO_AUDIO_DEPTH_UINT24:
+         SINC_GATHER((float) spl->spl_data.buffer.u24[j]
+            / ((float) 0x7FFFFF + 0.5f) - 1.0f);
+         break;
+      case ALLEGRO_AUDIO_DEPTH_INT16:
+         SINC_GATHER((float) spl->spl_data.buffer.s16[j]
+            / ((float) 0x7FFF + 0.5f));
+         break;
+      case ALLEGRO_AUDIO_DEPTH_UINT16:
+         SINC_GATHER((float) spl->spl_data.buffer.u16[j]
+            / ((float) 0x7FFF + 0.5f) - 1.0f);
+         break;
+      case ALLEGRO_AUDIO_DEPTH_INT8:
+         SINC_GATHER((float) spl->spl_data.buffer.s8[j]
+            / ((float) 0x7F + 0.5f));
+         break;
+      case ALLEGRO_AUDIO_DEPTH_UINT8:
+         SINC_GATHER((float) spl->spl_data.buffer.u8[j]
+            / ((float) 0x7F + 0.5f) - 1.0f);
+         break;
+   }
+}
+
+#undef SINC_GATHER
+
+
+static INLINE void sinc_filter(const float *coeff,
+   float x[ALLEGRO_MAX_CHANNELS][SINC_TAPS], unsigned int maxc, float *out)
+{
+   unsigned int c;
+   int j, k;
+
+   for (c = 0; c < maxc; c++) {
+      /* Four partial sums, to keep the additions independent. */
+      float acc[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+      for (k = 0; k < SINC_TAPS; k += 4) {
+         for (j = 0; j < 4; j++) {
+            acc[j] += x[c][k + j] * coeff[k + j];
+         }
+      }
+      out[c] = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+   }
+}
+
+
+static INLINE const void *sinc_spl32(SAMP_BUF *samp_buf,
+   const ALLEGRO_SAMPLE_INSTANCE *spl, unsigned int maxc)
+{
+   float x[ALLEGRO_MAX_CHANNELS][SINC_TAPS];
+   float tmp[SINC_TAPS];
+
+   sinc_gather(spl, maxc, x);
+   sinc_filter(sinc_coefficients(spl, tmp), x, maxc, samp_buf->f32);
+   return samp_buf->f32;
+}
+
+
+static INLINE const void *sinc_spl16(SAMP_BUF *samp_buf,
+   const ALLEGRO_SAMPLE_INSTANCE *spl, unsigned int maxc)
+{
+   float x[ALLEGRO_MAX_CHANNELS][SINC_TAPS];
+   float tmp[SINC_TAPS];
+   float out[ALLEGRO_MAX_CHANNELS];
+   unsigned int c;
+
+   sinc_gather(spl, maxc, x);
+   sinc_filter(sinc_coefficients(spl, tmp), x, maxc, out);
+   for (c = 0; c < maxc; c++) {
+      samp_buf->s16[c] = clamp(out[c] * ((float)0x7FFF + 0.5f),
+         ~0x7FFF, 0x7FFF);
+   }
+   return samp_buf->s16;
+}
+
+
 /* Mix as many sample values as possible from the source sample into a mixer
  * buffer.  Implements stream_reader_t.
  *
  * TYPE is the type of the sample values in the mixer buffer, and
- * NEXT_SAMPLE_VALUE must return a buffer of the same type.
+ * NEXT_SAMPLE_VALUE must return a buffer of the same type.  So must
+ * UNITY_SAMPLE_VALUE, which is used instead while the sample is read at
+ * exactly the mixer frequency and so never falls between two values.
  * 
  * Note: Uses Bresenham to keep the precise sample position.
  */
@@ -276,7 +730,7 @@ static INLINE int32_t clamp(int32_t val, int32_t min, int32_t max)
       delta_error = spl->step - delta * spl->step_denom;                      \
    } while (0)
 
-#define MAKE_MIXER(NAME, NEXT_SAMPLE_VALUE, TYPE)                             \
+#define MAKE_MIXER(NAME, NEXT_SAMPLE_VALUE, UNITY_SAMPLE_VALUE, TYPE)         \
 static void NAME(void *source, void **vbuf, unsigned int *samples,            \
    ALLEGRO_AUDIO_DEPTH buffer_depth, size_t dest_maxc)                        \
 {                                                                             \
@@ -287,6 +741,9 @@ static void NAME(void *source, void **vbuf, unsigned int *samples,            \
    size_t c;                                                                  \
    int delta, delta_error;                                                    \
    SAMP_BUF samp_buf;                                                         \
+   /* The interpolating readers lag behind the position of streams. */        \
+   const bool lagging = (spl->loop == _ALLEGRO_PLAYMODE_STREAM_ONCE ||        \
+      spl->loop == _ALLEGRO_PLAYMODE_STREAM_ONEDIR);                          \
                                                                               \
    BRESENHAM;                                                                 \
                                                                               \
@@ -304,7 +761,11 @@ static void NAME(void *source, void **vbuf, unsigned int *samples,            \
       }                                                                       \
                                                                               \
       /* It might be worth preparing multiple sample values at once. */       \
-      s = (TYPE *) NEXT_SAMPLE_VALUE(&samp_buf, spl, maxc);                   \
+      if (spl->step == spl->step_denom && spl->pos_bresenham_error == 0       \
+            && !lagging)                                                      \
+         s = (TYPE *) UNITY_SAMPLE_VALUE(&samp_buf, spl, maxc);               \
+      else                                                                    \
+         s = (TYPE *) NEXT_SAMPLE_VALUE(&samp_buf, spl, maxc);                \
                                                                               \
       for (c = 0; c < dest_maxc; c++) {                                       \
          ALLEGRO_STATIC_ASSERT(kcm_mixer, ALLEGRO_MAX_CHANNELS == 8);         \
@@ -335,11 +796,14 @@ static void NAME(void *source, void **vbuf, unsigned int *samples,            \
    (void)buffer_depth;                                                        \
 }
 
-MAKE_MIXER(read_to_mixer_point_float_32, point_spl32, float)
-MAKE_MIXER(read_to_mixer_linear_float_32, linear_spl32, float)
-MAKE_MIXER(read_to_mixer_cubic_float_32, cubic_spl32, float)
-MAKE_MIXER(read_to_mixer_point_int16_t_16, point_spl16, int16_t)
-MAKE_MIXER(read_to_mixer_linear_int16_t_16, linear_spl16, int16_t)
+MAKE_MIXER(read_to_mixer_point_float_32, point_spl32, point_spl32, float)
+MAKE_MIXER(read_to_mixer_linear_float_32, linear_spl32, point_spl32, float)
+MAKE_MIXER(read_to_mixer_cubic_float_32, cubic_spl32, point_spl32, float)
+MAKE_MIXER(read_to_mixer_sinc_float_32, sinc_spl32, point_spl32, float)
+MAKE_MIXER(read_to_mixer_point_int16_t_16, point_spl16, point_spl16, int16_t)
+MAKE_MIXER(read_to_mixer_linear_int16_t_16, linear_spl16, point_spl16,
+   int16_t)
+MAKE_MIXER(read_to_mixer_sinc_int16_t_16, sinc_spl16, point_spl16, int16_t)
 
 #undef MAKE_MIXER
 
@@ -376,6 +840,8 @@ void _al_kcm_mixer_read(void *source, void **buf, unsigned int *samples,
 
    mixer = m;
 
+   _AL_PROFILE_BEGIN("_al_kcm_mixer_read");
+
    /* Clear the buffer to silence. */
    memset(mixer->ss.spl_data.buffer.ptr, 0, samples_l * maxc * al_get_audio_depth_size(mixer->ss.spl_data.depth));
 
@@ -384,6 +850,18 @@ void _al_kcm_mixer_read(void *source, void **buf, unsigned int *samples,
       ALLEGRO_SAMPLE_INSTANCE **slot = _al_vector_ref(&mixer->streams, i);
       ALLEGRO_SAMPLE_INSTANCE *spl = *slot;
       ASSERT(spl->spl_read);
+
+      /* Inaudible samples only need to keep their place.  Mixers and
+       * streams are always read, as reading them has side effects.
+       */
+      if (spl->matrix_peak <= mixer->cull_gain && !spl->is_mixer &&
+         spl->loop != _ALLEGRO_PLAYMODE_STREAM_ONCE &&
+         spl->loop != _ALLEGRO_PLAYMODE_STREAM_ONEDIR)
+      {
+         skip_sample_instance(spl, *samples);
+         continue;
+      }
+
       spl->spl_read(spl, (void **) &mixer->ss.spl_data.buffer.ptr, samples,
          m->ss.spl_data.depth, maxc);
    }
@@ -394,6 +872,8 @@ void _al_kcm_mixer_read(void *source, void **buf, unsigned int *samples,
          *samples, mixer->pp_callback_userdata);
    }
 
+   _AL_PROFILE_END();
+
    samples_l *= maxc;
 
    /* Apply the gain if necessary. */
@@ -630,6 +1110,10 @@ ALLEGRO_MIXER *al_create_mixer(unsigned int freq,
             ALLEGRO_INFO("Cubic interpolation\n");
             default_mixer_quality = ALLEGRO_MIXER_QUALITY_CUBIC;
          }
+         else if (!_al_stricmp(p, "sinc")) {
+            ALLEGRO_INFO("Sinc interpolation\n");
+            default_mixer_quality = ALLEGRO_MIXER_QUALITY_SINC;
+         }
       }
    }
 
@@ -645,7 +1129,7 @@ ALLEGRO_MIXER *al_create_mixer(unsigned int freq,
       return NULL;
    }
 
-   mixer = al_calloc(1, sizeof(ALLEGRO_MIXER));
+   mixer = _al_tagged_calloc(ALLEGRO_MEMORY_TAG_AUDIO, sizeof(ALLEGRO_MIXER));
    if (!mixer) {
       _al_set_error(ALLEGRO_GENERIC_ERROR,
          "Out of memory allocating mixer object");
@@ -668,8 +1152,10 @@ ALLEGRO_MIXER *al_create_mixer(unsigned int freq,
    mixer->quality = default_mixer_quality;
 
    _al_vector_init(&mixer->streams, sizeof(ALLEGRO_SAMPLE_INSTANCE *));
+   _al_vector_init(&mixer->sinc_tables, sizeof(struct _AL_SINC_TABLE *));
 
-   _al_kcm_register_destructor(mixer, (void (*)(void *)) al_destroy_mixer);
+   mixer->ss.dtor_item = _al_kcm_register_destructor(mixer,
+      (void (*)(void *)) al_destroy_mixer);
 
    return mixer;
 }
@@ -680,7 +1166,7 @@ ALLEGRO_MIXER *al_create_mixer(unsigned int freq,
 void al_destroy_mixer(ALLEGRO_MIXER *mixer)
 {
    if (mixer) {
-      _al_kcm_unregister_destructor(mixer);
+      _al_kcm_unregister_destructor(mixer->ss.dtor_item);
       _al_kcm_destroy_sample(&mixer->ss, false);
    }
 }
@@ -704,6 +1190,16 @@ bool al_attach_sample_instance_to_mixer(ALLEGRO_SAMPLE_INSTANCE *spl,
       return false;
    }
 
+   /* Detaching released the data of a compressed sample, but an instance
+    * still marked as playing will be read straight away.
+    */
+   if (spl->is_playing && spl->spl_data.compressed &&
+      !_al_kcm_acquire_sample_data(spl))
+   {
+      _al_set_error(ALLEGRO_GENERIC_ERROR, "Failed to decode sample");
+      return false;
+   }
+
    maybe_lock_mutex(mixer->ss.mutex);
    
    _al_kcm_stream_set_mutex(spl, mixer->ss.mutex);
@@ -713,6 +1209,7 @@ bool al_attach_sample_instance_to_mixer(ALLEGRO_SAMPLE_INSTANCE *spl,
       if (mixer->ss.mutex) {
          al_unlock_mutex(mixer->ss.mutex);
       }
+      _al_kcm_release_sample_data(spl);
       _al_set_error(ALLEGRO_GENERIC_ERROR,
          "Out of memory allocating attachment pointers");
       return false;
@@ -729,6 +1226,9 @@ bool al_attach_sample_instance_to_mixer(ALLEGRO_SAMPLE_INSTANCE *spl,
          spl->step = -1;
    }
 
+   /* Any sinc table found earlier belongs to another mixer. */
+   spl->sinc_table = NULL;
+
    /* Set the proper sample stream reader. */
    ASSERT(spl->spl_read == NULL);
    if (spl->is_mixer) {
@@ -747,6 +1247,9 @@ bool al_attach_sample_instance_to_mixer(ALLEGRO_SAMPLE_INSTANCE *spl,
                case ALLEGRO_MIXER_QUALITY_CUBIC:
                   spl->spl_read = read_to_mixer_cubic_float_32;
                   break;
+               case ALLEGRO_MIXER_QUALITY_SINC:
+                  spl->spl_read = read_to_mixer_sinc_float_32;
+                  break;
             }
             break;
 
@@ -761,6 +1264,9 @@ bool al_attach_sample_instance_to_mixer(ALLEGRO_SAMPLE_INSTANCE *spl,
                case ALLEGRO_MIXER_QUALITY_LINEAR:
                   spl->spl_read = read_to_mixer_linear_int16_t_16;
                   break;
+               case ALLEGRO_MIXER_QUALITY_SINC:
+                  spl->spl_read = read_to_mixer_sinc_int16_t_16;
+                  break;
             }
             break;
 
@@ -782,6 +1288,8 @@ bool al_attach_sample_instance_to_mixer(ALLEGRO_SAMPLE_INSTANCE *spl,
 
    maybe_unlock_mutex(mixer->ss.mutex);
 
+   _al_kcm_mixer_update_sinc_table(spl);
+
    return true;
 }
 
@@ -889,6 +1397,16 @@ float al_get_mixer_gain(const ALLEGRO_MIXER *mixer)
 }
 
 
+/* Function: al_get_mixer_cull_gain
+ */
+float al_get_mixer_cull_gain(const ALLEGRO_MIXER *mixer)
+{
+   ASSERT(mixer);
+
+   return mixer->cull_gain;
+}
+
+
 /* Function: al_get_mixer_playing
  */
 bool al_get_mixer_playing(const ALLEGRO_MIXER *mixer)
@@ -981,6 +1499,25 @@ bool al_set_mixer_gain(ALLEGRO_MIXER *mixer, float new_gain)
 }
 
 
+/* Function: al_set_mixer_cull_gain
+ */
+bool al_set_mixer_cull_gain(ALLEGRO_MIXER *mixer, float gain)
+{
+   ASSERT(mixer);
+
+   if (gain < 0.0f) {
+      _al_set_error(ALLEGRO_INVALID_PARAM, "Negative cull gain");
+      return false;
+   }
+
+   maybe_lock_mutex(mixer->ss.mutex);
+   mixer->cull_gain = gain;
+   maybe_unlock_mutex(mixer->ss.mutex);
+
+   return true;
+}
+
+
 /* Function: al_set_mixer_playing
  */
 bool al_set_mixer_playing(ALLEGRO_MIXER *mixer, bool val)
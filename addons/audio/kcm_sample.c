@@ -18,6 +18,8 @@
 /* Title: Sample audio interface
  */
 
+#include <string.h>
+
 #include "allegro5/allegro.h"
 #include "allegro5/allegro_audio.h"
 #include "allegro5/internal/aintern.h"
@@ -152,23 +154,117 @@ ALLEGRO_SAMPLE *al_create_sample(void *buf, unsigned int samples,
    spl->buffer.ptr = buf;
    spl->free_buf = free_buf;
 
-   _al_kcm_register_destructor(spl, (void (*)(void *)) al_destroy_sample);
+   spl->dtor_item = _al_kcm_register_destructor(spl,
+      (void (*)(void *)) al_destroy_sample);
 
    return spl;
 }
 
 
+/* Function: al_convert_sample
+ */
+ALLEGRO_SAMPLE *al_convert_sample(ALLEGRO_SAMPLE *spl, unsigned int freq,
+   ALLEGRO_AUDIO_DEPTH depth, ALLEGRO_CHANNEL_CONF chan_conf)
+{
+   ALLEGRO_MIXER *mixer = NULL;
+   ALLEGRO_SAMPLE_INSTANCE *splinst = NULL;
+   ALLEGRO_SAMPLE *ret = NULL;
+   const size_t maxc = al_get_channel_count(chan_conf);
+   const size_t frame_size = maxc * al_get_audio_depth_size(depth);
+   unsigned int len;
+   unsigned int pos;
+   char *buf;
+
+   ASSERT(spl);
+
+   if (!freq) {
+      _al_set_error(ALLEGRO_INVALID_PARAM, "Invalid sample frequency");
+      return NULL;
+   }
+
+   /* Round up, so that the tail of the sample is kept. */
+   len = ((uint64_t)spl->len * freq + spl->frequency - 1) / spl->frequency;
+
+   buf = al_malloc(len * frame_size);
+   if (!buf) {
+      _al_set_error(ALLEGRO_GENERIC_ERROR,
+         "Out of memory allocating sample data");
+      return NULL;
+   }
+
+   /* Play the sample through a private mixer in the new format, and keep
+    * what comes out.  Without panning the mixer only remaps the channels,
+    * so the new sample sounds like the original when played.
+    */
+   mixer = al_create_mixer(freq, ALLEGRO_AUDIO_DEPTH_FLOAT32, chan_conf);
+   if (!mixer)
+      goto Error;
+   al_set_mixer_quality(mixer, ALLEGRO_MIXER_QUALITY_SINC);
+
+   splinst = al_create_sample_instance(spl);
+   if (!splinst)
+      goto Error;
+   al_set_sample_instance_pan(splinst, ALLEGRO_AUDIO_PAN_NONE);
+   if (!al_attach_sample_instance_to_mixer(splinst, mixer))
+      goto Error;
+   if (!al_play_sample_instance(splinst))
+      goto Error;
+
+   for (pos = 0; pos < len; ) {
+      unsigned int samples = len - pos;
+      void *out = NULL;
+
+      if (samples > 4096)
+         samples = 4096;
+      _al_kcm_mixer_read(mixer, &out, &samples, depth, maxc);
+      if (!out)
+         goto Error;
+      memcpy(buf + pos * frame_size, out, samples * frame_size);
+      pos += samples;
+   }
+
+   ret = al_create_sample(buf, len, freq, depth, chan_conf, true);
+   if (!ret)
+      goto Error;
+   ret->priority = spl->priority;
+
+   al_destroy_sample_instance(splinst);
+   al_destroy_mixer(mixer);
+   return ret;
+
+Error:
+
+   al_destroy_sample_instance(splinst);
+   al_destroy_mixer(mixer);
+   al_free(buf);
+   return NULL;
+}
+
+
 /* Stop any sample instances which are still playing a sample buffer which
- * is about to be destroyed.
+ * is about to be destroyed.  Instances of a compressed sample also forget
+ * it, since they would otherwise decode it again when next played.
  */
 static void stop_sample_instances_helper(void *object, void (*func)(void *),
    void *userdata)
 {
    ALLEGRO_SAMPLE_INSTANCE *splinst = object;
+   ALLEGRO_SAMPLE *spl = userdata;
 
    /* This is ugly. */
-   if (func == (void (*)(void *)) al_destroy_sample_instance
-      && al_get_sample_data(al_get_sample(splinst)) == userdata
+   if (func != (void (*)(void *)) al_destroy_sample_instance)
+      return;
+
+   if (spl->compressed) {
+      if (splinst->spl_data.compressed == spl->compressed) {
+         if (al_get_sample_instance_playing(splinst))
+            al_stop_sample_instance(splinst);
+         _al_kcm_release_sample_data(splinst);
+         splinst->spl_data.compressed = NULL;
+         splinst->spl_data.buffer.ptr = NULL;
+      }
+   }
+   else if (al_get_sample_data(al_get_sample(splinst)) == spl->buffer.ptr
       && al_get_sample_instance_playing(splinst))
    {
       al_stop_sample_instance(splinst);
@@ -181,14 +277,20 @@ static void stop_sample_instances_helper(void *object, void (*func)(void *),
 void al_destroy_sample(ALLEGRO_SAMPLE *spl)
 {
    if (spl) {
-      _al_kcm_foreach_destructor(stop_sample_instances_helper,
-         al_get_sample_data(spl));
-      _al_kcm_unregister_destructor(spl);
+      _al_kcm_foreach_destructor(stop_sample_instances_helper, spl);
+      _al_kcm_unregister_destructor(spl->dtor_item);
 
-      if (spl->free_buf && spl->buffer.ptr) {
+      if (spl->compressed) {
+         _al_kcm_destroy_compressed_sample(spl);
+      }
+      else if (spl->free_buf && spl->map_base) {
+         _al_kcm_unmap_file(spl->map_base, spl->map_size);
+      }
+      else if (spl->free_buf && spl->buffer.ptr) {
          al_free(spl->buffer.ptr);
       }
       spl->buffer.ptr = NULL;
+      spl->map_base = NULL;
       spl->free_buf = false;
       al_free(spl);
    }
@@ -310,13 +412,56 @@ bool al_restore_default_mixer(void)
 }
 
 
+/* find_victim:
+ *  Chooses which of the reserved instances, all of which are playing, a
+ *  sample of the given priority may stop.  That is the one of lowest
+ *  priority, then lowest gain, then the one started first, as long as its
+ *  priority is no higher than `priority'.  Returns -1 if there is none.
+ */
+static int find_victim(int priority)
+{
+   ALLEGRO_SAMPLE_INSTANCE *victim = NULL;
+   int victim_id = 0;
+   int victim_index = -1;
+   unsigned int i;
+
+   for (i = 0; i < _al_vector_size(&auto_samples); i++) {
+      ALLEGRO_SAMPLE_INSTANCE **slot = _al_vector_ref(&auto_samples, i);
+      ALLEGRO_SAMPLE_INSTANCE *splinst = (*slot);
+      int *id = _al_vector_ref(&auto_sample_ids, i);
+
+      if (splinst->spl_data.priority > priority)
+         continue;
+
+      if (victim) {
+         if (splinst->spl_data.priority > victim->spl_data.priority)
+            continue;
+         if (splinst->spl_data.priority == victim->spl_data.priority) {
+            if (splinst->gain > victim->gain)
+               continue;
+            if (splinst->gain == victim->gain && *id > victim_id)
+               continue;
+         }
+      }
+
+      victim = splinst;
+      victim_id = *id;
+      victim_index = (int) i;
+   }
+
+   return victim_index;
+}
+
+
 /* Function: al_play_sample
  */
 bool al_play_sample(ALLEGRO_SAMPLE *spl, float gain, float pan, float speed,
    ALLEGRO_PLAYMODE loop, ALLEGRO_SAMPLE_ID *ret_id)
 {
    static int next_id = 0;
-   unsigned int i;
+   ALLEGRO_SAMPLE_INSTANCE **slot;
+   int *id;
+   int i;
    
    ASSERT(spl);
 
@@ -325,26 +470,33 @@ bool al_play_sample(ALLEGRO_SAMPLE *spl, float gain, float pan, float speed,
       ret_id->_index = 0;
    }
 
-   for (i = 0; i < _al_vector_size(&auto_samples); i++) {
-      ALLEGRO_SAMPLE_INSTANCE **slot = _al_vector_ref(&auto_samples, i);
-      ALLEGRO_SAMPLE_INSTANCE *splinst = (*slot);
+   for (i = 0; i < (int) _al_vector_size(&auto_samples); i++) {
+      slot = _al_vector_ref(&auto_samples, i);
+      if (!al_get_sample_instance_playing(*slot))
+         break;
+   }
 
-      if (!al_get_sample_instance_playing(splinst)) {
-         int *id = _al_vector_ref(&auto_sample_ids, i);
+   if (i == (int) _al_vector_size(&auto_samples)) {
+      i = find_victim(spl->priority);
+      if (i < 0)
+         return false;
+      ALLEGRO_DEBUG("Stealing reserved sample %d\n", i);
+   }
 
-         if (!do_play_sample(splinst, spl, gain, pan, speed, loop))
-            break;
+   slot = _al_vector_ref(&auto_samples, i);
+   id = _al_vector_ref(&auto_sample_ids, i);
 
-         if (ret_id != NULL) {
-            ret_id->_index = (int) i;
-            ret_id->_id = *id = ++next_id;
-         }
+   if (!do_play_sample(*slot, spl, gain, pan, speed, loop))
+      return false;
 
-         return true;
-      }
+   /* Any ALLEGRO_SAMPLE_ID for a stolen instance is now stale. */
+   *id = ++next_id;
+   if (ret_id != NULL) {
+      ret_id->_index = i;
+      ret_id->_id = *id;
    }
 
-   return false;
+   return true;
 }
 
 
@@ -456,6 +608,26 @@ void *al_get_sample_data(const ALLEGRO_SAMPLE *spl)
 }
 
 
+/* Function: al_get_sample_priority
+ */
+int al_get_sample_priority(const ALLEGRO_SAMPLE *spl)
+{
+   ASSERT(spl);
+
+   return spl->priority;
+}
+
+
+/* Function: al_set_sample_priority
+ */
+void al_set_sample_priority(ALLEGRO_SAMPLE *spl, int priority)
+{
+   ASSERT(spl);
+
+   spl->priority = priority;
+}
+
+
 /* Destroy all sample instances, and frees the associated vectors. */
 static void free_sample_vector(void)
 {
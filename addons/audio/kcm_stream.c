@@ -9,19 +9,24 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "allegro5/allegro_audio.h"
+#include "allegro5/internal/aintern.h"
 #include "allegro5/internal/aintern_audio.h"
 #include "allegro5/internal/aintern_audio_cfg.h"
 
 ALLEGRO_DEBUG_CHANNEL("audio")
 
 /*
- * The highest quality interpolator is a cubic interpolator requiring
- * four sample points.  In the streaming case we lag the true sample
- * position by three.
+ * The highest quality interpolator is a windowed sinc interpolator requiring
+ * sixteen sample points.  In the streaming case we lag the true sample
+ * position by fifteen.
  */
-#define MAX_LAG   (3)
+#define MAX_LAG   (15)
+
+struct _AL_READ_AHEAD;
+static void read_ahead_resume(struct _AL_READ_AHEAD *ra);
 
 
 static void maybe_lock_mutex(ALLEGRO_MUTEX *mutex)
@@ -127,10 +132,20 @@ ALLEGRO_AUDIO_STREAM *al_create_audio_stream(size_t fragment_count,
          + MAX_LAG*bytes_per_sample;
    }
 
+   stream->feeder_mutex = al_create_mutex();
+   if (!stream->feeder_mutex) {
+      al_free(stream->main_buffer);
+      al_free(stream->used_bufs);
+      al_free(stream);
+      _al_set_error(ALLEGRO_GENERIC_ERROR,
+         "Out of memory allocating stream mutex");
+      return NULL;
+   }
+
    al_init_user_event_source(&stream->spl.es);
 
    /* This can lead to deadlocks on shutdown, hence we don't do it. */
-   /* _al_kcm_register_destructor(stream, (void (*)(void *)) al_destroy_audio_stream); */
+   /* stream->spl.dtor_item = _al_kcm_register_destructor(stream, (void (*)(void *)) al_destroy_audio_stream); */
 
    return stream;
 }
@@ -145,10 +160,11 @@ void al_destroy_audio_stream(ALLEGRO_AUDIO_STREAM *stream)
          stream->unload_feeder(stream);
       }
       /* See commented out call to _al_kcm_register_destructor. */
-      /* _al_kcm_unregister_destructor(stream); */
+      /* _al_kcm_unregister_destructor(stream->spl.dtor_item); */
       _al_kcm_detach_from_parent(&stream->spl);
 
       al_destroy_user_event_source(&stream->spl.es);
+      al_destroy_mutex(stream->feeder_mutex);
       al_free(stream->main_buffer);
       al_free(stream->used_bufs);
       al_free(stream);
@@ -363,6 +379,8 @@ bool al_set_audio_stream_speed(ALLEGRO_AUDIO_STREAM *stream, float val)
       }
 
       maybe_unlock_mutex(stream->spl.mutex);
+
+      _al_kcm_mixer_update_sinc_table(&stream->spl);
    }
 
    return true;
@@ -452,7 +470,11 @@ bool al_set_audio_stream_playmode(ALLEGRO_AUDIO_STREAM *stream,
       if (!stream->feeder)
          return false;
 
+      maybe_lock_mutex(stream->spl.mutex);
       stream->spl.loop = _ALLEGRO_PLAYMODE_STREAM_ONEDIR;
+      if (stream->read_ahead)
+         read_ahead_resume(stream->read_ahead);
+      maybe_unlock_mutex(stream->spl.mutex);
       return true;
    }
 
@@ -588,6 +610,365 @@ bool _al_kcm_refill_stream(ALLEGRO_AUDIO_STREAM *stream)
 }
 
 
+/* Decoded read-ahead.
+ *
+ * A stream fed by a decoder can keep some seconds of decoded data ahead of
+ * its fragments.  A second thread then does all the decoding, in batches
+ * much larger than a fragment, while the feeder thread only copies decoded
+ * data into each fragment as it becomes free.  A slow read then only eats
+ * into the data read ahead instead of holding up the fragments.
+ *
+ * The decoder holds the stream's feeder mutex for a whole batch, but never
+ * the stream mutex, which is the mixer mutex once the stream is attached.
+ * Locks are taken in the order: feeder mutex, stream mutex, read-ahead
+ * mutex.  Seeking and the like wait for the batch to finish without
+ * holding up the mixer; querying the position only needs the read-ahead
+ * mutex.
+ */
+struct _AL_READ_AHEAD {
+   ALLEGRO_AUDIO_STREAM *stream;
+   double secs;
+   double length;
+                        /* The length of the feeder, or 0 if unknown. */
+   ALLEGRO_THREAD *thread;
+
+   ALLEGRO_MUTEX *mutex;
+   ALLEGRO_COND *cond;
+                        /* Protect the fields below.  The condition is
+                         * signalled whenever data or space is made.
+                         */
+   char *buf;
+   size_t size;
+   size_t start;
+   size_t used;
+                        /* A ring buffer of `size' bytes, holding `used'
+                         * bytes from `start' on.
+                         */
+   double feeder_pos;
+                        /* The position of the feeder after the last byte
+                         * in the ring buffer.
+                         */
+   char *batch_buf;
+   size_t batch;
+   bool eof;
+   bool quit;
+};
+
+
+static size_t bytes_per_frame(const ALLEGRO_AUDIO_STREAM *stream)
+{
+   return al_get_channel_count(stream->spl.spl_data.chan_conf) *
+      al_get_audio_depth_size(stream->spl.spl_data.depth);
+}
+
+
+/* Must be called with the feeder mutex held. */
+static double feeder_position(ALLEGRO_AUDIO_STREAM *stream)
+{
+   if (stream->get_feeder_position)
+      return stream->get_feeder_position(stream);
+   return 0.0;
+}
+
+
+/* read_ahead_proc:
+ *  Decodes a batch whenever there is room for one in the ring buffer.
+ */
+static void *read_ahead_proc(ALLEGRO_THREAD *thread, void *arg)
+{
+   struct _AL_READ_AHEAD *ra = arg;
+   ALLEGRO_AUDIO_STREAM *stream = ra->stream;
+   (void)thread;
+
+   al_lock_mutex(ra->mutex);
+   while (!ra->quit) {
+      size_t bytes_written;
+      size_t pos;
+      size_t first;
+      double feeder_pos;
+      int loop;
+
+      if (ra->eof || ra->size - ra->used < ra->batch) {
+         al_wait_cond(ra->cond, ra->mutex);
+         continue;
+      }
+      al_unlock_mutex(ra->mutex);
+
+      al_lock_mutex(stream->feeder_mutex);
+      bytes_written = stream->feeder(stream, ra->batch_buf, ra->batch);
+
+      maybe_lock_mutex(stream->spl.mutex);
+      loop = stream->spl.loop;
+      maybe_unlock_mutex(stream->spl.mutex);
+
+      /* As in _al_kcm_feed_stream, but the stream mutex is not held and the
+       * data read ahead must be kept, so the feeder is rewound directly.
+       */
+      while (bytes_written < ra->batch &&
+            loop == _ALLEGRO_PLAYMODE_STREAM_ONEDIR) {
+         size_t bw;
+         if (!stream->rewind_feeder || !stream->rewind_feeder(stream))
+            break;
+         bw = stream->feeder(stream, ra->batch_buf + bytes_written,
+            ra->batch - bytes_written);
+         if (bw == 0)
+            break;
+         bytes_written += bw;
+      }
+      feeder_pos = feeder_position(stream);
+
+      al_lock_mutex(ra->mutex);
+      pos = (ra->start + ra->used) % ra->size;
+      first = _ALLEGRO_MIN(bytes_written, ra->size - pos);
+      memcpy(ra->buf + pos, ra->batch_buf, first);
+      memcpy(ra->buf, ra->batch_buf + first, bytes_written - first);
+      ra->used += bytes_written;
+      ra->feeder_pos = feeder_pos;
+      if (bytes_written < ra->batch)
+         ra->eof = true;
+      al_broadcast_cond(ra->cond);
+      al_unlock_mutex(stream->feeder_mutex);
+   }
+   al_unlock_mutex(ra->mutex);
+
+   return NULL;
+}
+
+
+static void stop_read_ahead(struct _AL_READ_AHEAD *ra)
+{
+   if (ra->thread) {
+      al_lock_mutex(ra->mutex);
+      ra->quit = true;
+      al_broadcast_cond(ra->cond);
+      al_unlock_mutex(ra->mutex);
+      al_join_thread(ra->thread, NULL);
+      al_destroy_thread(ra->thread);
+      ra->thread = NULL;
+   }
+}
+
+
+static void destroy_read_ahead(struct _AL_READ_AHEAD *ra)
+{
+   stop_read_ahead(ra);
+   if (ra->cond)
+      al_destroy_cond(ra->cond);
+   if (ra->mutex)
+      al_destroy_mutex(ra->mutex);
+   al_free(ra->batch_buf);
+   al_free(ra->buf);
+   al_free(ra);
+}
+
+
+/* create_read_ahead:
+ *  Must be called with the feeder mutex held.  The decoder starts when it
+ *  is released.
+ */
+static struct _AL_READ_AHEAD *create_read_ahead(ALLEGRO_AUDIO_STREAM *stream,
+   double secs)
+{
+   struct _AL_READ_AHEAD *ra;
+   const size_t frame = bytes_per_frame(stream);
+   const size_t fragment = stream->spl.spl_data.len * frame;
+
+   ra = al_calloc(1, sizeof(*ra));
+   if (!ra)
+      return NULL;
+   ra->stream = stream;
+   ra->secs = secs;
+   if (stream->get_feeder_length)
+      ra->length = stream->get_feeder_length(stream);
+   ra->feeder_pos = feeder_position(stream);
+
+   /* The ring must hold a fragment and a batch at once, or filling the
+    * fragment could wait forever for a batch that does not fit.
+    */
+   ra->size = (size_t)(secs * stream->spl.spl_data.frequency) * frame;
+   if (ra->size < 4 * fragment)
+      ra->size = 4 * fragment;
+   ra->batch = ra->size / 4 / frame * frame;
+   if (ra->batch < fragment)
+      ra->batch = fragment;
+
+   ra->buf = al_malloc(ra->size);
+   ra->batch_buf = al_malloc(ra->batch);
+   ra->mutex = al_create_mutex();
+   ra->cond = al_create_cond();
+   if (!ra->buf || !ra->batch_buf || !ra->mutex || !ra->cond) {
+      destroy_read_ahead(ra);
+      return NULL;
+   }
+
+   ra->thread = al_create_thread(read_ahead_proc, ra);
+   if (!ra->thread) {
+      destroy_read_ahead(ra);
+      return NULL;
+   }
+   al_start_thread(ra->thread);
+
+   return ra;
+}
+
+
+/* read_ahead_fill:
+ *  Fills a fragment from the data read ahead, waiting for the decoder if
+ *  necessary.  Returns the number of bytes filled with data; the rest of
+ *  the fragment is silenced, which only happens at the end of the stream.
+ */
+static size_t read_ahead_fill(struct _AL_READ_AHEAD *ra, char *fragment,
+   size_t bytes)
+{
+   size_t n;
+   size_t first;
+
+   al_lock_mutex(ra->mutex);
+   while (ra->used < bytes && !ra->eof) {
+      al_wait_cond(ra->cond, ra->mutex);
+   }
+   n = _ALLEGRO_MIN(ra->used, bytes);
+   first = _ALLEGRO_MIN(n, ra->size - ra->start);
+   memcpy(fragment, ra->buf + ra->start, first);
+   memcpy(fragment + first, ra->buf, n - first);
+   ra->start = (ra->start + n) % ra->size;
+   ra->used -= n;
+   al_broadcast_cond(ra->cond);
+   al_unlock_mutex(ra->mutex);
+
+   if (n < bytes) {
+      memset(fragment + n,
+         _al_kcm_get_silence(ra->stream->spl.spl_data.depth), bytes - n);
+   }
+   return n;
+}
+
+
+/* read_ahead_flush:
+ *  Drops the data read ahead, after the feeder has moved elsewhere.  Must
+ *  be called with the feeder mutex held.
+ */
+static void read_ahead_flush(struct _AL_READ_AHEAD *ra)
+{
+   double feeder_pos = feeder_position(ra->stream);
+
+   al_lock_mutex(ra->mutex);
+   ra->start = 0;
+   ra->used = 0;
+   ra->feeder_pos = feeder_pos;
+   ra->eof = false;
+   al_broadcast_cond(ra->cond);
+   al_unlock_mutex(ra->mutex);
+}
+
+
+/* read_ahead_resume:
+ *  Lets a decoder which stopped at the end of a stream played once carry
+ *  on, now that the stream loops.
+ */
+static void read_ahead_resume(struct _AL_READ_AHEAD *ra)
+{
+   al_lock_mutex(ra->mutex);
+   ra->eof = false;
+   al_broadcast_cond(ra->cond);
+   al_unlock_mutex(ra->mutex);
+}
+
+
+/* read_ahead_position:
+ *  Returns the position of the feeder, less the data read ahead.  If the
+ *  decoder has looped since, that was before the end of the stream.
+ */
+static double read_ahead_position(struct _AL_READ_AHEAD *ra, int loop)
+{
+   const ALLEGRO_AUDIO_STREAM *stream = ra->stream;
+   double pos;
+
+   al_lock_mutex(ra->mutex);
+   pos = ra->feeder_pos - (double)(ra->used / bytes_per_frame(stream)) /
+      stream->spl.spl_data.frequency;
+   al_unlock_mutex(ra->mutex);
+
+   if (pos < 0.0 && ra->length > 0.0 &&
+         loop == _ALLEGRO_PLAYMODE_STREAM_ONEDIR) {
+      pos += ra->length;
+   }
+   return _ALLEGRO_MAX(pos, 0.0);
+}
+
+
+/* update_read_ahead:
+ *  Called by the feeder thread to apply a change to read_ahead_secs.
+ */
+static void update_read_ahead(ALLEGRO_AUDIO_STREAM *stream)
+{
+   struct _AL_READ_AHEAD *ra = stream->read_ahead;
+   double secs;
+   int loop;
+
+   maybe_lock_mutex(stream->spl.mutex);
+   secs = stream->read_ahead_secs;
+   maybe_unlock_mutex(stream->spl.mutex);
+
+   if ((ra ? ra->secs : 0.0) == secs)
+      return;
+
+   if (ra) {
+      /* Stop the decoder first; it may be waiting for the feeder mutex. */
+      stop_read_ahead(ra);
+
+      al_lock_mutex(stream->feeder_mutex);
+      maybe_lock_mutex(stream->spl.mutex);
+      stream->read_ahead = NULL;
+      loop = stream->spl.loop;
+      maybe_unlock_mutex(stream->spl.mutex);
+      /* Go back to where the data read ahead started. */
+      if (stream->get_feeder_position && stream->seek_feeder) {
+         stream->seek_feeder(stream, read_ahead_position(ra, loop));
+      }
+      al_unlock_mutex(stream->feeder_mutex);
+
+      destroy_read_ahead(ra);
+      ra = NULL;
+   }
+
+   if (secs > 0.0) {
+      al_lock_mutex(stream->feeder_mutex);
+      ra = create_read_ahead(stream, secs);
+      maybe_lock_mutex(stream->spl.mutex);
+      if (ra) {
+         stream->read_ahead = ra;
+      }
+      else {
+         ALLEGRO_ERROR("Could not set up read-ahead for stream.\n");
+         stream->read_ahead_secs = 0.0;
+      }
+      maybe_unlock_mutex(stream->spl.mutex);
+      al_unlock_mutex(stream->feeder_mutex);
+   }
+}
+
+
+/* lock_feeder:
+ *  Locks the stream for a call into its feeder.  Returns the read-ahead
+ *  buffer of the stream, if it has one.  The feeder mutex is taken first,
+ *  so waiting for the decoder to finish a batch does not hold up the mixer.
+ */
+static struct _AL_READ_AHEAD *lock_feeder(ALLEGRO_AUDIO_STREAM *stream)
+{
+   al_lock_mutex(stream->feeder_mutex);
+   maybe_lock_mutex(stream->spl.mutex);
+   return stream->read_ahead;
+}
+
+
+static void unlock_feeder(ALLEGRO_AUDIO_STREAM *stream)
+{
+   maybe_unlock_mutex(stream->spl.mutex);
+   al_unlock_mutex(stream->feeder_mutex);
+}
+
+
 /* _al_kcm_feed_stream:
  * A routine running in another thread that feeds the stream buffers as
  * neccesary, usually getting data from some file reader backend.
@@ -612,6 +993,8 @@ void *_al_kcm_feed_stream(ALLEGRO_THREAD *self, void *vstream)
 
       al_wait_for_event(queue, &event);
 
+      update_read_ahead(stream);
+
       if (event.type == ALLEGRO_EVENT_AUDIO_STREAM_FRAGMENT
           && !stream->is_draining) {
          unsigned long bytes;
@@ -627,24 +1010,31 @@ void *_al_kcm_feed_stream(ALLEGRO_THREAD *self, void *vstream)
                al_get_channel_count(stream->spl.spl_data.chan_conf) *
                al_get_audio_depth_size(stream->spl.spl_data.depth);
 
-         maybe_lock_mutex(stream->spl.mutex);
-         bytes_written = stream->feeder(stream, fragment, bytes);
-         maybe_unlock_mutex(stream->spl.mutex);
+         if (stream->read_ahead) {
+            bytes_written = read_ahead_fill(stream->read_ahead, fragment,
+               bytes);
+         }
+         else {
+            lock_feeder(stream);
+            bytes_written = stream->feeder(stream, fragment, bytes);
+            unlock_feeder(stream);
+         }
 
         /* In case it reaches the end of the stream source, stream feeder will
          * fill the remaining space with silence. If we should loop, rewind the
          * stream and override the silence with the beginning.
          * In extreme cases we need to repeat it multiple times.
+         * The read-ahead decoder does this itself.
          */
-         while (bytes_written < bytes &&
+         while (bytes_written < bytes && !stream->read_ahead &&
                   stream->spl.loop == _ALLEGRO_PLAYMODE_STREAM_ONEDIR) {
             size_t bw;
             al_rewind_audio_stream(stream);
-            maybe_lock_mutex(stream->spl.mutex);
+            lock_feeder(stream);
             bw = stream->feeder(stream, fragment + bytes_written,
                bytes - bytes_written);
             bytes_written += bw;
-            maybe_unlock_mutex(stream->spl.mutex);
+            unlock_feeder(stream);
          }
 
          if (!al_set_audio_stream_fragment(stream, fragment)) {
@@ -663,6 +1053,16 @@ void *_al_kcm_feed_stream(ALLEGRO_THREAD *self, void *vstream)
          stream->quit_feed_thread = true;
       }
    }
+
+   /* The feeder is about to be unloaded. */
+   if (stream->read_ahead) {
+      struct _AL_READ_AHEAD *ra = stream->read_ahead;
+      stop_read_ahead(ra);
+      lock_feeder(stream);
+      stream->read_ahead = NULL;
+      unlock_feeder(stream);
+      destroy_read_ahead(ra);
+   }
    
    event.user.type = ALLEGRO_EVENT_AUDIO_STREAM_FINISHED;
    event.user.timestamp = al_get_time();
@@ -707,9 +1107,11 @@ bool al_rewind_audio_stream(ALLEGRO_AUDIO_STREAM *stream)
    bool ret;
 
    if (stream->rewind_feeder) {
-      maybe_lock_mutex(stream->spl.mutex);
+      struct _AL_READ_AHEAD *ra = lock_feeder(stream);
       ret = stream->rewind_feeder(stream);
-      maybe_unlock_mutex(stream->spl.mutex);
+      if (ra)
+         read_ahead_flush(ra);
+      unlock_feeder(stream);
       return ret;
    }
 
@@ -724,9 +1126,11 @@ bool al_seek_audio_stream_secs(ALLEGRO_AUDIO_STREAM *stream, double time)
    bool ret;
 
    if (stream->seek_feeder) {
-      maybe_lock_mutex(stream->spl.mutex);
+      struct _AL_READ_AHEAD *ra = lock_feeder(stream);
       ret = stream->seek_feeder(stream, time);
-      maybe_unlock_mutex(stream->spl.mutex);
+      if (ra)
+         read_ahead_flush(ra);
+      unlock_feeder(stream);
       return ret;
    }
 
@@ -741,9 +1145,21 @@ double al_get_audio_stream_position_secs(ALLEGRO_AUDIO_STREAM *stream)
    double ret;
 
    if (stream->get_feeder_position) {
+      /* With read-ahead the decoder may be busy in the feeder, so use the
+       * position it recorded after its last batch.  The stream mutex keeps
+       * the read-ahead from going away.
+       */
       maybe_lock_mutex(stream->spl.mutex);
-      ret = stream->get_feeder_position(stream);
+      if (stream->read_ahead) {
+         ret = read_ahead_position(stream->read_ahead, stream->spl.loop);
+         maybe_unlock_mutex(stream->spl.mutex);
+         return ret;
+      }
       maybe_unlock_mutex(stream->spl.mutex);
+
+      lock_feeder(stream);
+      ret = stream->get_feeder_position(stream);
+      unlock_feeder(stream);
       return ret;
    }
 
@@ -758,9 +1174,9 @@ double al_get_audio_stream_length_secs(ALLEGRO_AUDIO_STREAM *stream)
    double ret;
 
    if (stream->get_feeder_length) {
-      maybe_lock_mutex(stream->spl.mutex);
+      lock_feeder(stream);
       ret = stream->get_feeder_length(stream);
-      maybe_unlock_mutex(stream->spl.mutex);
+      unlock_feeder(stream);
       return ret;
    }
 
@@ -779,9 +1195,11 @@ bool al_set_audio_stream_loop_secs(ALLEGRO_AUDIO_STREAM *stream,
       return false;
 
    if (stream->set_feeder_loop) {
-      maybe_lock_mutex(stream->spl.mutex);
+      struct _AL_READ_AHEAD *ra = lock_feeder(stream);
       ret = stream->set_feeder_loop(stream, start, end);
-      maybe_unlock_mutex(stream->spl.mutex);
+      if (ra)
+         read_ahead_flush(ra);
+      unlock_feeder(stream);
       return ret;
    }
 
@@ -789,6 +1207,47 @@ bool al_set_audio_stream_loop_secs(ALLEGRO_AUDIO_STREAM *stream,
 }
 
 
+/* Function: al_get_audio_stream_read_ahead
+ */
+double al_get_audio_stream_read_ahead(const ALLEGRO_AUDIO_STREAM *stream)
+{
+   ASSERT(stream);
+
+   return stream->read_ahead_secs;
+}
+
+
+/* Function: al_set_audio_stream_read_ahead
+ */
+bool al_set_audio_stream_read_ahead(ALLEGRO_AUDIO_STREAM *stream, double secs)
+{
+   ALLEGRO_EVENT event;
+   ASSERT(stream);
+
+   if (!stream->feed_thread) {
+      _al_set_error(ALLEGRO_INVALID_OBJECT,
+         "Attempted to read ahead on a stream without a feeder");
+      return false;
+   }
+   if (secs < 0.0) {
+      _al_set_error(ALLEGRO_INVALID_PARAM,
+         "Attempted to set a negative read-ahead");
+      return false;
+   }
+
+   maybe_lock_mutex(stream->spl.mutex);
+   stream->read_ahead_secs = secs;
+   maybe_unlock_mutex(stream->spl.mutex);
+
+   /* Wake up the feeder thread, which makes the change. */
+   event.user.type = _KCM_STREAM_FEEDER_READ_AHEAD_EVENT_TYPE;
+   event.user.timestamp = al_get_time();
+   al_emit_user_event(&stream->spl.es, &event, NULL);
+
+   return true;
+}
+
+
 /* Function: al_get_audio_stream_event_source
  */
 ALLEGRO_EVENT_SOURCE *al_get_audio_stream_event_source(
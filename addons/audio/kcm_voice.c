@@ -88,7 +88,8 @@ ALLEGRO_VOICE *al_create_voice(unsigned int freq,
       return NULL;
    }
 
-   _al_kcm_register_destructor(voice, (void (*)(void *)) al_destroy_voice);
+   voice->dtor_item = _al_kcm_register_destructor(voice,
+      (void (*)(void *)) al_destroy_voice);
 
    return voice;
 }
@@ -99,7 +100,7 @@ ALLEGRO_VOICE *al_create_voice(unsigned int freq,
 void al_destroy_voice(ALLEGRO_VOICE *voice)
 {
    if (voice) {
-      _al_kcm_unregister_destructor(voice);
+      _al_kcm_unregister_destructor(voice->dtor_item);
 
       al_detach_voice(voice);
       ASSERT(al_get_voice_playing(voice) == false);
@@ -149,6 +150,13 @@ bool al_attach_sample_instance_to_voice(ALLEGRO_SAMPLE_INSTANCE *spl,
       return false;
    }
 
+   if (spl->spl_data.compressed &&
+      !_al_kcm_acquire_sample_data(spl))
+   {
+      _al_set_error(ALLEGRO_GENERIC_ERROR, "Failed to decode sample");
+      return false;
+   }
+
    al_lock_mutex(voice->mutex);
 
    voice->attached_stream = spl;
@@ -182,6 +190,9 @@ bool al_attach_sample_instance_to_voice(ALLEGRO_SAMPLE_INSTANCE *spl,
 
    al_unlock_mutex(voice->mutex);
 
+   if (!ret)
+      _al_kcm_release_sample_data(spl);
+
    return ret;
 }
 
@@ -358,6 +369,7 @@ bool al_attach_mixer_to_voice(ALLEGRO_MIXER *mixer, ALLEGRO_VOICE *voice)
  */
 void al_detach_voice(ALLEGRO_VOICE *voice)
 {
+   ALLEGRO_SAMPLE_INSTANCE *unloaded = NULL;
    ASSERT(voice);
 
    if (!voice->attached_stream) {
@@ -374,6 +386,7 @@ void al_detach_voice(ALLEGRO_VOICE *voice)
 
       voice->driver->stop_voice(voice);
       voice->driver->unload_voice(voice);
+      unloaded = spl;
    }
    else {
       voice->driver->stop_voice(voice);
@@ -385,6 +398,9 @@ void al_detach_voice(ALLEGRO_VOICE *voice)
    voice->attached_stream = NULL;
 
    al_unlock_mutex(voice->mutex);
+
+   if (unloaded)
+      _al_kcm_release_sample_data(unloaded);
 }
 
 
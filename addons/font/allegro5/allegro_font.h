@@ -72,6 +72,10 @@ struct ALLEGRO_FONT_VTABLE
       int ranges_count, int *ranges));
 };
 
+/* Type: ALLEGRO_TEXT_LAYOUT
+*/
+typedef struct ALLEGRO_TEXT_LAYOUT ALLEGRO_TEXT_LAYOUT;
+
 enum {
    ALLEGRO_ALIGN_LEFT       = 0,
    ALLEGRO_ALIGN_CENTRE     = 1,
@@ -112,6 +116,19 @@ ALLEGRO_FONT_FUNC(uint32_t, al_get_allegro_font_version, (void));
 ALLEGRO_FONT_FUNC(int, al_get_font_ranges, (ALLEGRO_FONT *font,
    int ranges_count, int *ranges));
 
+ALLEGRO_FONT_FUNC(ALLEGRO_TEXT_LAYOUT *, al_create_text_layout, (const ALLEGRO_FONT *font));
+ALLEGRO_FONT_FUNC(void, al_destroy_text_layout, (ALLEGRO_TEXT_LAYOUT *layout));
+ALLEGRO_FONT_FUNC(void, al_clear_text_layout, (ALLEGRO_TEXT_LAYOUT *layout));
+ALLEGRO_FONT_FUNC(bool, al_append_text_layout_text, (ALLEGRO_TEXT_LAYOUT *layout, const char *text));
+ALLEGRO_FONT_FUNC(bool, al_append_text_layout_ustr, (ALLEGRO_TEXT_LAYOUT *layout, const ALLEGRO_USTR *text));
+ALLEGRO_FONT_FUNC(bool, al_set_text_layout_line, (ALLEGRO_TEXT_LAYOUT *layout, int index, const char *text));
+ALLEGRO_FONT_FUNC(void, al_remove_text_layout_lines, (ALLEGRO_TEXT_LAYOUT *layout, int start, int count));
+ALLEGRO_FONT_FUNC(int, al_get_text_layout_line_count, (const ALLEGRO_TEXT_LAYOUT *layout));
+ALLEGRO_FONT_FUNC(const ALLEGRO_USTR *, al_get_text_layout_line, (const ALLEGRO_TEXT_LAYOUT *layout, int index));
+ALLEGRO_FONT_FUNC(int, al_get_text_layout_width, (const ALLEGRO_TEXT_LAYOUT *layout));
+ALLEGRO_FONT_FUNC(int, al_get_text_layout_height, (const ALLEGRO_TEXT_LAYOUT *layout));
+ALLEGRO_FONT_FUNC(void, al_draw_text_layout, (const ALLEGRO_TEXT_LAYOUT *layout, ALLEGRO_COLOR color, float x, float y, int flags));
+
 
 #ifdef __cplusplus
    }
@@ -18,6 +18,8 @@
 #include "allegro5/internal/aintern_vector.h"
 #include "allegro5/allegro_font.h"
 #include "allegro5/internal/aintern_bitmap.h"
+#include "allegro5/internal/aintern_dtor.h"
+#include "allegro5/internal/aintern_system.h"
 
 #include "font.h"
 
@@ -213,8 +215,10 @@ static void color_destroy(ALLEGRO_FONT* f)
 
     cf = (ALLEGRO_FONT_COLOR_DATA*)(f->data);
 
-    if (cf)
+    if (cf) {
+        _al_unregister_destructor(_al_dtor_list, cf->dtor_item);
         glyphs = cf->glyphs;
+    }
 
     while (cf) {
         ALLEGRO_FONT_COLOR_DATA* next = cf->next;
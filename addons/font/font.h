@@ -1,6 +1,8 @@
 #ifndef __al_included_allegro5_font_h
 #define __al_included_allegro5_font_h
 
+#include "allegro5/internal/aintern_list.h"
+
 extern ALLEGRO_FONT_VTABLE _al_font_vtable_color;
 
 typedef struct ALLEGRO_FONT_COLOR_DATA
@@ -9,6 +11,7 @@ typedef struct ALLEGRO_FONT_COLOR_DATA
    ALLEGRO_BITMAP *glyphs;           /* our glyphs */
    ALLEGRO_BITMAP **bitmaps;         /* sub bitmaps pointing to our glyphs */
    struct ALLEGRO_FONT_COLOR_DATA *next;  /* linked list structure */
+   _AL_LIST_ITEM *dtor_item;         /* destructor, first range only */
 } ALLEGRO_FONT_COLOR_DATA;
 
 ALLEGRO_FONT *_al_load_bitmap_font(const char *filename,
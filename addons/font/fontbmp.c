@@ -284,8 +284,12 @@ ALLEGRO_FONT *al_grab_font_from_bitmap(ALLEGRO_BITMAP *bmp,
    if (unmasked)
        al_destroy_bitmap(unmasked);
 
-   _al_register_destructor(_al_dtor_list, f,
-      (void (*)(void  *))al_destroy_font);
+   /* The list item lives in the private data, so that fonts made by other
+    * vtables need not reserve room for it in ALLEGRO_FONT.
+    */
+   if (cf)
+      cf->dtor_item = _al_register_destructor(_al_dtor_list, f,
+         (void (*)(void  *))al_destroy_font);
 
    return f;
 
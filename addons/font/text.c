@@ -358,8 +358,6 @@ void al_destroy_font(ALLEGRO_FONT *f)
    if (!f)
       return;
 
-   _al_unregister_destructor(_al_dtor_list, f);
-
    f->vtable->destroy(f);
 }
 
@@ -0,0 +1,385 @@
+/*         ______   ___    ___
+ *        /\  _  \ /\_ \  /\_ \
+ *        \ \ \L\ \\//\ \ \//\ \      __     __   _ __   ___
+ *         \ \  __ \ \ \ \  \ \ \   /'__`\ /'_ `\/\`'__\/ __`\
+ *          \ \ \/\ \ \_\ \_ \_\ \_/\  __//\ \L\ \ \ \//\ \L\ \
+ *           \ \_\ \_\/\____\/\____\ \____\ \____ \ \_\\ \____/
+ *            \/_/\/_/\/____/\/____/\/____/\/___L\ \/_/ \/___/
+ *                                           /\____/
+ *                                           \_/__/
+ *
+ *      Text layouts: many lines of text, measured once and drawn
+ *      as a single batch.
+ *
+ *      See readme.txt for copyright information.
+ */
+
+
+#include <math.h>
+#include <string.h>
+#include "allegro5/allegro.h"
+
+#include "allegro5/allegro_font.h"
+#include "allegro5/internal/aintern.h"
+
+
+typedef struct TEXT_LAYOUT_LINE {
+   ALLEGRO_USTR *text;
+   int width;
+} TEXT_LAYOUT_LINE;
+
+struct ALLEGRO_TEXT_LAYOUT {
+   const ALLEGRO_FONT *font;
+   int line_height;
+   TEXT_LAYOUT_LINE *lines;
+   int num_lines;
+   int max_lines;
+   /* Width of the widest line, or -1 if it must be recomputed. */
+   int width;
+};
+
+
+
+static bool reserve_lines(ALLEGRO_TEXT_LAYOUT *layout, int n)
+{
+   TEXT_LAYOUT_LINE *lines;
+   int max_lines;
+
+   if (layout->num_lines + n <= layout->max_lines)
+      return true;
+
+   max_lines = _ALLEGRO_MAX(layout->max_lines * 2, layout->num_lines + n);
+   max_lines = _ALLEGRO_MAX(max_lines, 16);
+   lines = al_realloc(layout->lines, max_lines * sizeof(*lines));
+   if (!lines)
+      return false;
+
+   layout->lines = lines;
+   layout->max_lines = max_lines;
+   return true;
+}
+
+
+
+static bool set_line(ALLEGRO_TEXT_LAYOUT *layout, TEXT_LAYOUT_LINE *line,
+   const ALLEGRO_USTR *text)
+{
+   line->text = al_ustr_dup(text);
+   if (!line->text)
+      return false;
+   line->width = layout->font->vtable->text_length(layout->font, line->text);
+   if (layout->width >= 0 && line->width > layout->width)
+      layout->width = line->width;
+   return true;
+}
+
+
+
+/* Function: al_create_text_layout
+ */
+ALLEGRO_TEXT_LAYOUT *al_create_text_layout(const ALLEGRO_FONT *font)
+{
+   ALLEGRO_TEXT_LAYOUT *layout;
+   ASSERT(font);
+
+   layout = al_calloc(1, sizeof(*layout));
+   if (!layout)
+      return NULL;
+
+   layout->font = font;
+   layout->line_height = font->vtable->font_height(font);
+   return layout;
+}
+
+
+
+/* Function: al_destroy_text_layout
+ */
+void al_destroy_text_layout(ALLEGRO_TEXT_LAYOUT *layout)
+{
+   if (!layout)
+      return;
+
+   al_clear_text_layout(layout);
+   al_free(layout->lines);
+   al_free(layout);
+}
+
+
+
+/* Function: al_clear_text_layout
+ */
+void al_clear_text_layout(ALLEGRO_TEXT_LAYOUT *layout)
+{
+   int i;
+   ASSERT(layout);
+
+   for (i = 0; i < layout->num_lines; i++)
+      al_ustr_free(layout->lines[i].text);
+   layout->num_lines = 0;
+   layout->width = 0;
+}
+
+
+
+/* Function: al_append_text_layout_ustr
+ */
+bool al_append_text_layout_ustr(ALLEGRO_TEXT_LAYOUT *layout,
+   const ALLEGRO_USTR *text)
+{
+   ALLEGRO_USTR_INFO line_info;
+   const ALLEGRO_USTR *line;
+   int pos1 = 0;
+   int pos2;
+   ASSERT(layout);
+   ASSERT(text);
+
+   for (;;) {
+      pos2 = al_ustr_find_chr(text, pos1, '\n');
+      if (pos2 == -1)
+         pos2 = al_ustr_size(text);
+
+      if (!reserve_lines(layout, 1))
+         return false;
+      line = al_ref_ustr(&line_info, text, pos1, pos2);
+      if (!set_line(layout, &layout->lines[layout->num_lines], line))
+         return false;
+      layout->num_lines++;
+
+      if (pos2 == (int)al_ustr_size(text))
+         break;
+      pos1 = pos2 + 1;
+   }
+
+   return true;
+}
+
+
+
+/* Function: al_append_text_layout_text
+ */
+bool al_append_text_layout_text(ALLEGRO_TEXT_LAYOUT *layout, const char *text)
+{
+   ALLEGRO_USTR_INFO info;
+   ASSERT(text);
+   return al_append_text_layout_ustr(layout, al_ref_cstr(&info, text));
+}
+
+
+
+/* Function: al_set_text_layout_line
+ */
+bool al_set_text_layout_line(ALLEGRO_TEXT_LAYOUT *layout, int index,
+   const char *text)
+{
+   ALLEGRO_USTR_INFO info;
+   TEXT_LAYOUT_LINE *line;
+   int old_width;
+   ASSERT(layout);
+   ASSERT(text);
+
+   if (index < 0 || index >= layout->num_lines)
+      return false;
+
+   line = &layout->lines[index];
+   old_width = line->width;
+   if (!al_ustr_assign_cstr(line->text, text))
+      return false;
+   line->width = layout->font->vtable->text_length(layout->font,
+      al_ref_cstr(&info, text));
+
+   if (layout->width >= 0) {
+      if (line->width > layout->width)
+         layout->width = line->width;
+      else if (old_width == layout->width && line->width < old_width)
+         layout->width = -1;
+   }
+   return true;
+}
+
+
+
+/* Function: al_remove_text_layout_lines
+ */
+void al_remove_text_layout_lines(ALLEGRO_TEXT_LAYOUT *layout, int start,
+   int count)
+{
+   int i;
+   ASSERT(layout);
+
+   if (start < 0) {
+      count += start;
+      start = 0;
+   }
+   if (start + count > layout->num_lines)
+      count = layout->num_lines - start;
+   if (count <= 0)
+      return;
+
+   for (i = start; i < start + count; i++) {
+      if (layout->lines[i].width == layout->width)
+         layout->width = -1;
+      al_ustr_free(layout->lines[i].text);
+   }
+
+   memmove(layout->lines + start, layout->lines + start + count,
+      (layout->num_lines - start - count) * sizeof(TEXT_LAYOUT_LINE));
+   layout->num_lines -= count;
+}
+
+
+
+/* Function: al_get_text_layout_line_count
+ */
+int al_get_text_layout_line_count(const ALLEGRO_TEXT_LAYOUT *layout)
+{
+   ASSERT(layout);
+   return layout->num_lines;
+}
+
+
+
+/* Function: al_get_text_layout_line
+ */
+const ALLEGRO_USTR *al_get_text_layout_line(const ALLEGRO_TEXT_LAYOUT *layout,
+   int index)
+{
+   ASSERT(layout);
+
+   if (index < 0 || index >= layout->num_lines)
+      return NULL;
+   return layout->lines[index].text;
+}
+
+
+
+/* Function: al_get_text_layout_width
+ */
+int al_get_text_layout_width(const ALLEGRO_TEXT_LAYOUT *layout)
+{
+   ALLEGRO_TEXT_LAYOUT *mutable_layout = (ALLEGRO_TEXT_LAYOUT *)layout;
+   int i;
+   ASSERT(layout);
+
+   if (layout->width < 0) {
+      mutable_layout->width = 0;
+      for (i = 0; i < layout->num_lines; i++) {
+         if (layout->lines[i].width > layout->width)
+            mutable_layout->width = layout->lines[i].width;
+      }
+   }
+   return layout->width;
+}
+
+
+
+/* Function: al_get_text_layout_height
+ */
+int al_get_text_layout_height(const ALLEGRO_TEXT_LAYOUT *layout)
+{
+   ASSERT(layout);
+   return layout->num_lines * layout->line_height;
+}
+
+
+
+/* Work out which lines can intersect the clipping rectangle of the target
+ * bitmap when the layout is drawn at y.  If the current transformation
+ * cannot be inverted all lines are considered visible.
+ */
+static void get_visible_lines(const ALLEGRO_TEXT_LAYOUT *layout, float y,
+   int *first, int *last)
+{
+   ALLEGRO_TRANSFORM inv;
+   int cx, cy, cw, ch;
+   float xs[4], ys[4];
+   float miny, maxy;
+   int i;
+
+   *first = 0;
+   *last = layout->num_lines;
+
+   al_copy_transform(&inv, al_get_current_transform());
+   if (!al_check_inverse(&inv, 1e-7))
+      return;
+   al_invert_transform(&inv);
+
+   al_get_clipping_rectangle(&cx, &cy, &cw, &ch);
+   xs[0] = xs[3] = cx;
+   xs[1] = xs[2] = cx + cw;
+   ys[0] = ys[1] = cy;
+   ys[2] = ys[3] = cy + ch;
+   for (i = 0; i < 4; i++)
+      al_transform_coordinates(&inv, &xs[i], &ys[i]);
+
+   miny = maxy = ys[0];
+   for (i = 1; i < 4; i++) {
+      miny = _ALLEGRO_MIN(miny, ys[i]);
+      maxy = _ALLEGRO_MAX(maxy, ys[i]);
+   }
+
+   /* Allow a line of slack for glyphs which extend past their line. */
+   *first = _ALLEGRO_MAX(0,
+      (int)floorf((miny - y) / layout->line_height) - 1);
+   *last = _ALLEGRO_MIN(layout->num_lines,
+      (int)ceilf((maxy - y) / layout->line_height) + 1);
+}
+
+
+
+/* Function: al_draw_text_layout
+ */
+void al_draw_text_layout(const ALLEGRO_TEXT_LAYOUT *layout,
+   ALLEGRO_COLOR color, float x, float y, int flags)
+{
+   const ALLEGRO_FONT *font;
+   ALLEGRO_TRANSFORM const *fwd = NULL;
+   ALLEGRO_TRANSFORM inv;
+   bool held;
+   int first, last;
+   int i;
+   ASSERT(layout);
+
+   if (layout->num_lines == 0 || layout->line_height <= 0)
+      return;
+
+   font = layout->font;
+   get_visible_lines(layout, y, &first, &last);
+   if (first >= last)
+      return;
+
+   if (flags & ALLEGRO_ALIGN_INTEGER) {
+      fwd = al_get_current_transform();
+      al_copy_transform(&inv, fwd);
+      al_invert_transform(&inv);
+   }
+
+   held = al_is_bitmap_drawing_held();
+   if (!held)
+      al_hold_bitmap_drawing(true);
+
+   for (i = first; i < last; i++) {
+      const TEXT_LAYOUT_LINE *line = &layout->lines[i];
+      float drawx = x;
+      float drawy = y + i * layout->line_height;
+
+      if (flags & ALLEGRO_ALIGN_CENTRE)
+         drawx -= line->width / 2;
+      else if (flags & ALLEGRO_ALIGN_RIGHT)
+         drawx -= line->width;
+
+      if (flags & ALLEGRO_ALIGN_INTEGER) {
+         al_transform_coordinates(fwd, &drawx, &drawy);
+         drawx = floorf(drawx + 0.5f);
+         drawy = floorf(drawy + 0.5f);
+         al_transform_coordinates(&inv, &drawx, &drawy);
+      }
+
+      font->vtable->render(font, color, line->text, drawx, drawy);
+   }
+
+   if (!held)
+      al_hold_bitmap_drawing(false);
+}
+
+/* vim: set sts=3 sw=3 et: */
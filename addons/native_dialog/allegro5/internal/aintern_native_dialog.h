@@ -1,6 +1,7 @@
 #ifndef __al_included_allegro_aintern_native_dialog_h
 #define __al_included_allegro_aintern_native_dialog_h
 
+#include "allegro5/internal/aintern_list.h"
 #include "allegro5/internal/aintern_vector.h"
 
 typedef struct ALLEGRO_NATIVE_DIALOG ALLEGRO_NATIVE_DIALOG;
@@ -12,6 +13,7 @@ struct ALLEGRO_NATIVE_DIALOG
 {
    ALLEGRO_USTR *title;
    int flags;
+   _AL_LIST_ITEM *dtor_item;
 
    /* Only used by file chooser. */
    ALLEGRO_PATH *fc_initial_path;
@@ -146,6 +146,10 @@ struct ALLEGRO_VERTEX {
  */
 typedef struct ALLEGRO_VERTEX_BUFFER ALLEGRO_VERTEX_BUFFER;
 
+/* Type: ALLEGRO_PRIM_BATCH
+ */
+typedef struct ALLEGRO_PRIM_BATCH ALLEGRO_PRIM_BATCH;
+
 ALLEGRO_PRIM_FUNC(uint32_t, al_get_allegro_primitives_version, (void));
 
 /*
@@ -212,12 +216,28 @@ ALLEGRO_PRIM_FUNC(void, al_draw_filled_triangle, (float x1, float y1, float x2,
 ALLEGRO_PRIM_FUNC(void, al_draw_filled_rectangle, (float x1, float y1, float x2, float y2, ALLEGRO_COLOR color));
 ALLEGRO_PRIM_FUNC(void, al_draw_filled_ellipse, (float cx, float cy, float rx, float ry, ALLEGRO_COLOR color));
 ALLEGRO_PRIM_FUNC(void, al_draw_filled_circle, (float cx, float cy, float r, ALLEGRO_COLOR color));
+ALLEGRO_PRIM_FUNC(void, al_draw_filled_circles, (const float *centers, int stride, int num_circles, float r, ALLEGRO_COLOR color));
 ALLEGRO_PRIM_FUNC(void, al_draw_filled_pieslice, (float cx, float cy, float r, float start_theta, float delta_theta, ALLEGRO_COLOR color));
 ALLEGRO_PRIM_FUNC(void, al_draw_filled_rounded_rectangle, (float x1, float y1, float x2, float y2, float rx, float ry, ALLEGRO_COLOR color));
 
 ALLEGRO_PRIM_FUNC(void, al_draw_polyline, (const float* vertices, int vertex_count, ALLEGRO_LINE_JOIN join_style, ALLEGRO_LINE_CAP cap_style, ALLEGRO_COLOR color, float thickness, float miter_limit));
 ALLEGRO_PRIM_FUNC(void, al_draw_polyline_ex, (const float* vertices, int vertex_stride, int vertex_count, ALLEGRO_LINE_JOIN join_style, ALLEGRO_LINE_CAP cap_style, ALLEGRO_COLOR color, float thickness, float miter_limit));
 
+/*
+* Batches
+*/
+ALLEGRO_PRIM_FUNC(ALLEGRO_PRIM_BATCH*, al_create_prim_batch, (void));
+ALLEGRO_PRIM_FUNC(void, al_destroy_prim_batch, (ALLEGRO_PRIM_BATCH* batch));
+ALLEGRO_PRIM_FUNC(void, al_flush_prim_batch, (ALLEGRO_PRIM_BATCH* batch));
+ALLEGRO_PRIM_FUNC(void, al_batch_prim, (ALLEGRO_PRIM_BATCH* batch, const ALLEGRO_VERTEX* vtxs, ALLEGRO_BITMAP* texture, int num_vtx, int type));
+ALLEGRO_PRIM_FUNC(void, al_batch_line, (ALLEGRO_PRIM_BATCH* batch, float x1, float y1, float x2, float y2, ALLEGRO_COLOR color, float thickness));
+ALLEGRO_PRIM_FUNC(void, al_batch_filled_triangle, (ALLEGRO_PRIM_BATCH* batch, float x1, float y1, float x2, float y2, float x3, float y3, ALLEGRO_COLOR color));
+ALLEGRO_PRIM_FUNC(void, al_batch_rectangle, (ALLEGRO_PRIM_BATCH* batch, float x1, float y1, float x2, float y2, ALLEGRO_COLOR color, float thickness));
+ALLEGRO_PRIM_FUNC(void, al_batch_filled_rectangle, (ALLEGRO_PRIM_BATCH* batch, float x1, float y1, float x2, float y2, ALLEGRO_COLOR color));
+ALLEGRO_PRIM_FUNC(void, al_batch_circle, (ALLEGRO_PRIM_BATCH* batch, float cx, float cy, float r, ALLEGRO_COLOR color, float thickness));
+ALLEGRO_PRIM_FUNC(void, al_batch_filled_circle, (ALLEGRO_PRIM_BATCH* batch, float cx, float cy, float r, ALLEGRO_COLOR color));
+ALLEGRO_PRIM_FUNC(void, al_batch_polyline, (ALLEGRO_PRIM_BATCH* batch, const float* vertices, int vertex_stride, int vertex_count, ALLEGRO_LINE_JOIN join_style, ALLEGRO_LINE_CAP cap_style, ALLEGRO_COLOR color, float thickness, float miter_limit));
+
 ALLEGRO_PRIM_FUNC(void, al_draw_polygon, (const float* vertices, int vertex_count, ALLEGRO_LINE_JOIN join_style, ALLEGRO_COLOR color, float thickness, float miter_limit));
 ALLEGRO_PRIM_FUNC(void, al_draw_polygon_with_holes, (const float* vertices, int vertex_count, const int* holes, int hole_count, ALLEGRO_LINE_JOIN join_style, ALLEGRO_COLOR color, float thickness, float miter_limit));
 ALLEGRO_PRIM_FUNC(void, al_draw_filled_polygon, (const float* vertices, int vertex_count, ALLEGRO_COLOR color));
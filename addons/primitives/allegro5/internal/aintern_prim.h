@@ -23,6 +23,8 @@ typedef struct ALLEGRO_PRIM_VERTEX_CACHE {
    ALLEGRO_COLOR   color;
    int             prim_type;
    void*           user_data;
+   /* If set, flushed triangles are added to this batch instead of drawn. */
+   ALLEGRO_PRIM_BATCH* batch;
 } ALLEGRO_PRIM_VERTEX_CACHE;
 
 struct ALLEGRO_VERTEX_BUFFER {
@@ -47,6 +49,9 @@ void _al_prim_cache_flush(ALLEGRO_PRIM_VERTEX_CACHE* cache);
 void _al_prim_cache_push_point(ALLEGRO_PRIM_VERTEX_CACHE* cache, const float* v);
 void _al_prim_cache_push_triangle(ALLEGRO_PRIM_VERTEX_CACHE* cache, const float* v0, const float* v1, const float* v2);
 
+void _al_prim_emit_polyline(ALLEGRO_PRIM_VERTEX_CACHE* cache, const float* vertices, int vertex_stride, int vertex_count, int join_style, int cap_style, float thickness, float miter_limit);
+void _al_prim_batch_add_triangles(ALLEGRO_PRIM_BATCH* batch, const ALLEGRO_VERTEX* vtx, int num_vtx);
+
 
 /* Internal functions. */
 float     _al_prim_get_scale(void);
@@ -56,4 +61,8 @@ bool      _al_prim_is_point_in_triangle(const float* point, const float* v0, con
 bool      _al_prim_intersect_segment(const float* v0, const float* v1, const float* p0, const float* p1, float* point, float* t0, float* t1);
 bool      _al_prim_are_points_equal(const float* point_a, const float* point_b);
 
+/* Cached unit arc tables used by the high level routines. */
+void      _al_prim_init_arc_cache(void);
+void      _al_prim_shutdown_arc_cache(void);
+
 #endif
@@ -0,0 +1,539 @@
+/*         ______   ___    ___
+ *        /\  _  \ /\_ \  /\_ \
+ *        \ \ \L\ \\//\ \ \//\ \      __     __   _ __   ___
+ *         \ \  __ \ \ \ \  \ \ \   /'__`\ /'_ `\/\`'__\/ __`\
+ *          \ \ \/\ \ \_\ \_ \_\ \_/\  __//\ \L\ \ \ \//\ \L\ \
+ *           \ \_\ \_\/\____\/\____\ \____\ \____ \ \_\\ \____/
+ *            \/_/\/_/\/____/\/____/\/____/\/___L\ \/_/ \/___/
+ *                                           /\____/
+ *                                           \_/__/
+ *
+ *      Primitive batches: many shapes collected into one indexed
+ *      vertex stream and drawn with a single call.
+ *
+ *      See readme.txt for copyright information.
+ */
+
+#include "allegro5/allegro.h"
+#include "allegro5/allegro_primitives.h"
+#include "allegro5/internal/aintern.h"
+#include "allegro5/internal/aintern_prim.h"
+#include <math.h>
+#include <string.h>
+
+#ifdef ALLEGRO_MSVC
+   #define hypotf(x, y) _hypotf((x), (y))
+#endif
+
+/* Flush before the vertex count would exceed this, so that the indices of
+ * a batch fit in 16 bits wherever a backend needs them to.
+ */
+#define MAX_BATCH_VERTICES  65536
+
+struct ALLEGRO_PRIM_BATCH {
+   ALLEGRO_VERTEX *vtx;
+   int num_vtx;
+   int max_vtx;
+
+   int *indices;
+   int num_indices;
+   int max_indices;
+
+   /* ALLEGRO_PRIM_TRIANGLE_LIST or ALLEGRO_PRIM_LINE_LIST. */
+   int prim_type;
+   ALLEGRO_BITMAP *texture;
+
+   /* The state the queued shapes have to be drawn with. */
+   ALLEGRO_BITMAP *target;
+   ALLEGRO_TRANSFORM transform;
+   int blender[6];
+};
+
+
+
+static void get_blender(int blender[6])
+{
+   al_get_separate_blender(&blender[0], &blender[1], &blender[2],
+      &blender[3], &blender[4], &blender[5]);
+}
+
+
+
+static bool state_changed(const ALLEGRO_PRIM_BATCH *batch)
+{
+   int blender[6];
+
+   if (batch->target != al_get_target_bitmap())
+      return true;
+   get_blender(blender);
+   if (memcmp(blender, batch->blender, sizeof(blender)) != 0)
+      return true;
+   return memcmp(&batch->transform, al_get_current_transform(),
+      sizeof(ALLEGRO_TRANSFORM)) != 0;
+}
+
+
+
+static void draw_batch(ALLEGRO_PRIM_BATCH *batch)
+{
+   al_draw_indexed_prim(batch->vtx, NULL, batch->texture, batch->indices,
+      batch->num_indices, batch->prim_type);
+}
+
+
+
+/* Function: al_flush_prim_batch
+ */
+void al_flush_prim_batch(ALLEGRO_PRIM_BATCH *batch)
+{
+   ASSERT(batch);
+
+   if (batch->num_indices == 0)
+      return;
+
+   if (state_changed(batch)) {
+      /* Draw with the state the shapes were added under. */
+      al_push_state(ALLEGRO_STATE_TARGET_BITMAP | ALLEGRO_STATE_BLENDER |
+         ALLEGRO_STATE_TRANSFORM);
+      al_set_target_bitmap(batch->target);
+      al_set_separate_blender(batch->blender[0], batch->blender[1],
+         batch->blender[2], batch->blender[3], batch->blender[4],
+         batch->blender[5]);
+      al_use_transform(&batch->transform);
+      draw_batch(batch);
+      al_pop_state();
+   }
+   else {
+      draw_batch(batch);
+   }
+
+   batch->num_vtx = 0;
+   batch->num_indices = 0;
+}
+
+
+
+/* Makes room for num_vtx vertices and num_indices indices of the given
+ * type and texture, flushing first if the queued shapes cannot be drawn
+ * together with them.  Returns the index of the first new vertex, or -1
+ * if out of memory.
+ */
+static int reserve(ALLEGRO_PRIM_BATCH *batch, int prim_type,
+   ALLEGRO_BITMAP *texture, int num_vtx, int num_indices)
+{
+   if (batch->num_indices > 0) {
+      if (batch->prim_type != prim_type ||
+            batch->texture != texture ||
+            batch->num_vtx + num_vtx > MAX_BATCH_VERTICES ||
+            state_changed(batch)) {
+         al_flush_prim_batch(batch);
+      }
+   }
+
+   if (batch->num_indices == 0) {
+      batch->prim_type = prim_type;
+      batch->texture = texture;
+      batch->target = al_get_target_bitmap();
+      al_copy_transform(&batch->transform, al_get_current_transform());
+      get_blender(batch->blender);
+   }
+
+   if (batch->num_vtx + num_vtx > batch->max_vtx) {
+      int max_vtx = _ALLEGRO_MAX(batch->max_vtx * 2, batch->num_vtx + num_vtx);
+      ALLEGRO_VERTEX *vtx = al_realloc(batch->vtx, max_vtx * sizeof(*vtx));
+      if (!vtx)
+         return -1;
+      batch->vtx = vtx;
+      batch->max_vtx = max_vtx;
+   }
+
+   if (batch->num_indices + num_indices > batch->max_indices) {
+      int max_indices = _ALLEGRO_MAX(batch->max_indices * 2,
+         batch->num_indices + num_indices);
+      int *indices = al_realloc(batch->indices, max_indices * sizeof(int));
+      if (!indices)
+         return -1;
+      batch->indices = indices;
+      batch->max_indices = max_indices;
+   }
+
+   return batch->num_vtx;
+}
+
+
+
+static ALLEGRO_VERTEX *add_vertices(ALLEGRO_PRIM_BATCH *batch,
+   const ALLEGRO_VERTEX *vtx, int num_vtx)
+{
+   ALLEGRO_VERTEX *dest = batch->vtx + batch->num_vtx;
+   memcpy(dest, vtx, num_vtx * sizeof(*vtx));
+   batch->num_vtx += num_vtx;
+   return dest;
+}
+
+
+
+/* Adds vertices given in any of the ALLEGRO_PRIM_TYPE orders, converting
+ * them to an indexed triangle or line list.
+ */
+static void add_prim(ALLEGRO_PRIM_BATCH *batch, const ALLEGRO_VERTEX *vtx,
+   ALLEGRO_BITMAP *texture, int num_vtx, int type)
+{
+   int prim_type;
+   int num_indices;
+   int base;
+   int *idx;
+   int ii;
+
+   switch (type) {
+      case ALLEGRO_PRIM_TRIANGLE_LIST:
+         num_indices = num_vtx - num_vtx % 3;
+         prim_type = ALLEGRO_PRIM_TRIANGLE_LIST;
+         break;
+      case ALLEGRO_PRIM_TRIANGLE_STRIP:
+      case ALLEGRO_PRIM_TRIANGLE_FAN:
+         num_indices = 3 * (num_vtx - 2);
+         prim_type = ALLEGRO_PRIM_TRIANGLE_LIST;
+         break;
+      case ALLEGRO_PRIM_LINE_LIST:
+         num_indices = num_vtx - num_vtx % 2;
+         prim_type = ALLEGRO_PRIM_LINE_LIST;
+         break;
+      case ALLEGRO_PRIM_LINE_STRIP:
+         num_indices = 2 * (num_vtx - 1);
+         prim_type = ALLEGRO_PRIM_LINE_LIST;
+         break;
+      case ALLEGRO_PRIM_LINE_LOOP:
+         num_indices = 2 * num_vtx;
+         prim_type = ALLEGRO_PRIM_LINE_LIST;
+         break;
+      default:
+         ASSERT(false);
+         return;
+   }
+
+   if (num_indices <= 0)
+      return;
+
+   base = reserve(batch, prim_type, texture, num_vtx, num_indices);
+   if (base < 0)
+      return;
+   add_vertices(batch, vtx, num_vtx);
+
+   idx = batch->indices + batch->num_indices;
+   switch (type) {
+      case ALLEGRO_PRIM_TRIANGLE_LIST:
+      case ALLEGRO_PRIM_LINE_LIST:
+         for (ii = 0; ii < num_indices; ii++)
+            *idx++ = base + ii;
+         break;
+      case ALLEGRO_PRIM_TRIANGLE_STRIP:
+         for (ii = 0; ii < num_vtx - 2; ii++) {
+            *idx++ = base + ii;
+            *idx++ = base + ii + 1;
+            *idx++ = base + ii + 2;
+         }
+         break;
+      case ALLEGRO_PRIM_TRIANGLE_FAN:
+         for (ii = 1; ii < num_vtx - 1; ii++) {
+            *idx++ = base;
+            *idx++ = base + ii;
+            *idx++ = base + ii + 1;
+         }
+         break;
+      case ALLEGRO_PRIM_LINE_STRIP:
+      case ALLEGRO_PRIM_LINE_LOOP:
+         for (ii = 0; ii < num_vtx - 1; ii++) {
+            *idx++ = base + ii;
+            *idx++ = base + ii + 1;
+         }
+         if (type == ALLEGRO_PRIM_LINE_LOOP) {
+            *idx++ = base + num_vtx - 1;
+            *idx++ = base;
+         }
+         break;
+   }
+   batch->num_indices += num_indices;
+}
+
+
+
+static void set_vertex(ALLEGRO_VERTEX *v, float x, float y,
+   ALLEGRO_COLOR color)
+{
+   v->x = x;
+   v->y = y;
+   v->z = 0;
+   v->u = 0;
+   v->v = 0;
+   v->color = color;
+}
+
+
+
+/* Called by _al_prim_cache_flush for caches which feed a batch. */
+void _al_prim_batch_add_triangles(ALLEGRO_PRIM_BATCH *batch,
+   const ALLEGRO_VERTEX *vtx, int num_vtx)
+{
+   add_prim(batch, vtx, NULL, num_vtx, ALLEGRO_PRIM_TRIANGLE_LIST);
+}
+
+
+
+/* Function: al_create_prim_batch
+ */
+ALLEGRO_PRIM_BATCH *al_create_prim_batch(void)
+{
+   return al_calloc(1, sizeof(ALLEGRO_PRIM_BATCH));
+}
+
+
+
+/* Function: al_destroy_prim_batch
+ */
+void al_destroy_prim_batch(ALLEGRO_PRIM_BATCH *batch)
+{
+   if (!batch)
+      return;
+
+   al_free(batch->vtx);
+   al_free(batch->indices);
+   al_free(batch);
+}
+
+
+
+/* Function: al_batch_prim
+ */
+void al_batch_prim(ALLEGRO_PRIM_BATCH *batch, const ALLEGRO_VERTEX *vtxs,
+   ALLEGRO_BITMAP *texture, int num_vtx, int type)
+{
+   ASSERT(batch);
+   ASSERT(vtxs);
+
+   add_prim(batch, vtxs, texture, num_vtx, type);
+}
+
+
+
+/* Function: al_batch_line
+ */
+void al_batch_line(ALLEGRO_PRIM_BATCH *batch, float x1, float y1,
+   float x2, float y2, ALLEGRO_COLOR color, float thickness)
+{
+   ALLEGRO_VERTEX vtx[4];
+   ASSERT(batch);
+
+   if (thickness > 0) {
+      float len = hypotf(x2 - x1, y2 - y1);
+      float tx, ty;
+
+      if (len == 0)
+         return;
+
+      tx = 0.5f * thickness * (y2 - y1) / len;
+      ty = 0.5f * thickness * -(x2 - x1) / len;
+
+      set_vertex(&vtx[0], x1 + tx, y1 + ty, color);
+      set_vertex(&vtx[1], x1 - tx, y1 - ty, color);
+      set_vertex(&vtx[2], x2 - tx, y2 - ty, color);
+      set_vertex(&vtx[3], x2 + tx, y2 + ty, color);
+      add_prim(batch, vtx, NULL, 4, ALLEGRO_PRIM_TRIANGLE_FAN);
+   }
+   else {
+      set_vertex(&vtx[0], x1, y1, color);
+      set_vertex(&vtx[1], x2, y2, color);
+      add_prim(batch, vtx, NULL, 2, ALLEGRO_PRIM_LINE_LIST);
+   }
+}
+
+
+
+/* Function: al_batch_filled_triangle
+ */
+void al_batch_filled_triangle(ALLEGRO_PRIM_BATCH *batch, float x1, float y1,
+   float x2, float y2, float x3, float y3, ALLEGRO_COLOR color)
+{
+   ALLEGRO_VERTEX vtx[3];
+   ASSERT(batch);
+
+   set_vertex(&vtx[0], x1, y1, color);
+   set_vertex(&vtx[1], x2, y2, color);
+   set_vertex(&vtx[2], x3, y3, color);
+   add_prim(batch, vtx, NULL, 3, ALLEGRO_PRIM_TRIANGLE_LIST);
+}
+
+
+
+/* Function: al_batch_rectangle
+ */
+void al_batch_rectangle(ALLEGRO_PRIM_BATCH *batch, float x1, float y1,
+   float x2, float y2, ALLEGRO_COLOR color, float thickness)
+{
+   ASSERT(batch);
+
+   if (thickness > 0) {
+      float t = thickness / 2;
+      ALLEGRO_VERTEX vtx[10];
+
+      set_vertex(&vtx[0], x1 - t, y1 - t, color);
+      set_vertex(&vtx[1], x1 + t, y1 + t, color);
+      set_vertex(&vtx[2], x2 + t, y1 - t, color);
+      set_vertex(&vtx[3], x2 - t, y1 + t, color);
+      set_vertex(&vtx[4], x2 + t, y2 + t, color);
+      set_vertex(&vtx[5], x2 - t, y2 - t, color);
+      set_vertex(&vtx[6], x1 - t, y2 + t, color);
+      set_vertex(&vtx[7], x1 + t, y2 - t, color);
+      set_vertex(&vtx[8], x1 - t, y1 - t, color);
+      set_vertex(&vtx[9], x1 + t, y1 + t, color);
+      add_prim(batch, vtx, NULL, 10, ALLEGRO_PRIM_TRIANGLE_STRIP);
+   }
+   else {
+      ALLEGRO_VERTEX vtx[4];
+
+      set_vertex(&vtx[0], x1, y1, color);
+      set_vertex(&vtx[1], x2, y1, color);
+      set_vertex(&vtx[2], x2, y2, color);
+      set_vertex(&vtx[3], x1, y2, color);
+      add_prim(batch, vtx, NULL, 4, ALLEGRO_PRIM_LINE_LOOP);
+   }
+}
+
+
+
+/* Function: al_batch_filled_rectangle
+ */
+void al_batch_filled_rectangle(ALLEGRO_PRIM_BATCH *batch, float x1, float y1,
+   float x2, float y2, ALLEGRO_COLOR color)
+{
+   ALLEGRO_VERTEX vtx[4];
+   ASSERT(batch);
+
+   set_vertex(&vtx[0], x1, y1, color);
+   set_vertex(&vtx[1], x1, y2, color);
+   set_vertex(&vtx[2], x2, y2, color);
+   set_vertex(&vtx[3], x2, y1, color);
+   add_prim(batch, vtx, NULL, 4, ALLEGRO_PRIM_TRIANGLE_FAN);
+}
+
+
+
+/* Function: al_batch_circle
+ */
+void al_batch_circle(ALLEGRO_PRIM_BATCH *batch, float cx, float cy, float r,
+   ALLEGRO_COLOR color, float thickness)
+{
+   ALLEGRO_VERTEX vtx[ALLEGRO_VERTEX_CACHE_SIZE];
+   float scale = _al_prim_get_scale();
+   int num_segments;
+   int ii;
+
+   ASSERT(batch);
+   ASSERT(r >= 0);
+
+   /* Same tessellation as al_draw_circle. */
+   num_segments = ALLEGRO_PRIM_QUALITY * scale * sqrtf(r);
+   if (num_segments < 2)
+      return;
+
+   if (thickness > 0) {
+      if (2 * num_segments >= ALLEGRO_VERTEX_CACHE_SIZE)
+         num_segments = (ALLEGRO_VERTEX_CACHE_SIZE - 1) / 2;
+
+      al_calculate_arc(&vtx[0].x, sizeof(ALLEGRO_VERTEX), cx, cy, r, r, 0,
+         ALLEGRO_PI * 2, thickness, num_segments);
+      for (ii = 0; ii < 2 * num_segments; ii++)
+         set_vertex(&vtx[ii], vtx[ii].x, vtx[ii].y, color);
+      add_prim(batch, vtx, NULL, 2 * num_segments,
+         ALLEGRO_PRIM_TRIANGLE_STRIP);
+   }
+   else {
+      if (num_segments >= ALLEGRO_VERTEX_CACHE_SIZE)
+         num_segments = ALLEGRO_VERTEX_CACHE_SIZE - 1;
+
+      al_calculate_arc(&vtx[0].x, sizeof(ALLEGRO_VERTEX), cx, cy, r, r, 0,
+         ALLEGRO_PI * 2, 0, num_segments);
+      for (ii = 0; ii < num_segments; ii++)
+         set_vertex(&vtx[ii], vtx[ii].x, vtx[ii].y, color);
+      /* The last point repeats the first one. */
+      add_prim(batch, vtx, NULL, num_segments - 1, ALLEGRO_PRIM_LINE_LOOP);
+   }
+}
+
+
+
+/* Function: al_batch_filled_circle
+ */
+void al_batch_filled_circle(ALLEGRO_PRIM_BATCH *batch, float cx, float cy,
+   float r, ALLEGRO_COLOR color)
+{
+   ALLEGRO_VERTEX vtx[ALLEGRO_VERTEX_CACHE_SIZE];
+   float scale = _al_prim_get_scale();
+   int num_segments;
+   int ii;
+
+   ASSERT(batch);
+   ASSERT(r >= 0);
+
+   /* Same tessellation as al_draw_filled_circle. */
+   num_segments = ALLEGRO_PRIM_QUALITY * scale * sqrtf(r);
+   if (num_segments < 2)
+      return;
+   if (num_segments >= ALLEGRO_VERTEX_CACHE_SIZE)
+      num_segments = ALLEGRO_VERTEX_CACHE_SIZE - 1;
+
+   al_calculate_arc(&vtx[1].x, sizeof(ALLEGRO_VERTEX), cx, cy, r, r, 0,
+      ALLEGRO_PI * 2, 0, num_segments);
+   vtx[0].x = cx;
+   vtx[0].y = cy;
+   for (ii = 0; ii < num_segments + 1; ii++)
+      set_vertex(&vtx[ii], vtx[ii].x, vtx[ii].y, color);
+   add_prim(batch, vtx, NULL, num_segments + 1, ALLEGRO_PRIM_TRIANGLE_FAN);
+}
+
+
+
+/* Function: al_batch_polyline
+ */
+void al_batch_polyline(ALLEGRO_PRIM_BATCH *batch, const float *vertices,
+   int vertex_stride, int vertex_count, ALLEGRO_LINE_JOIN join_style,
+   ALLEGRO_LINE_CAP cap_style, ALLEGRO_COLOR color, float thickness,
+   float miter_limit)
+{
+   ASSERT(batch);
+   ASSERT(vertices);
+
+   if (thickness > 0) {
+      ALLEGRO_PRIM_VERTEX_CACHE cache;
+
+      _al_prim_cache_init(&cache, ALLEGRO_PRIM_VERTEX_CACHE_TRIANGLE, color);
+      cache.batch = batch;
+      _al_prim_emit_polyline(&cache, vertices, vertex_stride, vertex_count,
+         join_style, cap_style, thickness, miter_limit);
+      _al_prim_cache_term(&cache);
+   }
+   else {
+      ALLEGRO_VERTEX vtx[ALLEGRO_VERTEX_CACHE_SIZE];
+      int start = 0;
+
+      /* Like al_draw_polyline this ignores ALLEGRO_LINE_CAP_CLOSED for
+       * hairlines.  Long lines are added in pieces which share their end
+       * points.
+       */
+      while (start < vertex_count - 1) {
+         int count = _ALLEGRO_MIN(vertex_count - start,
+            ALLEGRO_VERTEX_CACHE_SIZE);
+         int ii;
+
+         for (ii = 0; ii < count; ii++) {
+            const float *v = (const float *)((const char *)vertices +
+               (start + ii) * vertex_stride);
+            set_vertex(&vtx[ii], v[0], v[1], color);
+         }
+         add_prim(batch, vtx, NULL, count, ALLEGRO_PRIM_LINE_STRIP);
+         start += count - 1;
+      }
+   }
+}
+
+/* vim: set sts=3 sw=3 et: */
@@ -41,7 +41,10 @@
 #ifdef ALLEGRO_CFG_OPENGL
 #include "allegro5/allegro_opengl.h"
 #endif
+#include "allegro5/internal/aintern.h"
+#include "allegro5/internal/aintern_atomicops.h"
 #include "allegro5/internal/aintern_bitmap.h"
+#include "allegro5/internal/aintern_prim.h"
 #include <math.h>
 
 #ifdef ALLEGRO_MSVC
@@ -405,30 +408,108 @@ void al_draw_filled_rectangle(float x1, float y1, float x2, float y2,
    al_draw_prim(vtx, 0, 0, 0, 4, ALLEGRO_PRIM_TRIANGLE_FAN);
 }
 
-/* Function: al_calculate_arc
+/*
+ * Unit arcs for the full circle and the quarter circle, as used by the
+ * ellipse and rounded rectangle routines, are cached by segment count.
+ * A table holds num_segments (cos, sin) pairs generated by exactly the
+ * same rotation as uncached arcs, so the output does not change.  Tables
+ * are built under arc_mutex and published with a release store; once
+ * published a pointer never changes until the addon is shut down, so
+ * lookups only need an acquire load.
  */
-void al_calculate_arc(float* dest, int stride, float cx, float cy,
-   float rx, float ry, float start_theta, float delta_theta, float thickness,
+#define ARC_CACHE_FULL     0
+#define ARC_CACHE_QUARTER  1
+#define ARC_CACHE_MAX_SEGMENTS  ALLEGRO_VERTEX_CACHE_SIZE
+
+static ALLEGRO_MUTEX *arc_mutex = NULL;
+static void * volatile arc_cache[2][ARC_CACHE_MAX_SEGMENTS + 1];
+
+static void fill_unit_arc(float *dest, float start_theta, float theta,
    int num_segments)
-{   
-   float theta;
-   float c;
-   float s;
-   float x, y, t;
+{
+   float c = cosf(theta);
+   float s = sinf(theta);
+   float x = cosf(start_theta);
+   float y = sinf(start_theta);
+   float t;
+   int ii;
+
+   for (ii = 0; ii < num_segments; ii++) {
+      dest[2 * ii] = x;
+      dest[2 * ii + 1] = y;
+
+      t = x;
+      x = c * x - s * y;
+      y = s * t + c * y;
+   }
+}
+
+static const float *get_cached_unit_arc(float start_theta, float delta_theta,
+   int num_segments)
+{
+   void * volatile *slot;
+   float *table;
+   int kind;
+
+   if (!arc_mutex || start_theta != 0.0f ||
+         num_segments > ARC_CACHE_MAX_SEGMENTS)
+      return NULL;
+
+   if (delta_theta == (float)(ALLEGRO_PI * 2))
+      kind = ARC_CACHE_FULL;
+   else if (delta_theta == (float)(ALLEGRO_PI / 2))
+      kind = ARC_CACHE_QUARTER;
+   else
+      return NULL;
+
+   slot = &arc_cache[kind][num_segments];
+   table = _al_load_ptr_acquire(slot);
+   if (!table) {
+      al_lock_mutex(arc_mutex);
+      table = *slot;
+      if (!table) {
+         table = al_malloc(2 * num_segments * sizeof(float));
+         if (table) {
+            fill_unit_arc(table, start_theta,
+               delta_theta / ((float)num_segments - 1), num_segments);
+            _al_store_ptr_release(slot, table);
+         }
+      }
+      al_unlock_mutex(arc_mutex);
+   }
+   return table;
+}
+
+void _al_prim_init_arc_cache(void)
+{
+   if (!arc_mutex)
+      arc_mutex = al_create_mutex();
+}
+
+void _al_prim_shutdown_arc_cache(void)
+{
+   int kind, ii;
+
+   for (kind = 0; kind < 2; kind++) {
+      for (ii = 0; ii <= ARC_CACHE_MAX_SEGMENTS; ii++) {
+         al_free(arc_cache[kind][ii]);
+         arc_cache[kind][ii] = NULL;
+      }
+   }
+   al_destroy_mutex(arc_mutex);
+   arc_mutex = NULL;
+}
+
+/* Writes the points of an arc, given as a table of unit vectors, to dest.
+ * Returns where the next point would go.
+ */
+static float *emit_arc(float *dest, int stride, const float *unit,
+   int num_segments, float cx, float cy, float rx, float ry, float thickness)
+{
+   float x, y;
    int ii;
- 
-   ASSERT(dest);
-   ASSERT(num_segments > 1);
-   ASSERT(rx >= 0);
-   ASSERT(ry >= 0);
 
    if (thickness > 0.0f) {
-      theta = delta_theta / ((float)(num_segments) - 1);
-      c = cosf(theta);
-      s = sinf(theta);
-      x = cosf(start_theta);
-      y = sinf(start_theta);
- 
       if (rx == ry) {
          /*
          The circle case is particularly simple
@@ -436,23 +517,24 @@ void al_calculate_arc(float* dest, int stride, float cx, float cy,
          float r1 = rx - thickness / 2.0f;
          float r2 = rx + thickness / 2.0f;
          for (ii = 0; ii < num_segments; ii ++) {
+            x = unit[2 * ii];
+            y = unit[2 * ii + 1];
             *dest =       r2 * x + cx;
             *(dest + 1) = r2 * y + cy;
             dest = (float*)(((char*)dest) + stride);
             *dest =        r1 * x + cx;
             *(dest + 1) =  r1 * y + cy;
             dest = (float*)(((char*)dest) + stride);
-            
-            t = x;
-            x = c * x - s * y;
-            y = s * t + c * y;
          }
       } else {
          if (rx != 0 && !ry == 0) {
             for (ii = 0; ii < num_segments; ii++) {
-               float denom = hypotf(ry * x, rx * y);
-               float nx = thickness / 2 * ry * x / denom;
-               float ny = thickness / 2 * rx * y / denom;
+               float denom, nx, ny;
+               x = unit[2 * ii];
+               y = unit[2 * ii + 1];
+               denom = hypotf(ry * x, rx * y);
+               nx = thickness / 2 * ry * x / denom;
+               ny = thickness / 2 * rx * y / denom;
 
                *dest =       rx * x + cx + nx;
                *(dest + 1) = ry * y + cy + ny;
@@ -460,30 +542,61 @@ void al_calculate_arc(float* dest, int stride, float cx, float cy,
                *dest =       rx * x + cx - nx;
                *(dest + 1) = ry * y + cy - ny;
                dest = (float*)(((char*)dest) + stride);
-
-               t = x;
-               x = c * x - s * y;
-               y = s * t + c * y;
             }
          }
       }
    } else {
-      theta = delta_theta / ((float)num_segments - 1);
-      c = cosf(theta);
-      s = sinf(theta);
-      x = cosf(start_theta);
-      y = sinf(start_theta);
-      
       for (ii = 0; ii < num_segments; ii++) {
-         *dest =       rx * x + cx;
-         *(dest + 1) = ry * y + cy;
+         *dest =       rx * unit[2 * ii] + cx;
+         *(dest + 1) = ry * unit[2 * ii + 1] + cy;
          dest = (float*)(((char*)dest) + stride);
-
-         t = x;
-         x = c * x - s * y;
-         y = s * t + c * y;
       }
    }
+
+   return dest;
+}
+
+/* Function: al_calculate_arc
+ */
+void al_calculate_arc(float* dest, int stride, float cx, float cy,
+   float rx, float ry, float start_theta, float delta_theta, float thickness,
+   int num_segments)
+{   
+   float scratch[2 * ARC_CACHE_MAX_SEGMENTS];
+   float *heap = NULL;
+   const float *unit;
+   float theta;
+   int ii, n;
+ 
+   ASSERT(dest);
+   ASSERT(num_segments > 1);
+   ASSERT(rx >= 0);
+   ASSERT(ry >= 0);
+
+   unit = get_cached_unit_arc(start_theta, delta_theta, num_segments);
+   if (unit) {
+      emit_arc(dest, stride, unit, num_segments, cx, cy, rx, ry, thickness);
+      return;
+   }
+
+   theta = delta_theta / ((float)num_segments - 1);
+   if (num_segments > ARC_CACHE_MAX_SEGMENTS)
+      heap = al_malloc(2 * num_segments * sizeof(float));
+   if (heap) {
+      fill_unit_arc(heap, start_theta, theta, num_segments);
+      emit_arc(dest, stride, heap, num_segments, cx, cy, rx, ry, thickness);
+      al_free(heap);
+      return;
+   }
+
+   /* Short arcs fit on the stack.  Longer ones do too, a piece at a time,
+    * if there was no memory for the whole table.
+    */
+   for (ii = 0; ii < num_segments; ii += n) {
+      n = _ALLEGRO_MIN(num_segments - ii, ARC_CACHE_MAX_SEGMENTS);
+      fill_unit_arc(scratch, start_theta + ii * theta, theta, n);
+      dest = emit_arc(dest, stride, scratch, n, cx, cy, rx, ry, thickness);
+   }
 }
 
 /* Function: al_draw_pieslice
@@ -775,6 +888,98 @@ void al_draw_filled_circle(float cx, float cy, float r, ALLEGRO_COLOR color)
    al_draw_filled_ellipse(cx, cy, r, r, color);
 }
 
+/* Function: al_draw_filled_circles
+ */
+void al_draw_filled_circles(const float *centers, int stride, int num_circles,
+   float r, ALLEGRO_COLOR color)
+{
+   /* Vertices drawn by one al_draw_indexed_prim call. */
+   const int max_batch_vtx = 16 * ALLEGRO_VERTEX_CACHE_SIZE;
+   float ring[2 * ALLEGRO_VERTEX_CACHE_SIZE];
+   float scale = get_scale();
+   ALLEGRO_VERTEX *vtx;
+   int *indices;
+   int num_segments, circle_vtx, max_batch;
+   int ii, jj, kk;
+
+   ASSERT(centers);
+   ASSERT(r >= 0);
+
+   if (num_circles <= 0)
+      return;
+
+   /* Same tessellation as al_draw_filled_circle. */
+   num_segments = ALLEGRO_PRIM_QUALITY * scale * sqrtf(r);
+   if (num_segments < 2)
+      return;
+   if (num_segments >= ALLEGRO_VERTEX_CACHE_SIZE) {
+      num_segments = ALLEGRO_VERTEX_CACHE_SIZE - 1;
+   }
+
+   circle_vtx = num_segments + 1;
+   max_batch = _ALLEGRO_MIN(num_circles, max_batch_vtx / circle_vtx);
+
+   vtx = al_malloc(max_batch * circle_vtx * sizeof(*vtx));
+   indices = al_malloc(max_batch * 3 * (num_segments - 1) * sizeof(*indices));
+   if (!vtx || !indices) {
+      al_free(vtx);
+      al_free(indices);
+      for (ii = 0; ii < num_circles; ii++) {
+         const float *c = (const float *)((const char *)centers + ii * stride);
+         al_draw_filled_circle(c[0], c[1], r, color);
+      }
+      return;
+   }
+
+   /* The ring of offsets, the colors and the fans are the same for every
+    * circle; only the centers change from batch to batch.
+    */
+   al_calculate_arc(ring, 2 * sizeof(float), 0, 0, r, r, 0, ALLEGRO_PI * 2,
+      0, num_segments);
+
+   for (ii = 0; ii < max_batch * circle_vtx; ii++) {
+      vtx[ii].z = 0;
+      vtx[ii].u = 0;
+      vtx[ii].v = 0;
+      vtx[ii].color = color;
+   }
+
+   kk = 0;
+   for (ii = 0; ii < max_batch; ii++) {
+      int base = ii * circle_vtx;
+      for (jj = 1; jj < num_segments; jj++) {
+         indices[kk++] = base;
+         indices[kk++] = base + jj;
+         indices[kk++] = base + jj + 1;
+      }
+   }
+
+   for (ii = 0; ii < num_circles; ii += max_batch) {
+      int batch = _ALLEGRO_MIN(max_batch, num_circles - ii);
+
+      for (jj = 0; jj < batch; jj++) {
+         const float *c = (const float *)((const char *)centers +
+            (ii + jj) * stride);
+         ALLEGRO_VERTEX *v = &vtx[jj * circle_vtx];
+         float cx = c[0];
+         float cy = c[1];
+
+         v[0].x = cx;
+         v[0].y = cy;
+         for (kk = 0; kk < num_segments; kk++) {
+            v[kk + 1].x = ring[2 * kk] + cx;
+            v[kk + 1].y = ring[2 * kk + 1] + cy;
+         }
+      }
+
+      al_draw_indexed_prim(vtx, NULL, NULL, indices,
+         batch * 3 * (num_segments - 1), ALLEGRO_PRIM_TRIANGLE_LIST);
+   }
+
+   al_free(vtx);
+   al_free(indices);
+}
+
 /* Function: al_draw_elliptical_arc
  */
 void al_draw_elliptical_arc(float cx, float cy, float rx, float ry, float start_theta,
@@ -266,7 +266,7 @@ static void setup_state(const char* vtxs, const ALLEGRO_VERTEX_DECL* decl, ALLEG
       }
 
       if (!(display->flags & ALLEGRO_USE_PROGRAMMABLE_PIPELINE)) {
-         glBindTexture(GL_TEXTURE_2D, gl_texture);
+         _al_ogl_bind_texture(display, gl_texture);
       }
 
       if (display->flags & ALLEGRO_USE_PROGRAMMABLE_PIPELINE) {
@@ -285,8 +285,8 @@ static void setup_state(const char* vtxs, const ALLEGRO_VERTEX_DECL* decl, ALLEG
             glUniform1i(display->ogl_extras->use_tex_loc, 1);
          }
          if (display->ogl_extras->tex_loc >= 0) {
-            glBindTexture(GL_TEXTURE_2D, al_get_opengl_texture(texture));
             glActiveTexture(GL_TEXTURE0);
+            _al_ogl_bind_texture(display, gl_texture);
             glUniform1i(display->ogl_extras->tex_loc, 0); // 0th sampler
          }
          glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -303,7 +303,7 @@ static void setup_state(const char* vtxs, const ALLEGRO_VERTEX_DECL* decl, ALLEG
          glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
       }
    } else {
-      glBindTexture(GL_TEXTURE_2D, 0);
+      _al_ogl_bind_texture(display, 0);
    }
 }
 
@@ -354,6 +354,9 @@ static void revert_state(ALLEGRO_BITMAP* texture)
       glDisableClientState(GL_VERTEX_ARRAY);
       glDisableClientState(GL_TEXTURE_COORD_ARRAY);
    }
+
+   /* We changed the uniforms behind the cache. */
+   _al_ogl_invalidate_state_cache(display, _AL_OGL_STATE_UNIFORMS);
 }
 
 static int draw_prim_raw(ALLEGRO_BITMAP* target, ALLEGRO_BITMAP* texture,
@@ -432,6 +435,9 @@ static int draw_prim_raw(ALLEGRO_BITMAP* target, ALLEGRO_BITMAP* texture,
       };
    }
 
+   ogl_disp->stats.draw_calls++;
+   ogl_disp->stats.vertices += num_vtx;
+
    revert_state(texture);
 
    if (vertex_buffer) {
@@ -518,6 +524,9 @@ static int draw_prim_indexed_raw(ALLEGRO_BITMAP* target, ALLEGRO_BITMAP* texture
       };
    }
 
+   ogl_disp->stats.draw_calls++;
+   ogl_disp->stats.vertices += num_vtx;
+
    revert_state(texture);
    
    return num_primitives;
@@ -175,6 +175,7 @@ void _al_prim_cache_init_ex(ALLEGRO_PRIM_VERTEX_CACHE* cache, int prim_type, ALL
    cache->color     = color;
    cache->prim_type = prim_type;
    cache->user_data = user_data;
+   cache->batch     = NULL;
 }
 
 void _al_prim_cache_term(ALLEGRO_PRIM_VERTEX_CACHE* cache)
@@ -187,7 +188,11 @@ void _al_prim_cache_flush(ALLEGRO_PRIM_VERTEX_CACHE* cache)
    if (cache->size == 0)
       return;
 
-   if (cache->prim_type == ALLEGRO_PRIM_VERTEX_CACHE_TRIANGLE)
+   if (cache->batch) {
+      ASSERT(cache->prim_type == ALLEGRO_PRIM_VERTEX_CACHE_TRIANGLE);
+      _al_prim_batch_add_triangles(cache->batch, cache->buffer, cache->size);
+   }
+   else if (cache->prim_type == ALLEGRO_PRIM_VERTEX_CACHE_TRIANGLE)
       al_draw_prim(cache->buffer, NULL, NULL, 0, cache->size, ALLEGRO_PRIM_TRIANGLE_LIST);
    else if (cache->prim_type == ALLEGRO_PRIM_VERTEX_CACHE_LINE_STRIP)
       al_draw_prim(cache->buffer, NULL, NULL, 0, cache->size, ALLEGRO_PRIM_LINE_STRIP);
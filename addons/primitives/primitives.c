@@ -24,6 +24,7 @@
 #include "allegro5/internal/aintern_prim_soft.h"
 #include "allegro5/internal/aintern_bitmap.h"
 #include "allegro5/internal/aintern_prim.h"
+#include "allegro5/internal/aintern_profile.h"
 #include "allegro5/internal/aintern.h"
 #include <math.h>
 
@@ -49,6 +50,7 @@ bool al_init_primitives_addon(void)
 {
    bool ret = true;
    ret &= _al_init_d3d_driver();
+   _al_prim_init_arc_cache();
    
    addon_initialized = ret;
    
@@ -62,6 +64,7 @@ bool al_init_primitives_addon(void)
 void al_shutdown_primitives_addon(void)
 {
    _al_shutdown_d3d_driver();
+   _al_prim_shutdown_arc_cache();
    addon_initialized = false;
 }
 
@@ -84,6 +87,7 @@ int al_draw_prim(const void* vtxs, const ALLEGRO_VERTEX_DECL* decl,
     * view space should occur here
     */
    
+   _AL_PROFILE_BEGIN("al_draw_prim");
    if (target->flags & ALLEGRO_MEMORY_BITMAP || (texture && texture->flags & ALLEGRO_MEMORY_BITMAP)) {
       ret =  _al_draw_prim_soft(texture, vtxs, decl, start, end, type);
    } else {
@@ -94,6 +98,7 @@ int al_draw_prim(const void* vtxs, const ALLEGRO_VERTEX_DECL* decl,
          ret =  _al_draw_prim_directx(target, texture, vtxs, decl, start, end, type);
       }
    }
+   _AL_PROFILE_END();
    
    return ret;
 }
@@ -118,6 +123,7 @@ int al_draw_indexed_prim(const void* vtxs, const ALLEGRO_VERTEX_DECL* decl,
     * view space should occur here
     */
    
+   _AL_PROFILE_BEGIN("al_draw_indexed_prim");
    if (target->flags & ALLEGRO_MEMORY_BITMAP || (texture && texture->flags & ALLEGRO_MEMORY_BITMAP)) {
       ret =  _al_draw_prim_indexed_soft(texture, vtxs, decl, indices, num_vtx, type);
    } else {
@@ -128,6 +134,7 @@ int al_draw_indexed_prim(const void* vtxs, const ALLEGRO_VERTEX_DECL* decl,
          ret =  _al_draw_prim_indexed_directx(target, texture, vtxs, decl, indices, num_vtx, type);
       }
    }
+   _AL_PROFILE_END();
    
    return ret;
 }
@@ -23,6 +23,7 @@
 # include "allegro5/internal/aintern_list.h"
 # include <float.h>
 # include <math.h>
+# include <stdlib.h>
 
 
 # define POLY_DEBUG 0
@@ -808,6 +809,860 @@ static void poly_do_triangulate(POLY* polygon)
 }
 
 
+/*
+ *  Sweep line triangulation.
+ *
+ *  The outline and its holes are cut into y-monotone pieces by a sweep
+ *  from top to bottom, which adds a diagonal wherever the boundary turns
+ *  back on itself.  Each piece is then triangulated in a single pass.
+ *  Everything is kept in flat arrays indexed by node, and the whole
+ *  process takes O(n log n) time.
+ *
+ *  Nodes are the input vertices with repeated points dropped.  The y axis
+ *  is flipped, and loops are reversed where needed, so that the outline
+ *  runs counter-clockwise and the holes clockwise.  The interior is then on
+ *  the left of every edge.
+ *
+ *  Input the sweep can not make sense of, such as self-intersecting
+ *  outlines, makes it fail before any triangle is emitted, and the ear
+ *  clipper above is used instead.
+ */
+# define POLY_NODE_START      0
+# define POLY_NODE_END        1
+# define POLY_NODE_SPLIT      2
+# define POLY_NODE_MERGE      3
+# define POLY_NODE_REGULAR    4
+
+# define POLY_CHAIN_LEFT      0
+# define POLY_CHAIN_RIGHT     1
+
+
+typedef struct POLY_NODE {
+   double   x, y;
+   int      index;      /* in the vertex buffer */
+   int      next;
+   int      prev;
+   int      rank;       /* position in sweep order */
+   int      type;
+   int      helper;     /* of the edge from this node to the next one */
+   int      status_pos; /* of that edge in the sweep status, or -1 */
+} POLY_NODE;
+
+typedef struct POLY_SORT_KEY {
+   double   x, y;
+   int      node;
+} POLY_SORT_KEY;
+
+typedef struct POLY_SLOT {
+   double   angle;
+   int      to;
+   bool     used;
+} POLY_SLOT;
+
+typedef struct POLY_SWEEP {
+   POLY_NODE*     nodes;
+   int            node_count;
+   int*           order;
+   /* Edges crossing the sweep line with the interior on their right,
+    * sorted from left to right.
+    */
+   int*           status;
+   int            status_count;
+   /* Pairs of nodes. */
+   int*           diagonals;
+   int            diagonal_count;
+   int            diagonal_capacity;
+   /* Edges and diagonals around each node, sorted by angle. */
+   int*           slot_start;
+   POLY_SLOT*     slots;
+   /* Monotone pieces, as runs of nodes. */
+   int*           faces;
+   int*           face_start;
+   int            face_count;
+   int*           sorted;
+   int*           chain;
+   int*           stack;
+} POLY_SWEEP;
+
+
+# define POLY_VERTEX(index)      ((float*)(((uint8_t*)polygon->vertex_buffer) + (index) * polygon->vertex_stride))
+# define POLY_SPLIT(index)       (*((int*)(((uint8_t*)polygon->split_indices) + (index) * polygon->split_stride)))
+
+
+static double poly_orient(const POLY_NODE* a, const POLY_NODE* b, const POLY_NODE* c)
+{
+   return (b->x - a->x) * (c->y - a->y) - (b->y - a->y) * (c->x - a->x);
+}
+
+
+static double poly_angle(const POLY_NODE* from, const POLY_NODE* to)
+{
+   return atan2(to->y - from->y, to->x - from->x);
+}
+
+
+/*
+ *  Build nodes for the outline and every hole. Returns false if the
+ *  outline has no orientation to go by, and leaves no nodes if it has
+ *  fewer than three distinct points.
+ */
+static bool poly_sweep_build(POLY_SWEEP* sweep, const POLY* polygon)
+{
+   POLY_NODE* nodes = sweep->nodes;
+   size_t loop;
+   int begin = 0;
+   int count = 0;
+
+   for (loop = 0; loop < polygon->split_count; ++loop) {
+
+      int end   = POLY_SPLIT(loop);
+      int first = count;
+      double area = 0.0;
+      int i;
+
+      for (i = begin; i < end; ++i) {
+
+         const float* point = POLY_VERTEX(i);
+
+         if (count > first && nodes[count - 1].x == point[0] && nodes[count - 1].y == -point[1])
+            continue;
+
+         nodes[count].x     = point[0];
+         nodes[count].y     = -point[1];
+         nodes[count].index = i;
+         ++count;
+      }
+
+      if (end > begin)
+         begin = end;
+
+      while (count - first > 1 && nodes[count - 1].x == nodes[first].x && nodes[count - 1].y == nodes[first].y)
+         --count;
+
+      for (i = first; i < count; ++i) {
+
+         POLY_NODE* node = nodes + i;
+
+         node->next       = (i + 1 < count) ? i + 1 : first;
+         node->prev       = (i > first) ? i - 1 : count - 1;
+         node->helper     = -1;
+         node->status_pos = -1;
+
+         area += node->x * nodes[node->next].y - nodes[node->next].x * node->y;
+      }
+
+      /* Drop holes which enclose nothing. */
+      if (count - first < 3 || area == 0.0) {
+
+         if (loop == 0) {
+
+            sweep->node_count = 0;
+            return count - first < 3;
+         }
+
+         count = first;
+         continue;
+      }
+
+      /* Outline counter-clockwise, holes clockwise. */
+      if ((loop == 0) == (area < 0.0)) {
+
+         for (i = first; i < count; ++i) {
+
+            int next = nodes[i].next;
+            nodes[i].next = nodes[i].prev;
+            nodes[i].prev = next;
+         }
+      }
+   }
+
+   sweep->node_count = count;
+
+   return true;
+}
+
+# undef POLY_VERTEX
+# undef POLY_SPLIT
+
+
+static int poly_compare_sort_keys(const void* a, const void* b)
+{
+   const POLY_SORT_KEY* key_a = (const POLY_SORT_KEY*)a;
+   const POLY_SORT_KEY* key_b = (const POLY_SORT_KEY*)b;
+
+   if (key_a->y != key_b->y)
+      return key_a->y > key_b->y ? -1 : 1;
+
+   if (key_a->x != key_b->x)
+      return key_a->x < key_b->x ? -1 : 1;
+
+   return key_a->node - key_b->node;
+}
+
+
+/*
+ *  Sort nodes from top to bottom, left to right at equal height, and
+ *  classify them by the directions of their edges.
+ */
+static bool poly_sweep_sort(POLY_SWEEP* sweep)
+{
+   POLY_NODE* nodes = sweep->nodes;
+   POLY_SORT_KEY* keys;
+   int i;
+
+   keys = (POLY_SORT_KEY*)al_malloc(sweep->node_count * sizeof(POLY_SORT_KEY));
+   if (NULL == keys)
+      return false;
+
+   for (i = 0; i < sweep->node_count; ++i) {
+
+      keys[i].x    = nodes[i].x;
+      keys[i].y    = nodes[i].y;
+      keys[i].node = i;
+   }
+
+   qsort(keys, sweep->node_count, sizeof(POLY_SORT_KEY), poly_compare_sort_keys);
+
+   for (i = 0; i < sweep->node_count; ++i) {
+
+      sweep->order[i] = keys[i].node;
+      nodes[keys[i].node].rank = i;
+   }
+
+   al_free(keys);
+
+   for (i = 0; i < sweep->node_count; ++i) {
+
+      POLY_NODE* node = nodes + i;
+      POLY_NODE* prev = nodes + node->prev;
+      POLY_NODE* next = nodes + node->next;
+      bool prev_above = prev->rank < node->rank;
+      bool next_above = next->rank < node->rank;
+      bool convex = poly_orient(prev, node, next) > 0.0;
+
+      if (!prev_above && !next_above)
+         node->type = convex ? POLY_NODE_START : POLY_NODE_SPLIT;
+      else if (prev_above && next_above)
+         node->type = convex ? POLY_NODE_END : POLY_NODE_MERGE;
+      else
+         node->type = POLY_NODE_REGULAR;
+   }
+
+   return true;
+}
+
+
+/*
+ *  Horizontal position of the edge from 'edge' to the next node at
+ *  height 'y'. Edges in the sweep status always go down.
+ */
+static double poly_edge_x(const POLY_SWEEP* sweep, int edge, double y)
+{
+   const POLY_NODE* a = sweep->nodes + edge;
+   const POLY_NODE* b = sweep->nodes + a->next;
+
+   if (y >= a->y)
+      return a->x;
+
+   if (y <= b->y)
+      return b->x;
+
+   return a->x + (y - a->y) * (b->x - a->x) / (b->y - a->y);
+}
+
+
+/*
+ *  Find the edge in the sweep status directly to the left of 'node'.
+ *  Returns -1 if there is none.
+ */
+static int poly_status_find_left(const POLY_SWEEP* sweep, const POLY_NODE* node)
+{
+   int lo = 0;
+   int hi = sweep->status_count;
+
+   while (lo < hi) {
+
+      int mid = (lo + hi) / 2;
+
+      if (poly_edge_x(sweep, sweep->status[mid], node->y) < node->x)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+
+   return lo > 0 ? sweep->status[lo - 1] : -1;
+}
+
+
+/*
+ *  The status is a sorted array: lookups are binary searches and updates
+ *  shift the entries to their right, which is cheap for the number of
+ *  edges a horizontal line crosses in practice.
+ */
+static void poly_status_insert(POLY_SWEEP* sweep, int edge)
+{
+   const POLY_NODE* node = sweep->nodes + edge;
+   int lo = 0;
+   int hi = sweep->status_count;
+   int i;
+
+   while (lo < hi) {
+
+      int mid = (lo + hi) / 2;
+
+      if (poly_edge_x(sweep, sweep->status[mid], node->y) <= node->x)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+
+   for (i = sweep->status_count; i > lo; --i) {
+
+      sweep->status[i] = sweep->status[i - 1];
+      sweep->nodes[sweep->status[i]].status_pos = i;
+   }
+
+   sweep->status[lo] = edge;
+   sweep->nodes[edge].status_pos = lo;
+   sweep->nodes[edge].helper = edge;
+   ++sweep->status_count;
+}
+
+
+static void poly_status_remove(POLY_SWEEP* sweep, int edge)
+{
+   int i;
+
+   --sweep->status_count;
+
+   for (i = sweep->nodes[edge].status_pos; i < sweep->status_count; ++i) {
+
+      sweep->status[i] = sweep->status[i + 1];
+      sweep->nodes[sweep->status[i]].status_pos = i;
+   }
+
+   sweep->nodes[edge].status_pos = -1;
+}
+
+
+static bool poly_add_diagonal(POLY_SWEEP* sweep, int a, int b)
+{
+   if (sweep->diagonal_count >= sweep->diagonal_capacity)
+      return false;
+
+   sweep->diagonals[sweep->diagonal_count * 2 + 0] = a;
+   sweep->diagonals[sweep->diagonal_count * 2 + 1] = b;
+   ++sweep->diagonal_count;
+
+   return true;
+}
+
+
+/*
+ *  Finish the edge ending at 'node', connecting the node to the helper
+ *  of the edge if that is a merge vertex.
+ */
+static bool poly_sweep_close_edge(POLY_SWEEP* sweep, int node)
+{
+   int edge = sweep->nodes[node].prev;
+   int helper;
+
+   if (sweep->nodes[edge].status_pos < 0)
+      return false;
+
+   helper = sweep->nodes[edge].helper;
+   if (sweep->nodes[helper].type == POLY_NODE_MERGE && !poly_add_diagonal(sweep, node, helper))
+      return false;
+
+   poly_status_remove(sweep, edge);
+
+   return true;
+}
+
+
+/*
+ *  Make 'node' the helper of the edge to its left, connecting it to the
+ *  previous helper when that is a merge vertex, or always if 'connect'.
+ */
+static bool poly_sweep_help_left(POLY_SWEEP* sweep, int node, bool connect)
+{
+   int edge = poly_status_find_left(sweep, sweep->nodes + node);
+   int helper;
+
+   if (edge < 0)
+      return false;
+
+   helper = sweep->nodes[edge].helper;
+   if ((connect || sweep->nodes[helper].type == POLY_NODE_MERGE) && !poly_add_diagonal(sweep, node, helper))
+      return false;
+
+   sweep->nodes[edge].helper = node;
+
+   return true;
+}
+
+
+/*
+ *  Add diagonals which split the polygon into y-monotone pieces.
+ */
+static bool poly_sweep_partition(POLY_SWEEP* sweep)
+{
+   int i;
+
+   for (i = 0; i < sweep->node_count; ++i) {
+
+      int node = sweep->order[i];
+      POLY_NODE* n = sweep->nodes + node;
+
+      switch (n->type) {
+
+         case POLY_NODE_START:
+            poly_status_insert(sweep, node);
+            break;
+
+         case POLY_NODE_END:
+            if (!poly_sweep_close_edge(sweep, node))
+               return false;
+            break;
+
+         case POLY_NODE_SPLIT:
+            if (!poly_sweep_help_left(sweep, node, true))
+               return false;
+            poly_status_insert(sweep, node);
+            break;
+
+         case POLY_NODE_MERGE:
+            if (!poly_sweep_close_edge(sweep, node))
+               return false;
+            if (!poly_sweep_help_left(sweep, node, false))
+               return false;
+            break;
+
+         default:
+            /* Interior to the right when the boundary goes down. */
+            if (sweep->nodes[n->prev].rank < n->rank) {
+
+               if (!poly_sweep_close_edge(sweep, node))
+                  return false;
+               poly_status_insert(sweep, node);
+            }
+            else if (!poly_sweep_help_left(sweep, node, false))
+               return false;
+            break;
+      }
+   }
+
+   return true;
+}
+
+
+static int poly_compare_slots(const void* a, const void* b)
+{
+   const POLY_SLOT* slot_a = (const POLY_SLOT*)a;
+   const POLY_SLOT* slot_b = (const POLY_SLOT*)b;
+
+   if (slot_a->angle != slot_b->angle)
+      return slot_a->angle < slot_b->angle ? -1 : 1;
+
+   return slot_a->to - slot_b->to;
+}
+
+
+static int poly_find_slot(const POLY_SWEEP* sweep, int node, int to)
+{
+   double angle = poly_angle(sweep->nodes + node, sweep->nodes + to);
+   int lo = sweep->slot_start[node];
+   int hi = sweep->slot_start[node + 1];
+
+   while (lo < hi) {
+
+      int mid = (lo + hi) / 2;
+
+      if (sweep->slots[mid].angle < angle)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+
+   for (; lo < sweep->slot_start[node + 1] && sweep->slots[lo].angle == angle; ++lo)
+      if (sweep->slots[lo].to == to)
+         return lo;
+
+   return -1;
+}
+
+
+/*
+ *  Trace the pieces bounded by edges and diagonals. Each piece is walked
+ *  with its interior on the left, taking the sharpest left turn at every
+ *  node.
+ */
+static bool poly_sweep_collect_faces(POLY_SWEEP* sweep)
+{
+   POLY_NODE* nodes = sweep->nodes;
+   int node_count   = sweep->node_count;
+   int slot_count   = 2 * (node_count + sweep->diagonal_count);
+   int face_capacity = sweep->diagonal_count + 1;
+   int* fill = sweep->order;
+   int count = 0;
+   int i;
+
+   sweep->slot_start = (int*)al_malloc((node_count + 1) * sizeof(int));
+   sweep->slots      = (POLY_SLOT*)al_malloc(slot_count * sizeof(POLY_SLOT));
+   sweep->faces      = (int*)al_malloc(slot_count * sizeof(int));
+   sweep->face_start = (int*)al_malloc((face_capacity + 1) * sizeof(int));
+   sweep->sorted     = (int*)al_malloc(slot_count * sizeof(int));
+   sweep->chain      = (int*)al_malloc(slot_count * sizeof(int));
+   sweep->stack      = (int*)al_malloc(slot_count * sizeof(int));
+
+   if (!sweep->slot_start || !sweep->slots || !sweep->faces || !sweep->face_start ||
+       !sweep->sorted || !sweep->chain || !sweep->stack)
+      return false;
+
+   for (i = 0; i < node_count; ++i)
+      fill[i] = 2;
+
+   for (i = 0; i < sweep->diagonal_count * 2; ++i)
+      ++fill[sweep->diagonals[i]];
+
+   for (i = 0; i < node_count; ++i) {
+
+      sweep->slot_start[i] = count;
+      count  += fill[i];
+      fill[i] = sweep->slot_start[i];
+   }
+   sweep->slot_start[node_count] = count;
+
+   /* Edges to the previous node bound the outside, so are never walked. */
+   for (i = 0; i < node_count; ++i) {
+
+      sweep->slots[fill[i]].to   = nodes[i].next;
+      sweep->slots[fill[i]].used = false;
+      ++fill[i];
+
+      sweep->slots[fill[i]].to   = nodes[i].prev;
+      sweep->slots[fill[i]].used = true;
+      ++fill[i];
+   }
+
+   for (i = 0; i < sweep->diagonal_count; ++i) {
+
+      int a = sweep->diagonals[i * 2 + 0];
+      int b = sweep->diagonals[i * 2 + 1];
+
+      sweep->slots[fill[a]].to   = b;
+      sweep->slots[fill[a]].used = false;
+      ++fill[a];
+
+      sweep->slots[fill[b]].to   = a;
+      sweep->slots[fill[b]].used = false;
+      ++fill[b];
+   }
+
+   for (i = 0; i < node_count; ++i) {
+
+      POLY_SLOT* slots = sweep->slots + sweep->slot_start[i];
+      int size = sweep->slot_start[i + 1] - sweep->slot_start[i];
+      int j, k;
+
+      for (j = 0; j < size; ++j)
+         slots[j].angle = poly_angle(nodes + i, nodes + slots[j].to);
+
+      /* Most nodes have no diagonals at all. */
+      if (size > 8) {
+
+         qsort(slots, size, sizeof(POLY_SLOT), poly_compare_slots);
+         continue;
+      }
+
+      for (j = 1; j < size; ++j) {
+
+         POLY_SLOT slot = slots[j];
+
+         for (k = j; k > 0 && poly_compare_slots(&slot, slots + k - 1) < 0; --k)
+            slots[k] = slots[k - 1];
+
+         slots[k] = slot;
+      }
+   }
+
+   count = 0;
+   sweep->face_count = 0;
+
+   for (i = 0; i < node_count; ++i) {
+
+      int first_slot;
+
+      for (first_slot = sweep->slot_start[i]; first_slot < sweep->slot_start[i + 1]; ++first_slot) {
+
+         int node = i;
+         int slot = first_slot;
+
+         if (sweep->slots[slot].used)
+            continue;
+
+         if (sweep->face_count >= face_capacity)
+            return false;
+
+         sweep->face_start[sweep->face_count++] = count;
+
+         do {
+
+            int to = sweep->slots[slot].to;
+            int twin;
+
+            if (sweep->slots[slot].used || count >= slot_count)
+               return false;
+
+            sweep->slots[slot].used = true;
+            sweep->faces[count++]   = node;
+
+            /* Next edge clockwise from the one we came along. */
+            twin = poly_find_slot(sweep, to, node);
+            if (twin < 0)
+               return false;
+
+            slot = (twin > sweep->slot_start[to] ? twin : sweep->slot_start[to + 1]) - 1;
+            node = to;
+
+         } while (slot != first_slot);
+
+         if (count - sweep->face_start[sweep->face_count - 1] < 3)
+            return false;
+      }
+   }
+
+   sweep->face_start[sweep->face_count] = count;
+
+   return true;
+}
+
+
+/*
+ *  Returns the position of the topmost node of a piece, or -1 if the
+ *  piece is not y-monotone or does not run counter-clockwise.
+ */
+static int poly_face_find_top(const POLY_SWEEP* sweep, const int* face, int size)
+{
+   double area = 0.0;
+   int peaks = 0;
+   int top = -1;
+   int i;
+
+   for (i = 0; i < size; ++i) {
+
+      const POLY_NODE* prev = sweep->nodes + face[(i + size - 1) % size];
+      const POLY_NODE* node = sweep->nodes + face[i];
+      const POLY_NODE* next = sweep->nodes + face[(i + 1) % size];
+
+      if (node->rank < prev->rank && node->rank < next->rank) {
+
+         top = i;
+         ++peaks;
+      }
+
+      area += node->x * next->y - next->x * node->y;
+   }
+
+   return (peaks == 1 && area > 0.0) ? top : -1;
+}
+
+
+static void poly_sweep_emit(const POLY_SWEEP* sweep, const POLY* polygon, int a, int b, int c)
+{
+   const POLY_NODE* na = sweep->nodes + a;
+   const POLY_NODE* nb = sweep->nodes + b;
+   const POLY_NODE* nc = sweep->nodes + c;
+
+   if (poly_orient(na, nb, nc) < 0.0)
+      polygon->emit(na->index, nc->index, nb->index, polygon->userdata);
+   else
+      polygon->emit(na->index, nb->index, nc->index, polygon->userdata);
+}
+
+
+/*
+ *  Triangulate y-monotone piece, walking both of its chains downwards at
+ *  once and cutting off every triangle as soon as it is known to be
+ *  inside.
+ */
+static void poly_sweep_triangulate_face(POLY_SWEEP* sweep, const POLY* polygon, const int* face, int size, int top)
+{
+   POLY_NODE* nodes = sweep->nodes;
+   int* sorted = sweep->sorted;
+   int* chain  = sweep->chain;
+   int* stack  = sweep->stack;
+   int depth = 0;
+   int left  = (top + 1) % size;
+   int right = (top + size - 1) % size;
+   int i, j;
+
+   /* Merge both chains into sweep order. */
+   sorted[0] = face[top];
+   chain[0]  = POLY_CHAIN_LEFT;
+
+   for (i = 1; left != right; ++i) {
+
+      if (nodes[face[left]].rank < nodes[face[right]].rank) {
+
+         sorted[i] = face[left];
+         chain[i]  = POLY_CHAIN_LEFT;
+         left = (left + 1) % size;
+      }
+      else {
+
+         sorted[i] = face[right];
+         chain[i]  = POLY_CHAIN_RIGHT;
+         right = (right + size - 1) % size;
+      }
+   }
+
+   sorted[i] = face[left];
+   chain[i]  = POLY_CHAIN_LEFT;
+
+   stack[depth++] = 0;
+   stack[depth++] = 1;
+
+   for (j = 2; j < size - 1; ++j) {
+
+      if (chain[j] != chain[stack[depth - 1]]) {
+
+         /* Fan out to everything on the other chain. */
+         while (depth > 1) {
+
+            int a = stack[--depth];
+            poly_sweep_emit(sweep, polygon, sorted[j], sorted[a], sorted[stack[depth - 1]]);
+         }
+
+         depth = 0;
+         stack[depth++] = j - 1;
+         stack[depth++] = j;
+      }
+      else {
+
+         int last = stack[--depth];
+
+         while (depth > 0) {
+
+            int b = stack[depth - 1];
+            double turn;
+
+            if (chain[j] == POLY_CHAIN_LEFT)
+               turn = poly_orient(nodes + sorted[b], nodes + sorted[last], nodes + sorted[j]);
+            else
+               turn = poly_orient(nodes + sorted[j], nodes + sorted[last], nodes + sorted[b]);
+
+            if (turn <= 0.0)
+               break;
+
+            poly_sweep_emit(sweep, polygon, sorted[j], sorted[last], sorted[b]);
+            last = b;
+            --depth;
+         }
+
+         stack[depth++] = last;
+         stack[depth++] = j;
+      }
+   }
+
+   while (depth > 1) {
+
+      int a = stack[--depth];
+      poly_sweep_emit(sweep, polygon, sorted[size - 1], sorted[a], sorted[stack[depth - 1]]);
+   }
+}
+
+
+static void poly_sweep_destroy(POLY_SWEEP* sweep)
+{
+   al_free(sweep->nodes);
+   al_free(sweep->order);
+   al_free(sweep->status);
+   al_free(sweep->diagonals);
+   al_free(sweep->slot_start);
+   al_free(sweep->slots);
+   al_free(sweep->faces);
+   al_free(sweep->face_start);
+   al_free(sweep->sorted);
+   al_free(sweep->chain);
+   al_free(sweep->stack);
+}
+
+
+/*
+ *  Triangulate polygon with a sweep line. Returns false, without emitting
+ *  anything, if the polygon could not be triangulated this way.
+ */
+static bool poly_sweep_triangulate(POLY* polygon)
+{
+   POLY_SWEEP sweep;
+   bool result = false;
+   int vertex_count;
+   int i;
+
+   vertex_count = *((int*)(((uint8_t*)polygon->split_indices) + (polygon->split_count - 1) * polygon->split_stride));
+   if (vertex_count < 3)
+      return true;
+
+   ASSERT((size_t)vertex_count <= polygon->vertex_count);
+
+   memset(&sweep, 0, sizeof(sweep));
+   sweep.nodes     = (POLY_NODE*)al_malloc(vertex_count * sizeof(POLY_NODE));
+   sweep.order     = (int*)al_malloc(vertex_count * sizeof(int));
+   sweep.status    = (int*)al_malloc(vertex_count * sizeof(int));
+   sweep.diagonals = (int*)al_malloc(vertex_count * 2 * sizeof(int));
+   sweep.diagonal_capacity = vertex_count;
+
+   if (!sweep.nodes || !sweep.order || !sweep.status || !sweep.diagonals)
+      goto done;
+
+   if (!poly_sweep_build(&sweep, polygon))
+      goto done;
+
+   if (sweep.node_count == 0) {
+
+      result = true;
+      goto done;
+   }
+
+   if (!poly_sweep_sort(&sweep) || !poly_sweep_partition(&sweep) || !poly_sweep_collect_faces(&sweep))
+      goto done;
+
+   /* Check every piece before emitting any triangle. */
+   for (i = 0; i < sweep.face_count; ++i) {
+
+      int* face = sweep.faces + sweep.face_start[i];
+      int size  = sweep.face_start[i + 1] - sweep.face_start[i];
+
+      if (poly_face_find_top(&sweep, face, size) < 0)
+         goto done;
+   }
+
+   for (i = 0; i < sweep.face_count; ++i) {
+
+      int* face = sweep.faces + sweep.face_start[i];
+      int size  = sweep.face_start[i + 1] - sweep.face_start[i];
+
+      poly_sweep_triangulate_face(&sweep, polygon, face, size, poly_face_find_top(&sweep, face, size));
+   }
+
+   result = true;
+
+done:
+   poly_sweep_destroy(&sweep);
+
+   return result;
+}
+
+# undef POLY_NODE_START
+# undef POLY_NODE_END
+# undef POLY_NODE_SPLIT
+# undef POLY_NODE_MERGE
+# undef POLY_NODE_REGULAR
+# undef POLY_CHAIN_LEFT
+# undef POLY_CHAIN_RIGHT
+
+
 /* Function: al_triangulate_polygon
  *  General triangulation function.
  */
@@ -818,6 +1673,9 @@ bool al_triangulate_polygon(
 {
    POLY polygon;
 
+   if (split_count == 0)
+      return false;
+
    memset(&polygon, 0, sizeof(polygon));
    polygon.vertex_buffer = vertices;
    polygon.vertex_stride = vertex_stride;
@@ -828,6 +1686,10 @@ bool al_triangulate_polygon(
    polygon.emit          = emit_triangle;
    polygon.userdata      = userdata;
 
+   if (poly_sweep_triangulate(&polygon))
+      return true;
+
+   /* Fall back to ear clipping for degenerate input. */
    if (poly_initialize(&polygon)) {
 
       poly_do_triangulate(&polygon);
@@ -105,9 +105,13 @@ CGD3D9SETUNIFORMPROC          _imp_cgD3D9SetUniform = INITSYM(cgD3D9SetUniform);
 #endif
 
 #ifdef CG_MODULE_LOADING
+static _AL_LIST_ITEM *_imp_cg_dtor_item = NULL;
+
 static void _imp_unload_cg_module(void* module)
 {
-   _al_unregister_destructor(_al_dtor_list, module);
+   (void)module;
+   _al_unregister_destructor(_al_dtor_list, _imp_cg_dtor_item);
+   _imp_cg_dtor_item = NULL;
 
    _al_close_library(_imp_cg_module);
    _imp_cg_module = NULL;
@@ -152,14 +156,18 @@ static bool _imp_load_cg_module()
       return false;
    }
 
-   _al_register_destructor(_al_dtor_list, _imp_cg_module, _imp_unload_cg_module);
+   _imp_cg_dtor_item = _al_register_destructor(_al_dtor_list, _imp_cg_module, _imp_unload_cg_module);
 
    return true;
 }
 
+static _AL_LIST_ITEM *_imp_cggl_dtor_item = NULL;
+
 static void _imp_unload_cggl_module(void* module)
 {
-   _al_unregister_destructor(_al_dtor_list, module);
+   (void)module;
+   _al_unregister_destructor(_al_dtor_list, _imp_cggl_dtor_item);
+   _imp_cggl_dtor_item = NULL;
 
    _al_close_library(_imp_cggl_module);
    _imp_cggl_module = NULL;
@@ -194,15 +202,19 @@ static bool _imp_load_cggl_module()
       return false;
    }
 
-   _al_register_destructor(_al_dtor_list, _imp_cggl_module, _imp_unload_cggl_module);
+   _imp_cggl_dtor_item = _al_register_destructor(_al_dtor_list, _imp_cggl_module, _imp_unload_cggl_module);
 
    return true;
 }
 
 #ifdef ALLEGRO_WINDOWS
+static _AL_LIST_ITEM *_imp_cgd3d9_dtor_item = NULL;
+
 static void _imp_unload_cgd3d9_module(void* module)
 {
-   _al_unregister_destructor(_al_dtor_list, module);
+   (void)module;
+   _al_unregister_destructor(_al_dtor_list, _imp_cgd3d9_dtor_item);
+   _imp_cgd3d9_dtor_item = NULL;
 
    _al_close_library(_imp_cgd3d9_module);
    _imp_cgd3d9_module = NULL;
@@ -235,7 +247,7 @@ static bool _imp_load_cgd3d9_module()
       return false;
    }
 
-   _al_register_destructor(_al_dtor_list, _imp_cgd3d9_module, _imp_unload_cgd3d9_module);
+   _imp_cgd3d9_dtor_item = _al_register_destructor(_al_dtor_list, _imp_cgd3d9_module, _imp_unload_cgd3d9_module);
 
    return true;
 }
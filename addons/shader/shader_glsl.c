@@ -86,7 +86,8 @@ static bool glsl_link_shader(ALLEGRO_SHADER *shader)
       return false;
 
    if (gl_shader->program_object != 0) {
-      glDeleteProgram(gl_shader->program_object);
+      _al_ogl_delete_program(al_get_current_display(),
+         gl_shader->program_object);
    }
 
    gl_shader->program_object = glCreateProgram();
@@ -113,7 +114,8 @@ static bool glsl_link_shader(ALLEGRO_SHADER *shader)
          shader->log = al_ustr_new(error_buf);
       }
       ALLEGRO_ERROR("Link error: %s\n", error_buf);
-      glDeleteProgram(gl_shader->program_object);
+      _al_ogl_delete_program(al_get_current_display(),
+         gl_shader->program_object);
       return false;
    }
    
@@ -202,7 +204,8 @@ static void glsl_destroy_shader(ALLEGRO_SHADER *shader)
 
    glDeleteShader(gl_shader->vertex_shader);
    glDeleteShader(gl_shader->pixel_shader);
-   glDeleteProgram(gl_shader->program_object);
+   _al_ogl_delete_program(al_get_current_display(),
+      gl_shader->program_object);
    free_deferred_sets(gl_shader->deferred_sets, true);
    al_free(shader);
 }
@@ -216,12 +219,22 @@ static void shader_set_sampler(GLSL_DEFERRED_SET *s)
 
    handle = glGetUniformLocation(gl_shader->program_object, s->name);
 
-   glActiveTexture(GL_TEXTURE0 + s->unit);
-
    texture = s->bitmap ? al_get_opengl_texture(s->bitmap) : 0;
-   glBindTexture(GL_TEXTURE_2D, texture);
+
+   /* The state cache tracks unit 0 only, and expects it to stay active. */
+   if (s->unit == 0) {
+      glActiveTexture(GL_TEXTURE0);
+      _al_ogl_bind_texture(al_get_current_display(), texture);
+   }
+   else {
+      glActiveTexture(GL_TEXTURE0 + s->unit);
+      glBindTexture(GL_TEXTURE_2D, texture);
+      glActiveTexture(GL_TEXTURE0);
+   }
 
    glUniform1i(handle, s->unit);
+   _al_ogl_invalidate_state_cache(al_get_current_display(),
+      _AL_OGL_STATE_UNIFORMS);
 
    LOG_GL_ERROR(s->name);
 }
@@ -327,7 +340,7 @@ static void glsl_use_shader(ALLEGRO_SHADER *shader, bool use)
       ALLEGRO_SHADER_GLSL_S *gl_shader = (ALLEGRO_SHADER_GLSL_S *)shader;
       GLint handle;
 
-      glUseProgram(gl_shader->program_object);
+      _al_ogl_use_program(display, gl_shader->program_object);
 
       handle = glGetUniformLocation(gl_shader->program_object, "projview_matrix");
       if (handle >= 0) {
@@ -343,9 +356,12 @@ static void glsl_use_shader(ALLEGRO_SHADER *shader, bool use)
          (*(sptr->fptr))(sptr);
       }
       free_deferred_sets(gl_shader->deferred_sets, false);
+
+      /* The deferred sets may have changed uniforms we keep track of. */
+      _al_ogl_invalidate_state_cache(display, _AL_OGL_STATE_UNIFORMS);
    }
    else {
-      glUseProgram(0);
+      _al_ogl_use_program(display, 0);
    }
 }
 
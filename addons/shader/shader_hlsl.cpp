@@ -74,9 +74,13 @@ static const char *technique_source_both =
    "   }\n"
    "}\n";
 
+static _AL_LIST_ITEM *_imp_d3dx9_dtor_item = NULL;
+
 static void _imp_unload_d3dx9_module(void* handle)
 {
-   _al_unregister_destructor(_al_dtor_list, handle);
+   (void)handle;
+   _al_unregister_destructor(_al_dtor_list, _imp_d3dx9_dtor_item);
+   _imp_d3dx9_dtor_item = NULL;
 
    FreeLibrary(_imp_d3dx9_module);
    _imp_d3dx9_module = NULL;
@@ -109,7 +113,7 @@ static bool _imp_load_d3dx9_module_version(int version)
       return false;
    }
 
-   _al_register_destructor(_al_dtor_list, (void*)_imp_d3dx9_module, _imp_unload_d3dx9_module);
+   _imp_d3dx9_dtor_item = _al_register_destructor(_al_dtor_list, (void*)_imp_d3dx9_module, _imp_unload_d3dx9_module);
 
    ALLEGRO_INFO("Module \"%s\" loaded.\n", module_name);
 
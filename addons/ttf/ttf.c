@@ -80,6 +80,8 @@ typedef struct ALLEGRO_TTF_FONT_DATA
 
    int bitmap_format;
    int bitmap_flags;
+
+   _AL_LIST_ITEM *dtor_item;
 } ALLEGRO_TTF_FONT_DATA;
 
 
@@ -674,6 +676,8 @@ static void ttf_destroy(ALLEGRO_FONT *f)
    ALLEGRO_TTF_FONT_DATA *data = f->data;
    int i;
 
+   _al_unregister_destructor(_al_dtor_list, data->dtor_item);
+
    unlock_current_page(data);
 
 #ifdef DEBUG_CACHE
@@ -821,7 +825,7 @@ ALLEGRO_FONT *al_load_ttf_font_stretch_f(ALLEGRO_FILE *file,
     f->vtable = &vt;
     f->data = data;
 
-    _al_register_destructor(_al_dtor_list, f,
+    data->dtor_item = _al_register_destructor(_al_dtor_list, f,
        (void (*)(void *))al_destroy_font);
 
     return f;
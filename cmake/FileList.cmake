@@ -32,6 +32,7 @@ set(ALLEGRO_SRC_FILES
     src/mouse_cursor.c
     src/path.c
     src/pixels.c
+    src/profile.c
     src/system.c
     src/threads.c
     src/timernu.c
@@ -40,6 +41,7 @@ set(ALLEGRO_SRC_FILES
     src/transformations.c
     src/tri_soft.c
     src/utf8.c
+    src/headless/hdisplay.c
     src/misc/aatree.c
     src/misc/bstrlib.c
     src/misc/list.c
@@ -114,6 +116,7 @@ set(ALLEGRO_SRC_UNIX_FILES
     src/unix/udrvlist.c
     src/unix/ufdwatch.c
     src/unix/ugfxdrv.c
+    src/unix/uheadless.c
     src/unix/ujoydrv.c
     src/unix/ukeybd.c
     # src/unix/umodules.c   # not used currently
@@ -248,6 +251,7 @@ set(ALLEGRO_INCLUDE_ALLEGRO_FILES
     include/allegro5/mouse.h
     include/allegro5/mouse_cursor.h
     include/allegro5/path.h
+    include/allegro5/profile.h
     include/allegro5/render_state.h
     include/allegro5/system.h
     include/allegro5/threads.h
@@ -275,12 +279,15 @@ set(ALLEGRO_INCLUDE_ALLEGRO_INTERNAL_FILES
     include/allegro5/internal/aintern_events.h
     include/allegro5/internal/aintern_float.h
     include/allegro5/internal/aintern_fshook.h
+    include/allegro5/internal/aintern_headless.h
     include/allegro5/internal/aintern_joystick.h
     include/allegro5/internal/aintern_keyboard.h
     include/allegro5/internal/aintern_list.h
+    include/allegro5/internal/aintern_memory.h
     include/allegro5/internal/aintern_mouse.h
     include/allegro5/internal/aintern_opengl.h
     include/allegro5/internal/aintern_pixels.h
+    include/allegro5/internal/aintern_profile.h
     include/allegro5/internal/aintern_system.h
     include/allegro5/internal/aintern_thread.h
     include/allegro5/internal/aintern_timer.h
@@ -20,6 +20,7 @@ set(PAGES
     monitor
     mouse
     path
+    profile
     state
     system
     threads
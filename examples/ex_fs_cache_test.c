@@ -0,0 +1,471 @@
+/*
+ *    Example program for the Allegro library.
+ *
+ *    Test the directory cache of the standard filesystem interface.
+ */
+
+#include <allegro5/allegro.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifndef ALLEGRO_WINDOWS
+   #include <unistd.h>
+#endif
+
+#include "common.c"
+
+typedef void (*test_t)(void);
+
+int error = 0;
+
+#define CHECK(x)                                                            \
+   do {                                                                     \
+      bool ok = (bool)(x);                                                  \
+      if (!ok) {                                                            \
+         log_printf("FAIL %s\n", #x);                                       \
+         error++;                                                           \
+      } else {                                                              \
+         log_printf("OK   %s\n", #x);                                       \
+      }                                                                     \
+   } while (0)
+
+#define CHECK_EQ(x,y)   CHECK(0 == strcmp(x, y))
+
+#define MAX_NAMES 16
+
+/* Names of the files every test starts with. */
+static const char *initial_files[] = { "one", "two", "three", "four" };
+#define NUM_INITIAL_FILES \
+   (int)(sizeof(initial_files) / sizeof(initial_files[0]))
+
+static ALLEGRO_PATH *test_dir;
+
+/*---------------------------------------------------------------------------*/
+
+static const char *file_path(const char *name)
+{
+   static char buf[1024];
+   ALLEGRO_PATH *path = al_clone_path(test_dir);
+
+   al_set_path_filename(path, name);
+   snprintf(buf, sizeof(buf), "%s", al_path_cstr(path, ALLEGRO_NATIVE_PATH_SEP));
+   al_destroy_path(path);
+   return buf;
+}
+
+static void write_file(const char *name, const char *contents)
+{
+   ALLEGRO_FILE *f = al_fopen(file_path(name), "wb");
+
+   if (!f)
+      abort_example("Could not create %s.\n", file_path(name));
+   al_fputs(f, contents);
+   al_fclose(f);
+}
+
+static int compare_names(const void *a, const void *b)
+{
+   return strcmp(*(const char **)a, *(const char **)b);
+}
+
+/* Lists a directory into names[], sorted, with the size of each entry
+ * appended after a colon.  Returns the number of entries.
+ */
+static int list_path(const char *path, char *names[MAX_NAMES])
+{
+   ALLEGRO_FS_ENTRY *dir = al_create_fs_entry(path);
+   ALLEGRO_FS_ENTRY *next;
+   int n = 0;
+
+   if (!al_open_directory(dir)) {
+      al_destroy_fs_entry(dir);
+      return 0;
+   }
+
+   while ((next = al_read_directory(dir)) != NULL) {
+      ALLEGRO_PATH *path = al_create_path(al_get_fs_entry_name(next));
+      char buf[256];
+
+      snprintf(buf, sizeof(buf), "%s:%d", al_get_path_filename(path),
+         (int)al_get_fs_entry_size(next));
+      if (n < MAX_NAMES)
+         names[n++] = strdup(buf);
+      al_destroy_path(path);
+      al_destroy_fs_entry(next);
+   }
+
+   al_close_directory(dir);
+   al_destroy_fs_entry(dir);
+
+   qsort(names, n, sizeof(names[0]), compare_names);
+   return n;
+}
+
+static int list_dir(char *names[MAX_NAMES])
+{
+   return list_path(al_path_cstr(test_dir, ALLEGRO_NATIVE_PATH_SEP), names);
+}
+
+static void free_names(char *names[MAX_NAMES], int n)
+{
+   int i;
+
+   for (i = 0; i < n; i++)
+      free(names[i]);
+}
+
+/* Checks for an entry by name, or by "name:size". */
+static bool listed(char *names[MAX_NAMES], int n, const char *name)
+{
+   int len = strlen(name);
+   int i;
+
+   for (i = 0; i < n; i++) {
+      if (0 == strncmp(names[i], name, len)
+            && (names[i][len] == ':' || names[i][len] == '\0'))
+         return true;
+   }
+   return false;
+}
+
+static void make_test_dir(void)
+{
+   int i;
+
+   CHECK(al_make_directory(al_path_cstr(test_dir, ALLEGRO_NATIVE_PATH_SEP)));
+   for (i = 0; i < NUM_INITIAL_FILES; i++)
+      write_file(initial_files[i], initial_files[i]);
+}
+
+static void remove_test_dir(void)
+{
+   char *names[MAX_NAMES];
+   int n;
+   int i;
+
+   al_set_standard_fs_cache(false);
+
+   n = list_dir(names);
+   for (i = 0; i < n; i++) {
+      *strchr(names[i], ':') = '\0';
+      al_remove_filename(file_path(names[i]));
+   }
+   free_names(names, n);
+
+   al_remove_filename(al_path_cstr(test_dir, ALLEGRO_NATIVE_PATH_SEP));
+}
+
+/*---------------------------------------------------------------------------*/
+
+/* Test that a cached listing has the same entries and sizes as an uncached
+ * one, and that listing again gives the same result.
+ */
+static void t1(void)
+{
+   char *uncached[MAX_NAMES];
+   char *cached[MAX_NAMES];
+   int nu, nc;
+   int i;
+
+   make_test_dir();
+
+   nu = list_dir(uncached);
+   CHECK(nu == NUM_INITIAL_FILES);
+
+   al_set_standard_fs_cache(true);
+   nc = list_dir(cached);
+   CHECK(nc == nu);
+   for (i = 0; i < nc && i < nu; i++)
+      CHECK_EQ(cached[i], uncached[i]);
+   free_names(cached, nc);
+
+   nc = list_dir(cached);
+   CHECK(nc == nu);
+   for (i = 0; i < nc && i < nu; i++)
+      CHECK_EQ(cached[i], uncached[i]);
+   free_names(cached, nc);
+   free_names(uncached, nu);
+
+   CHECK(al_filename_exists(file_path("three")));
+   CHECK(!al_filename_exists(file_path("five")));
+
+   remove_test_dir();
+}
+
+/* Test that removing files and making directories through Allegro updates
+ * the cached listing of the parent directory.
+ */
+static void t2(void)
+{
+   char *names[MAX_NAMES];
+   int n;
+
+   make_test_dir();
+   al_set_standard_fs_cache(true);
+
+   n = list_dir(names);
+   CHECK(listed(names, n, "two"));
+   free_names(names, n);
+
+   CHECK(al_remove_filename(file_path("two")));
+   CHECK(!al_filename_exists(file_path("two")));
+   n = list_dir(names);
+   CHECK(n == NUM_INITIAL_FILES - 1);
+   CHECK(!listed(names, n, "two"));
+   free_names(names, n);
+
+   CHECK(al_make_directory(file_path("subdir")));
+   CHECK(al_filename_exists(file_path("subdir")));
+   n = list_dir(names);
+   CHECK(n == NUM_INITIAL_FILES);
+   CHECK(listed(names, n, "subdir"));
+   free_names(names, n);
+
+   remove_test_dir();
+}
+
+/* Test that files changed behind the cache's back are seen after
+ * al_clear_standard_fs_cache, and straight away where inotify is used.
+ */
+static void t3(void)
+{
+   char *names[MAX_NAMES];
+   int n;
+
+   make_test_dir();
+   al_set_standard_fs_cache(true);
+
+   n = list_dir(names);
+   CHECK(n == NUM_INITIAL_FILES);
+   free_names(names, n);
+
+   /* Not through Allegro, so the parent is not invalidated directly. */
+   remove(file_path("one"));
+   write_file("five", "five");
+   write_file("four", "a longer four");
+
+#ifdef ALLEGRO_HAVE_SYS_INOTIFY_H
+   /* Notifications are only read every few milliseconds. */
+   al_rest(0.01);
+#else
+   al_clear_standard_fs_cache();
+#endif
+
+   CHECK(!al_filename_exists(file_path("one")));
+   CHECK(al_filename_exists(file_path("five")));
+   n = list_dir(names);
+   CHECK(n == NUM_INITIAL_FILES);
+   CHECK(!listed(names, n, "one"));
+   CHECK(listed(names, n, "five"));
+   free_names(names, n);
+
+   al_clear_standard_fs_cache();
+   n = list_dir(names);
+   CHECK(n == NUM_INITIAL_FILES);
+   CHECK(listed(names, n, "five"));
+   CHECK(listed(names, n, "four:13"));
+   free_names(names, n);
+
+   remove_test_dir();
+}
+
+/* Test al_read_directory_entries with and without the cache. */
+static void t4(void)
+{
+   ALLEGRO_FS_ENTRY *dir;
+   ALLEGRO_FS_ENTRY *entries[3];
+   int pass;
+   int total;
+   int n;
+   int i;
+
+   make_test_dir();
+
+   for (pass = 0; pass < 2; pass++) {
+      al_set_standard_fs_cache(pass == 1);
+
+      dir = al_create_fs_entry(al_path_cstr(test_dir, ALLEGRO_NATIVE_PATH_SEP));
+      CHECK(al_open_directory(dir));
+
+      total = 0;
+      n = al_read_directory_entries(dir, entries, 3);
+      CHECK(n == 3);
+      total += n;
+      for (i = 0; i < n; i++)
+         al_destroy_fs_entry(entries[i]);
+
+      n = al_read_directory_entries(dir, entries, 3);
+      CHECK(n == NUM_INITIAL_FILES - 3);
+      total += n;
+      for (i = 0; i < n; i++)
+         al_destroy_fs_entry(entries[i]);
+
+      CHECK(al_read_directory_entries(dir, entries, 3) == 0);
+      CHECK(total == NUM_INITIAL_FILES);
+
+      al_close_directory(dir);
+      al_destroy_fs_entry(dir);
+   }
+
+   remove_test_dir();
+}
+
+/* Test that a directory scan in progress is not disturbed when the cache
+ * rereads the directory.
+ */
+static void t5(void)
+{
+   ALLEGRO_FS_ENTRY *dir;
+   ALLEGRO_FS_ENTRY *next;
+   int n = 0;
+
+   make_test_dir();
+   al_set_standard_fs_cache(true);
+
+   dir = al_create_fs_entry(al_path_cstr(test_dir, ALLEGRO_NATIVE_PATH_SEP));
+   CHECK(al_open_directory(dir));
+
+   next = al_read_directory(dir);
+   CHECK(next != NULL);
+   n++;
+   al_destroy_fs_entry(next);
+
+   write_file("five", "five");
+   al_clear_standard_fs_cache();
+   CHECK(al_filename_exists(file_path("five")));
+
+   while ((next = al_read_directory(dir)) != NULL) {
+      n++;
+      al_destroy_fs_entry(next);
+   }
+   CHECK(n == NUM_INITIAL_FILES);
+
+   al_close_directory(dir);
+   al_destroy_fs_entry(dir);
+
+   remove_test_dir();
+}
+
+/* Test a directory cached under two paths through a symbolic link.  With
+ * inotify both share one watch, which must keep working for both.
+ */
+static void t6(void)
+{
+#ifndef ALLEGRO_WINDOWS
+   ALLEGRO_PATH *link_dir;
+   char link_path[1024];
+   char *names[MAX_NAMES];
+   int n;
+
+   make_test_dir();
+
+   link_dir = al_clone_path(test_dir);
+   al_replace_path_component(link_dir, -1, "ex_fs_cache_test_link");
+   snprintf(link_path, sizeof(link_path), "%s",
+      al_path_cstr(link_dir, ALLEGRO_NATIVE_PATH_SEP));
+   al_destroy_path(link_dir);
+   /* symlink wants no trailing separator. */
+   link_path[strlen(link_path) - 1] = '\0';
+
+   remove(link_path);
+   CHECK(0 == symlink(al_path_cstr(test_dir, ALLEGRO_NATIVE_PATH_SEP),
+      link_path));
+
+   al_set_standard_fs_cache(true);
+
+   n = list_dir(names);
+   CHECK(n == NUM_INITIAL_FILES);
+   free_names(names, n);
+   n = list_path(link_path, names);
+   CHECK(n == NUM_INITIAL_FILES);
+   free_names(names, n);
+
+   /* Change the directory behind the cache's back. */
+   remove(file_path("one"));
+   write_file("five", "five");
+#ifdef ALLEGRO_HAVE_SYS_INOTIFY_H
+   al_rest(0.01);
+#else
+   al_clear_standard_fs_cache();
+#endif
+
+   n = list_dir(names);
+   CHECK(!listed(names, n, "one"));
+   CHECK(listed(names, n, "five"));
+   free_names(names, n);
+   n = list_path(link_path, names);
+   CHECK(!listed(names, n, "one"));
+   CHECK(listed(names, n, "five"));
+   free_names(names, n);
+
+   /* And again, as the first change must not have used up the watch. */
+   write_file("six", "six");
+#ifdef ALLEGRO_HAVE_SYS_INOTIFY_H
+   al_rest(0.01);
+#else
+   al_clear_standard_fs_cache();
+#endif
+
+   n = list_path(link_path, names);
+   CHECK(listed(names, n, "six"));
+   free_names(names, n);
+   n = list_dir(names);
+   CHECK(listed(names, n, "six"));
+   free_names(names, n);
+
+   remove(link_path);
+   remove_test_dir();
+#endif
+}
+
+/*---------------------------------------------------------------------------*/
+
+const test_t all_tests[] =
+{
+   NULL, t1, t2, t3, t4, t5, t6
+};
+
+#define NUM_TESTS (int)(sizeof(all_tests) / sizeof(all_tests[0]))
+
+int main(int argc, const char *argv[])
+{
+   char name[64];
+   int i;
+
+   if (!al_init()) {
+      abort_example("Could not initialise Allegro.\n");
+   }
+   open_log();
+
+   test_dir = al_get_standard_path(ALLEGRO_TEMP_PATH);
+   snprintf(name, sizeof(name), "ex_fs_cache_test_%lu",
+      (unsigned long)time(NULL));
+   al_append_path_component(test_dir, name);
+
+   if (argc < 2) {
+      for (i = 1; i < NUM_TESTS; i++) {
+         log_printf("# t%d\n\n", i);
+         all_tests[i]();
+         log_printf("\n");
+      }
+   }
+   else {
+      i = atoi(argv[1]);
+      if (i > 0 && i < NUM_TESTS) {
+         all_tests[i]();
+      }
+   }
+
+   al_destroy_path(test_dir);
+
+   close_log(true);
+
+   if (error) {
+      exit(EXIT_FAILURE);
+   }
+
+   return 0;
+}
+
+/* vim: set sts=3 sw=3 et: */
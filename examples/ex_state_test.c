@@ -0,0 +1,283 @@
+/*
+ *    Example program for the Allegro library.
+ *
+ *    Test al_push_state/al_pop_state and how they mix with
+ *    al_store_state/al_restore_state.
+ */
+
+#include <allegro5/allegro.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common.c"
+
+typedef void (*test_t)(void);
+
+int error = 0;
+
+#define CHECK(x)                                                            \
+   do {                                                                     \
+      bool ok = (bool)(x);                                                  \
+      if (!ok) {                                                            \
+         log_printf("FAIL %s\n", #x);                                       \
+         error++;                                                           \
+      } else {                                                              \
+         log_printf("OK   %s\n", #x);                                       \
+      }                                                                     \
+   } while (0)
+
+#define DEPTH 100
+
+static ALLEGRO_BITMAP *bmp[3];
+
+/*---------------------------------------------------------------------------*/
+
+static bool blender_is(int op, int src, int dst)
+{
+   int o, s, d;
+
+   al_get_blender(&o, &s, &d);
+   return o == op && s == src && d == dst;
+}
+
+static bool translation_is(float x, float y)
+{
+   const ALLEGRO_TRANSFORM *t = al_get_current_transform();
+   float tx = 0, ty = 0;
+
+   al_transform_coordinates(t, &tx, &ty);
+   return tx == x && ty == y;
+}
+
+static void translate(float x, float y)
+{
+   ALLEGRO_TRANSFORM t;
+
+   al_identity_transform(&t);
+   al_translate_transform(&t, x, y);
+   al_use_transform(&t);
+}
+
+/* Every test starts from the same state. */
+static void reset(void)
+{
+   al_set_target_bitmap(bmp[0]);
+   translate(0, 0);
+   al_set_blender(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_INVERSE_ALPHA);
+   al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+}
+
+/*---------------------------------------------------------------------------*/
+
+/* Test that nested pushes each restore their own state, for both the lazily
+ * saved groups (blender, new bitmap flags) and the others (target,
+ * transform).
+ */
+static void t1(void)
+{
+   reset();
+
+   al_push_state(ALLEGRO_STATE_ALL);
+   al_set_blender(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_ZERO);
+   al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP | ALLEGRO_NO_PRESERVE_TEXTURE);
+   al_set_target_bitmap(bmp[1]);
+   translate(1, 1);
+
+      al_push_state(ALLEGRO_STATE_ALL);
+      al_set_blender(ALLEGRO_DEST_MINUS_SRC, ALLEGRO_ALPHA, ALLEGRO_ONE);
+      al_set_target_bitmap(bmp[2]);
+      translate(2, 2);
+
+         al_push_state(ALLEGRO_STATE_ALL);
+         al_set_blender(ALLEGRO_ADD, ALLEGRO_ZERO, ALLEGRO_ONE);
+         al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP | ALLEGRO_MIN_LINEAR);
+         translate(3, 3);
+         al_pop_state();
+
+      CHECK(blender_is(ALLEGRO_DEST_MINUS_SRC, ALLEGRO_ALPHA, ALLEGRO_ONE));
+      CHECK(al_get_new_bitmap_flags() ==
+         (ALLEGRO_MEMORY_BITMAP | ALLEGRO_NO_PRESERVE_TEXTURE));
+      CHECK(al_get_target_bitmap() == bmp[2]);
+      CHECK(translation_is(2, 2));
+      al_pop_state();
+
+   CHECK(blender_is(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_ZERO));
+   CHECK(al_get_new_bitmap_flags() ==
+      (ALLEGRO_MEMORY_BITMAP | ALLEGRO_NO_PRESERVE_TEXTURE));
+   CHECK(al_get_target_bitmap() == bmp[1]);
+   CHECK(translation_is(1, 1));
+   al_pop_state();
+
+   CHECK(blender_is(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_INVERSE_ALPHA));
+   CHECK(al_get_new_bitmap_flags() == ALLEGRO_MEMORY_BITMAP);
+   CHECK(al_get_target_bitmap() == bmp[0]);
+   CHECK(translation_is(0, 0));
+}
+
+/* Test that a push only restores the groups it was asked to save, even when
+ * an outer push saves more.
+ */
+static void t2(void)
+{
+   reset();
+
+   al_push_state(ALLEGRO_STATE_BLENDER | ALLEGRO_STATE_TARGET_BITMAP);
+      al_push_state(ALLEGRO_STATE_NEW_BITMAP_PARAMETERS);
+      al_set_blender(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_ZERO);
+      al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP | ALLEGRO_MIN_LINEAR);
+      al_set_target_bitmap(bmp[1]);
+      al_pop_state();
+
+   CHECK(blender_is(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_ZERO));
+   CHECK(al_get_new_bitmap_flags() == ALLEGRO_MEMORY_BITMAP);
+   CHECK(al_get_target_bitmap() == bmp[1]);
+   al_pop_state();
+
+   CHECK(blender_is(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_INVERSE_ALPHA));
+   CHECK(al_get_target_bitmap() == bmp[0]);
+}
+
+/* Test restoring a state stored before a push, while the push is active.
+ * The pop must bring back the state from before the push, not the stored
+ * one.
+ */
+static void t3(void)
+{
+   ALLEGRO_STATE state;
+
+   reset();
+   al_set_blender(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_ZERO);
+   al_store_state(&state, ALLEGRO_STATE_ALL);
+   al_set_blender(ALLEGRO_ADD, ALLEGRO_ALPHA, ALLEGRO_ONE);
+   al_set_target_bitmap(bmp[1]);
+   translate(1, 1);
+
+   al_push_state(ALLEGRO_STATE_ALL);
+   al_restore_state(&state);
+   CHECK(blender_is(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_ZERO));
+   CHECK(al_get_target_bitmap() == bmp[0]);
+   CHECK(translation_is(0, 0));
+   al_pop_state();
+
+   CHECK(blender_is(ALLEGRO_ADD, ALLEGRO_ALPHA, ALLEGRO_ONE));
+   CHECK(al_get_target_bitmap() == bmp[1]);
+   CHECK(translation_is(1, 1));
+}
+
+/* Test storing and restoring inside a push, and pushing inside a stored
+ * state.  Neither may disturb the other.
+ */
+static void t4(void)
+{
+   ALLEGRO_STATE outer, inner;
+
+   reset();
+   al_store_state(&outer, ALLEGRO_STATE_BLENDER | ALLEGRO_STATE_TRANSFORM);
+
+   al_push_state(ALLEGRO_STATE_BLENDER | ALLEGRO_STATE_TRANSFORM);
+   al_set_blender(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_ZERO);
+   translate(1, 1);
+
+   al_store_state(&inner, ALLEGRO_STATE_BLENDER | ALLEGRO_STATE_TRANSFORM);
+      al_push_state(ALLEGRO_STATE_BLENDER);
+      al_set_blender(ALLEGRO_ADD, ALLEGRO_ZERO, ALLEGRO_ONE);
+      translate(2, 2);
+      al_restore_state(&inner);
+      CHECK(blender_is(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_ZERO));
+      CHECK(translation_is(1, 1));
+      al_set_blender(ALLEGRO_ADD, ALLEGRO_ALPHA, ALLEGRO_ALPHA);
+      al_pop_state();
+   CHECK(blender_is(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_ZERO));
+   CHECK(translation_is(1, 1));
+
+   al_pop_state();
+   CHECK(blender_is(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_INVERSE_ALPHA));
+   CHECK(translation_is(0, 0));
+
+   al_set_blender(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_ONE);
+   translate(5, 5);
+   al_restore_state(&outer);
+   CHECK(blender_is(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_INVERSE_ALPHA));
+   CHECK(translation_is(0, 0));
+}
+
+/* Test deep nesting, which grows the stack, with a change at every level. */
+static void t5(void)
+{
+   int bad = 0;
+   int i;
+
+   reset();
+
+   for (i = 0; i < DEPTH; i++) {
+      al_push_state(ALLEGRO_STATE_BLENDER | ALLEGRO_STATE_TARGET_BITMAP);
+      al_set_blender(ALLEGRO_ADD, i % 2 ? ALLEGRO_ONE : ALLEGRO_ZERO,
+         ALLEGRO_ONE);
+      al_set_target_bitmap(bmp[1 + i % 2]);
+   }
+
+   for (i = DEPTH - 1; i >= 0; i--) {
+      if (!blender_is(ALLEGRO_ADD, i % 2 ? ALLEGRO_ONE : ALLEGRO_ZERO,
+            ALLEGRO_ONE))
+         bad++;
+      if (al_get_target_bitmap() != bmp[1 + i % 2])
+         bad++;
+      al_pop_state();
+   }
+   CHECK(bad == 0);
+
+   CHECK(blender_is(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_INVERSE_ALPHA));
+   CHECK(al_get_target_bitmap() == bmp[0]);
+}
+
+/*---------------------------------------------------------------------------*/
+
+const test_t all_tests[] =
+{
+   NULL, t1, t2, t3, t4, t5
+};
+
+#define NUM_TESTS (int)(sizeof(all_tests) / sizeof(all_tests[0]))
+
+int main(int argc, const char *argv[])
+{
+   int i;
+
+   if (!al_init()) {
+      abort_example("Could not initialise Allegro.\n");
+   }
+   open_log();
+
+   /* Memory bitmaps make the tests independent of a display. */
+   al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+   for (i = 0; i < 3; i++)
+      bmp[i] = al_create_bitmap(16, 16);
+
+   if (argc < 2) {
+      for (i = 1; i < NUM_TESTS; i++) {
+         log_printf("# t%d\n\n", i);
+         all_tests[i]();
+         log_printf("\n");
+      }
+   }
+   else {
+      i = atoi(argv[1]);
+      if (i > 0 && i < NUM_TESTS) {
+         all_tests[i]();
+      }
+   }
+
+   al_set_target_bitmap(NULL);
+   for (i = 0; i < 3; i++)
+      al_destroy_bitmap(bmp[i]);
+
+   close_log(true);
+
+   if (error) {
+      exit(EXIT_FAILURE);
+   }
+
+   return 0;
+}
+
+/* vim: set sts=3 sw=3 et: */
@@ -0,0 +1,228 @@
+/*
+ *    Example program for the Allegro library.
+ *
+ *    Test seeking in audio streams which read ahead.
+ */
+
+#include <allegro5/allegro.h>
+#include <allegro5/allegro_audio.h>
+#include <allegro5/allegro_acodec.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "common.c"
+
+typedef void (*test_t)(void);
+
+int error = 0;
+
+#define CHECK(x)                                                            \
+   do {                                                                     \
+      bool ok = (bool)(x);                                                  \
+      if (!ok) {                                                            \
+         log_printf("FAIL %s\n", #x);                                       \
+         error++;                                                           \
+      } else {                                                              \
+         log_printf("OK   %s\n", #x);                                       \
+      }                                                                     \
+   } while (0)
+
+#define FREQUENCY    44100
+#define SECONDS      3
+#define NEAR(x, y)   (fabs((x) - (y)) < 0.001)
+
+static ALLEGRO_PATH *wav_path;
+static bool have_audio;
+
+/*---------------------------------------------------------------------------*/
+
+/* Writes a mono ramp to a temporary file, for the tests to stream from. */
+static void make_wav(void)
+{
+   ALLEGRO_SAMPLE *spl;
+   int16_t *buf;
+   int n = FREQUENCY * SECONDS;
+   int i;
+
+   buf = al_malloc(n * sizeof(*buf));
+   for (i = 0; i < n; i++)
+      buf[i] = i % 30000;
+   spl = al_create_sample(buf, n, FREQUENCY, ALLEGRO_AUDIO_DEPTH_INT16,
+      ALLEGRO_CHANNEL_CONF_1, true);
+   if (!spl || !al_save_sample(al_path_cstr(wav_path, '/'), spl))
+      abort_example("Could not write %s.\n", al_path_cstr(wav_path, '/'));
+   al_destroy_sample(spl);
+}
+
+static ALLEGRO_AUDIO_STREAM *load_stream(double read_ahead)
+{
+   ALLEGRO_AUDIO_STREAM *stream;
+
+   stream = al_load_audio_stream(al_path_cstr(wav_path, '/'), 4, 1024);
+   if (!stream)
+      abort_example("Could not load %s.\n", al_path_cstr(wav_path, '/'));
+   CHECK(al_set_audio_stream_read_ahead(stream, read_ahead));
+   return stream;
+}
+
+/*---------------------------------------------------------------------------*/
+
+/* Test that the position after a seek does not move while the decoder
+ * fills the data read ahead, which nothing consumes.
+ */
+static void t1(void)
+{
+   ALLEGRO_AUDIO_STREAM *stream = load_stream(1.0);
+   const double targets[] = { 0.0, 1.5, 0.25, 2.9, 1.0 };
+   int i;
+
+   al_rest(0.1);
+   CHECK(NEAR(al_get_audio_stream_position_secs(stream), 0.0));
+   CHECK(NEAR(al_get_audio_stream_length_secs(stream), SECONDS));
+
+   for (i = 0; i < (int)(sizeof(targets) / sizeof(targets[0])); i++) {
+      CHECK(al_seek_audio_stream_secs(stream, targets[i]));
+      CHECK(NEAR(al_get_audio_stream_position_secs(stream), targets[i]));
+      al_rest(0.05);
+      CHECK(NEAR(al_get_audio_stream_position_secs(stream), targets[i]));
+   }
+
+   CHECK(al_rewind_audio_stream(stream));
+   CHECK(NEAR(al_get_audio_stream_position_secs(stream), 0.0));
+
+   al_destroy_audio_stream(stream);
+}
+
+/* Test many seeks while the decoder is busy, and near the end of a looping
+ * stream, where the decoder wraps around.
+ */
+static void t2(void)
+{
+   ALLEGRO_AUDIO_STREAM *stream = load_stream(2.0);
+   int bad = 0;
+   int i;
+
+   CHECK(al_set_audio_stream_playmode(stream, ALLEGRO_PLAYMODE_LOOP));
+
+   for (i = 0; i < 500; i++) {
+      double t = (i * 7919 % 3000) / 1000.0;
+      if (!al_seek_audio_stream_secs(stream, t))
+         bad++;
+      else if (!NEAR(al_get_audio_stream_position_secs(stream), t))
+         bad++;
+   }
+   CHECK(bad == 0);
+
+   CHECK(al_seek_audio_stream_secs(stream, 2.75));
+   al_rest(0.1);
+   CHECK(NEAR(al_get_audio_stream_position_secs(stream), 2.75));
+
+   al_destroy_audio_stream(stream);
+}
+
+/* Test that turning read-ahead off and on again keeps the position. */
+static void t3(void)
+{
+   ALLEGRO_AUDIO_STREAM *stream = load_stream(1.0);
+
+   al_rest(0.05);
+   CHECK(al_seek_audio_stream_secs(stream, 1.25));
+   al_rest(0.05);
+
+   CHECK(al_set_audio_stream_read_ahead(stream, 0.0));
+   al_rest(0.1);
+   CHECK(NEAR(al_get_audio_stream_position_secs(stream), 1.25));
+
+   CHECK(al_set_audio_stream_read_ahead(stream, 0.5));
+   al_rest(0.1);
+   CHECK(NEAR(al_get_audio_stream_position_secs(stream), 1.25));
+   CHECK(al_seek_audio_stream_secs(stream, 0.5));
+   CHECK(NEAR(al_get_audio_stream_position_secs(stream), 0.5));
+
+   al_destroy_audio_stream(stream);
+}
+
+/* Test seeking a stream which is playing.  Needs an audio device. */
+static void t4(void)
+{
+   ALLEGRO_AUDIO_STREAM *stream;
+   double pos;
+   int i;
+
+   if (!have_audio) {
+      log_printf("Skipped, no audio device.\n");
+      return;
+   }
+
+   stream = load_stream(0.5);
+   CHECK(al_set_audio_stream_playmode(stream, ALLEGRO_PLAYMODE_LOOP));
+   CHECK(al_attach_audio_stream_to_mixer(stream, al_get_default_mixer()));
+
+   for (i = 0; i < 20; i++) {
+      double t = (i % 5) * 0.5;
+      CHECK(al_seek_audio_stream_secs(stream, t));
+      al_rest(0.05);
+      pos = al_get_audio_stream_position_secs(stream);
+      CHECK(pos >= t && pos < t + 0.5);
+   }
+
+   al_destroy_audio_stream(stream);
+}
+
+/*---------------------------------------------------------------------------*/
+
+const test_t all_tests[] =
+{
+   NULL, t1, t2, t3, t4
+};
+
+#define NUM_TESTS (int)(sizeof(all_tests) / sizeof(all_tests[0]))
+
+int main(int argc, const char *argv[])
+{
+   char name[64];
+   int i;
+
+   if (!al_init()) {
+      abort_example("Could not initialise Allegro.\n");
+   }
+   /* Streams can be loaded and seeked without an audio device. */
+   have_audio = al_install_audio() && al_reserve_samples(0);
+   al_init_acodec_addon();
+   open_log();
+
+   wav_path = al_get_standard_path(ALLEGRO_TEMP_PATH);
+   snprintf(name, sizeof(name), "ex_stream_read_ahead_%lu.wav",
+      (unsigned long)time(NULL));
+   al_set_path_filename(wav_path, name);
+   make_wav();
+
+   if (argc < 2) {
+      for (i = 1; i < NUM_TESTS; i++) {
+         log_printf("# t%d\n\n", i);
+         all_tests[i]();
+         log_printf("\n");
+      }
+   }
+   else {
+      i = atoi(argv[1]);
+      if (i > 0 && i < NUM_TESTS) {
+         all_tests[i]();
+      }
+   }
+
+   al_remove_filename(al_path_cstr(wav_path, '/'));
+   al_destroy_path(wav_path);
+
+   close_log(true);
+
+   if (error) {
+      exit(EXIT_FAILURE);
+   }
+
+   return 0;
+}
+
+/* vim: set sts=3 sw=3 et: */
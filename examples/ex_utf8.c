@@ -1192,6 +1192,183 @@ static void t51(void)
    CHECK(0 == memcmp(str, "Al", 3));
 }
 
+/* Test growing and shrinking short strings. */
+static void t52(void)
+{
+   ALLEGRO_USTR *us = al_ustr_new("short");
+   ALLEGRO_USTR *us2;
+   int i;
+
+   for (i = 0; i < 20; i++)
+      al_ustr_append_cstr(us, "0123456789");
+   CHECK(al_ustr_size(us) == 205);
+   CHECK(0 == memcmp(al_cstr(us) + 195, "0123456789", 11));
+
+   al_ustr_truncate(us, 5);
+   us2 = al_ustr_dup(us);
+   CHECK(0 == strcmp(al_cstr(us2), "short"));
+   al_ustr_append_chr(us2, U_euro);
+   CHECK(al_ustr_length(us2) == 6);
+
+   al_ustr_free(us);
+   al_ustr_free(us2);
+}
+
+/* Test scratch arena strings. */
+static void t53(void)
+{
+   ALLEGRO_USTR *us1;
+   ALLEGRO_USTR *us2;
+   ALLEGRO_USTR *us3;
+   int i;
+
+   CHECK(al_ustr_arena_new("outside") == NULL);
+
+   al_ustr_arena_begin();
+   us1 = al_ustr_arena_new("áƵ");
+   us2 = al_ustr_arena_newf("%d %s", 42, "abc");
+   CHECK(0 == strcmp(al_cstr(us1), "áƵ"));
+   CHECK(0 == strcmp(al_cstr(us2), "42 abc"));
+
+   al_ustr_arena_begin();
+   us3 = al_ustr_arena_dup(us2);
+   for (i = 0; i < 100; i++)
+      al_ustr_append(us3, us2);
+   CHECK(al_ustr_size(us3) == 606);
+   al_ustr_free(us2);
+   al_ustr_arena_end();
+
+   al_ustr_append_cstr(us1, "-still-valid");
+   CHECK(0 == strcmp(al_cstr(us1), "áƵ-still-valid"));
+   al_ustr_arena_end();
+}
+
+/* Test al_ustr_length and al_ustr_offset on strings longer than one scan
+ * block, with multi-byte sequences straddling block boundaries.
+ */
+static void t54(void)
+{
+   ALLEGRO_USTR *us = al_ustr_new("");
+   int i;
+
+   for (i = 0; i < 40; i++)
+      al_ustr_append_cstr(us, "abcdefghijklmno");
+   CHECK(al_ustr_length(us) == 600);
+   CHECK(al_ustr_offset(us, 599) == 599);
+   CHECK(al_ustr_offset(us, 600) == 600);
+   CHECK(al_ustr_offset(us, -1) == 599);
+
+   for (i = 0; i < 40; i++)
+      al_ustr_append_chr(us, U_euro);
+   CHECK(al_ustr_length(us) == 640);
+   CHECK(al_ustr_offset(us, 601) == 603);
+   CHECK(al_ustr_offset(us, 639) == 717);
+   CHECK(al_ustr_offset(us, 1000) == 720);
+   CHECK(al_ustr_offset(us, -40) == 600);
+
+   al_ustr_insert_chr(us, 0, U_2051);
+   CHECK(al_ustr_length(us) == 641);
+   CHECK(al_ustr_offset(us, 1) == 3);
+   CHECK(al_ustr_offset(us, 602) == 606);
+
+   al_ustr_free(us);
+}
+
+/* Test arena strings which outgrow their buffer inside a nested scope. */
+static void t55(void)
+{
+   ALLEGRO_USTR *outer;
+   ALLEGRO_USTR *inner;
+   int i;
+
+   al_ustr_arena_begin();
+   outer = al_ustr_arena_new("outer");
+
+   al_ustr_arena_begin();
+   inner = al_ustr_arena_new("inner");
+   for (i = 0; i < 10; i++) {
+      al_ustr_append_cstr(outer, "0123456789");
+      al_ustr_append_cstr(inner, "0123456789");
+   }
+   CHECK(al_ustr_size(inner) == 105);
+   al_ustr_arena_end();
+
+   /* The outer string grew in the inner scope but still belongs here. */
+   CHECK(al_ustr_size(outer) == 105);
+   CHECK(0 == memcmp(al_cstr(outer) + 95, "0123456789", 11));
+   al_ustr_append_cstr(outer, "!");
+   CHECK(al_ustr_size(outer) == 106);
+   al_ustr_arena_end();
+
+   /* A new outermost scope starts from scratch. */
+   al_ustr_arena_begin();
+   outer = al_ustr_arena_new("again");
+   CHECK(0 == strcmp(al_cstr(outer), "again"));
+   al_ustr_arena_end();
+}
+
+static void *t56_thread(ALLEGRO_THREAD *thread, void *arg)
+{
+   (void)thread;
+   al_ustr_free(arg);
+   return NULL;
+}
+
+/* Test that freeing an arena string on another thread leaves it alone. */
+static void t56(void)
+{
+   ALLEGRO_THREAD *thread;
+   ALLEGRO_USTR *us;
+   int i;
+
+   al_ustr_arena_begin();
+   us = al_ustr_arena_new("");
+   for (i = 0; i < 10; i++)
+      al_ustr_append_cstr(us, "0123456789");
+
+   thread = al_create_thread(t56_thread, us);
+   CHECK(thread);
+   if (thread) {
+      al_start_thread(thread);
+      al_join_thread(thread, NULL);
+      al_destroy_thread(thread);
+   }
+
+   CHECK(al_ustr_size(us) == 100);
+   al_ustr_append_cstr(us, "!");
+   CHECK(al_ustr_size(us) == 101);
+   al_ustr_arena_end();
+}
+
+/* Test deeply nested scopes, and freeing grown strings out of order. */
+static void t57(void)
+{
+   ALLEGRO_USTR *us[40];
+   int i;
+
+   for (i = 0; i < 40; i++) {
+      al_ustr_arena_begin();
+      us[i] = al_ustr_arena_newf("%d:", i);
+      al_ustr_append_cstr(us[i], "0123456789012345678901234567890123456789");
+   }
+
+   /* Free every third string, which leaves holes in the middle. */
+   for (i = 0; i < 40; i += 3)
+      al_ustr_free(us[i]);
+
+   for (i = 39; i >= 20; i--)
+      al_ustr_arena_end();
+
+   CHECK(0 == strncmp(al_cstr(us[19]), "19:0123", 7));
+   CHECK(0 == strncmp(al_cstr(us[1]), "1:0123", 6));
+   al_ustr_append_cstr(us[1], "!");
+   CHECK(al_ustr_size(us[1]) == 43);
+
+   for (i = 19; i >= 0; i--)
+      al_ustr_arena_end();
+   CHECK(al_ustr_arena_new("outside") == NULL);
+}
+
 /*---------------------------------------------------------------------------*/
 
 const test_t all_tests[] =
@@ -1201,7 +1378,7 @@ const test_t all_tests[] =
    t20, t21, t22, t23, t24, t25, t26, t27, t28, t29,
    t30, t31, t32, t33, t34, t35, t36, t37, t38, t39,
    t40, t41, t42, t43, t44, t45, t46, t47, t48, t49,
-   t50, t51
+   t50, t51, t52, t53, t54, t55, t56, t57
 };
 
 #define NUM_TESTS (int)(sizeof(all_tests) / sizeof(all_tests[0]))
@@ -50,6 +50,7 @@
 #include "allegro5/mouse.h"
 #include "allegro5/mouse_cursor.h"
 #include "allegro5/path.h"
+#include "allegro5/profile.h"
 #include "allegro5/render_state.h"
 #include "allegro5/system.h"
 #include "allegro5/threads.h"
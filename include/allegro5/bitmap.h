@@ -27,7 +27,8 @@ enum {
    ALLEGRO_MIPMAP                   = 0x0100,
    _ALLEGRO_NO_PREMULTIPLIED_ALPHA  = 0x0200,	/* now a bitmap loader flag */
    ALLEGRO_VIDEO_BITMAP             = 0x0400,
-   ALLEGRO_CONVERT_BITMAP           = 0x1000
+   ALLEGRO_CONVERT_BITMAP           = 0x1000,
+   ALLEGRO_PACKED_BITMAP            = 0x2000
 };
 
 
@@ -44,7 +45,10 @@ AL_FUNC(int, al_get_bitmap_flags, (ALLEGRO_BITMAP *bitmap));
 
 AL_FUNC(ALLEGRO_BITMAP*, al_create_bitmap, (int w, int h));
 AL_FUNC(ALLEGRO_BITMAP*, al_create_custom_bitmap, (int w, int h, bool (*upload)(ALLEGRO_BITMAP *bitmap, void *data), void *data));
+AL_FUNC(ALLEGRO_BITMAP*, al_create_bitmap_with_pitch, (int w, int h, int pitch));
+AL_FUNC(ALLEGRO_BITMAP*, al_create_bitmap_for_memory, (void *data, int w, int h, int format, int pitch));
 AL_FUNC(void, al_destroy_bitmap, (ALLEGRO_BITMAP *bitmap));
+AL_FUNC(void, al_destroy_bitmaps, (ALLEGRO_BITMAP **bitmaps, int count));
 
 AL_FUNC(void, al_put_pixel, (int x, int y, ALLEGRO_COLOR color));
 AL_FUNC(void, al_put_blended_pixel, (int x, int y, ALLEGRO_COLOR color));
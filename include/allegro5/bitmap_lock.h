@@ -31,6 +31,10 @@ struct ALLEGRO_LOCKED_REGION {
 
 AL_FUNC(ALLEGRO_LOCKED_REGION*, al_lock_bitmap, (ALLEGRO_BITMAP *bitmap, int format, int flags));
 AL_FUNC(ALLEGRO_LOCKED_REGION*, al_lock_bitmap_region, (ALLEGRO_BITMAP *bitmap, int x, int y, int width, int height, int format, int flags));
+AL_FUNC(bool, al_lock_bitmap_async, (ALLEGRO_BITMAP *bitmap, int format, int flags));
+AL_FUNC(bool, al_lock_bitmap_region_async, (ALLEGRO_BITMAP *bitmap, int x, int y, int width, int height, int format, int flags));
+AL_FUNC(bool, al_is_bitmap_lock_ready, (ALLEGRO_BITMAP *bitmap));
+AL_FUNC(ALLEGRO_LOCKED_REGION*, al_wait_for_bitmap_lock, (ALLEGRO_BITMAP *bitmap));
 AL_FUNC(void, al_unlock_bitmap, (ALLEGRO_BITMAP *bitmap));
 AL_FUNC(bool, al_is_bitmap_locked, (ALLEGRO_BITMAP *bitmap));
 
@@ -31,6 +31,8 @@ AL_FUNC(bool, _al_trace_prefix, (char const *channel, int level,
 
 AL_PRINTFUNC(void, _al_trace_suffix, (const char *msg, ...), 1, 2);
 
+AL_VAR(int, _al_trace_level);
+
 #if defined(DEBUGMODE) || defined(ALLEGRO_CFG_RELEASE_LOGGING)
    /* Must not be used with a trailing semicolon. */
    #ifdef ALLEGRO_GCC
@@ -40,8 +42,10 @@ AL_PRINTFUNC(void, _al_trace_suffix, (const char *msg, ...), 1, 2);
       #define ALLEGRO_DEBUG_CHANNEL(x) \
          static char const *__al_debug_channel = x;
    #endif
+   /* Messages below the configured level cost a single comparison. */
    #define ALLEGRO_TRACE_CHANNEL_LEVEL(channel, level)                        \
-      !_al_trace_prefix(channel, level, __FILE__, __LINE__, __func__)         \
+      ((level) < _al_trace_level                                              \
+      || !_al_trace_prefix(channel, level, __FILE__, __LINE__, __func__))     \
       ? (void)0 : _al_trace_suffix
 #else
    #define ALLEGRO_TRACE_CHANNEL_LEVEL(channel, x)  1 ? (void) 0 : _al_trace_suffix
@@ -63,6 +67,8 @@ AL_FUNC(void, al_register_assert_handler, (void (*handler)(char const *expr,
 
 AL_FUNC(void, al_register_trace_handler, (void (*handler)(char const *)));
 
+AL_FUNC(void, al_dump_trace_history, (int max_entries));
+
 #ifdef NDEBUG
    #define ALLEGRO_ASSERT(e)	((void)(0 && (e)))
 #else
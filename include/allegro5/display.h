@@ -24,7 +24,8 @@ enum {
    ALLEGRO_FULLSCREEN_WINDOW           = 1 << 9,
    ALLEGRO_MINIMIZED                   = 1 << 10,
    ALLEGRO_USE_PROGRAMMABLE_PIPELINE   = 1 << 11,
-   ALLEGRO_GTK_TOPLEVEL_INTERNAL       = 1 << 12
+   ALLEGRO_GTK_TOPLEVEL_INTERNAL       = 1 << 12,
+   ALLEGRO_HEADLESS                    = 1 << 13
 };
 
 /* Possible parameters for al_set_display_option.
@@ -104,6 +105,26 @@ enum
 typedef struct ALLEGRO_DISPLAY ALLEGRO_DISPLAY;
 
 
+/* Type: ALLEGRO_DISPLAY_STATS
+ */
+typedef struct ALLEGRO_DISPLAY_STATS ALLEGRO_DISPLAY_STATS;
+
+struct ALLEGRO_DISPLAY_STATS
+{
+   int draw_calls;
+   int vertices;
+   int batch_breaks_texture;
+   int batch_breaks_hold;
+   int texture_uploads;
+   int64_t upload_bytes;
+   int readbacks;
+   int64_t readback_bytes;
+   int locks;
+   int state_changes;
+   int redundant_state_changes;
+};
+
+
 AL_FUNC(void, al_set_new_display_refresh_rate, (int refresh_rate));
 AL_FUNC(void, al_set_new_display_flags, (int flags));
 AL_FUNC(int,  al_get_new_display_refresh_rate, (void));
@@ -128,11 +149,17 @@ AL_FUNC(ALLEGRO_BITMAP*, al_get_target_bitmap, (void));
 AL_FUNC(bool, al_acknowledge_resize, (ALLEGRO_DISPLAY *display));
 AL_FUNC(bool, al_resize_display,     (ALLEGRO_DISPLAY *display, int width, int height));
 AL_FUNC(void, al_flip_display,       (void));
+AL_FUNC(void, al_get_display_stats,  (ALLEGRO_DISPLAY *display, ALLEGRO_DISPLAY_STATS *stats));
 AL_FUNC(void, al_update_display_region, (int x, int y, int width, int height));
 AL_FUNC(bool, al_is_compatible_bitmap, (ALLEGRO_BITMAP *bitmap));
 
 AL_FUNC(bool, al_wait_for_vsync, (void));
 
+AL_FUNC(bool, al_set_headless_flip_callback, (ALLEGRO_DISPLAY *display,
+   void (*callback)(ALLEGRO_DISPLAY *display, ALLEGRO_BITMAP *frame, void *arg),
+   void *arg));
+AL_FUNC(bool, al_set_headless_flip_filename, (ALLEGRO_DISPLAY *display, const char *filename));
+
 AL_FUNC(ALLEGRO_EVENT_SOURCE *, al_get_display_event_source, (ALLEGRO_DISPLAY *display));
 
 AL_FUNC(void, al_set_display_icon, (ALLEGRO_DISPLAY *display, ALLEGRO_BITMAP *icon));
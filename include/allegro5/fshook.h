@@ -104,6 +104,9 @@ AL_FUNC(bool,                 al_remove_fs_entry,  (ALLEGRO_FS_ENTRY *e));
 
 AL_FUNC(bool,                 al_open_directory,   (ALLEGRO_FS_ENTRY *e));
 AL_FUNC(ALLEGRO_FS_ENTRY *,   al_read_directory,   (ALLEGRO_FS_ENTRY *e));
+AL_FUNC(int,                  al_read_directory_entries, (ALLEGRO_FS_ENTRY *e,
+                                                    ALLEGRO_FS_ENTRY **entries,
+                                                    int max));
 AL_FUNC(bool,                 al_close_directory,  (ALLEGRO_FS_ENTRY *e));
 
 AL_FUNC(bool,                 al_filename_exists,  (const char *path));
@@ -121,6 +124,9 @@ AL_FUNC(const ALLEGRO_FS_INTERFACE *, al_get_fs_interface, (void));
 AL_FUNC(void, al_set_fs_interface, (const ALLEGRO_FS_INTERFACE *vtable));
 AL_FUNC(void, al_set_standard_fs_interface, (void));
 
+AL_FUNC(void, al_set_standard_fs_cache, (bool enable));
+AL_FUNC(void, al_clear_standard_fs_cache, (void));
+
 
 #ifdef __cplusplus
    }
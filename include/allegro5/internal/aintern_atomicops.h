@@ -19,6 +19,24 @@
       return __sync_sub_and_fetch(ptr, 1);
    })
 
+   AL_INLINE_STATIC(void *,
+      _al_load_ptr_acquire, (void * volatile *ptr),
+   {
+      void *value = *ptr;
+      __sync_synchronize();
+      return value;
+   })
+
+   AL_INLINE_STATIC(void,
+      _al_store_ptr_release, (void * volatile *ptr, void *value),
+   {
+      __sync_synchronize();
+      *ptr = value;
+   })
+
+   #define _al_read_barrier()    __sync_synchronize()
+   #define _al_write_barrier()   __sync_synchronize()
+
 #elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
 
    /* gcc, x86 or x86-64 */
@@ -49,6 +67,27 @@
       return old - 1;
    })
 
+   /* x86 does not reorder loads with later accesses, or stores with
+    * earlier ones, so only the compiler needs to be held back.
+    */
+   AL_INLINE_STATIC(void *,
+      _al_load_ptr_acquire, (void * volatile *ptr),
+   {
+      void *value = *ptr;
+      __asm__ __volatile__ ("" : : : "memory");
+      return value;
+   })
+
+   AL_INLINE_STATIC(void,
+      _al_store_ptr_release, (void * volatile *ptr, void *value),
+   {
+      __asm__ __volatile__ ("" : : : "memory");
+      *ptr = value;
+   })
+
+   #define _al_read_barrier()    __asm__ __volatile__ ("" : : : "memory")
+   #define _al_write_barrier()   __asm__ __volatile__ ("" : : : "memory")
+
 #elif defined(_MSC_VER) && _M_IX86 >= 400
 
    /* MSVC, x86 */
@@ -68,6 +107,24 @@
       return InterlockedDecrement(ptr);
    })
 
+   AL_INLINE_STATIC(void *,
+      _al_load_ptr_acquire, (void * volatile *ptr),
+   {
+      void *value = *ptr;
+      MemoryBarrier();
+      return value;
+   })
+
+   AL_INLINE_STATIC(void,
+      _al_store_ptr_release, (void * volatile *ptr, void *value),
+   {
+      MemoryBarrier();
+      *ptr = value;
+   })
+
+   #define _al_read_barrier()    MemoryBarrier()
+   #define _al_write_barrier()   MemoryBarrier()
+
 #elif defined(ALLEGRO_HAVE_OSATOMIC_H)
 
    /* OS X, GCC < 4.1
@@ -93,6 +150,24 @@
       return OSAtomicDecrement32Barrier((_AL_ATOMIC *)ptr);
    })
 
+   AL_INLINE_STATIC(void *,
+      _al_load_ptr_acquire, (void * volatile *ptr),
+   {
+      void *value = *ptr;
+      OSMemoryBarrier();
+      return value;
+   })
+
+   AL_INLINE_STATIC(void,
+      _al_store_ptr_release, (void * volatile *ptr, void *value),
+   {
+      OSMemoryBarrier();
+      *ptr = value;
+   })
+
+   #define _al_read_barrier()    OSMemoryBarrier()
+   #define _al_write_barrier()   OSMemoryBarrier()
+
 
 #else
 
@@ -113,6 +188,21 @@
       return --(*ptr);
    })
 
+   AL_INLINE_STATIC(void *,
+      _al_load_ptr_acquire, (void * volatile *ptr),
+   {
+      return *ptr;
+   })
+
+   AL_INLINE_STATIC(void,
+      _al_store_ptr_release, (void * volatile *ptr, void *value),
+   {
+      *ptr = value;
+   })
+
+   #define _al_read_barrier()    ((void)0)
+   #define _al_write_barrier()   ((void)0)
+
 #endif
 
 #endif
@@ -6,6 +6,7 @@
 #include "allegro5/display.h"
 #include "allegro5/render_state.h"
 #include "allegro5/transformations.h"
+#include "allegro5/internal/aintern_list.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -45,9 +46,11 @@ struct ALLEGRO_BITMAP
     * lock_x/y - top left of the locked region
     * lock_w/h - width and height of the locked region
     * lock_flags - flags the region was locked with
+    * lock_pending - an asynchronous lock has not been completed yet
     * locked_region - a copy of the locked rectangle
     */
    bool locked;
+   bool lock_pending;
    int lock_x;
    int lock_y;
    int lock_w;
@@ -67,12 +70,23 @@ struct ALLEGRO_BITMAP
 
    /* A memory copy of the bitmap data. May be NULL for an empty bitmap. */
    unsigned char *memory;
+   /* The memory was supplied by the user and is not freed with the bitmap. */
+   bool user_memory;
 
    /* Extra data for display bitmaps, like texture id and so on. */
    void *extra;
 
    /* set_target_bitmap and lock_bitmap mark bitmaps as dirty for preservation */
    bool dirty;
+
+   /* Registration with the destructor list, or NULL. */
+   _AL_LIST_ITEM *dtor_item;
+
+   /* Positions in display->bitmaps and the list of bitmaps to be
+    * converted, see bitmap.c.
+    */
+   int display_index;
+   int convert_index;
 };
 
 struct ALLEGRO_BITMAP_INTERFACE
@@ -99,6 +113,15 @@ struct ALLEGRO_BITMAP_INTERFACE
 
    void (*unlock_region)(ALLEGRO_BITMAP *bitmap);
 
+   /* Optional. lock_region_async starts transferring the region without
+    * waiting for it, is_lock_ready polls whether the transfer is done and
+    * finish_lock waits for it and fills in locked_region.
+    */
+   bool (*lock_region_async)(ALLEGRO_BITMAP *bitmap,
+      int x, int y, int w, int h, int format, int flags);
+   bool (*is_lock_ready)(ALLEGRO_BITMAP *bitmap);
+   ALLEGRO_LOCKED_REGION * (*finish_lock)(ALLEGRO_BITMAP *bitmap);
+
    /* Used to update any dangling pointers the bitmap driver might keep. */
    void (*bitmap_pointer_changed)(ALLEGRO_BITMAP *bitmap, ALLEGRO_BITMAP *old);
 };
@@ -139,6 +162,7 @@ bool _al_transform_is_translation(const ALLEGRO_TRANSFORM* trans,
 
 void _al_init_iio_table(void);
 void _al_init_to_be_converted_bitmaps(void);
+void _al_transfer_display_bitmaps(ALLEGRO_DISPLAY *from, ALLEGRO_DISPLAY *to);
 
 #ifdef __cplusplus
 }
@@ -22,6 +22,15 @@
    (_AL_SRC_NOT_MODIFIED && \
    tint.r == 1.0f && tint.g == 1.0f && tint.b == 1.0f && tint.a == 1.0f)
 
+/* Unpacks an ALLEGRO_BLENDER into the locals the macros above expect. */
+#define _AL_LOAD_BLENDER(b)                \
+   (op = (b)->blend_op,                    \
+   src_mode = (b)->blend_source,           \
+   dst_mode = (b)->blend_dest,             \
+   op_alpha = (b)->blend_alpha_op,         \
+   src_alpha = (b)->blend_alpha_source,    \
+   dst_alpha = (b)->blend_alpha_dest)
+
 
 #ifndef _AL_NO_BLEND_INLINE_FUNC
 
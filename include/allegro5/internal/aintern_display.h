@@ -144,6 +144,12 @@ struct ALLEGRO_DISPLAY
    ALLEGRO_TRANSFORM view_transform;
 
    _ALLEGRO_RENDER_STATE render_state; 
+
+   /* Counters for the frame being drawn, and those of the last frame
+    * presented.  See al_get_display_stats.
+    */
+   ALLEGRO_DISPLAY_STATS stats;
+   ALLEGRO_DISPLAY_STATS last_stats;
 };
 
 int  _al_score_display_settings(ALLEGRO_EXTRA_DISPLAY_SETTINGS *eds, ALLEGRO_EXTRA_DISPLAY_SETTINGS *ref);
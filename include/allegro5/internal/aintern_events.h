@@ -35,8 +35,10 @@ void _al_event_source_on_registration_to_queue(ALLEGRO_EVENT_SOURCE*, ALLEGRO_EV
 void _al_event_source_on_unregistration_from_queue(ALLEGRO_EVENT_SOURCE*, ALLEGRO_EVENT_QUEUE*);
 bool _al_event_source_needs_to_generate_event(ALLEGRO_EVENT_SOURCE*);
 void _al_event_source_emit_event(ALLEGRO_EVENT_SOURCE *, ALLEGRO_EVENT*);
+void _al_event_source_emit_events(ALLEGRO_EVENT_SOURCE *, ALLEGRO_EVENT*, unsigned int num);
 
 void _al_event_queue_push_event(ALLEGRO_EVENT_QUEUE*, const ALLEGRO_EVENT*);
+void _al_event_queue_push_events(ALLEGRO_EVENT_QUEUE*, const ALLEGRO_EVENT*, unsigned int num);
 
 
 #ifdef __cplusplus
@@ -0,0 +1,35 @@
+#ifndef __al_included_allegro5_aintern_headless_h
+#define __al_included_allegro5_aintern_headless_h
+
+#include "allegro5/internal/aintern_display.h"
+#include "allegro5/internal/aintern_system.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ALLEGRO_DISPLAY_HEADLESS
+{
+   ALLEGRO_DISPLAY display; /* This must be the first member. */
+
+   /* A memory bitmap which everything is drawn to. */
+   ALLEGRO_BITMAP *backbuffer;
+
+   /* Where flipped frames go. */
+   void (*flip_callback)(ALLEGRO_DISPLAY *display, ALLEGRO_BITMAP *frame,
+      void *arg);
+   void *flip_callback_arg;
+   ALLEGRO_USTR *flip_filename;
+   int frame;
+} ALLEGRO_DISPLAY_HEADLESS;
+
+ALLEGRO_DISPLAY_INTERFACE *_al_display_headless_driver(void);
+ALLEGRO_SYSTEM_INTERFACE *_al_system_headless_driver(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* vim: set sts=3 sw=3 et: */
@@ -0,0 +1,41 @@
+#ifndef __al_included_allegro5_aintern_memory_h
+#define __al_included_allegro5_aintern_memory_h
+
+#ifdef __cplusplus
+   extern "C" {
+#endif
+
+
+void _al_init_memory(void);
+
+struct _AL_MEMORY_CACHE;
+void _al_memory_cache_destroy(struct _AL_MEMORY_CACHE *cache);
+
+/* Small fixed-size objects, up to _AL_POOL_MAX_SIZE bytes.  The size
+ * passed to _al_pool_free must be the one the object was allocated with.
+ * Larger requests are passed on to _al_tagged_malloc.
+ */
+#define _AL_POOL_MAX_SIZE  256
+
+AL_FUNC(void *, _al_pool_malloc, (int tag, size_t size));
+AL_FUNC(void, _al_pool_free, (int tag, void *ptr, size_t size));
+
+/* Ordinary heap allocations which are counted against a memory tag.  The
+ * caller supplies the size of the block when resizing or freeing it.
+ */
+AL_FUNC(void *, _al_tagged_malloc, (int tag, size_t size));
+AL_FUNC(void *, _al_tagged_calloc, (int tag, size_t size));
+AL_FUNC(void *, _al_tagged_realloc, (int tag, void *ptr, size_t old_size,
+   size_t size));
+AL_FUNC(void, _al_tagged_free, (int tag, void *ptr, size_t size));
+AL_FUNC(void, _al_tagged_free_in_cache, (struct _AL_MEMORY_CACHE *cache,
+   int tag, void *ptr, size_t size));
+
+
+#ifdef __cplusplus
+   }
+#endif
+
+#endif
+
+/* vim: set ts=8 sts=3 sw=3 et: */
@@ -29,6 +29,7 @@ enum {
 };
 
 #define ALLEGRO_MAX_OPENGL_FBOS 8
+#define ALLEGRO_MAX_OPENGL_UPLOAD_PBOS 4
 
 enum {
    FBO_INFO_UNUSED      = 0,
@@ -56,6 +57,15 @@ typedef struct ALLEGRO_BITMAP_EXTRA_OPENGL
    ALLEGRO_FBO_INFO *fbo_info;
 
    unsigned char *lock_buffer;
+   GLuint lock_pbo;  /* Pixel buffer object mapped at lock_buffer, or 0. */
+   int lock_offset;  /* Offset of the locked region into lock_buffer. */
+   int lock_size;
+
+#if !defined ALLEGRO_CFG_OPENGLES
+   /* Asynchronous readback, see al_lock_bitmap_async. */
+   GLuint readback_pbo;
+   GLsync readback_fence;
+#endif
 
    float left, top, right, bottom; /* Texture coordinates. */
    bool is_backbuffer; /* This is not a real bitmap, but the backbuffer. */
@@ -75,6 +85,39 @@ typedef struct OPENGL_INFO {
 } OPENGL_INFO;
 
 
+/* Shadow copy of the GL state that the drawing code sets most often, so
+ * that redundant calls can be skipped.  See ogl_draw.c.
+ */
+enum {
+   _AL_OGL_STATE_TEXTURE  = 1,  /* texture binding and active unit */
+   _AL_OGL_STATE_BLENDER  = 2,  /* blending enable, functions, equations */
+   _AL_OGL_STATE_UNIFORMS = 4,  /* use_tex, use_tex_matrix, tex, projview
+                                 * (GL_TEXTURE_2D for the fixed pipeline) */
+   _AL_OGL_STATE_PROGRAM  = 8,  /* program object, implies uniforms */
+   _AL_OGL_STATE_ALL      = 15
+};
+
+typedef struct ALLEGRO_OGL_STATE_CACHE
+{
+   int valid;             /* _AL_OGL_STATE_* bits whose fields are known */
+
+   GLuint texture;
+   int blender[6];
+   GLuint program;
+   GLint projview_loc;
+
+   /* Uniforms, -1 or false if unknown. */
+   int use_tex;
+   int use_tex_matrix;
+   bool tex_unit_set;     /* unit 0 active and the tex sampler set to it */
+   bool projview_set;
+   ALLEGRO_TRANSFORM projview;
+
+   /* Attribute locations the VAO was last set up for. */
+   bool vao_set;
+   GLint vao_locs[3];
+} ALLEGRO_OGL_STATE_CACHE;
+
 typedef struct ALLEGRO_OGL_EXTRAS
 {
    /* A list of extensions supported by Allegro, for this context. */
@@ -108,6 +151,16 @@ typedef struct ALLEGRO_OGL_EXTRAS
    /* For OpenGL 3.0+ we use a single vao and vbo. */
    GLuint vao, vbo;
 
+   /* Pixel unpack buffers which write-only locks are streamed through,
+    * used round-robin.  Bit i of upload_pbos_mapped is set while
+    * upload_pbos[i] is mapped by a lock.
+    */
+   GLuint upload_pbos[ALLEGRO_MAX_OPENGL_UPLOAD_PBOS];
+   int next_upload_pbo;
+   int upload_pbos_mapped;
+
+   ALLEGRO_OGL_STATE_CACHE state_cache;
+
 } ALLEGRO_OGL_EXTRAS;
 
 typedef struct ALLEGRO_OGL_BITMAP_VERTEX
@@ -133,6 +186,10 @@ void _al_ogl_upload_bitmap_memory(ALLEGRO_BITMAP *bitmap, int format, void *ptr)
 ALLEGRO_LOCKED_REGION *_al_ogl_lock_region_new(ALLEGRO_BITMAP *bitmap,
    int x, int y, int w, int h, int format, int flags);
 void _al_ogl_unlock_region_new(ALLEGRO_BITMAP *bitmap);
+bool _al_ogl_lock_region_async_new(ALLEGRO_BITMAP *bitmap,
+   int x, int y, int w, int h, int format, int flags);
+bool _al_ogl_is_lock_ready_new(ALLEGRO_BITMAP *bitmap);
+ALLEGRO_LOCKED_REGION *_al_ogl_finish_lock_new(ALLEGRO_BITMAP *bitmap);
 
 /* common driver */
 GLint _al_ogl_bind_framebuffer(GLint fbo);
@@ -154,6 +211,11 @@ struct ALLEGRO_DISPLAY_INTERFACE;
 void _al_ogl_add_drawing_functions(struct ALLEGRO_DISPLAY_INTERFACE *vt);
 
 AL_FUNC(bool, _al_opengl_set_blender, (ALLEGRO_DISPLAY *disp));
+AL_FUNC(void, _al_ogl_invalidate_state_cache, (ALLEGRO_DISPLAY *disp, int state));
+AL_FUNC(void, _al_ogl_bind_texture, (ALLEGRO_DISPLAY *disp, GLuint texture));
+AL_FUNC(void, _al_ogl_use_program, (ALLEGRO_DISPLAY *disp, GLuint program));
+AL_FUNC(void, _al_ogl_delete_texture, (ALLEGRO_DISPLAY *disp, GLuint texture));
+AL_FUNC(void, _al_ogl_delete_program, (ALLEGRO_DISPLAY *disp, GLuint program));
 AL_FUNC(char const *, _al_gl_error_string, (GLenum e));
 
 void _al_ogl_update_render_state(ALLEGRO_DISPLAY *display);
@@ -0,0 +1,38 @@
+#ifndef __al_included_allegro5_aintern_profile_h
+#define __al_included_allegro5_aintern_profile_h
+
+#ifdef __cplusplus
+   extern "C" {
+#endif
+
+
+AL_VAR(int, _al_profiling);
+
+AL_FUNC(void, _al_profile_begin, (const char *name));
+AL_FUNC(void, _al_profile_end, (void));
+
+void _al_init_profiling(void);
+
+/* Scope markers for Allegro's own hot paths.  They compile to nothing
+ * unless the library was built with WANT_PROFILER, and otherwise cost a
+ * test of _al_profiling while the profiler is off.  The name must be a
+ * string literal, as only the pointer is kept.
+ */
+#ifdef ALLEGRO_CFG_PROFILER
+   #define _AL_PROFILE_BEGIN(name)                                            \
+      do { if (_al_profiling) _al_profile_begin(name); } while (0)
+   #define _AL_PROFILE_END()                                                  \
+      do { if (_al_profiling) _al_profile_end(); } while (0)
+#else
+   #define _AL_PROFILE_BEGIN(name)  do { } while (0)
+   #define _AL_PROFILE_END()        do { } while (0)
+#endif
+
+
+#ifdef __cplusplus
+   }
+#endif
+
+#endif
+
+/* vim: set ts=8 sts=3 sw=3 et: */
@@ -10,6 +10,22 @@ void _al_tls_init_once(void);
 
 int *_al_tls_get_dtor_owner_count(void);
 
+struct _AL_USTR_ARENA;
+struct _AL_MEMORY_CACHE;
+struct _AL_USTR_ARENA **_al_tls_get_ustr_arena(void);
+void _al_ustr_arena_destroy(struct _AL_USTR_ARENA *arena,
+   struct _AL_MEMORY_CACHE *cache);
+
+char **_al_tls_get_trace_buffer(void);
+
+struct _AL_PROFILE_THREAD;
+struct _AL_PROFILE_THREAD **_al_tls_get_profile_thread(void);
+
+struct _AL_MEMORY_CACHE **_al_tls_get_memory_cache(void);
+
+struct ALLEGRO_BLENDER;
+const struct ALLEGRO_BLENDER *_al_tls_get_blender(void);
+
 
 #ifdef __cplusplus
    }
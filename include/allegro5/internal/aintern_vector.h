@@ -45,6 +45,9 @@ AL_FUNC(void, _al_vector_delete_at, (_AL_VECTOR*, unsigned int index));
 AL_FUNC(bool, _al_vector_find_and_delete, (_AL_VECTOR*, const void *ptr_item));
 AL_FUNC(void, _al_vector_free, (_AL_VECTOR*));
 
+struct _AL_MEMORY_CACHE;
+AL_FUNC(void, _al_vector_free_in_cache, (_AL_VECTOR*, struct _AL_MEMORY_CACHE *cache));
+
 
 #ifdef __cplusplus
    }
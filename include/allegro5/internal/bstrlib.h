@@ -38,6 +38,11 @@ extern "C" {
 #define _AL_BSTR_OK (0)
 #define _AL_BSTR_BS_BUFF_LENGTH_GET (0)
 
+/* Allegro: strings whose buffer fits in this many bytes are allocated
+ * together with their header.
+ */
+#define _AL_BSTR_INLINE_SIZE (32)
+
 typedef struct _al_tagbstring * _al_bstring;
 typedef const struct _al_tagbstring * _al_const_bstring;
 
@@ -297,6 +302,24 @@ struct _al_tagbstring {
     (t).mlen = -__LINE__;                                                    \
 }
 
+/* Allegro: every header allocated by bstrlib or a scratch arena is
+ * preceded by a tag.  arena is NULL unless the string belongs to a scratch
+ * arena, in which case scope says which al_ustr_arena_begin it was made
+ * under, and escaped is one more than its index in the arena's list of
+ * strings whose buffer moved to the heap, or 0.
+ */
+typedef struct _al_bstrtag {
+	void * arena;
+	size_t scope;
+	size_t escaped;
+} _al_bstrtag;
+
+#define _al_bstrtag_of(b) (((_al_bstrtag *) (b)) - 1)
+
+/* Allegro: scratch arena hooks, implemented in utf8.c */
+extern void _al_ustr_arena_release (_al_bstring b);
+extern void _al_ustr_arena_adopt (_al_bstring b);
+
 /* Write protection macros */
 #define _al_bwriteprotect(t)     { if ((t).mlen >=  0) (t).mlen = -1; }
 #define _al_bwriteallow(t)       { if ((t).mlen == -1) (t).mlen = (t).slen + ((t).slen == 0); }
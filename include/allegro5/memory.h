@@ -35,6 +35,36 @@ struct ALLEGRO_MEMORY_INTERFACE {
 AL_FUNC(void, al_set_memory_interface, (ALLEGRO_MEMORY_INTERFACE *iface));
 
 
+/* Enum: ALLEGRO_MEMORY_TAG
+ */
+typedef enum ALLEGRO_MEMORY_TAG
+{
+   ALLEGRO_MEMORY_TAG_EVENTS,
+   ALLEGRO_MEMORY_TAG_STRINGS,
+   ALLEGRO_MEMORY_TAG_CONTAINERS,
+   ALLEGRO_MEMORY_TAG_BITMAPS,
+   ALLEGRO_MEMORY_TAG_AUDIO,
+   ALLEGRO_MEMORY_TAG_SYSTEM,
+   ALLEGRO_NUM_MEMORY_TAGS
+} ALLEGRO_MEMORY_TAG;
+
+
+/* Type: ALLEGRO_MEMORY_STATS
+ */
+typedef struct ALLEGRO_MEMORY_STATS ALLEGRO_MEMORY_STATS;
+
+struct ALLEGRO_MEMORY_STATS
+{
+   int64_t live_bytes;
+   int64_t live_count;
+   int64_t total_count;
+};
+
+
+AL_FUNC(bool, al_get_memory_stats, (ALLEGRO_MEMORY_TAG tag,
+   ALLEGRO_MEMORY_STATS *stats));
+
+
 /* Function: al_malloc
  */
 #define al_malloc(n) \
@@ -0,0 +1,39 @@
+/*         ______   ___    ___
+ *        /\  _  \ /\_ \  /\_ \
+ *        \ \ \L\ \\//\ \ \//\ \      __     __   _ __   ___
+ *         \ \  __ \ \ \ \  \ \ \   /'__`\ /'_ `\/\`'__\/ __`\
+ *          \ \ \/\ \ \_\ \_ \_\ \_/\  __//\ \L\ \ \ \//\ \L\ \
+ *           \ \_\ \_\/\____\/\____\ \____\ \____ \ \_\\ \____/
+ *            \/_/\/_/\/____/\/____/\/____/\/___L\ \/_/ \/___/
+ *                                           /\____/
+ *                                           \_/__/
+ *
+ *      Scope profiler.
+ *
+ *      See readme.txt for copyright information.
+ */
+
+#ifndef __al_included_allegro5_profile_h
+#define __al_included_allegro5_profile_h
+
+#include "allegro5/base.h"
+
+#ifdef __cplusplus
+   extern "C" {
+#endif
+
+
+AL_FUNC(bool, al_set_profiling, (bool onoff));
+AL_FUNC(bool, al_get_profiling, (void));
+AL_FUNC(void, al_profile_begin, (const char *name));
+AL_FUNC(void, al_profile_end, (void));
+AL_FUNC(bool, al_save_profile, (const char *filename));
+
+
+#ifdef __cplusplus
+   }
+#endif
+
+#endif
+
+/* vim: set sts=3 sw=3 et: */
@@ -56,6 +56,8 @@ struct ALLEGRO_STATE
 
 AL_FUNC(void, al_store_state, (ALLEGRO_STATE *state, int flags));
 AL_FUNC(void, al_restore_state, (ALLEGRO_STATE const *state));
+AL_FUNC(void, al_push_state, (int flags));
+AL_FUNC(void, al_pop_state, (void));
 
 
 #ifdef __cplusplus
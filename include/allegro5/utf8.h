@@ -36,6 +36,16 @@ AL_FUNC(ALLEGRO_USTR *, al_ustr_dup, (const ALLEGRO_USTR *us));
 AL_FUNC(ALLEGRO_USTR *, al_ustr_dup_substr, (const ALLEGRO_USTR *us,
       int start_pos, int end_pos));
 
+/* Scratch arena strings */
+AL_FUNC(void, al_ustr_arena_begin, (void));
+AL_FUNC(void, al_ustr_arena_end, (void));
+AL_FUNC(ALLEGRO_USTR *, al_ustr_arena_new, (const char *s));
+AL_FUNC(ALLEGRO_USTR *, al_ustr_arena_new_from_buffer, (const char *s,
+      size_t size));
+AL_PRINTFUNC(ALLEGRO_USTR *, al_ustr_arena_newf, (const char *fmt, ...),
+      1, 2);
+AL_FUNC(ALLEGRO_USTR *, al_ustr_arena_dup, (const ALLEGRO_USTR *us));
+
 /* Predefined string */
 AL_FUNC(const ALLEGRO_USTR *, al_ustr_empty_string, (void));
 
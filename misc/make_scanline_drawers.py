@@ -110,8 +110,7 @@ def make_drawer(name):
       print """\
       int op, src_mode, dst_mode;
       int op_alpha, src_alpha, dst_alpha;
-      al_get_separate_blender(&op, &src_mode, &dst_mode,
-         &op_alpha, &src_alpha, &dst_alpha);
+      _AL_LOAD_BLENDER(s->blender);
       """
 
    print "{"
@@ -0,0 +1,62 @@
+#!/usr/bin/env python
+#
+# Generate the polyphase coefficient table for the windowed sinc resampler.
+# Run:
+#  python misc/make_sinc_table.py > addons/audio/kcm_sinc_table.inc
+#
+# The parameters must agree with the SINC_* definitions in
+# addons/audio/kcm_mixer.c, which builds exact tables for fixed ratios at
+# run time using the same filter.
+
+import math
+
+TAPS = 16
+PHASES = 256
+CUTOFF = 0.88
+BETA = 6.0
+
+def bessel_i0(x):
+   s = 1.0
+   term = 1.0
+   k = 1
+   while term > 1e-12 * s:
+      term *= (x / (2.0 * k)) ** 2
+      s += term
+      k += 1
+   return s
+
+def kernel(x):
+   half = TAPS // 2
+   r = x / half
+   if abs(r) >= 1.0:
+      return 0.0
+   w = bessel_i0(BETA * math.sqrt(1.0 - r * r)) / bessel_i0(BETA)
+   y = CUTOFF * x
+   if y == 0.0:
+      s = 1.0
+   else:
+      s = math.sin(math.pi * y) / (math.pi * y)
+   return CUTOFF * s * w
+
+def row(t):
+   half = TAPS // 2
+   c = [kernel((k - (half - 1)) - t) for k in range(TAPS)]
+   total = sum(c)
+   return [v / total for v in c]
+
+def main():
+   print("// Warning: This file was created by make_sinc_table.py - do not edit.")
+   print("// vim: set ft=c:")
+   print("static const float sinc_table[SINC_PHASES + 1][SINC_TAPS] = {")
+   for p in range(PHASES + 1):
+      c = row(float(p) / PHASES)
+      vals = ["%.9ef" % v for v in c]
+      print("   {")
+      for i in range(0, TAPS, 4):
+         print("      " + ", ".join(vals[i:i + 4]) + ",")
+      print("   },")
+   print("};")
+
+main()
+
+# vim: set sts=3 sw=3 et:
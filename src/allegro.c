@@ -24,15 +24,27 @@
 #include "allegro5/internal/aintern.h"
 #include "allegro5/internal/aintern_dtor.h"
 #include "allegro5/internal/aintern_system.h"
+#include "allegro5/internal/aintern_thread.h"
+#include "allegro5/internal/aintern_tls.h"
 #include "allegro5/platform/alplatf.h"
 #include ALLEGRO_INTERNAL_HEADER
 
-static char static_trace_buffer[2048];
+#define TRACE_BUFFER_SIZE  2048
+
+static char static_trace_buffer[TRACE_BUFFER_SIZE];
 
 #ifdef ALLEGRO_ANDROID
 #  include <android/log.h>
 #endif
 
+#ifdef ALLEGRO_WINDOWS
+#  include <io.h>
+#  define trace_write_stderr(buf, n)   _write(2, buf, (unsigned)(n))
+#else
+#  include <unistd.h>
+#  define trace_write_stderr(buf, n)   write(STDERR_FILENO, buf, n)
+#endif
+
 
 /* tracing */
 typedef struct TRACE_INFO
@@ -65,6 +77,38 @@ static TRACE_INFO trace_info =
 };
 
 
+/* Asynchronous logging.  Formatted messages are appended to a byte ring
+ * and written out by a background thread, so a log call costs a format
+ * into a per-thread buffer plus a short copy under trace_mutex.  `head'
+ * and `tail' count bytes ever queued and written; bytes before `tail' are
+ * kept as history until overwritten, for al_dump_trace_history.  All
+ * fields are protected by trace_mutex.
+ */
+typedef struct TRACE_RING
+{
+   bool active;
+   bool quit;
+   char *buf;
+   size_t size;
+   uint64_t head;
+   uint64_t tail;
+   unsigned dropped;
+   _AL_THREAD thread;
+   _AL_COND cond;
+} TRACE_RING;
+
+static TRACE_RING trace_ring;
+
+#define TRACE_RING_DEFAULT_SIZE  65536
+#define TRACE_RING_MIN_SIZE      4096
+
+/* Lowest level which may be logged.  The trace macros compare against
+ * this before calling _al_trace_prefix.  It stays at 0 until logging has
+ * been configured, so that the first message triggers the configuration.
+ */
+int _al_trace_level = 0;
+
+
 /* run-time assertions */
 void (*_al_user_assert_handler)(char const *expr, char const *file,
    int line, char const *func);
@@ -163,6 +207,10 @@ static void delete_string_list(_AL_VECTOR *v)
 
 
 
+static void start_trace_ring(size_t size);
+
+
+
 static void configure_logging(void)
 {
    ALLEGRO_CONFIG *config;
@@ -242,7 +290,19 @@ static void configure_logging(void)
 
    _al_mutex_init(&trace_info.trace_mutex);
 
+#ifndef ALLEGRO_ANDROID
+   v = al_get_config_value(config, "trace", "async");
+   if (v && strcmp(v, "0")) {
+      size_t size = TRACE_RING_DEFAULT_SIZE;
+      v = al_get_config_value(config, "trace", "async_buffer");
+      if (v && atoi(v) > 0)
+         size = _ALLEGRO_MAX(atoi(v), TRACE_RING_MIN_SIZE);
+      start_trace_ring(size);
+   }
+#endif
+
    trace_info.configured = true;
+   _al_trace_level = trace_info.level;
 }
 
 
@@ -272,20 +332,162 @@ static void open_trace_file(void)
 }
 
 
-static void do_trace(const char *msg, ...)
+/* Writes the bytes [from, to) of the ring to the trace file. */
+static void write_trace_ring(uint64_t from, uint64_t to)
+{
+   while (from < to) {
+      size_t pos = from % trace_ring.size;
+      size_t n = _ALLEGRO_MIN(trace_ring.size - pos, to - from);
+      fwrite(trace_ring.buf + pos, 1, n, trace_info.trace_file);
+      from += n;
+   }
+}
+
+
+
+static void trace_writer_proc(_AL_THREAD *thread, void *arg)
+{
+   (void)thread;
+   (void)arg;
+
+   _al_mutex_lock(&trace_info.trace_mutex);
+   open_trace_file();
+
+   for (;;) {
+      uint64_t start, end;
+      unsigned dropped;
+
+      while (trace_ring.tail == trace_ring.head && !trace_ring.dropped &&
+            !trace_ring.quit) {
+         _al_cond_wait(&trace_ring.cond, &trace_info.trace_mutex);
+      }
+      if (trace_ring.tail == trace_ring.head && !trace_ring.dropped)
+         break;
+
+      start = trace_ring.tail;
+      end = trace_ring.head;
+      dropped = trace_ring.dropped;
+      trace_ring.dropped = 0;
+
+      /* Producers never overwrite bytes past `tail', so the range can be
+       * written without holding the lock.
+       */
+      _al_mutex_unlock(&trace_info.trace_mutex);
+      if (trace_info.trace_file) {
+         write_trace_ring(start, end);
+         if (dropped) {
+            fprintf(trace_info.trace_file,
+               "trace    W %u messages dropped, log buffer full\n", dropped);
+         }
+         fflush(trace_info.trace_file);
+      }
+      _al_mutex_lock(&trace_info.trace_mutex);
+
+      trace_ring.tail = end;
+   }
+
+   _al_mutex_unlock(&trace_info.trace_mutex);
+}
+
+
+
+static void start_trace_ring(size_t size)
+{
+   trace_ring.buf = al_malloc(size);
+   if (!trace_ring.buf)
+      return;
+   trace_ring.size = size;
+   trace_ring.head = 0;
+   trace_ring.tail = 0;
+   trace_ring.dropped = 0;
+   trace_ring.quit = false;
+   _al_cond_init(&trace_ring.cond);
+   _al_thread_create(&trace_ring.thread, trace_writer_proc, NULL);
+   trace_ring.active = true;
+}
+
+
+
+static void stop_trace_ring(void)
+{
+   if (!trace_ring.active)
+      return;
+
+   /* Messages formatted from now on bypass the ring, so nobody touches the
+    * buffer once the writer has drained it.
+    */
+   _al_mutex_lock(&trace_info.trace_mutex);
+   trace_ring.active = false;
+   trace_ring.quit = true;
+   _al_cond_signal(&trace_ring.cond);
+   _al_mutex_unlock(&trace_info.trace_mutex);
+   _al_thread_join(&trace_ring.thread);
+
+   _al_cond_destroy(&trace_ring.cond);
+   al_free(trace_ring.buf);
+   trace_ring.buf = NULL;
+}
+
+
+
+/* Queues a complete message for the writer thread.  Must be called with
+ * trace_mutex held.  If the writer has fallen too far behind the message
+ * is dropped, rather than blocking the caller.
+ */
+static void enqueue_trace(const char *msg)
+{
+   size_t len = strlen(msg);
+   size_t pos;
+   size_t n;
+
+   if (trace_ring.head - trace_ring.tail + len > trace_ring.size) {
+      trace_ring.dropped++;
+      return;
+   }
+
+   pos = trace_ring.head % trace_ring.size;
+   n = _ALLEGRO_MIN(trace_ring.size - pos, len);
+   memcpy(trace_ring.buf + pos, msg, n);
+   memcpy(trace_ring.buf, msg + n, len - n);
+   trace_ring.head += len;
+
+   _al_cond_signal(&trace_ring.cond);
+}
+
+
+
+/* Returns this thread's buffer for formatting messages for the ring,
+ * allocating it on first use.  Returns NULL if there is none.  The buffer
+ * is freed along with the rest of the thread local state when the thread
+ * exits.
+ */
+static char *get_thread_trace_buffer(bool create)
+{
+   char **pbuf = _al_tls_get_trace_buffer();
+
+   if (!pbuf)
+      return NULL;
+   if (!*pbuf && create) {
+      *pbuf = al_malloc(TRACE_BUFFER_SIZE);
+      if (*pbuf)
+         (*pbuf)[0] = '\0';
+   }
+   return *pbuf;
+}
+
+
+
+/* Appends to `buf' if not NULL, or else writes straight to the trace
+ * file.
+ */
+static void do_trace(char *buf, const char *msg, ...)
 {
    va_list ap;
 
-#ifdef ALLEGRO_ANDROID
-   if (true)
-#else
-   if (_al_user_trace_handler)
-#endif
-   {
-      int s = strlen(static_trace_buffer);
+   if (buf) {
+      int s = strlen(buf);
       va_start(ap, msg);
-      vsnprintf(static_trace_buffer + s, sizeof(static_trace_buffer) - s,
-         msg, ap);
+      vsnprintf(buf + s, TRACE_BUFFER_SIZE - s, msg, ap);
       va_end(ap);
    }
    else if (trace_info.trace_file) {
@@ -306,6 +508,7 @@ bool _al_trace_prefix(char const *channel, int level,
 {
    size_t i;
    char *name;
+   char *buf;
    _AL_VECTOR const *v;
 
    /* XXX logging should be reconfigured if the system driver is reinstalled */
@@ -339,23 +542,38 @@ channel_included:
       }
    }
 
-   /* Avoid interleaved output from different threads. */
-   _al_mutex_lock(&trace_info.trace_mutex);
+   /* With the ring, each thread formats into its own buffer and only
+    * takes the lock to queue the finished message in _al_trace_suffix.
+    */
+   buf = NULL;
+   if (trace_ring.active && !_al_user_trace_handler)
+      buf = get_thread_trace_buffer(true);
 
-   if (!_al_user_trace_handler)
-      open_trace_file();
+   if (!buf) {
+      /* Avoid interleaved output from different threads. */
+      _al_mutex_lock(&trace_info.trace_mutex);
 
-   do_trace("%-8s ", channel);
-   if (level == 0) do_trace("D ");
-   if (level == 1) do_trace("I ");
-   if (level == 2) do_trace("W ");
-   if (level == 3) do_trace("E ");
+#ifdef ALLEGRO_ANDROID
+      buf = static_trace_buffer;
+#else
+      if (_al_user_trace_handler || trace_ring.active)
+         buf = static_trace_buffer;
+      else
+         open_trace_file();
+#endif
+   }
+
+   do_trace(buf, "%-8s ", channel);
+   if (level == 0) do_trace(buf, "D ");
+   if (level == 1) do_trace(buf, "I ");
+   if (level == 2) do_trace(buf, "W ");
+   if (level == 3) do_trace(buf, "E ");
 
 #ifdef ALLEGRO_ANDROID
    {
       char pid_buf[16];
       snprintf(pid_buf, sizeof(pid_buf), "%i: ", gettid());
-      do_trace(pid_buf);
+      do_trace(buf, pid_buf);
    }
 #endif
 
@@ -365,10 +583,10 @@ channel_included:
    name = strrchr(file, '/');
 #endif
    if (trace_info.flags & 1) {
-      do_trace("%20s:%-4d ", name ? name + 1 : file, line);
+      do_trace(buf, "%20s:%-4d ", name ? name + 1 : file, line);
    }
    if (trace_info.flags & 2) {
-      do_trace("%-32s ", function);
+      do_trace(buf, "%-32s ", function);
    }
    if (trace_info.flags & 4) {
       double t = al_get_time();
@@ -378,33 +596,79 @@ channel_included:
        */
       if (t > 3600 * 24 * 365)
          t = 0;
-      do_trace("[%10.5f] ", t);
+      do_trace(buf, "[%10.5f] ", t);
    }
 
-   /* Do not unlocked trace_mutex here; that is done by _al_trace_suffix. */
+   /* Do not unlocked trace_mutex here; that is done by _al_trace_suffix.
+    * The thread buffer is non-empty now exactly if it was used, which is
+    * how the suffix knows whether we hold the lock.
+    */
    return true;
 }
 
 
 
+/* Appends the message to `buf', making sure it still ends in a newline
+ * if it had to be truncated.
+ */
+static void format_trace_message(char *buf, const char *msg, va_list ap)
+{
+   int s = strlen(buf);
+   vsnprintf(buf + s, TRACE_BUFFER_SIZE - s, msg, ap);
+   if (strlen(buf) == TRACE_BUFFER_SIZE - 1)
+      buf[TRACE_BUFFER_SIZE - 2] = '\n';
+}
+
+
+
 /* _al_trace_suffix:
  *  Output the final part of a trace message, and release the trace_mutex lock.
  */
 void _al_trace_suffix(const char *msg, ...)
 {
    int olderr = errno;
+   char *buf;
    va_list ap;
 
+   /* Go by the path the prefix took, not by whether the ring is still
+    * running, as it may have been stopped in between.
+    */
+   buf = get_thread_trace_buffer(false);
+
+   if (buf && buf[0]) {
+      va_start(ap, msg);
+      format_trace_message(buf, msg, ap);
+      va_end(ap);
+
+      _al_mutex_lock(&trace_info.trace_mutex);
+      if (trace_ring.active) {
+         enqueue_trace(buf);
+      }
+      else if (_al_user_trace_handler) {
+         _al_user_trace_handler(buf);
+      }
+      else {
+         open_trace_file();
+         if (trace_info.trace_file) {
+            fputs(buf, trace_info.trace_file);
+            fflush(trace_info.trace_file);
+         }
+      }
+      _al_mutex_unlock(&trace_info.trace_mutex);
+      buf[0] = '\0';
+
+      errno = olderr;
+      return;
+   }
+
 #ifdef ALLEGRO_ANDROID
    if (true)
 #else
-   if (_al_user_trace_handler)
+   if (_al_user_trace_handler || trace_ring.active)
 #endif
    {
-      int s = strlen(static_trace_buffer);
       va_start(ap, msg);
-      vsnprintf(static_trace_buffer + s, sizeof(static_trace_buffer) - s,
-         msg, ap);
+      format_trace_message(static_trace_buffer, msg, ap);
       va_end(ap);
 
       if (_al_user_trace_handler) {
@@ -415,6 +679,10 @@ void _al_trace_suffix(const char *msg, ...)
          (void)__android_log_print(ANDROID_LOG_INFO, "allegro",
             static_trace_buffer);
       }
+      #else
+      else {
+         enqueue_trace(static_trace_buffer);
+      }
       #endif
       static_trace_buffer[0] = '\0';
    }
@@ -435,12 +703,14 @@ void _al_trace_suffix(const char *msg, ...)
 void _al_shutdown_logging(void)
 {
    if (trace_info.configured) {
+      stop_trace_ring();
       _al_mutex_destroy(&trace_info.trace_mutex);
 
       delete_string_list(&trace_info.channels);
       delete_string_list(&trace_info.excluded);
 
       trace_info.configured = false;
+      _al_trace_level = 0;
    }
 
    if (trace_info.trace_file && trace_info.trace_file != stderr) {
@@ -472,6 +742,52 @@ void al_register_trace_handler(void (*handler)(char const *))
 
 
 
+/* Function: al_dump_trace_history
+ */
+void al_dump_trace_history(int max_entries)
+{
+   const char *ring;
+   size_t size;
+   uint64_t head;
+   uint64_t start, from, p;
+   int n = 0;
+
+   /* This is meant to be usable from a crash handler, so it takes no
+    * locks, allocates nothing and writes with the raw system call.  The
+    * oldest retained line is skipped once the ring has wrapped, as it will
+    * have been partly overwritten.
+    */
+   if (!trace_ring.active)
+      return;
+   ring = trace_ring.buf;
+   size = trace_ring.size;
+   head = trace_ring.head;
+   if (!ring || head == 0)
+      return;
+
+   start = head > size ? head - size : 0;
+   from = head;
+   for (p = head - 1; p > start; p--) {
+      if (ring[(p - 1) % size] != '\n')
+         continue;
+      from = p;
+      if (max_entries > 0 && ++n >= max_entries)
+         break;
+   }
+   if (p == 0)
+      from = 0;
+
+   while (from < head) {
+      size_t pos = from % size;
+      size_t len = _ALLEGRO_MIN(size - pos, head - from);
+      if (trace_write_stderr(ring + pos, len) < 0)
+         break;
+      from += len;
+   }
+}
+
+
+
 /* Function: al_get_allegro_version
  */
 uint32_t al_get_allegro_version(void)
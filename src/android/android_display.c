@@ -756,7 +756,7 @@ static void android_acknowledge_drawing_halt(ALLEGRO_DISPLAY *dpy)
 	    if (!(bmp->flags & ALLEGRO_NO_PRESERVE_TEXTURE)) {
                ALLEGRO_BITMAP_EXTRA_OPENGL *extra = bmp->extra;
                al_remove_opengl_fbo(bmp);
-               glDeleteTextures(1, &extra->texture);
+               _al_ogl_delete_texture(dpy, extra->texture);
 	       extra->texture = 0;
 	    }
       }
@@ -26,6 +26,7 @@
 #include "allegro5/internal/aintern_display.h"
 #include "allegro5/internal/aintern_bitmap.h"
 #include "allegro5/internal/aintern_system.h"
+#include "allegro5/internal/aintern_memory.h"
 
 ALLEGRO_DEBUG_CHANNEL("bitmap")
 
@@ -53,15 +54,64 @@ void _al_init_to_be_converted_bitmaps(void)
       "cleanup_to_be_converted_bitmaps");
 }
 
+/* Each bitmap remembers its position in display->bitmaps and in the list
+ * of bitmaps to be converted, so that it can be removed by moving the last
+ * element into its place instead of searching the list.  The position is
+ * only trusted if the list actually holds the bitmap there, so a zeroed
+ * bitmap which was never added is handled too.
+ */
+static int *bitmap_list_index(ALLEGRO_BITMAP *bitmap, bool display_list)
+{
+   return display_list ? &bitmap->display_index : &bitmap->convert_index;
+}
+
+
+static bool bitmap_list_contains(_AL_VECTOR *list, ALLEGRO_BITMAP *bitmap,
+   bool display_list)
+{
+   int index = *bitmap_list_index(bitmap, display_list);
+   return index >= 0 && (unsigned int)index < _al_vector_size(list)
+      && *(ALLEGRO_BITMAP **)_al_vector_ref(list, index) == bitmap;
+}
+
+
+static void bitmap_list_add(_AL_VECTOR *list, ALLEGRO_BITMAP *bitmap,
+   bool display_list)
+{
+   ALLEGRO_BITMAP **back = _al_vector_alloc_back(list);
+   *back = bitmap;
+   *bitmap_list_index(bitmap, display_list) = _al_vector_size(list) - 1;
+}
+
+
+static void bitmap_list_remove(_AL_VECTOR *list, ALLEGRO_BITMAP *bitmap,
+   bool display_list)
+{
+   int index;
+   int last;
+
+   if (!bitmap_list_contains(list, bitmap, display_list))
+      return;
+
+   index = *bitmap_list_index(bitmap, display_list);
+   last = _al_vector_size(list) - 1;
+   if (index != last) {
+      ALLEGRO_BITMAP *moved = *(ALLEGRO_BITMAP **)_al_vector_ref(list, last);
+      *(ALLEGRO_BITMAP **)_al_vector_ref(list, index) = moved;
+      *bitmap_list_index(moved, display_list) = index;
+   }
+   _al_vector_delete_at(list, last);
+   *bitmap_list_index(bitmap, display_list) = -1;
+}
+
+
 static void check_to_be_converted_list_add(ALLEGRO_BITMAP *bitmap)
 {
    if (!(bitmap->flags & ALLEGRO_MEMORY_BITMAP))
       return;
    if (bitmap->flags & ALLEGRO_CONVERT_BITMAP) {
-      ALLEGRO_BITMAP **back;
       al_lock_mutex(to_be_converted.mutex);
-      back = _al_vector_alloc_back(&to_be_converted.bitmaps);
-      *back = bitmap;
+      bitmap_list_add(&to_be_converted.bitmaps, bitmap, false);
       al_unlock_mutex(to_be_converted.mutex);
    }
 }
@@ -73,25 +123,94 @@ static void check_to_be_converted_list_remove(ALLEGRO_BITMAP *bitmap)
       return;
    if (bitmap->flags & ALLEGRO_CONVERT_BITMAP) {
       al_lock_mutex(to_be_converted.mutex);
-      _al_vector_find_and_delete(&to_be_converted.bitmaps, &bitmap);
+      bitmap_list_remove(&to_be_converted.bitmaps, bitmap, false);
       al_unlock_mutex(to_be_converted.mutex);
    }
 }
 
 
-/* Creates a memory bitmap.
+/* Internal function: _al_transfer_display_bitmaps
+ *  Move all bitmaps of one display to another, compatible display.
  */
-static ALLEGRO_BITMAP *_al_create_memory_bitmap(int w, int h)
+void _al_transfer_display_bitmaps(ALLEGRO_DISPLAY *from, ALLEGRO_DISPLAY *to)
 {
-   ALLEGRO_BITMAP *bitmap;
-   int pitch;
-   int format = al_get_new_bitmap_format();
+   while (_al_vector_is_nonempty(&from->bitmaps)) {
+      ALLEGRO_BITMAP *bitmap =
+         *(ALLEGRO_BITMAP **)_al_vector_ref_back(&from->bitmaps);
+      bitmap_list_remove(&from->bitmaps, bitmap, true);
+      bitmap_list_add(&to->bitmaps, bitmap, true);
+      bitmap->display = to;
+   }
+}
 
-   format = _al_get_real_pixel_format(al_get_current_display(), format);
+
+/* The pixels of memory bitmaps start on a BITMAP_ALIGNMENT byte boundary
+ * and, unless ALLEGRO_PACKED_BITMAP is set, so does every row.  This lets
+ * vectorised code use aligned loads and stores.  The block returned by
+ * al_malloc and its size are remembered just before the aligned pointer.
+ */
+#define BITMAP_ALIGNMENT   64
+#define BITMAP_PREFIX      (2 * sizeof(void *))
+
+
+static unsigned char *alloc_bitmap_memory(size_t size)
+{
+   unsigned char *block;
+   uintptr_t p;
+
+   size += BITMAP_ALIGNMENT + BITMAP_PREFIX;
+   block = _al_tagged_malloc(ALLEGRO_MEMORY_TAG_BITMAPS, size);
+   if (!block)
+      return NULL;
+
+   p = (uintptr_t)(block + BITMAP_PREFIX);
+   p = (p + BITMAP_ALIGNMENT - 1) & ~(uintptr_t)(BITMAP_ALIGNMENT - 1);
+   ((void **)p)[-1] = block;
+   ((size_t *)p)[-2] = size;
+   return (unsigned char *)p;
+}
+
+
+static void free_bitmap_memory(unsigned char *memory)
+{
+   if (memory) {
+      _al_tagged_free(ALLEGRO_MEMORY_TAG_BITMAPS, ((void **)memory)[-1],
+         ((size_t *)memory)[-2]);
+   }
+}
+
+
+/* Creates a memory bitmap.  If data is NULL the pixels are allocated,
+ * with the default pitch if pitch is 0.  Otherwise the bitmap uses the
+ * given memory, which it does not own.
+ */
+static ALLEGRO_BITMAP *create_memory_bitmap(int w, int h, int format,
+   int flags, int pitch, void *data)
+{
+   ALLEGRO_BITMAP *bitmap;
 
    bitmap = al_calloc(1, sizeof *bitmap);
+   if (!bitmap)
+      return NULL;
 
-   pitch = w * al_get_pixel_size(format);
+   if (data) {
+      bitmap->memory = data;
+      bitmap->user_memory = true;
+   }
+   else {
+      if (pitch == 0) {
+         pitch = w * al_get_pixel_size(format);
+         if (!(flags & ALLEGRO_PACKED_BITMAP)) {
+            pitch = (pitch + BITMAP_ALIGNMENT - 1)
+               & ~(BITMAP_ALIGNMENT - 1);
+         }
+      }
+      bitmap->memory = alloc_bitmap_memory((size_t)pitch * h);
+      if (!bitmap->memory) {
+         al_free(bitmap);
+         return NULL;
+      }
+   }
 
    bitmap->vt = NULL;
    bitmap->format = format;
@@ -99,7 +218,7 @@ static ALLEGRO_BITMAP *_al_create_memory_bitmap(int w, int h)
    /* If this is really a video bitmap, we add it to the list of to
     * be converted bitmaps.
     */
-   bitmap->flags = al_get_new_bitmap_flags() | ALLEGRO_MEMORY_BITMAP;
+   bitmap->flags = flags | ALLEGRO_MEMORY_BITMAP;
    bitmap->flags &= ~ALLEGRO_VIDEO_BITMAP;
    bitmap->w = w;
    bitmap->h = h;
@@ -114,20 +233,30 @@ static ALLEGRO_BITMAP *_al_create_memory_bitmap(int w, int h)
    bitmap->inverse_transform_dirty = false;
    bitmap->parent = NULL;
    bitmap->xofs = bitmap->yofs = 0;
-   bitmap->memory = al_malloc(pitch * h);
-   
+
    check_to_be_converted_list_add(bitmap);
    return bitmap;
 }
 
 
+static ALLEGRO_BITMAP *_al_create_memory_bitmap(int w, int h)
+{
+   int format = al_get_new_bitmap_format();
+
+   format = _al_get_real_pixel_format(al_get_current_display(), format);
+
+   return create_memory_bitmap(w, h, format, al_get_new_bitmap_flags(),
+      0, NULL);
+}
+
+
 
 static void _al_destroy_memory_bitmap(ALLEGRO_BITMAP *bmp)
 {
    check_to_be_converted_list_remove(bmp);
 
-   if (bmp->memory)
-      al_free(bmp->memory);
+   if (!bmp->user_memory)
+      free_bitmap_memory(bmp->memory);
    al_free(bmp);
 }
 
@@ -138,7 +267,6 @@ static ALLEGRO_BITMAP *do_create_bitmap(int w, int h,
    void *custom_data)
 {
    ALLEGRO_BITMAP *bitmap;
-   ALLEGRO_BITMAP **back;
    ALLEGRO_SYSTEM *system = al_get_system_driver();
    ALLEGRO_DISPLAY *current_display = al_get_current_display();
    int64_t mul;
@@ -158,7 +286,9 @@ static ALLEGRO_BITMAP *do_create_bitmap(int w, int h,
          current_display->vt->create_bitmap == NULL) ||
          (system->displays._size < 1)) {
 
-      if (al_get_new_bitmap_flags() & ALLEGRO_VIDEO_BITMAP)
+      /* The memory of a headless display is all the video memory there is. */
+      if ((al_get_new_bitmap_flags() & ALLEGRO_VIDEO_BITMAP) &&
+            !(current_display && (current_display->flags & ALLEGRO_HEADLESS)))
          return NULL;
 
       return _al_create_memory_bitmap(w, h);
@@ -213,8 +343,7 @@ static ALLEGRO_BITMAP *do_create_bitmap(int w, int h,
    
    /* We keep a list of bitmaps depending on the current display so that we can
     * convert them to memory bimaps when the display is destroyed. */
-   back = _al_vector_alloc_back(&current_display->bitmaps);
-   *back = bitmap;
+   bitmap_list_add(&current_display->bitmaps, bitmap, true);
 
    return bitmap;
 }
@@ -226,7 +355,7 @@ ALLEGRO_BITMAP *al_create_bitmap(int w, int h)
 {
    ALLEGRO_BITMAP *bitmap = do_create_bitmap(w, h, NULL, NULL);
    if (bitmap) {
-      _al_register_destructor(_al_dtor_list, bitmap,
+      bitmap->dtor_item = _al_register_destructor(_al_dtor_list, bitmap,
          (void (*)(void *))al_destroy_bitmap);
    }
    
@@ -241,7 +370,7 @@ ALLEGRO_BITMAP *al_create_custom_bitmap(int w, int h,
 {
    ALLEGRO_BITMAP *bitmap = do_create_bitmap(w, h, upload, data);
    if (bitmap) {
-      _al_register_destructor(_al_dtor_list, bitmap,
+      bitmap->dtor_item = _al_register_destructor(_al_dtor_list, bitmap,
          (void (*)(void *))al_destroy_bitmap);
    }
    
@@ -249,6 +378,81 @@ ALLEGRO_BITMAP *al_create_custom_bitmap(int w, int h,
 }
 
 
+/* Rejects a pitch too small for the width, or so large that offsets into
+ * the pixels would overflow int.
+ */
+static bool check_pitch(int w, int h, int format, int pitch)
+{
+   int64_t row = (int64_t) w * al_get_pixel_size(format);
+
+   if (w <= 0 || h <= 0 || pitch < row ||
+         (int64_t) pitch * (int64_t) h > (int64_t) INT_MAX) {
+      ALLEGRO_ERROR("Invalid pitch %d for a %dx%d bitmap.\n", pitch, w, h);
+      return false;
+   }
+   return true;
+}
+
+
+
+/* Function: al_create_bitmap_with_pitch
+ */
+ALLEGRO_BITMAP *al_create_bitmap_with_pitch(int w, int h, int pitch)
+{
+   ALLEGRO_BITMAP *bitmap;
+   ALLEGRO_DISPLAY *current_display = al_get_current_display();
+   int format = al_get_new_bitmap_format();
+   int flags = al_get_new_bitmap_flags() & ~ALLEGRO_CONVERT_BITMAP;
+
+   /* As in do_create_bitmap, only a headless display counts memory as
+    * video memory.
+    */
+   if ((flags & ALLEGRO_VIDEO_BITMAP) &&
+         !(current_display && (current_display->flags & ALLEGRO_HEADLESS))) {
+      ALLEGRO_ERROR("Bitmaps with a pitch cannot be video bitmaps.\n");
+      return NULL;
+   }
+
+   format = _al_get_real_pixel_format(current_display, format);
+   if (!check_pitch(w, h, format, pitch))
+      return NULL;
+
+   bitmap = create_memory_bitmap(w, h, format, flags, pitch, NULL);
+   if (bitmap) {
+      bitmap->dtor_item = _al_register_destructor(_al_dtor_list, bitmap,
+         (void (*)(void *))al_destroy_bitmap);
+   }
+
+   return bitmap;
+}
+
+
+/* Function: al_create_bitmap_for_memory
+ */
+ALLEGRO_BITMAP *al_create_bitmap_for_memory(void *data, int w, int h,
+   int format, int pitch)
+{
+   ALLEGRO_BITMAP *bitmap;
+   int flags = al_get_new_bitmap_flags() & ~ALLEGRO_CONVERT_BITMAP;
+   ASSERT(data);
+
+   if (!_al_pixel_format_is_real(format)) {
+      ALLEGRO_ERROR("Pixel format %d is not a real format.\n", format);
+      return NULL;
+   }
+   if (!check_pitch(w, h, format, pitch))
+      return NULL;
+
+   bitmap = create_memory_bitmap(w, h, format, flags, pitch, data);
+   if (bitmap) {
+      bitmap->dtor_item = _al_register_destructor(_al_dtor_list, bitmap,
+         (void (*)(void *))al_destroy_bitmap);
+   }
+
+   return bitmap;
+}
+
+
 /* Function: al_destroy_bitmap
  */
 void al_destroy_bitmap(ALLEGRO_BITMAP *bitmap)
@@ -257,7 +461,7 @@ void al_destroy_bitmap(ALLEGRO_BITMAP *bitmap)
       return;
    }
 
-   _al_unregister_destructor(_al_dtor_list, bitmap);
+   _al_unregister_destructor(_al_dtor_list, bitmap->dtor_item);
 
    if (bitmap->flags & ALLEGRO_MEMORY_BITMAP) {
       _al_destroy_memory_bitmap(bitmap);
@@ -273,7 +477,7 @@ void al_destroy_bitmap(ALLEGRO_BITMAP *bitmap)
       bitmap->vt->destroy_bitmap(bitmap);
 
    if (bitmap->display)
-      _al_vector_find_and_delete(&bitmap->display->bitmaps, &bitmap);
+      bitmap_list_remove(&bitmap->display->bitmaps, bitmap, true);
 
    if (bitmap->memory)
       al_free(bitmap->memory);
@@ -282,6 +486,22 @@ void al_destroy_bitmap(ALLEGRO_BITMAP *bitmap)
 }
 
 
+/* Function: al_destroy_bitmaps
+ */
+void al_destroy_bitmaps(ALLEGRO_BITMAP **bitmaps, int count)
+{
+   int i;
+   ASSERT(bitmaps || count == 0);
+
+   /* Take the (recursive) list lock once for the whole batch. */
+   al_lock_mutex(to_be_converted.mutex);
+   for (i = 0; i < count; i++) {
+      al_destroy_bitmap(bitmaps[i]);
+   }
+   al_unlock_mutex(to_be_converted.mutex);
+}
+
+
 /* Function: al_convert_mask_to_alpha
  */
 void al_convert_mask_to_alpha(ALLEGRO_BITMAP *bitmap, ALLEGRO_COLOR mask_color)
@@ -441,7 +661,11 @@ ALLEGRO_BITMAP *al_create_sub_bitmap(ALLEGRO_BITMAP *parent,
 
    bitmap->w = w;
    bitmap->h = h;
-   bitmap->display = parent->display;
+   /* Memory bitmaps don't belong to a display, except for the backbuffer
+    * of a headless display.  Its sub-bitmaps don't, either.
+    */
+   if (!(parent->flags & ALLEGRO_MEMORY_BITMAP))
+      bitmap->display = parent->display;
    bitmap->locked = false;
    bitmap->cl = bitmap->ct = 0;
    bitmap->cr_excl = w;
@@ -455,9 +679,7 @@ ALLEGRO_BITMAP *al_create_sub_bitmap(ALLEGRO_BITMAP *parent,
    bitmap->memory = NULL;
 
    if (bitmap->display) {
-      ALLEGRO_BITMAP **back;
-      back = _al_vector_alloc_back(&bitmap->display->bitmaps);
-      *back = bitmap;
+      bitmap_list_add(&bitmap->display->bitmaps, bitmap, true);
    }
 
    return bitmap;
@@ -523,6 +745,12 @@ ALLEGRO_BITMAP *al_clone_bitmap(ALLEGRO_BITMAP *bitmap)
 static void _al_swap_bitmaps(ALLEGRO_BITMAP *bitmap, ALLEGRO_BITMAP *other)
 {
    ALLEGRO_BITMAP temp = *bitmap;
+   _AL_LIST_ITEM *bitmap_dtor_item = bitmap->dtor_item;
+   _AL_LIST_ITEM *other_dtor_item = other->dtor_item;
+   bool bitmap_listed = bitmap->display
+      && bitmap_list_contains(&bitmap->display->bitmaps, bitmap, true);
+   bool other_listed = other->display
+      && bitmap_list_contains(&other->display->bitmaps, other, true);
 
    check_to_be_converted_list_remove(bitmap);
    check_to_be_converted_list_remove(other);
@@ -530,27 +758,27 @@ static void _al_swap_bitmaps(ALLEGRO_BITMAP *bitmap, ALLEGRO_BITMAP *other)
    *bitmap = *other;
    *other = temp;
 
+   /* The destructor registration belongs to the pointer, not the contents. */
+   bitmap->dtor_item = bitmap_dtor_item;
+   other->dtor_item = other_dtor_item;
+
    /* We are basically done already. Except we now have to update everything
     * possibly referencing any of the two bitmaps.
     */
 
-   if (bitmap->display && !other->display) {
-      /* This means before the swap, other was the display bitmap, and we
-       * now should replace it with the swapped pointer.
-       */
-      ALLEGRO_BITMAP **back;
-      int pos = _al_vector_find(&bitmap->display->bitmaps, &other);
-      ASSERT(pos >= 0);
-      back = _al_vector_ref(&bitmap->display->bitmaps, pos);
-      *back = bitmap;
-   }
-
-   if (other->display && !bitmap->display) {
-      ALLEGRO_BITMAP **back;
-      int pos = _al_vector_find(&other->display->bitmaps, &bitmap);
-      ASSERT(pos >= 0);
-      back = _al_vector_ref(&other->display->bitmaps, pos);
-      *back = other;
+   /* The display list positions moved along with the contents; point the
+    * list entries at the swapped pointers.
+    */
+   if (other_listed) {
+      ALLEGRO_BITMAP **slot = _al_vector_ref(&bitmap->display->bitmaps,
+         bitmap->display_index);
+      *slot = bitmap;
+   }
+
+   if (bitmap_listed) {
+      ALLEGRO_BITMAP **slot = _al_vector_ref(&other->display->bitmaps,
+         other->display_index);
+      *slot = other;
    }
 
    check_to_be_converted_list_add(bitmap);
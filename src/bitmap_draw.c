@@ -17,6 +17,7 @@
 #include "allegro5/allegro.h"
 #include "allegro5/internal/aintern_display.h"
 #include "allegro5/internal/aintern_bitmap.h"
+#include "allegro5/internal/aintern_profile.h"
 
 
 static ALLEGRO_COLOR solid_white = {1, 1, 1, 1};
@@ -111,9 +112,11 @@ static void _draw_tinted_rotated_scaled_bitmap_region(ALLEGRO_BITMAP *bitmap,
    al_translate_transform(&t, dx, dy);
    al_compose_transform(&t, &backup);
 
+   _AL_PROFILE_BEGIN("al_draw_bitmap");
    al_use_transform(&t);
    _bitmap_drawer(parent, tint, sx, sy, sw, sh, flags);
    al_use_transform(&backup);
+   _AL_PROFILE_END();
 }
 
 
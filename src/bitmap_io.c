@@ -16,6 +16,7 @@
 #include "allegro5/allegro.h"
 #include "allegro5/internal/aintern.h"
 #include "allegro5/internal/aintern_bitmap.h"
+#include "allegro5/internal/aintern_profile.h"
 #include "allegro5/internal/aintern_vector.h"
 
 #include <string.h>
@@ -233,7 +234,9 @@ ALLEGRO_BITMAP *al_load_bitmap_flags(const char *filename, int flags)
 
    h = find_handler(ext);
    if (h) {
+      _AL_PROFILE_BEGIN("al_load_bitmap");
       ret = h->loader(filename, flags);
+      _AL_PROFILE_END();
       if (!ret)
          ALLEGRO_WARN("Failed loading %s with %s handler.\n", filename,
             ext);
@@ -292,10 +295,15 @@ ALLEGRO_BITMAP *al_load_bitmap_flags_f(ALLEGRO_FILE *fp, const char *ident,
    int flags)
 {
    Handler *h = find_handler(ident);
-   if (h)
-      return h->fs_loader(fp, flags);
-   else
+   ALLEGRO_BITMAP *ret;
+
+   if (!h)
       return NULL;
+
+   _AL_PROFILE_BEGIN("al_load_bitmap_f");
+   ret = h->fs_loader(fp, flags);
+   _AL_PROFILE_END();
+   return ret;
 }
 
 
@@ -17,22 +17,47 @@
 #include "allegro5/allegro.h"
 #include "allegro5/internal/aintern.h"
 #include "allegro5/internal/aintern_bitmap.h"
+#include "allegro5/internal/aintern_display.h"
 
 
-/* Function: al_lock_bitmap_region
+/* Count a lock of a display bitmap and the transfer it implies in the
+ * statistics of its display.
  */
-ALLEGRO_LOCKED_REGION *al_lock_bitmap_region(ALLEGRO_BITMAP *bitmap,
-   int x, int y, int width, int height, int format, int flags)
+static void count_lock(ALLEGRO_BITMAP *bitmap, int width, int height,
+   int flags)
+{
+   ALLEGRO_DISPLAY_STATS *stats;
+
+   if ((bitmap->flags & ALLEGRO_MEMORY_BITMAP) || !bitmap->display)
+      return;
+
+   stats = &bitmap->display->stats;
+   stats->locks++;
+   if (!(flags & ALLEGRO_LOCK_WRITEONLY)) {
+      stats->readbacks++;
+      stats->readback_bytes += (int64_t)width * height *
+         al_get_pixel_size(bitmap->locked_region.format);
+   }
+}
+
+
+
+/* Records a lock of a region in the bitmap which owns the pixels, that is
+ * the parent of a sub-bitmap, moving x and y into its coordinates.  Returns
+ * that bitmap, or NULL if it is already locked.
+ */
+static ALLEGRO_BITMAP *begin_lock(ALLEGRO_BITMAP *bitmap,
+   int *x, int *y, int width, int height, int flags)
 {
-   ASSERT(x >= 0);
-   ASSERT(y >= 0);
+   ASSERT(*x >= 0);
+   ASSERT(*y >= 0);
    ASSERT(width >= 0);
    ASSERT(height >= 0);
 
    /* For sub-bitmaps */
    if (bitmap->parent) {
-      x += bitmap->xofs;
-      y += bitmap->yofs;
+      *x += bitmap->xofs;
+      *y += bitmap->yofs;
       bitmap = bitmap->parent;
    }
 
@@ -43,15 +68,29 @@ ALLEGRO_LOCKED_REGION *al_lock_bitmap_region(ALLEGRO_BITMAP *bitmap,
          !(flags & ALLEGRO_LOCK_READONLY))
       bitmap->dirty = true;
 
-   ASSERT(x+width <= bitmap->w);
-   ASSERT(y+height <= bitmap->h);
+   ASSERT(*x+width <= bitmap->w);
+   ASSERT(*y+height <= bitmap->h);
 
-   bitmap->lock_x = x;
-   bitmap->lock_y = y;
+   bitmap->lock_x = *x;
+   bitmap->lock_y = *y;
    bitmap->lock_w = width;
    bitmap->lock_h = height;
    bitmap->lock_flags = flags;
 
+   return bitmap;
+}
+
+
+
+/* Function: al_lock_bitmap_region
+ */
+ALLEGRO_LOCKED_REGION *al_lock_bitmap_region(ALLEGRO_BITMAP *bitmap,
+   int x, int y, int width, int height, int format, int flags)
+{
+   bitmap = begin_lock(bitmap, &x, &y, width, height, flags);
+   if (!bitmap)
+      return NULL;
+
    if (bitmap->flags & ALLEGRO_MEMORY_BITMAP) {
       int f = _al_get_real_pixel_format(al_get_current_display(), format);
       if (f < 0) {
@@ -82,6 +121,7 @@ ALLEGRO_LOCKED_REGION *al_lock_bitmap_region(ALLEGRO_BITMAP *bitmap,
       if (!bitmap->vt->lock_region(bitmap, x, y, width, height, format, flags)) {
          return NULL;
       }
+      count_lock(bitmap, width, height, flags);
    }
 
    bitmap->locked = true;
@@ -99,6 +139,95 @@ ALLEGRO_LOCKED_REGION *al_lock_bitmap(ALLEGRO_BITMAP *bitmap,
 }
 
 
+/* Function: al_lock_bitmap_region_async
+ */
+bool al_lock_bitmap_region_async(ALLEGRO_BITMAP *bitmap,
+   int x, int y, int width, int height, int format, int flags)
+{
+   ALLEGRO_BITMAP *parent;
+   const int bx = x;
+   const int by = y;
+
+   parent = begin_lock(bitmap, &x, &y, width, height, flags);
+   if (!parent)
+      return false;
+
+   /* Write-only locks have nothing to wait for, and memory bitmaps or
+    * drivers without asynchronous transfers simply lock right away.  The
+    * bitmap is not marked as locked yet, so this records the lock again.
+    */
+   if ((flags & ALLEGRO_LOCK_WRITEONLY) ||
+         (parent->flags & ALLEGRO_MEMORY_BITMAP) ||
+         !parent->vt->lock_region_async ||
+         !parent->vt->lock_region_async(parent, x, y, width, height, format,
+            flags)) {
+      return al_lock_bitmap_region(bitmap, bx, by, width, height, format,
+         flags) != NULL;
+   }
+
+   count_lock(parent, width, height, flags);
+   parent->locked = true;
+   parent->lock_pending = true;
+
+   return true;
+}
+
+
+/* Function: al_lock_bitmap_async
+ */
+bool al_lock_bitmap_async(ALLEGRO_BITMAP *bitmap, int format, int flags)
+{
+   return al_lock_bitmap_region_async(bitmap, 0, 0, bitmap->w, bitmap->h,
+      format, flags);
+}
+
+
+/* Function: al_is_bitmap_lock_ready
+ */
+bool al_is_bitmap_lock_ready(ALLEGRO_BITMAP *bitmap)
+{
+   /* For sub-bitmaps */
+   if (bitmap->parent) {
+      bitmap = bitmap->parent;
+   }
+
+   ASSERT(bitmap->locked);
+
+   if (!bitmap->lock_pending)
+      return true;
+
+   return bitmap->vt->is_lock_ready(bitmap);
+}
+
+
+/* Function: al_wait_for_bitmap_lock
+ */
+ALLEGRO_LOCKED_REGION *al_wait_for_bitmap_lock(ALLEGRO_BITMAP *bitmap)
+{
+   /* For sub-bitmaps */
+   if (bitmap->parent) {
+      bitmap = bitmap->parent;
+   }
+
+   if (!bitmap->locked)
+      return NULL;
+
+   if (bitmap->lock_pending) {
+      ALLEGRO_LOCKED_REGION *lr;
+
+      bitmap->lock_pending = false;
+      lr = bitmap->vt->finish_lock(bitmap);
+      if (!lr) {
+         /* Nothing is left to unlock on the driver side. */
+         bitmap->locked = false;
+      }
+      return lr;
+   }
+
+   return &bitmap->locked_region;
+}
+
+
 /* Function: al_unlock_bitmap
  */
 void al_unlock_bitmap(ALLEGRO_BITMAP *bitmap)
@@ -108,7 +237,21 @@ void al_unlock_bitmap(ALLEGRO_BITMAP *bitmap)
       bitmap = bitmap->parent;
    }
 
+   if (bitmap->lock_pending) {
+      if (!al_wait_for_bitmap_lock(bitmap))
+         return;
+   }
+
    if (!(bitmap->flags & ALLEGRO_MEMORY_BITMAP)) {
+      /* Count the upload in the format of the locked region, which the
+       * driver may not keep once unlocked.
+       */
+      if (!(bitmap->lock_flags & ALLEGRO_LOCK_READONLY) && bitmap->display) {
+         ALLEGRO_DISPLAY_STATS *stats = &bitmap->display->stats;
+         stats->texture_uploads++;
+         stats->upload_bytes += (int64_t)bitmap->lock_w * bitmap->lock_h *
+            al_get_pixel_size(bitmap->locked_region.format);
+      }
       bitmap->vt->unlock_region(bitmap);
    }
    else {
@@ -20,6 +20,7 @@
 #include "allegro5/internal/aintern_bitmap.h"
 #include "allegro5/internal/aintern_blend.h"
 #include "allegro5/internal/aintern_display.h"
+#include "allegro5/internal/aintern_tls.h"
 #include <string.h>
 
 void _al_blend_memory(ALLEGRO_COLOR *scol,
@@ -27,13 +28,12 @@ void _al_blend_memory(ALLEGRO_COLOR *scol,
    int dx, int dy, ALLEGRO_COLOR *result)
 {
    ALLEGRO_COLOR dcol;
-   int op, src_blend, dest_blend, alpha_op, alpha_src_blend, alpha_dest_blend;
+   const ALLEGRO_BLENDER *b = _al_tls_get_blender();
    dcol = al_get_pixel(dest, dx, dy);
-   al_get_separate_blender(&op, &src_blend, &dest_blend,
-                           &alpha_op, &alpha_src_blend, &alpha_dest_blend);
    _al_blend_inline(scol, &dcol,
-                    op, src_blend, dest_blend,
-                    alpha_op, alpha_src_blend, alpha_dest_blend,
+                    b->blend_op, b->blend_source, b->blend_dest,
+                    b->blend_alpha_op, b->blend_alpha_source,
+                    b->blend_alpha_dest,
                     result);
    (void) _al_blend_alpha_inline; // silence compiler
 }
@@ -28,6 +28,8 @@
 #include "allegro5/internal/aintern_system.h"
 #include "allegro5/internal/aintern_display.h"
 #include "allegro5/internal/aintern_bitmap.h"
+#include "allegro5/internal/aintern_headless.h"
+#include "allegro5/internal/aintern_profile.h"
 
 
 ALLEGRO_DEBUG_CHANNEL("display")
@@ -45,7 +47,10 @@ ALLEGRO_DISPLAY *al_create_display(int w, int h)
    int flags;
 
    system = al_get_system_driver();
-   driver = system->vt->get_display_driver();
+   if (al_get_new_display_flags() & ALLEGRO_HEADLESS)
+      driver = _al_display_headless_driver();
+   else
+      driver = system->vt->get_display_driver();
    display = driver->create_display(w, h);
 
    if (!display) {
@@ -159,6 +164,15 @@ ALLEGRO_BITMAP *al_get_backbuffer(ALLEGRO_DISPLAY *display)
 
 
 
+/* Start counting the statistics of a new frame. */
+static void end_frame_stats(ALLEGRO_DISPLAY *display)
+{
+   display->last_stats = display->stats;
+   memset(&display->stats, 0, sizeof(display->stats));
+}
+
+
+
 /* Function: al_flip_display
  */
 void al_flip_display(void)
@@ -167,12 +181,28 @@ void al_flip_display(void)
 
    if (display) {
       ASSERT(display->vt);
+      _AL_PROFILE_BEGIN("al_flip_display");
       display->vt->flip_display(display);
+      _AL_PROFILE_END();
+      end_frame_stats(display);
    }
 }
 
 
 
+/* Function: al_get_display_stats
+ */
+void al_get_display_stats(ALLEGRO_DISPLAY *display,
+   ALLEGRO_DISPLAY_STATS *stats)
+{
+   ASSERT(display);
+   ASSERT(stats);
+
+   *stats = display->last_stats;
+}
+
+
+
 /* Function: al_update_display_region
  */
 void al_update_display_region(int x, int y, int width, int height)
@@ -181,7 +211,10 @@ void al_update_display_region(int x, int y, int width, int height)
 
    if (display) {
       ASSERT(display->vt);
+      _AL_PROFILE_BEGIN("al_update_display_region");
       display->vt->update_display_region(display, x, y, width, height);
+      _AL_PROFILE_END();
+      end_frame_stats(display);
    }
 }
 
@@ -507,6 +540,8 @@ void al_hold_bitmap_drawing(bool hold)
       }
 
       if (!hold) {
+         if (current_display->num_cache_vertices > 0)
+            current_display->stats.batch_breaks_hold++;
          current_display->vt->flush_vertex_cache(current_display);
          /*
           * Reset the hardware transform to match the stored transform.
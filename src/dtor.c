@@ -27,9 +27,10 @@
 #include "allegro5/allegro.h"
 #include "allegro5/internal/aintern.h"
 #include "allegro5/internal/aintern_dtor.h"
+#include "allegro5/internal/aintern_list.h"
+#include "allegro5/internal/aintern_memory.h"
 #include "allegro5/internal/aintern_thread.h"
 #include "allegro5/internal/aintern_tls.h"
-#include "allegro5/internal/aintern_vector.h"
 
 /* XXX The dependency on tls.c is not nice but the DllMain stuff for Windows
  * does not it easy to make abstract away TLS API differences.
@@ -38,9 +39,12 @@
 ALLEGRO_DEBUG_CHANNEL("dtor")
 
 
+/* The list is doubly linked and each object keeps the list item returned
+ * by _al_register_destructor, so that unregistering does not need to search.
+ */
 struct _AL_DTOR_LIST {
    _AL_MUTEX mutex;
-   _AL_VECTOR dtors;
+   _AL_LIST *dtors;
 };
 
 
@@ -59,7 +63,7 @@ _AL_DTOR_LIST *_al_init_destructors(void)
 
    _AL_MARK_MUTEX_UNINITED(dtors->mutex);
    _al_mutex_init(&dtors->mutex);
-   _al_vector_init(&dtors->dtors, sizeof(DTOR));
+   dtors->dtors = _al_list_create();
 
    return dtors;
 }
@@ -106,8 +110,8 @@ void _al_run_destructors(_AL_DTOR_LIST *dtors)
    /* call the destructors in reverse order */
    _al_mutex_lock(&dtors->mutex);
    {
-      while (!_al_vector_is_empty(&dtors->dtors)) {
-         DTOR *dtor = _al_vector_ref_back(&dtors->dtors);
+      while (!_al_list_is_empty(dtors->dtors)) {
+         DTOR *dtor = _al_list_item_data(_al_list_back(dtors->dtors));
          void *object = dtor->object;
          void (*func)(void *) = dtor->func;
 
@@ -134,8 +138,8 @@ void _al_shutdown_destructors(_AL_DTOR_LIST *dtors)
    }
 
    /* free resources used by the destructor subsystem */
-   ASSERT(_al_vector_size(&dtors->dtors) == 0);
-   _al_vector_free(&dtors->dtors);
+   ASSERT(_al_list_size(dtors->dtors) == 0);
+   _al_list_destroy(dtors->dtors);
 
    _al_mutex_destroy(&dtors->mutex);
 
@@ -144,43 +148,62 @@ void _al_shutdown_destructors(_AL_DTOR_LIST *dtors)
 
 
 
+static void free_dtor(void *value, void *userdata)
+{
+   (void)userdata;
+   _al_pool_free(ALLEGRO_MEMORY_TAG_SYSTEM, value, sizeof(DTOR));
+}
+
+
+
 /* Internal function: _al_register_destructor
  *  Register OBJECT to be destroyed by FUNC during Allegro shutdown.
  *  This would be done in the object's constructor function.
  *
+ *  Returns the list item which must be passed to _al_unregister_destructor,
+ *  or NULL if the object was not registered.
+ *
  *  [thread-safe]
  */
-void _al_register_destructor(_AL_DTOR_LIST *dtors, void *object,
+_AL_LIST_ITEM *_al_register_destructor(_AL_DTOR_LIST *dtors, void *object,
    void (*func)(void*))
 {
    int *dtor_owner_count;
+   _AL_LIST_ITEM *ret = NULL;
    ASSERT(object);
    ASSERT(func);
 
    dtor_owner_count = _al_tls_get_dtor_owner_count();
    if (*dtor_owner_count > 0)
-      return;
+      return NULL;
 
    _al_mutex_lock(&dtors->mutex);
    {
 #ifdef DEBUGMODE
       /* make sure the object is not registered twice */
       {
-         unsigned int i;
+         _AL_LIST_ITEM *iter = _al_list_front(dtors->dtors);
 
-         for (i = 0; i < _al_vector_size(&dtors->dtors); i++) {
-            DTOR *dtor = _al_vector_ref(&dtors->dtors, i);
+         while (iter) {
+            DTOR *dtor = _al_list_item_data(iter);
             ASSERT(dtor->object != object);
+            iter = _al_list_next(dtors->dtors, iter);
          }
       }
 #endif /* DEBUGMODE */
 
       /* add the destructor to the list */
       {
-         DTOR *new_dtor = _al_vector_alloc_back(&dtors->dtors);
+         DTOR *new_dtor = _al_pool_malloc(ALLEGRO_MEMORY_TAG_SYSTEM,
+            sizeof(DTOR));
          if (new_dtor) {
             new_dtor->object = object;
             new_dtor->func = func;
+            ret = _al_list_push_back_ex(dtors->dtors, new_dtor, free_dtor);
+            if (!ret)
+               _al_pool_free(ALLEGRO_MEMORY_TAG_SYSTEM, new_dtor, sizeof(DTOR));
+         }
+         if (ret) {
             ALLEGRO_DEBUG("added dtor for object %p, func %p\n", object, func);
          }
          else {
@@ -189,36 +212,32 @@ void _al_register_destructor(_AL_DTOR_LIST *dtors, void *object,
       }
    }
    _al_mutex_unlock(&dtors->mutex);
+
+   return ret;
 }
 
 
 
 /* Internal function: _al_unregister_destructor
- *  Unregister a previously registered object.  This must be called
- *  in the normal object destroyer routine, e.g. al_destroy_timer.
+ *  Unregister a previously registered object, given the list item returned
+ *  by _al_register_destructor.  This must be called in the normal object
+ *  destroyer routine, e.g. al_destroy_timer.
  *
  *  [thread-safe]
  */
-void _al_unregister_destructor(_AL_DTOR_LIST *dtors, void *object)
+void _al_unregister_destructor(_AL_DTOR_LIST *dtors, _AL_LIST_ITEM *dtor_item)
 {
-   ASSERT(object);
+   /* The item may be NULL if the owner count was non-zero at the time the
+    * object was created.
+    */
+   if (!dtor_item)
+      return;
 
    _al_mutex_lock(&dtors->mutex);
    {
-      unsigned int i;
-
-      for (i = 0; i < _al_vector_size(&dtors->dtors); i++) {
-         DTOR *dtor = _al_vector_ref(&dtors->dtors, i);
-         if (dtor->object == object) {
-            _al_vector_delete_at(&dtors->dtors, i);
-            ALLEGRO_DEBUG("removed dtor for object %p\n", object);
-            break;
-         }
-      }
-
-      /* We cannot assert that the destructor was found because it might not
-       * have been registered if the owner count was non-zero at the time.
-       */
+      ALLEGRO_DEBUG("removed dtor for object %p\n",
+         ((DTOR *)_al_list_item_data(dtor_item))->object);
+      _al_list_erase(dtors->dtors, dtor_item);
    }
    _al_mutex_unlock(&dtors->mutex);
 }
@@ -235,11 +254,12 @@ void _al_foreach_destructor(_AL_DTOR_LIST *dtors,
 {
    _al_mutex_lock(&dtors->mutex);
    {
-      unsigned int i;
+      _AL_LIST_ITEM *iter = _al_list_front(dtors->dtors);
 
-      for (i = 0; i < _al_vector_size(&dtors->dtors); i++) {
-         DTOR *dtor = _al_vector_ref(&dtors->dtors, i);
+      while (iter) {
+         DTOR *dtor = _al_list_item_data(iter);
          callback(dtor->object, dtor->func, userdata);
+         iter = _al_list_next(dtors->dtors, iter);
       }
    }
    _al_mutex_unlock(&dtors->mutex);
@@ -28,6 +28,7 @@
 #include "allegro5/internal/aintern.h"
 #include "allegro5/internal/aintern_dtor.h"
 #include "allegro5/internal/aintern_events.h"
+#include "allegro5/internal/aintern_memory.h"
 #include "allegro5/internal/aintern_system.h"
 
 
@@ -41,6 +42,7 @@ struct ALLEGRO_EVENT_QUEUE
    bool paused;
    _AL_MUTEX mutex;
    _AL_COND cond;
+   _AL_LIST_ITEM *dtor_item;
 };
 
 
@@ -87,7 +89,8 @@ static void shutdown_events(void)
  */
 ALLEGRO_EVENT_QUEUE *al_create_event_queue(void)
 {
-   ALLEGRO_EVENT_QUEUE *queue = al_malloc(sizeof *queue);
+   ALLEGRO_EVENT_QUEUE *queue = _al_tagged_malloc(ALLEGRO_MEMORY_TAG_EVENTS,
+      sizeof *queue);
 
    ASSERT(queue);
 
@@ -104,7 +107,7 @@ ALLEGRO_EVENT_QUEUE *al_create_event_queue(void)
       _al_mutex_init(&queue->mutex);
       _al_cond_init(&queue->cond);
 
-      _al_register_destructor(_al_dtor_list, queue,
+      queue->dtor_item = _al_register_destructor(_al_dtor_list, queue,
          (void (*)(void *)) al_destroy_event_queue);
    }
 
@@ -119,7 +122,7 @@ void al_destroy_event_queue(ALLEGRO_EVENT_QUEUE *queue)
 {
    ASSERT(queue);
 
-   _al_unregister_destructor(_al_dtor_list, queue);
+   _al_unregister_destructor(_al_dtor_list, queue->dtor_item);
 
    /* Unregister any event sources registered with this queue.  */
    while (_al_vector_is_nonempty(&queue->sources)) {
@@ -136,7 +139,7 @@ void al_destroy_event_queue(ALLEGRO_EVENT_QUEUE *queue)
    _al_cond_destroy(&queue->cond);
    _al_mutex_destroy(&queue->mutex);
 
-   al_free(queue);
+   _al_tagged_free(ALLEGRO_MEMORY_TAG_EVENTS, queue, sizeof *queue);
 }
 
 
@@ -543,19 +546,34 @@ static void unref_if_user_event(ALLEGRO_EVENT *event)
  */
 void _al_event_queue_push_event(ALLEGRO_EVENT_QUEUE *queue,
    const ALLEGRO_EVENT *orig_event)
+{
+   _al_event_queue_push_events(queue, orig_event, 1);
+}
+
+
+
+/* Internal function: _al_event_queue_push_events
+ *  Like _al_event_queue_push_event, but adds NUM events at once, taking the
+ *  queue lock and waking up waiting threads only once.
+ */
+void _al_event_queue_push_events(ALLEGRO_EVENT_QUEUE *queue,
+   const ALLEGRO_EVENT *orig_events, unsigned int num)
 {
    ALLEGRO_EVENT *new_event;
+   unsigned int i;
    ASSERT(queue);
-   ASSERT(orig_event);
+   ASSERT(orig_events);
 
-   if (queue->paused)
+   if (queue->paused || num == 0)
       return;
 
    _al_mutex_lock(&queue->mutex);
    {
-      new_event = alloc_event(queue);
-      copy_event(new_event, orig_event);
-      ref_if_user_event(new_event);
+      for (i = 0; i < num; i++) {
+         new_event = alloc_event(queue);
+         copy_event(new_event, &orig_events[i]);
+         ref_if_user_event(new_event);
+      }
 
       /* Wake up threads that are waiting for an event to be placed in
        * the queue.
@@ -669,7 +687,7 @@ void al_unref_user_event(ALLEGRO_USER_EVENT *event)
 
       if (refcount == 0) {
          (descr->dtor)(event);
-         al_free(descr);
+         _al_pool_free(ALLEGRO_MEMORY_TAG_EVENTS, descr, sizeof(*descr));
       }
    }
 }
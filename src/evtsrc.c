@@ -23,6 +23,7 @@
 #include "allegro5/internal/aintern.h"
 #include "allegro5/internal/aintern_dtor.h"
 #include "allegro5/internal/aintern_events.h"
+#include "allegro5/internal/aintern_memory.h"
 #include "allegro5/internal/aintern_system.h"
 
 
@@ -168,22 +169,41 @@ bool _al_event_source_needs_to_generate_event(ALLEGRO_EVENT_SOURCE *es)
  *  [runs in background threads]
  */
 void _al_event_source_emit_event(ALLEGRO_EVENT_SOURCE *es, ALLEGRO_EVENT *event)
+{
+   _al_event_source_emit_events(es, event, 1);
+}
+
+
+
+/* Internal function: _al_event_source_emit_events
+ *  Like _al_event_source_emit_event, but for an array of NUM events which
+ *  are pushed to each queue in a single step.  Sources which produce
+ *  bursts of events should collect them and use this instead, so that each
+ *  queue is locked and signalled once per burst rather than once per event.
+ *
+ *  The event source must be _locked_ before calling this function.
+ *
+ *  [runs in background threads]
+ */
+void _al_event_source_emit_events(ALLEGRO_EVENT_SOURCE *es,
+   ALLEGRO_EVENT *events, unsigned int num)
 {
    ALLEGRO_EVENT_SOURCE_REAL *this = (ALLEGRO_EVENT_SOURCE_REAL *)es;
+   unsigned int i;
 
-   event->any.source = es;
+   for (i = 0; i < num; i++)
+      events[i].any.source = es;
 
-   /* Push the event to all the queues that this event source is
+   /* Push the events to all the queues that this event source is
     * registered to.
     */
    {
       size_t num_queues = _al_vector_size(&this->queues);
-      unsigned int i;
       ALLEGRO_EVENT_QUEUE **slot;
 
       for (i = 0; i < num_queues; i++) {
          slot = _al_vector_ref(&this->queues, i);
-         _al_event_queue_push_event(*slot, event);
+         _al_event_queue_push_events(*slot, events, num);
       }
    }
 }
@@ -225,7 +245,8 @@ bool al_emit_user_event(ALLEGRO_EVENT_SOURCE *src,
    ASSERT(ALLEGRO_EVENT_TYPE_IS_USER(event->any.type));
 
    if (dtor) {
-      ALLEGRO_USER_EVENT_DESCRIPTOR *descr = al_malloc(sizeof(*descr));
+      ALLEGRO_USER_EVENT_DESCRIPTOR *descr = _al_pool_malloc(
+         ALLEGRO_MEMORY_TAG_EVENTS, sizeof(*descr));
       descr->refcount = 0;
       descr->dtor = dtor;
       event->user.__internal__descr = descr;
@@ -252,7 +273,8 @@ bool al_emit_user_event(ALLEGRO_EVENT_SOURCE *src,
 
    if (dtor && !rc) {
       dtor(&event->user);
-      al_free(event->user.__internal__descr);
+      _al_pool_free(ALLEGRO_MEMORY_TAG_EVENTS, event->user.__internal__descr,
+         sizeof(ALLEGRO_USER_EVENT_DESCRIPTOR));
    }
 
    return rc;
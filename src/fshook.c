@@ -163,6 +163,27 @@ ALLEGRO_FS_ENTRY *al_read_directory(ALLEGRO_FS_ENTRY *e)
 }
 
 
+/* Function: al_read_directory_entries
+ */
+int al_read_directory_entries(ALLEGRO_FS_ENTRY *e, ALLEGRO_FS_ENTRY **entries,
+   int max)
+{
+   ALLEGRO_FS_ENTRY *next;
+   int n = 0;
+   ASSERT(e != NULL);
+   ASSERT(entries != NULL || max == 0);
+
+   while (n < max) {
+      next = e->vtable->fs_read_directory(e);
+      if (!next)
+         break;
+      entries[n++] = next;
+   }
+
+   return n;
+}
+
+
 /* Function: al_get_current_directory
  */
 char *al_get_current_directory(void)
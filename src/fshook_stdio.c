@@ -48,6 +48,8 @@ ALLEGRO_DEBUG_CHANNEL("fshook")
 
 #include "allegro5/internal/aintern_file.h"
 #include "allegro5/internal/aintern_fshook.h"
+#include "allegro5/internal/aintern_thread.h"
+#include "allegro5/internal/aintern_vector.h"
 
 #ifdef ALLEGRO_HAVE_SYS_STAT_H
    #include <sys/stat.h>
@@ -81,6 +83,11 @@ ALLEGRO_DEBUG_CHANNEL("fshook")
    #define S_IXGRP   (0)
 #endif
 
+#ifdef ALLEGRO_HAVE_SYS_INOTIFY_H
+   #include <sys/inotify.h>
+   #include <unistd.h>
+#endif
+
 #ifdef ALLEGRO_HAVE_SYS_TIME
    #include <sys/time.h>
 #endif
@@ -140,6 +147,8 @@ struct ALLEGRO_FS_ENTRY_STDIO
    uint32_t stat_mode;
    WRAP_STAT_TYPE st;
    WRAP_DIR_TYPE *dir;
+   struct FS_CACHE_LISTING *listing;   /* used instead of dir if cached */
+   int listing_pos;
 };
 
 
@@ -147,6 +156,672 @@ static void fs_update_stat_mode(ALLEGRO_FS_ENTRY_STDIO *fp_stdio);
 static bool fs_stdio_update_entry(ALLEGRO_FS_ENTRY *fp);
 
 
+/*
+ * Directory index cache.
+ *
+ * When enabled with al_set_standard_fs_cache, each directory that is
+ * listed or looked into is read once, together with the status of all of
+ * its entries, and kept in memory.  Directory listings, existence checks
+ * and entry status are then answered from the cache.
+ *
+ * Where inotify is available each cached directory is watched and the
+ * pending notifications are processed before lookups, at most once every
+ * few milliseconds so that a burst of lookups costs one read.  Elsewhere
+ * a directory is reread when its modification time changes.
+ */
+
+typedef struct FS_CACHE_ITEM {
+   WRAP_CHAR *name;
+   WRAP_STAT_TYPE st;
+} FS_CACHE_ITEM;
+
+/* A snapshot of a directory.  Open directory entries hold a reference so
+ * that reading stays consistent if the directory is reread meanwhile.
+ */
+typedef struct FS_CACHE_LISTING {
+   int refcount;
+   int count;
+   FS_CACHE_ITEM *items;   /* sorted by name */
+} FS_CACHE_LISTING;
+
+typedef struct FS_CACHE_DIR FS_CACHE_DIR;
+
+struct FS_CACHE_DIR {
+   FS_CACHE_DIR *next;     /* next in hash chain */
+   unsigned int hash;
+   WRAP_CHAR *path;
+   FS_CACHE_LISTING *listing; /* NULL if it must be reread */
+   time_t mtime;
+   int wd;                 /* inotify watch, or -1 */
+   FS_CACHE_DIR *next_alias; /* next directory sharing the watch */
+};
+
+static struct {
+   bool enabled;
+   bool mutex_inited;
+   _AL_MUTEX mutex;
+   FS_CACHE_DIR **buckets;
+   unsigned int num_buckets;
+   unsigned int num_dirs;
+   int inotify_fd;
+   _AL_VECTOR watched;     /* FS_CACHE_DIR * indexed by watch descriptor,
+                            * the first of a list linked by next_alias
+                            */
+   double notify_time;     /* when notifications were last processed */
+} fs_cache = {
+   false, false, _AL_MUTEX_UNINITED, NULL, 0, 0, -1,
+   _AL_VECTOR_INITIALIZER(FS_CACHE_DIR *), 0.0
+};
+
+
+static unsigned int cache_hash(const WRAP_CHAR *path, size_t len)
+{
+   /* FNV-1a */
+   unsigned int h = 2166136261u;
+   size_t i;
+
+   for (i = 0; i < len; i++) {
+      h ^= (unsigned int)path[i];
+      h *= 16777619u;
+   }
+   return h;
+}
+
+
+static bool is_path_sep(WRAP_CHAR c)
+{
+#ifdef ALLEGRO_WINDOWS
+   return c == '\\' || c == '/';
+#else
+   return c == ALLEGRO_NATIVE_PATH_SEP;
+#endif
+}
+
+
+/* Length of path[0..len) without trailing separators. */
+static size_t trim_path_len(const WRAP_CHAR *path, size_t len)
+{
+   while (len > 1 && is_path_sep(path[len - 1]))
+      len--;
+   return len;
+}
+
+
+/* Length of the parent directory part of path[0..len), or 0 if none. */
+static size_t parent_path_len(const WRAP_CHAR *path, size_t len)
+{
+   while (len > 0 && !is_path_sep(path[len - 1]))
+      len--;
+   if (len == 0)
+      return 0;
+   /* Keep the separator if the parent is the root directory. */
+   if (len > 1 && path[len - 2] != ':')
+      len--;
+   return len;
+}
+
+
+/* Make a path from a directory and the name of an entry in it.
+ * The result must be freed with al_free().
+ */
+static WRAP_CHAR *join_path(const WRAP_CHAR *dir, const WRAP_CHAR *name)
+{
+   size_t dir_len = WRAP_STRLEN(dir);
+   size_t name_len = WRAP_STRLEN(name);
+   WRAP_CHAR *buf;
+
+   buf = al_malloc((dir_len + 1 + name_len + 1) * sizeof(WRAP_CHAR));
+   if (!buf) {
+      al_set_errno(ENOMEM);
+      return NULL;
+   }
+   memcpy(buf, dir, dir_len * sizeof(WRAP_CHAR));
+   buf[dir_len] = ALLEGRO_NATIVE_PATH_SEP;
+   memcpy(buf + dir_len + 1, name, (name_len + 1) * sizeof(WRAP_CHAR));
+   return buf;
+}
+
+
+static int compare_cache_items(const void *a, const void *b)
+{
+   const FS_CACHE_ITEM *ia = a;
+   const FS_CACHE_ITEM *ib = b;
+   return WRAP_STRCMP(ia->name, ib->name);
+}
+
+
+static void release_listing(FS_CACHE_LISTING *listing)
+{
+   int i;
+
+   if (!listing || --listing->refcount > 0)
+      return;
+
+   for (i = 0; i < listing->count; i++)
+      al_free(listing->items[i].name);
+   al_free(listing->items);
+   al_free(listing);
+}
+
+
+/* Read a directory and the status of all its entries. */
+static FS_CACHE_LISTING *scan_directory(const WRAP_CHAR *path)
+{
+   FS_CACHE_LISTING *listing;
+   WRAP_DIR_TYPE *dir;
+   WRAP_DIRENT_TYPE *ent;
+   int max = 0;
+
+   dir = WRAP_OPENDIR(path);
+   if (!dir)
+      return NULL;
+
+   listing = al_calloc(1, sizeof(*listing));
+   if (!listing) {
+      WRAP_CLOSEDIR(dir);
+      return NULL;
+   }
+   listing->refcount = 1;
+
+   while ((ent = WRAP_READDIR(dir))) {
+      FS_CACHE_ITEM *item;
+      WRAP_CHAR *full;
+
+      if (0 == WRAP_STRCMP(ent->d_name, WRAP_LIT("."))
+            || 0 == WRAP_STRCMP(ent->d_name, WRAP_LIT("..")))
+         continue;
+
+      if (listing->count == max) {
+         FS_CACHE_ITEM *items;
+         max = _ALLEGRO_MAX(16, max * 2);
+         items = al_realloc(listing->items, max * sizeof(*items));
+         if (!items)
+            goto Error;
+         listing->items = items;
+      }
+
+      item = &listing->items[listing->count];
+      full = join_path(path, ent->d_name);
+      if (!full)
+         goto Error;
+      /* The entry may have disappeared since readdir. */
+      if (WRAP_STAT(full, &item->st) != 0) {
+         al_free(full);
+         continue;
+      }
+      al_free(full);
+
+      item->name = al_malloc((WRAP_STRLEN(ent->d_name) + 1) * sizeof(WRAP_CHAR));
+      if (!item->name)
+         goto Error;
+      memcpy(item->name, ent->d_name,
+         (WRAP_STRLEN(ent->d_name) + 1) * sizeof(WRAP_CHAR));
+      listing->count++;
+   }
+
+   WRAP_CLOSEDIR(dir);
+   if (listing->count > 1) {
+      qsort(listing->items, listing->count, sizeof(FS_CACHE_ITEM),
+         compare_cache_items);
+   }
+   return listing;
+
+Error:
+
+   WRAP_CLOSEDIR(dir);
+   release_listing(listing);
+   return NULL;
+}
+
+
+static void invalidate_dir(FS_CACHE_DIR *cdir)
+{
+   release_listing(cdir->listing);
+   cdir->listing = NULL;
+}
+
+
+static void invalidate_all_dirs(void)
+{
+   unsigned int i;
+   FS_CACHE_DIR *cdir;
+
+   for (i = 0; i < fs_cache.num_buckets; i++) {
+      for (cdir = fs_cache.buckets[i]; cdir; cdir = cdir->next)
+         invalidate_dir(cdir);
+   }
+}
+
+
+#ifdef ALLEGRO_HAVE_SYS_INOTIFY_H
+
+#define CACHE_WATCH_MASK   (IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | \
+   IN_DELETE | IN_DELETE_SELF | IN_MODIFY | IN_MOVE_SELF | IN_MOVED_FROM | \
+   IN_MOVED_TO)
+
+/* Minimum time between reads of the inotify descriptor, in seconds. */
+#define CACHE_NOTIFY_INTERVAL 0.002
+
+
+static void watch_dir(FS_CACHE_DIR *cdir)
+{
+   FS_CACHE_DIR **slot;
+
+   if (fs_cache.inotify_fd == -1) {
+      fs_cache.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+      if (fs_cache.inotify_fd == -1) {
+         ALLEGRO_WARN("inotify_init1 failed, using modification times.\n");
+         fs_cache.inotify_fd = -2;
+      }
+   }
+   if (fs_cache.inotify_fd < 0)
+      return;
+
+   cdir->wd = inotify_add_watch(fs_cache.inotify_fd, cdir->path,
+      CACHE_WATCH_MASK);
+   if (cdir->wd < 0)
+      return;
+
+   /* A new slot means nobody else has this watch yet. */
+   while (_al_vector_size(&fs_cache.watched) <= (unsigned int)cdir->wd) {
+      slot = _al_vector_alloc_back(&fs_cache.watched);
+      if (!slot) {
+         inotify_rm_watch(fs_cache.inotify_fd, cdir->wd);
+         cdir->wd = -1;
+         return;
+      }
+      *slot = NULL;
+   }
+
+   /* Paths to the same directory, e.g. through a symbolic link, get the
+    * same watch descriptor, so they share the slot.
+    */
+   slot = _al_vector_ref(&fs_cache.watched, cdir->wd);
+   cdir->next_alias = *slot;
+   *slot = cdir;
+}
+
+
+/* Stop watching a directory, removing the watch with its last user. */
+static void unwatch_dir(FS_CACHE_DIR *cdir)
+{
+   FS_CACHE_DIR **slot;
+
+   if (cdir->wd < 0)
+      return;
+
+   slot = _al_vector_ref(&fs_cache.watched, cdir->wd);
+   while (*slot != cdir)
+      slot = &(*slot)->next_alias;
+   *slot = cdir->next_alias;
+   cdir->next_alias = NULL;
+
+   if (!*(FS_CACHE_DIR **)_al_vector_ref(&fs_cache.watched, cdir->wd))
+      inotify_rm_watch(fs_cache.inotify_fd, cdir->wd);
+   cdir->wd = -1;
+}
+
+
+/* Drop the listings of all directories which have changed. */
+static void process_notifications(void)
+{
+   char buf[4096]
+      __attribute__ ((aligned(__alignof__(struct inotify_event))));
+   const struct inotify_event *event;
+   ssize_t len;
+   char *ptr;
+   double now;
+
+   if (fs_cache.inotify_fd < 0)
+      return;
+
+   now = al_get_time();
+   if (now - fs_cache.notify_time < CACHE_NOTIFY_INTERVAL)
+      return;
+   fs_cache.notify_time = now;
+
+   while ((len = read(fs_cache.inotify_fd, buf, sizeof(buf))) > 0) {
+      for (ptr = buf; ptr < buf + len;
+            ptr += sizeof(struct inotify_event) + event->len) {
+         FS_CACHE_DIR *cdir = NULL;
+
+         event = (const struct inotify_event *)ptr;
+
+         if (event->mask & IN_Q_OVERFLOW) {
+            invalidate_all_dirs();
+            continue;
+         }
+
+         if (event->wd >= 0 &&
+               (unsigned int)event->wd < _al_vector_size(&fs_cache.watched)) {
+            cdir = *(FS_CACHE_DIR **)_al_vector_ref(&fs_cache.watched,
+               event->wd);
+         }
+         if (!cdir)
+            continue;
+
+         if (event->mask & IN_IGNORED) {
+            /* The watch is gone; new ones are added when reread. */
+            FS_CACHE_DIR **slot = _al_vector_ref(&fs_cache.watched, event->wd);
+            *slot = NULL;
+         }
+         while (cdir) {
+            FS_CACHE_DIR *next = cdir->next_alias;
+            invalidate_dir(cdir);
+            if (event->mask & IN_IGNORED) {
+               cdir->wd = -1;
+               cdir->next_alias = NULL;
+            }
+            cdir = next;
+         }
+      }
+   }
+}
+
+#else
+
+static void watch_dir(FS_CACHE_DIR *cdir)
+{
+   cdir->wd = -1;
+}
+
+
+static void unwatch_dir(FS_CACHE_DIR *cdir)
+{
+   (void)cdir;
+}
+
+
+static void process_notifications(void)
+{
+}
+
+#endif /* ALLEGRO_HAVE_SYS_INOTIFY_H */
+
+
+static void free_cache(void)
+{
+   unsigned int i;
+
+   for (i = 0; i < fs_cache.num_buckets; i++) {
+      FS_CACHE_DIR *cdir = fs_cache.buckets[i];
+      while (cdir) {
+         FS_CACHE_DIR *next = cdir->next;
+         unwatch_dir(cdir);
+         release_listing(cdir->listing);
+         al_free(cdir->path);
+         al_free(cdir);
+         cdir = next;
+      }
+   }
+   al_free(fs_cache.buckets);
+   fs_cache.buckets = NULL;
+   fs_cache.num_buckets = 0;
+   fs_cache.num_dirs = 0;
+   _al_vector_free(&fs_cache.watched);
+
+#ifdef ALLEGRO_HAVE_SYS_INOTIFY_H
+   if (fs_cache.inotify_fd >= 0)
+      close(fs_cache.inotify_fd);
+#endif
+   fs_cache.inotify_fd = -1;
+}
+
+
+static void grow_buckets(void)
+{
+   unsigned int num_buckets = _ALLEGRO_MAX(64, fs_cache.num_buckets * 2);
+   FS_CACHE_DIR **buckets;
+   unsigned int i;
+
+   buckets = al_calloc(num_buckets, sizeof(*buckets));
+   if (!buckets)
+      return;
+
+   for (i = 0; i < fs_cache.num_buckets; i++) {
+      FS_CACHE_DIR *cdir = fs_cache.buckets[i];
+      while (cdir) {
+         FS_CACHE_DIR *next = cdir->next;
+         unsigned int b = cdir->hash & (num_buckets - 1);
+         cdir->next = buckets[b];
+         buckets[b] = cdir;
+         cdir = next;
+      }
+   }
+
+   al_free(fs_cache.buckets);
+   fs_cache.buckets = buckets;
+   fs_cache.num_buckets = num_buckets;
+}
+
+
+static FS_CACHE_DIR *find_dir(const WRAP_CHAR *path, size_t len,
+   unsigned int hash)
+{
+   FS_CACHE_DIR *cdir;
+
+   if (fs_cache.num_buckets == 0)
+      return NULL;
+
+   for (cdir = fs_cache.buckets[hash & (fs_cache.num_buckets - 1)];
+         cdir; cdir = cdir->next) {
+      if (cdir->hash == hash
+            && 0 == memcmp(cdir->path, path, len * sizeof(WRAP_CHAR))
+            && cdir->path[len] == '\0')
+         return cdir;
+   }
+   return NULL;
+}
+
+
+/* Return the up-to-date listing of the directory path[0..len), reading it
+ * if necessary.  The cache must be locked.
+ */
+static FS_CACHE_LISTING *get_listing(const WRAP_CHAR *path, size_t len)
+{
+   unsigned int hash = cache_hash(path, len);
+   FS_CACHE_DIR *cdir;
+
+   process_notifications();
+
+   cdir = find_dir(path, len, hash);
+   if (!cdir) {
+      unsigned int b;
+
+      if (fs_cache.num_dirs >= fs_cache.num_buckets)
+         grow_buckets();
+      if (fs_cache.num_buckets == 0)
+         return NULL;
+
+      cdir = al_calloc(1, sizeof(*cdir));
+      if (!cdir)
+         return NULL;
+      cdir->path = al_malloc((len + 1) * sizeof(WRAP_CHAR));
+      if (!cdir->path) {
+         al_free(cdir);
+         return NULL;
+      }
+      memcpy(cdir->path, path, len * sizeof(WRAP_CHAR));
+      cdir->path[len] = '\0';
+      cdir->hash = hash;
+      cdir->wd = -1;
+
+      b = hash & (fs_cache.num_buckets - 1);
+      cdir->next = fs_cache.buckets[b];
+      fs_cache.buckets[b] = cdir;
+      fs_cache.num_dirs++;
+   }
+
+   if (cdir->wd < 0) {
+      /* Without a watch, fall back to comparing modification times. */
+      WRAP_STAT_TYPE st;
+
+      if (WRAP_STAT(cdir->path, &st) != 0) {
+         invalidate_dir(cdir);
+         return NULL;
+      }
+      if (cdir->listing && st.st_mtime != cdir->mtime)
+         invalidate_dir(cdir);
+      cdir->mtime = st.st_mtime;
+
+      if (!cdir->listing)
+         watch_dir(cdir);
+   }
+
+   if (!cdir->listing)
+      cdir->listing = scan_directory(cdir->path);
+
+   return cdir->listing;
+}
+
+
+/* Look up the status of an absolute path in the cache.
+ * Returns 1 if found, 0 if it does not exist and -1 if the cache cannot
+ * answer (disabled, or the parent directory could not be read).
+ */
+static int cache_stat(const WRAP_CHAR *abs_path, WRAP_STAT_TYPE *st)
+{
+   FS_CACHE_LISTING *listing;
+   FS_CACHE_ITEM key;
+   FS_CACHE_ITEM *item;
+   WRAP_CHAR name[256];
+   size_t len;
+   size_t dir_len;
+   size_t name_start;
+   size_t name_len;
+   int ret = -1;
+
+   if (!fs_cache.enabled)
+      return -1;
+
+   len = trim_path_len(abs_path, WRAP_STRLEN(abs_path));
+   for (name_start = len; name_start > 0
+         && !is_path_sep(abs_path[name_start - 1]); name_start--)
+      ;
+   dir_len = parent_path_len(abs_path, len);
+   name_len = len - name_start;
+   if (dir_len == 0 || name_len == 0
+         || name_len >= sizeof(name) / sizeof(name[0]))
+      return -1;
+
+   memcpy(name, abs_path + name_start, name_len * sizeof(WRAP_CHAR));
+   name[name_len] = '\0';
+   key.name = name;
+
+   _al_mutex_lock(&fs_cache.mutex);
+   if (fs_cache.enabled) {
+      listing = get_listing(abs_path, dir_len);
+      if (listing) {
+         item = bsearch(&key, listing->items, listing->count,
+            sizeof(FS_CACHE_ITEM), compare_cache_items);
+         if (item) {
+            *st = item->st;
+            ret = 1;
+         }
+         else {
+            ret = 0;
+         }
+      }
+   }
+   _al_mutex_unlock(&fs_cache.mutex);
+
+   return ret;
+}
+
+
+/* Acquire a reference to the listing of a directory, or NULL. */
+static FS_CACHE_LISTING *cache_open_listing(const WRAP_CHAR *abs_path)
+{
+   FS_CACHE_LISTING *listing = NULL;
+   size_t len;
+
+   if (!fs_cache.enabled)
+      return NULL;
+
+   len = trim_path_len(abs_path, WRAP_STRLEN(abs_path));
+
+   _al_mutex_lock(&fs_cache.mutex);
+   if (fs_cache.enabled) {
+      listing = get_listing(abs_path, len);
+      if (listing)
+         listing->refcount++;
+   }
+   _al_mutex_unlock(&fs_cache.mutex);
+
+   return listing;
+}
+
+
+static void cache_close_listing(FS_CACHE_LISTING *listing)
+{
+   _al_mutex_lock(&fs_cache.mutex);
+   release_listing(listing);
+   _al_mutex_unlock(&fs_cache.mutex);
+}
+
+
+/* Forget the directory containing abs_path, after we changed it. */
+static void cache_invalidate_parent(const WRAP_CHAR *abs_path)
+{
+   FS_CACHE_DIR *cdir;
+   size_t len;
+
+   if (!fs_cache.enabled)
+      return;
+
+   len = trim_path_len(abs_path, WRAP_STRLEN(abs_path));
+   len = parent_path_len(abs_path, len);
+   if (len == 0)
+      return;
+
+   _al_mutex_lock(&fs_cache.mutex);
+   cdir = find_dir(abs_path, len, cache_hash(abs_path, len));
+   if (cdir)
+      invalidate_dir(cdir);
+   _al_mutex_unlock(&fs_cache.mutex);
+}
+
+
+static void shutdown_fs_cache(void)
+{
+   al_set_standard_fs_cache(false);
+}
+
+
+/* Function: al_set_standard_fs_cache
+ */
+void al_set_standard_fs_cache(bool enable)
+{
+   if (!fs_cache.mutex_inited) {
+      _al_mutex_init(&fs_cache.mutex);
+      fs_cache.mutex_inited = true;
+   }
+
+   _al_mutex_lock(&fs_cache.mutex);
+   if (enable && !fs_cache.enabled) {
+      _al_add_exit_func(shutdown_fs_cache, "shutdown_fs_cache");
+   }
+   else if (!enable && fs_cache.enabled) {
+      free_cache();
+   }
+   fs_cache.enabled = enable;
+   _al_mutex_unlock(&fs_cache.mutex);
+}
+
+
+/* Function: al_clear_standard_fs_cache
+ */
+void al_clear_standard_fs_cache(void)
+{
+   if (!fs_cache.mutex_inited)
+      return;
+
+   _al_mutex_lock(&fs_cache.mutex);
+   invalidate_all_dirs();
+   _al_mutex_unlock(&fs_cache.mutex);
+}
+
+
 /* Make an absolute path given a potentially relative path.
  * The result must be freed with free(), NOT al_free().
  */
@@ -223,7 +898,9 @@ static WRAP_CHAR *make_absolute_path(const char *tail)
 }
 
 
-static ALLEGRO_FS_ENTRY *create_abs_path_entry(const WRAP_CHAR *abs_path)
+/* If st is not NULL it is used instead of querying the status. */
+static ALLEGRO_FS_ENTRY *create_abs_path_entry(const WRAP_CHAR *abs_path,
+   const WRAP_STAT_TYPE *st)
 {
    ALLEGRO_FS_ENTRY_STDIO *fh;
    size_t len;
@@ -255,7 +932,13 @@ static ALLEGRO_FS_ENTRY *create_abs_path_entry(const WRAP_CHAR *abs_path)
 
    ALLEGRO_DEBUG("Creating entry for %s\n", fh->ABS_PATH_UTF8);
 
-   fs_stdio_update_entry((ALLEGRO_FS_ENTRY *) fh);
+   if (st) {
+      fh->st = *st;
+      fs_update_stat_mode(fh);
+   }
+   else {
+      fs_stdio_update_entry((ALLEGRO_FS_ENTRY *) fh);
+   }
 
    return (ALLEGRO_FS_ENTRY *) fh;
 }
@@ -268,7 +951,7 @@ static ALLEGRO_FS_ENTRY *fs_stdio_create_entry(const char *orig_path)
 
    abs_path = make_absolute_path(orig_path);
    if (abs_path) {
-      ret = create_abs_path_entry(abs_path);
+      ret = create_abs_path_entry(abs_path, NULL);
       free(abs_path);
    }
    return ret;
@@ -344,6 +1027,16 @@ static bool fs_stdio_update_entry(ALLEGRO_FS_ENTRY *fp)
    ALLEGRO_FS_ENTRY_STDIO *fp_stdio = (ALLEGRO_FS_ENTRY_STDIO *) fp;
    int ret;
 
+   ret = cache_stat(fp_stdio->abs_path, &(fp_stdio->st));
+   if (ret == 0) {
+      al_set_errno(ENOENT);
+      return false;
+   }
+   if (ret == 1) {
+      fs_update_stat_mode(fp_stdio);
+      return true;
+   }
+
    ret = WRAP_STAT(fp_stdio->abs_path, &(fp_stdio->st));
    if (ret == -1) {
       al_set_errno(errno);
@@ -363,6 +1056,12 @@ static bool fs_stdio_open_directory(ALLEGRO_FS_ENTRY *fp)
    if (!(fp_stdio->stat_mode & ALLEGRO_FILEMODE_ISDIR))
       return false;
 
+   fp_stdio->listing = cache_open_listing(fp_stdio->abs_path);
+   if (fp_stdio->listing) {
+      fp_stdio->listing_pos = 0;
+      return true;
+   }
+
    fp_stdio->dir = WRAP_OPENDIR(fp_stdio->abs_path);
    if (!fp_stdio->dir) {
       al_set_errno(errno);
@@ -378,6 +1077,12 @@ static bool fs_stdio_close_directory(ALLEGRO_FS_ENTRY *fp)
    ALLEGRO_FS_ENTRY_STDIO *fp_stdio = (ALLEGRO_FS_ENTRY_STDIO *) fp;
    int rc;
 
+   if (fp_stdio->listing) {
+      cache_close_listing(fp_stdio->listing);
+      fp_stdio->listing = NULL;
+      return true;
+   }
+
    if (!fp_stdio->dir) {
       al_set_errno(ENOTDIR);
       return false;
@@ -402,6 +1107,22 @@ static ALLEGRO_FS_ENTRY *fs_stdio_read_directory(ALLEGRO_FS_ENTRY *fp)
    WRAP_DIRENT_TYPE *ent;
    ALLEGRO_FS_ENTRY *ret;
 
+   if (fp_stdio->listing) {
+      FS_CACHE_LISTING *listing = fp_stdio->listing;
+      FS_CACHE_ITEM *item;
+      WRAP_CHAR *buf;
+
+      if (fp_stdio->listing_pos >= listing->count)
+         return NULL;
+      item = &listing->items[fp_stdio->listing_pos++];
+      buf = join_path(fp_stdio->abs_path, item->name);
+      if (!buf)
+         return NULL;
+      ret = create_abs_path_entry(buf, &item->st);
+      al_free(buf);
+      return ret;
+   }
+
    ASSERT(fp_stdio->dir);
 
    do {
@@ -425,7 +1146,7 @@ static ALLEGRO_FS_ENTRY *fs_stdio_read_directory(ALLEGRO_FS_ENTRY *fp)
          al_set_errno(ERANGE);
          return NULL;
       }
-      ret = create_abs_path_entry(buf);
+      ret = create_abs_path_entry(buf, NULL);
    }
 #else
    {
@@ -440,7 +1161,7 @@ static ALLEGRO_FS_ENTRY *fs_stdio_read_directory(ALLEGRO_FS_ENTRY *fp)
       buf[abs_path_len] = ALLEGRO_NATIVE_PATH_SEP;
       memcpy(buf + abs_path_len + 1, ent->d_name, ent_name_len);
       buf[abs_path_len + 1 + ent_name_len] = '\0';
-      ret = create_abs_path_entry(buf);
+      ret = create_abs_path_entry(buf, NULL);
       al_free(buf);
    }
 #endif
@@ -457,7 +1178,7 @@ static void fs_stdio_destroy_entry(ALLEGRO_FS_ENTRY *fh_)
    al_free(fh->abs_path_utf8);
 #endif
 
-   if (fh->dir)
+   if (fh->dir || fh->listing)
       fs_stdio_close_directory(fh_);
 
    al_free(fh);
@@ -568,7 +1289,11 @@ static bool mkdir_exists(const WRAP_CHAR *path)
       return S_ISDIR(st.st_mode);
    }
 
-   return WRAP_MKDIR(path) == 0;
+   if (WRAP_MKDIR(path) != 0)
+      return false;
+
+   cache_invalidate_parent(path);
+   return true;
 }
 
 
@@ -621,6 +1346,11 @@ static bool fs_stdio_entry_exists(ALLEGRO_FS_ENTRY *fp)
 {
    ALLEGRO_FS_ENTRY_STDIO *fp_stdio = (ALLEGRO_FS_ENTRY_STDIO *) fp;
    WRAP_STAT_TYPE st;
+   int ret;
+
+   ret = cache_stat(fp_stdio->abs_path, &st);
+   if (ret >= 0)
+      return ret == 1;
 
    if (WRAP_STAT(fp_stdio->abs_path, &st) != 0) {
       if (errno != ENOENT) {
@@ -639,6 +1369,16 @@ static bool fs_stdio_filename_exists(const char *path)
    bool ret = false;
    ASSERT(path);
 
+   if (fs_cache.enabled) {
+      WRAP_CHAR *abs_path = make_absolute_path(path);
+      if (abs_path) {
+         int found = cache_stat(abs_path, &st);
+         free(abs_path);
+         if (found >= 0)
+            return found == 1;
+      }
+   }
+
 #ifdef ALLEGRO_WINDOWS
    {
       /* Pass an path created by _wfullpath() to avoid issues
@@ -682,6 +1422,8 @@ static bool fs_stdio_remove_entry(ALLEGRO_FS_ENTRY *fp)
       return false;
    }
 
+   cache_invalidate_parent(fp_stdio->abs_path);
+
    if (err != 0) {
       al_set_errno(errno);
       return false;
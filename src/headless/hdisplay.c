@@ -0,0 +1,427 @@
+/*         ______   ___    ___
+ *        /\  _  \ /\_ \  /\_ \
+ *        \ \ \L\ \\//\ \ \//\ \      __     __   _ __   ___
+ *         \ \  __ \ \ \ \  \ \ \   /'__`\ /'_ `\/\`'__\/ __`\
+ *          \ \ \/\ \ \_\ \_ \_\ \_/\  __//\ \L\ \ \ \//\ \L\ \
+ *           \ \_\ \_\/\____\/\____\ \____\ \____ \ \_\\ \____/
+ *            \/_/\/_/\/____/\/____/\/____/\/___L\ \/_/ \/___/
+ *                                           /\____/
+ *                                           \_/__/
+ *
+ *      Headless display driver.  The backbuffer is a memory bitmap and
+ *      all drawing goes through the software routines, so no window
+ *      system or GPU is required.
+ *
+ *      See readme.txt for copyright information.
+ */
+
+
+#include "allegro5/allegro.h"
+#include "allegro5/internal/aintern.h"
+#include "allegro5/internal/aintern_bitmap.h"
+#include "allegro5/internal/aintern_display.h"
+#include "allegro5/internal/aintern_dtor.h"
+#include "allegro5/internal/aintern_headless.h"
+#include "allegro5/internal/aintern_system.h"
+#include "allegro5/internal/aintern_vector.h"
+
+ALLEGRO_DEBUG_CHANNEL("headless")
+
+static ALLEGRO_DISPLAY_INTERFACE *vt;
+
+/* Headless displays are kept apart from the system driver's list of
+ * displays, which the window system drivers expect to hold only their own.
+ */
+static _AL_VECTOR headless_displays =
+   _AL_VECTOR_INITIALIZER(ALLEGRO_DISPLAY *);
+
+
+
+static void shutdown_headless_displays(void)
+{
+   while (_al_vector_size(&headless_displays) > 0) {
+      ALLEGRO_DISPLAY **dptr = _al_vector_ref_back(&headless_displays);
+      al_destroy_display(*dptr);
+   }
+   _al_vector_free(&headless_displays);
+}
+
+
+
+static ALLEGRO_BITMAP *create_backbuffer(ALLEGRO_DISPLAY *d, int w, int h)
+{
+   ALLEGRO_STATE state;
+   ALLEGRO_BITMAP *backbuffer;
+
+   al_store_state(&state, ALLEGRO_STATE_NEW_BITMAP_PARAMETERS);
+   al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+   al_set_new_bitmap_format(d->backbuffer_format);
+
+   /* The backbuffer belongs to the display. */
+   _al_push_destructor_owner();
+   backbuffer = al_create_bitmap(w, h);
+   _al_pop_destructor_owner();
+
+   al_restore_state(&state);
+
+   /* Unlike other memory bitmaps the backbuffer remembers its display, so
+    * that targeting it makes the display current.
+    */
+   if (backbuffer)
+      backbuffer->display = d;
+   return backbuffer;
+}
+
+
+
+static ALLEGRO_DISPLAY *headless_create_display(int w, int h)
+{
+   ALLEGRO_DISPLAY_HEADLESS *hd;
+   ALLEGRO_DISPLAY *d;
+   ALLEGRO_DISPLAY **add;
+   ALLEGRO_EXTRA_DISPLAY_SETTINGS *eds;
+
+   if (w <= 0 || h <= 0) {
+      ALLEGRO_ERROR("Invalid display size %dx%d.\n", w, h);
+      return NULL;
+   }
+
+   hd = al_calloc(1, sizeof *hd);
+   if (!hd)
+      return NULL;
+   d = (ALLEGRO_DISPLAY *)hd;
+
+   d->vt = _al_display_headless_driver();
+   d->w = w;
+   d->h = h;
+   d->flags = al_get_new_display_flags() | ALLEGRO_HEADLESS;
+   d->flags &= ~(ALLEGRO_OPENGL | ALLEGRO_DIRECT3D_INTERNAL |
+      ALLEGRO_OPENGL_3_0 | ALLEGRO_OPENGL_FORWARD_COMPATIBLE |
+      ALLEGRO_USE_PROGRAMMABLE_PIPELINE);
+   d->refresh_rate = 0;
+   d->backbuffer_format = ALLEGRO_PIXEL_FORMAT_ARGB_8888;
+
+   eds = &d->extra_settings;
+   _al_set_color_components(d->backbuffer_format, eds, ALLEGRO_REQUIRE);
+   eds->settings[ALLEGRO_COMPATIBLE_DISPLAY] = 1;
+   eds->settings[ALLEGRO_CAN_DRAW_INTO_BITMAP] = 1;
+   eds->settings[ALLEGRO_SUPPORT_NPOT_BITMAP] = 1;
+   eds->settings[ALLEGRO_SUPPORT_SEPARATE_ALPHA] = 1;
+
+   hd->backbuffer = create_backbuffer(d, w, h);
+   if (!hd->backbuffer) {
+      ALLEGRO_ERROR("Failed to create %dx%d backbuffer.\n", w, h);
+      al_free(hd);
+      return NULL;
+   }
+
+   /* Each display is an event source. */
+   _al_event_source_init(&d->es);
+
+   add = _al_vector_alloc_back(&headless_displays);
+   *add = d;
+   _al_add_exit_func(shutdown_headless_displays,
+      "shutdown_headless_displays");
+
+   ALLEGRO_INFO("Created %dx%d headless display.\n", w, h);
+   return d;
+}
+
+
+
+static void headless_destroy_display(ALLEGRO_DISPLAY *d)
+{
+   ALLEGRO_DISPLAY_HEADLESS *hd = (ALLEGRO_DISPLAY_HEADLESS *)d;
+   ALLEGRO_BITMAP *target = al_get_target_bitmap();
+
+   if (target == hd->backbuffer)
+      al_set_target_bitmap(NULL);
+
+   _al_vector_find_and_delete(&headless_displays, &d);
+
+   al_destroy_bitmap(hd->backbuffer);
+
+   al_ustr_free(hd->flip_filename);
+   _al_vector_free(&d->bitmaps);
+   _al_event_source_free(&d->es);
+   al_free(d->vertex_cache);
+   al_free(d);
+}
+
+
+
+static bool headless_set_current_display(ALLEGRO_DISPLAY *d)
+{
+   (void)d;
+   return true;
+}
+
+
+
+static void headless_unset_current_display(ALLEGRO_DISPLAY *d)
+{
+   (void)d;
+}
+
+
+
+/* Expands each run of '#' in the file name pattern to the frame number,
+ * zero padded to the length of the run.
+ */
+static ALLEGRO_USTR *frame_filename(const ALLEGRO_USTR *pattern, int frame)
+{
+   ALLEGRO_USTR *name = al_ustr_new("");
+   int pos = 0;
+   int32_t c;
+
+   while ((c = al_ustr_get_next(pattern, &pos)) >= 0) {
+      if (c == '#') {
+         int digits = 1;
+         while (al_ustr_get(pattern, pos) == '#') {
+            al_ustr_next(pattern, &pos);
+            digits++;
+         }
+         al_ustr_appendf(name, "%0*d", digits, frame);
+      }
+      else {
+         al_ustr_append_chr(name, c);
+      }
+   }
+
+   return name;
+}
+
+
+
+static void headless_flip_display(ALLEGRO_DISPLAY *d)
+{
+   ALLEGRO_DISPLAY_HEADLESS *hd = (ALLEGRO_DISPLAY_HEADLESS *)d;
+
+   if (hd->flip_callback) {
+      hd->flip_callback(d, hd->backbuffer, hd->flip_callback_arg);
+   }
+
+   if (hd->flip_filename) {
+      ALLEGRO_USTR *name = frame_filename(hd->flip_filename, hd->frame);
+      if (!al_save_bitmap(al_cstr(name), hd->backbuffer)) {
+         ALLEGRO_ERROR("Failed to save frame to %s.\n", al_cstr(name));
+      }
+      al_ustr_free(name);
+   }
+
+   hd->frame++;
+}
+
+
+
+static void headless_update_display_region(ALLEGRO_DISPLAY *d,
+   int x, int y, int width, int height)
+{
+   (void)x;
+   (void)y;
+   (void)width;
+   (void)height;
+   headless_flip_display(d);
+}
+
+
+
+static bool headless_acknowledge_resize(ALLEGRO_DISPLAY *d)
+{
+   (void)d;
+   return true;
+}
+
+
+
+static bool headless_resize_display(ALLEGRO_DISPLAY *d, int w, int h)
+{
+   ALLEGRO_DISPLAY_HEADLESS *hd = (ALLEGRO_DISPLAY_HEADLESS *)d;
+   ALLEGRO_BITMAP *backbuffer;
+   bool was_target;
+
+   if (w <= 0 || h <= 0)
+      return false;
+
+   backbuffer = create_backbuffer(d, w, h);
+   if (!backbuffer)
+      return false;
+
+   was_target = (al_get_target_bitmap() == hd->backbuffer);
+   al_destroy_bitmap(hd->backbuffer);
+   hd->backbuffer = backbuffer;
+   d->w = w;
+   d->h = h;
+
+   if (was_target)
+      al_set_target_bitmap(backbuffer);
+   return true;
+}
+
+
+
+static int headless_get_orientation(ALLEGRO_DISPLAY *d)
+{
+   (void)d;
+   return ALLEGRO_DISPLAY_ORIENTATION_0_DEGREES;
+}
+
+
+
+static ALLEGRO_BITMAP *headless_get_backbuffer(ALLEGRO_DISPLAY *d)
+{
+   return ((ALLEGRO_DISPLAY_HEADLESS *)d)->backbuffer;
+}
+
+
+
+/* All bitmaps are memory bitmaps and drawn in software. */
+static bool headless_is_compatible_bitmap(ALLEGRO_DISPLAY *d,
+   ALLEGRO_BITMAP *bitmap)
+{
+   (void)d;
+   (void)bitmap;
+   return true;
+}
+
+
+
+/* There is no hardware state: the software routines read the transformation
+ * and blender when they draw, and never use the vertex cache.
+ */
+static void headless_flush_vertex_cache(ALLEGRO_DISPLAY *d)
+{
+   d->num_cache_vertices = 0;
+}
+
+
+
+static void headless_update_transformation(ALLEGRO_DISPLAY *d,
+   ALLEGRO_BITMAP *target)
+{
+   (void)d;
+   (void)target;
+}
+
+
+
+static void headless_set_projection(ALLEGRO_DISPLAY *d)
+{
+   (void)d;
+}
+
+
+
+static bool headless_set_mouse_cursor(ALLEGRO_DISPLAY *d,
+   ALLEGRO_MOUSE_CURSOR *cursor)
+{
+   (void)d;
+   (void)cursor;
+   return false;
+}
+
+
+
+static bool headless_set_system_mouse_cursor(ALLEGRO_DISPLAY *d,
+   ALLEGRO_SYSTEM_MOUSE_CURSOR cursor_id)
+{
+   (void)d;
+   (void)cursor_id;
+   return false;
+}
+
+
+
+static bool headless_show_mouse_cursor(ALLEGRO_DISPLAY *d)
+{
+   (void)d;
+   return false;
+}
+
+
+
+static bool headless_hide_mouse_cursor(ALLEGRO_DISPLAY *d)
+{
+   (void)d;
+   return false;
+}
+
+
+
+/* Obtain a reference to this driver. */
+ALLEGRO_DISPLAY_INTERFACE *_al_display_headless_driver(void)
+{
+   if (vt)
+      return vt;
+
+   vt = al_calloc(1, sizeof *vt);
+
+   vt->create_display = headless_create_display;
+   vt->destroy_display = headless_destroy_display;
+   vt->set_current_display = headless_set_current_display;
+   vt->unset_current_display = headless_unset_current_display;
+   vt->flip_display = headless_flip_display;
+   vt->update_display_region = headless_update_display_region;
+   vt->acknowledge_resize = headless_acknowledge_resize;
+   vt->resize_display = headless_resize_display;
+   vt->get_orientation = headless_get_orientation;
+   vt->get_backbuffer = headless_get_backbuffer;
+   vt->is_compatible_bitmap = headless_is_compatible_bitmap;
+   vt->flush_vertex_cache = headless_flush_vertex_cache;
+   vt->update_transformation = headless_update_transformation;
+   vt->set_projection = headless_set_projection;
+   vt->set_mouse_cursor = headless_set_mouse_cursor;
+   vt->set_system_mouse_cursor = headless_set_system_mouse_cursor;
+   vt->show_mouse_cursor = headless_show_mouse_cursor;
+   vt->hide_mouse_cursor = headless_hide_mouse_cursor;
+
+   return vt;
+}
+
+
+
+static ALLEGRO_DISPLAY_HEADLESS *get_headless_display(ALLEGRO_DISPLAY *display)
+{
+   if (display && display->vt == vt && vt)
+      return (ALLEGRO_DISPLAY_HEADLESS *)display;
+   return NULL;
+}
+
+
+
+/* Function: al_set_headless_flip_callback
+ */
+bool al_set_headless_flip_callback(ALLEGRO_DISPLAY *display,
+   void (*callback)(ALLEGRO_DISPLAY *display, ALLEGRO_BITMAP *frame,
+      void *arg), void *arg)
+{
+   ALLEGRO_DISPLAY_HEADLESS *hd = get_headless_display(display);
+
+   if (!hd)
+      return false;
+
+   hd->flip_callback = callback;
+   hd->flip_callback_arg = arg;
+   return true;
+}
+
+
+
+/* Function: al_set_headless_flip_filename
+ */
+bool al_set_headless_flip_filename(ALLEGRO_DISPLAY *display,
+   const char *filename)
+{
+   ALLEGRO_DISPLAY_HEADLESS *hd = get_headless_display(display);
+
+   if (!hd)
+      return false;
+
+   al_ustr_free(hd->flip_filename);
+   hd->flip_filename = filename ? al_ustr_new(filename) : NULL;
+   hd->frame = 0;
+   return true;
+}
+
+
+/* vim: set sts=3 sw=3 et: */
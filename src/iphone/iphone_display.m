@@ -386,13 +386,13 @@ static void iphone_flip_display(ALLEGRO_DISPLAY *d)
    }
 
    if (using_shader) {
-      glUseProgram(0);
+      _al_ogl_use_program(d, 0);
    }
 
     _al_iphone_flip_view(d);
 
    if (using_shader) {
-      glUseProgram(d->ogl_extras->program_object);
+      _al_ogl_use_program(d, d->ogl_extras->program_object);
    }
 }
 
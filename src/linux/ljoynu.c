@@ -105,8 +105,8 @@ static const char *ljoy_get_name(ALLEGRO_JOYSTICK *joy_);
 static bool ljoy_get_active(ALLEGRO_JOYSTICK *joy_);
 
 static void ljoy_process_new_data(void *data);
-static void ljoy_generate_axis_event(ALLEGRO_JOYSTICK_LINUX *joy, int stick, int axis, float pos);
-static void ljoy_generate_button_event(ALLEGRO_JOYSTICK_LINUX *joy, int button, ALLEGRO_EVENT_TYPE event_type);
+static void ljoy_init_axis_event(ALLEGRO_EVENT *event, ALLEGRO_JOYSTICK_LINUX *joy, int stick, int axis, float pos);
+static void ljoy_init_button_event(ALLEGRO_EVENT *event, ALLEGRO_JOYSTICK_LINUX *joy, int button, ALLEGRO_EVENT_TYPE event_type);
 
 
 
@@ -711,11 +711,15 @@ static void ljoy_process_new_data(void *data)
    _al_event_source_lock(es);
    {
       struct js_event js_events[32];
+      ALLEGRO_EVENT events[32];
+      bool generate = _al_event_source_needs_to_generate_event(es);
       int bytes, nr, i;
+      unsigned int num;
 
       while ((bytes = read(joy->fd, &js_events, sizeof js_events)) > 0) {
 
          nr = bytes / sizeof(struct js_event);
+         num = 0;
 
          for (i = 0; i < nr; i++) {
 
@@ -730,10 +734,12 @@ static void ljoy_process_new_data(void *data)
                   else
                      joy->joystate.button[number] = 0;
 
-                  ljoy_generate_button_event(joy, number,
-                                             (value
-                                              ? ALLEGRO_EVENT_JOYSTICK_BUTTON_DOWN
-                                              : ALLEGRO_EVENT_JOYSTICK_BUTTON_UP));
+                  if (generate) {
+                     ljoy_init_button_event(&events[num++], joy, number,
+                                            (value
+                                             ? ALLEGRO_EVENT_JOYSTICK_BUTTON_DOWN
+                                             : ALLEGRO_EVENT_JOYSTICK_BUTTON_UP));
+                  }
                }
             }
             else if (type & JS_EVENT_AXIS) {
@@ -744,10 +750,15 @@ static void ljoy_process_new_data(void *data)
 
                   joy->joystate.stick[stick].axis[axis] = pos;
 
-                  ljoy_generate_axis_event(joy, stick, axis, pos);
+                  if (generate)
+                     ljoy_init_axis_event(&events[num++], joy, stick, axis, pos);
                }
             }
          }
+
+         /* Emit everything from this read in one go. */
+         if (num > 0)
+            _al_event_source_emit_events(es, events, num);
       }
    }
    _al_event_source_unlock(es);
@@ -755,54 +766,36 @@ static void ljoy_process_new_data(void *data)
 
 
 
-/* ljoy_generate_axis_event: [fdwatch thread]
+/* ljoy_init_axis_event: [fdwatch thread]
  *
- *  Helper to generate an event after an axis is moved.
- *  The joystick must be locked BEFORE entering this function.
+ *  Helper to fill in an event after an axis is moved.
  */
-static void ljoy_generate_axis_event(ALLEGRO_JOYSTICK_LINUX *joy, int stick, int axis, float pos)
+static void ljoy_init_axis_event(ALLEGRO_EVENT *event, ALLEGRO_JOYSTICK_LINUX *joy, int stick, int axis, float pos)
 {
-   ALLEGRO_EVENT event;
-   ALLEGRO_EVENT_SOURCE *es = al_get_joystick_event_source();
-
-   if (!_al_event_source_needs_to_generate_event(es))
-      return;
-
-   event.joystick.type = ALLEGRO_EVENT_JOYSTICK_AXIS;
-   event.joystick.timestamp = al_get_time();
-   event.joystick.id = (ALLEGRO_JOYSTICK *)joy;
-   event.joystick.stick = stick;
-   event.joystick.axis = axis;
-   event.joystick.pos = pos;
-   event.joystick.button = 0;
-
-   _al_event_source_emit_event(es, &event);
+   event->joystick.type = ALLEGRO_EVENT_JOYSTICK_AXIS;
+   event->joystick.timestamp = al_get_time();
+   event->joystick.id = (ALLEGRO_JOYSTICK *)joy;
+   event->joystick.stick = stick;
+   event->joystick.axis = axis;
+   event->joystick.pos = pos;
+   event->joystick.button = 0;
 }
 
 
 
-/* ljoy_generate_button_event: [fdwatch thread]
+/* ljoy_init_button_event: [fdwatch thread]
  *
- *  Helper to generate an event after a button is pressed or released.
- *  The joystick must be locked BEFORE entering this function.
+ *  Helper to fill in an event after a button is pressed or released.
  */
-static void ljoy_generate_button_event(ALLEGRO_JOYSTICK_LINUX *joy, int button, ALLEGRO_EVENT_TYPE event_type)
+static void ljoy_init_button_event(ALLEGRO_EVENT *event, ALLEGRO_JOYSTICK_LINUX *joy, int button, ALLEGRO_EVENT_TYPE event_type)
 {
-   ALLEGRO_EVENT event;
-   ALLEGRO_EVENT_SOURCE *es = al_get_joystick_event_source();
-
-   if (!_al_event_source_needs_to_generate_event(es))
-      return;
-
-   event.joystick.type = event_type;
-   event.joystick.timestamp = al_get_time();
-   event.joystick.id = (ALLEGRO_JOYSTICK *)joy;
-   event.joystick.stick = 0;
-   event.joystick.axis = 0;
-   event.joystick.pos = 0.0;
-   event.joystick.button = button;
-
-   _al_event_source_emit_event(es, &event);
+   event->joystick.type = event_type;
+   event->joystick.timestamp = al_get_time();
+   event->joystick.id = (ALLEGRO_JOYSTICK *)joy;
+   event->joystick.stick = 0;
+   event->joystick.axis = 0;
+   event->joystick.pos = 0.0;
+   event->joystick.button = button;
 }
 
 #endif /* ALLEGRO_HAVE_LINUX_JOYSTICK_H */
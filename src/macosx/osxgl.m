@@ -1458,13 +1458,7 @@ static void destroy_display(ALLEGRO_DISPLAY* d)
    }
    if (other != NULL) {
       // Found another compatible display. Transfer our bitmaps to it.
-      _AL_VECTOR* bmps = &dpy->parent.bitmaps;
-      for (i = 0; i<_al_vector_size(bmps); ++i) {
-         ALLEGRO_BITMAP **add = _al_vector_alloc_back(&other->parent.bitmaps);
-         ALLEGRO_BITMAP **ref = _al_vector_ref(bmps, i);
-         *add = *ref;
-         (*add)->display = &(other->parent);
-      }
+      _al_transfer_display_bitmaps(&dpy->parent, &other->parent);
    }
    else {
       // This is the last in its group. Convert all its bitmaps to memory bmps
@@ -1529,7 +1523,7 @@ static void flip_display(ALLEGRO_DISPLAY *disp)
    }
 
    if (using_shader) {
-      glUseProgram(0);
+      _al_ogl_use_program(disp, 0);
    }
 
    ALLEGRO_DISPLAY_OSX_WIN* dpy = (ALLEGRO_DISPLAY_OSX_WIN*) disp;
@@ -1543,7 +1537,7 @@ static void flip_display(ALLEGRO_DISPLAY *disp)
    }
 
    if (using_shader) {
-      glUseProgram(disp->ogl_extras->program_object);
+      _al_ogl_use_program(disp, disp->ogl_extras->program_object);
    }
 }
 
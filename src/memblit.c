@@ -18,6 +18,8 @@
 #include "allegro5/internal/aintern_bitmap.h"
 #include "allegro5/internal/aintern_blend.h"
 #include "allegro5/internal/aintern_convert.h"
+#include "allegro5/internal/aintern_display.h"
+#include "allegro5/internal/aintern_tls.h"
 #include "allegro5/internal/aintern_tri_soft.h"
 #include <math.h>
 
@@ -139,7 +141,7 @@ void _al_draw_bitmap_region_memory(ALLEGRO_BITMAP *src,
    
    ASSERT(src->parent == NULL);
 
-   al_get_separate_blender(&op, &src_mode, &dst_mode, &op_alpha, &src_alpha, &dst_alpha);
+   _AL_LOAD_BLENDER(_al_tls_get_blender());
 
    if (_AL_DEST_IS_ZERO && _AL_SRC_NOT_MODIFIED_TINT_WHITE &&
       _al_transform_is_translation(al_get_current_transform(), &xtrans, &ytrans))
@@ -17,12 +17,446 @@
 
 
 #include "allegro5/allegro.h"
+#include "allegro5/internal/aintern.h"
+#include "allegro5/internal/aintern_atomicops.h"
+#include "allegro5/internal/aintern_memory.h"
+#include "allegro5/internal/aintern_thread.h"
+#include "allegro5/internal/aintern_tls.h"
 
 
 /* globals */
 static ALLEGRO_MEMORY_INTERFACE *mem = NULL;
 
 
+/* Small object pools.
+ *
+ * Objects up to _AL_POOL_MAX_SIZE bytes are rounded up to one of a few size
+ * classes and carved out of POOL_CHUNK_SIZE chunks, which are allocated
+ * with al_malloc and never returned.  Each thread keeps a cache of free
+ * objects per class, so allocation and freeing normally take no shared
+ * lock; the shared free list of a class is only locked to move a batch of
+ * objects in or out of a cache.  An object may be freed by a different
+ * thread than the one which allocated it.
+ *
+ * Each thread's cache also holds its share of the per-tag statistics,
+ * which al_get_memory_stats adds up.  Only the owning thread writes them,
+ * bumping a sequence number to odd before and back to even after, and the
+ * reader retries until it sees the same even number on both sides.  So
+ * counting takes no lock and never waits.  When a thread exits its free
+ * objects go back to the shared lists and its statistics are added to
+ * shared_stats.
+ */
+
+#define POOL_CHUNK_SIZE    16384
+#define POOL_NUM_CLASSES   12
+#define CACHE_MAX          64
+#define CACHE_BATCH        32
+
+typedef struct POOL_OBJECT {
+   struct POOL_OBJECT *next;
+} POOL_OBJECT;
+
+typedef struct POOL_CLASS {
+   _AL_MUTEX mutex;
+   POOL_OBJECT *free;
+} POOL_CLASS;
+
+typedef struct _AL_MEMORY_CACHE {
+   struct _AL_MEMORY_CACHE *next;
+   POOL_OBJECT *free[POOL_NUM_CLASSES];
+   int num_free[POOL_NUM_CLASSES];
+   volatile unsigned int stats_seq;
+   /* Per thread these can go negative, when objects are freed by another
+    * thread than the one which allocated them.
+    */
+   int64_t live_bytes[ALLEGRO_NUM_MEMORY_TAGS];
+   int64_t live_count[ALLEGRO_NUM_MEMORY_TAGS];
+   int64_t total_count[ALLEGRO_NUM_MEMORY_TAGS];
+} _AL_MEMORY_CACHE;
+
+static POOL_CLASS pool_classes[POOL_NUM_CLASSES];
+
+/* All thread caches, and the statistics of threads without TLS. */
+static _AL_MUTEX caches_mutex;
+static _AL_MEMORY_CACHE *caches = NULL;
+static _AL_MEMORY_CACHE shared_stats;
+
+static bool memory_initialised = false;
+
+
+
+/* _al_init_memory:
+ *  Creates the locks for the pools.  Before this the program is assumed to
+ *  have only one thread.
+ */
+void _al_init_memory(void)
+{
+   int i;
+
+   if (memory_initialised)
+      return;
+
+   for (i = 0; i < POOL_NUM_CLASSES; i++)
+      _al_mutex_init(&pool_classes[i].mutex);
+   _al_mutex_init(&caches_mutex);
+   memory_initialised = true;
+}
+
+
+
+/* 16 byte steps up to 128 bytes, then 32 byte steps up to 256. */
+static int size_class(size_t size)
+{
+   if (size <= 128)
+      return size == 0 ? 0 : (size + 15) / 16 - 1;
+   return 8 + (size - 129) / 32;
+}
+
+
+
+static size_t class_size(int c)
+{
+   return c < 8 ? (c + 1) * 16 : 128 + (c - 7) * 32;
+}
+
+
+
+static _AL_MEMORY_CACHE *get_cache(void)
+{
+   _AL_MEMORY_CACHE **pcache = _al_tls_get_memory_cache();
+   _AL_MEMORY_CACHE *cache;
+
+   if (!pcache)
+      return NULL;
+   if (*pcache)
+      return *pcache;
+
+   cache = al_calloc(1, sizeof *cache);
+   if (!cache)
+      return NULL;
+
+   _al_mutex_lock(&caches_mutex);
+   cache->next = caches;
+   caches = cache;
+   _al_mutex_unlock(&caches_mutex);
+
+   *pcache = cache;
+   return cache;
+}
+
+
+
+static void count(_AL_MEMORY_CACHE *cache, int tag, int64_t bytes, int n)
+{
+   ASSERT(tag >= 0 && tag < ALLEGRO_NUM_MEMORY_TAGS);
+
+   if (!cache) {
+      _al_mutex_lock(&caches_mutex);
+      count(&shared_stats, tag, bytes, n);
+      _al_mutex_unlock(&caches_mutex);
+      return;
+   }
+
+   cache->stats_seq++;
+   _al_write_barrier();
+   cache->live_bytes[tag] += bytes;
+   cache->live_count[tag] += n;
+   if (n > 0)
+      cache->total_count[tag] += n;
+   _al_write_barrier();
+   cache->stats_seq++;
+}
+
+
+
+/* Adds the statistics of another thread's cache for `tag' to `stats'. */
+static void read_stats(const _AL_MEMORY_CACHE *cache, int tag,
+   ALLEGRO_MEMORY_STATS *stats)
+{
+   unsigned int seq;
+   int64_t live_bytes, live_count, total_count;
+
+   do {
+      seq = cache->stats_seq;
+      _al_read_barrier();
+      live_bytes = cache->live_bytes[tag];
+      live_count = cache->live_count[tag];
+      total_count = cache->total_count[tag];
+      _al_read_barrier();
+   } while ((seq & 1) || seq != cache->stats_seq);
+
+   stats->live_bytes += live_bytes;
+   stats->live_count += live_count;
+   stats->total_count += total_count;
+}
+
+
+
+static void add_stats(_AL_MEMORY_CACHE *to, const _AL_MEMORY_CACHE *from)
+{
+   int tag;
+
+   for (tag = 0; tag < ALLEGRO_NUM_MEMORY_TAGS; tag++) {
+      to->live_bytes[tag] += from->live_bytes[tag];
+      to->live_count[tag] += from->live_count[tag];
+      to->total_count[tag] += from->total_count[tag];
+   }
+}
+
+
+
+/* Takes up to `max' objects of class c from its shared free list, carving
+ * up a new chunk if it is empty.  Returns the number taken.
+ */
+static int take_objects(int c, POOL_OBJECT **list, int max)
+{
+   POOL_CLASS *pc = &pool_classes[c];
+   int n = 0;
+
+   _al_mutex_lock(&pc->mutex);
+
+   if (!pc->free) {
+      size_t size = class_size(c);
+      char *chunk = al_malloc(POOL_CHUNK_SIZE);
+      if (chunk) {
+         size_t i;
+         for (i = 0; i + size <= POOL_CHUNK_SIZE; i += size) {
+            POOL_OBJECT *obj = (POOL_OBJECT *)(chunk + i);
+            obj->next = pc->free;
+            pc->free = obj;
+         }
+      }
+   }
+
+   while (pc->free && n < max) {
+      POOL_OBJECT *obj = pc->free;
+      pc->free = obj->next;
+      obj->next = *list;
+      *list = obj;
+      n++;
+   }
+
+   _al_mutex_unlock(&pc->mutex);
+   return n;
+}
+
+
+
+/* Gives up to `max' objects from `list' back to the shared free list of
+ * class c.  Returns the number given.
+ */
+static int give_objects(int c, POOL_OBJECT **list, int max)
+{
+   POOL_CLASS *pc = &pool_classes[c];
+   int n = 0;
+
+   _al_mutex_lock(&pc->mutex);
+   while (*list && n < max) {
+      POOL_OBJECT *obj = *list;
+      *list = obj->next;
+      obj->next = pc->free;
+      pc->free = obj;
+      n++;
+   }
+   _al_mutex_unlock(&pc->mutex);
+   return n;
+}
+
+
+
+/* Internal function: _al_memory_cache_destroy
+ *  Called by the thread which owns the cache when it exits.  Returns the
+ *  free objects of the cache to the shared lists and keeps its statistics
+ *  in shared_stats.
+ */
+void _al_memory_cache_destroy(_AL_MEMORY_CACHE *cache)
+{
+   _AL_MEMORY_CACHE **p;
+   int c;
+
+   if (!cache)
+      return;
+
+   for (c = 0; c < POOL_NUM_CLASSES; c++) {
+      while (cache->free[c])
+         give_objects(c, &cache->free[c], CACHE_MAX);
+   }
+
+   _al_mutex_lock(&caches_mutex);
+   for (p = &caches; *p; p = &(*p)->next) {
+      if (*p == cache) {
+         *p = cache->next;
+         break;
+      }
+   }
+   add_stats(&shared_stats, cache);
+   _al_mutex_unlock(&caches_mutex);
+
+   al_free(cache);
+}
+
+
+
+/* Internal function: _al_pool_malloc
+ *  Allocates a small object, counted against `tag'.
+ */
+void *_al_pool_malloc(int tag, size_t size)
+{
+   _AL_MEMORY_CACHE *cache;
+   POOL_OBJECT *obj = NULL;
+   int c;
+
+   if (size > _AL_POOL_MAX_SIZE)
+      return _al_tagged_malloc(tag, size);
+
+   c = size_class(size);
+   cache = get_cache();
+
+   if (cache) {
+      if (!cache->free[c])
+         cache->num_free[c] = take_objects(c, &cache->free[c], CACHE_BATCH);
+      obj = cache->free[c];
+      if (obj) {
+         cache->free[c] = obj->next;
+         cache->num_free[c]--;
+      }
+   }
+   else {
+      take_objects(c, &obj, 1);
+   }
+
+   if (obj)
+      count(cache, tag, size, 1);
+   return obj;
+}
+
+
+
+/* Internal function: _al_pool_free
+ *  Frees an object allocated by _al_pool_malloc.
+ */
+void _al_pool_free(int tag, void *ptr, size_t size)
+{
+   _AL_MEMORY_CACHE *cache;
+   POOL_OBJECT *obj = ptr;
+   int c;
+
+   if (!ptr)
+      return;
+   if (size > _AL_POOL_MAX_SIZE) {
+      _al_tagged_free(tag, ptr, size);
+      return;
+   }
+
+   c = size_class(size);
+   cache = get_cache();
+   count(cache, tag, -(int64_t)size, -1);
+
+   if (cache) {
+      obj->next = cache->free[c];
+      cache->free[c] = obj;
+      if (++cache->num_free[c] > CACHE_MAX) {
+         cache->num_free[c] -= give_objects(c, &cache->free[c],
+            CACHE_BATCH);
+      }
+   }
+   else {
+      obj->next = NULL;
+      give_objects(c, &obj, 1);
+   }
+}
+
+
+
+/* Internal function: _al_tagged_malloc
+ */
+void *_al_tagged_malloc(int tag, size_t size)
+{
+   void *ptr = al_malloc(size);
+   if (ptr)
+      count(get_cache(), tag, size, 1);
+   return ptr;
+}
+
+
+
+/* Internal function: _al_tagged_calloc
+ */
+void *_al_tagged_calloc(int tag, size_t size)
+{
+   void *ptr = al_calloc(1, size);
+   if (ptr)
+      count(get_cache(), tag, size, 1);
+   return ptr;
+}
+
+
+
+/* Internal function: _al_tagged_realloc
+ */
+void *_al_tagged_realloc(int tag, void *ptr, size_t old_size, size_t size)
+{
+   void *new_ptr = al_realloc(ptr, size);
+   if (new_ptr) {
+      if (ptr)
+         count(get_cache(), tag, (int64_t)size - (int64_t)old_size, 0);
+      else
+         count(get_cache(), tag, size, 1);
+   }
+   return new_ptr;
+}
+
+
+
+/* Internal function: _al_tagged_free
+ */
+void _al_tagged_free(int tag, void *ptr, size_t size)
+{
+   if (ptr)
+      _al_tagged_free_in_cache(get_cache(), tag, ptr, size);
+}
+
+
+
+/* Internal function: _al_tagged_free_in_cache
+ *  Like _al_tagged_free, but counts the free in `cache', which may be NULL,
+ *  rather than looking up the calling thread's.  For freeing while a
+ *  thread's local storage is being torn down.
+ */
+void _al_tagged_free_in_cache(struct _AL_MEMORY_CACHE *cache, int tag,
+   void *ptr, size_t size)
+{
+   if (ptr) {
+      count(cache, tag, -(int64_t)size, -1);
+      al_free(ptr);
+   }
+}
+
+
+
+/* Function: al_get_memory_stats
+ */
+bool al_get_memory_stats(ALLEGRO_MEMORY_TAG tag, ALLEGRO_MEMORY_STATS *stats)
+{
+   _AL_MEMORY_CACHE *cache;
+   ASSERT(stats);
+   ASSERT(tag >= 0 && tag < ALLEGRO_NUM_MEMORY_TAGS);
+
+   if (tag < 0 || tag >= ALLEGRO_NUM_MEMORY_TAGS)
+      return false;
+
+   _al_mutex_lock(&caches_mutex);
+   stats->live_bytes = shared_stats.live_bytes[tag];
+   stats->live_count = shared_stats.live_count[tag];
+   stats->total_count = shared_stats.total_count[tag];
+   for (cache = caches; cache; cache = cache->next)
+      read_stats(cache, tag, stats);
+   _al_mutex_unlock(&caches_mutex);
+
+   return true;
+}
+
+
 
 /* Function: al_set_memory_interface
  */
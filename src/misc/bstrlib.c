@@ -23,6 +23,7 @@
 #include <string.h>
 #include <ctype.h>
 #include "allegro5/allegro.h"
+#include "allegro5/internal/aintern_memory.h"
 #include "allegro5/internal/bstrlib.h"
 
 #define bstr__alloc(x)	    al_malloc(x)
@@ -97,6 +98,65 @@ static int snapUpSize (int i) {
 	return i;
 }
 
+/* Allegro: short strings keep their buffer inline, directly after the
+   header, so creating and destroying one costs a single allocation.  Strings
+   allocated from a scratch arena (see utf8.c) use the same layout.  An inline
+   buffer is never passed to bstr__realloc or bstr__free; when the string
+   outgrows it the contents are moved to a separate heap buffer. */
+
+#define bstr__inlinedata(b) ((unsigned char *) ((b) + 1))
+#define bstr__isinline(b) ((b)->data == bstr__inlinedata (b))
+
+/* Allegro: headers come from the small object pool.  They are all the same
+   size, whether or not the buffer is inline, so that the size is known
+   when they are freed.  Each one is preceded by an empty _al_bstrtag so
+   that _al_bdestroy can tell it from a scratch arena string. */
+
+#define bstr__isarena(b) (_al_bstrtag_of (b)->arena != NULL)
+#define bstr__headersize (sizeof (_al_bstrtag) + \
+	sizeof (struct _al_tagbstring) + _AL_BSTR_INLINE_SIZE)
+#define bstr__freeheader(b) \
+	_al_pool_free (ALLEGRO_MEMORY_TAG_STRINGS, _al_bstrtag_of (b), \
+		bstr__headersize)
+
+static _al_bstring bstr__allocheader (void) {
+_al_bstrtag * t;
+
+	t = (_al_bstrtag *) _al_pool_malloc (ALLEGRO_MEMORY_TAG_STRINGS,
+		bstr__headersize);
+	if (t == NULL) return NULL;
+	t->arena = NULL;
+	t->scope = 0;
+	t->escaped = 0;
+	return (_al_bstring) (t + 1);
+}
+
+/*  static _al_bstring bstr__new (int mlen)
+ *
+ *  Allocate a header with a data buffer of at least mlen bytes.  Only the
+ *  data and mlen fields are initialized.
+ */
+static _al_bstring bstr__new (int mlen) {
+_al_bstring b;
+
+	if (mlen <= _AL_BSTR_INLINE_SIZE) {
+		b = bstr__allocheader ();
+		if (b == NULL) return NULL;
+		b->data = bstr__inlinedata (b);
+		b->mlen = _AL_BSTR_INLINE_SIZE;
+		return b;
+	}
+
+	b = bstr__allocheader ();
+	if (b == NULL) return NULL;
+	if (NULL == (b->data = (unsigned char *) bstr__alloc ((size_t) mlen))) {
+		bstr__freeheader (b);
+		return NULL;
+	}
+	b->mlen = mlen;
+	return b;
+}
+
 /*  int _al_balloc (_al_bstring b, int len)
  *
  *  Increase the size of the memory backing the _al_bstring b to at least len.
@@ -113,8 +173,22 @@ int _al_balloc (_al_bstring b, int olen) {
 
 		if ((len = snapUpSize (olen)) <= b->mlen) return _AL_BSTR_OK;
 
+		if (bstr__isinline (b)) {
+
+			/* The inline buffer cannot be resized, so move the contents
+			   out to the heap */
+
+			if (NULL == (x = (unsigned char *) bstr__alloc ((size_t) len))) {
+				if (NULL == (x = (unsigned char *) bstr__alloc ((size_t) (len = olen)))) {
+					return _AL_BSTR_ERR;
+				}
+			}
+			if (b->slen) bstr__memcpy ((char *) x, (char *) b->data, (size_t) b->slen);
+			if (bstr__isarena (b)) _al_ustr_arena_adopt (b);
+		}
+
 		/* Assume probability of a non-moving realloc is 0.125 */
-		if (7 * b->mlen < 8 * b->slen) {
+		else if (7 * b->mlen < 8 * b->slen) {
 
 			/* If slen is close to mlen in size then use realloc to reduce
 			   the memory defragmentation */
@@ -173,6 +247,12 @@ int _al_ballocmin (_al_bstring b, int len) {
 
 	if (len < b->slen + 1) len = b->slen + 1;
 
+	if (bstr__isinline (b)) {
+		/* Inline buffers are never shrunk. */
+		if (len <= b->mlen) return _AL_BSTR_OK;
+		return _al_balloc (b, len);
+	}
+
 	if (len != b->mlen) {
 		s = (unsigned char *) bstr__realloc (b->data, (size_t) len);
 		if (NULL == s) return _AL_BSTR_ERR;
@@ -199,13 +279,9 @@ size_t j;
 	i = snapUpSize ((int) (j + (2 - (j != 0))));
 	if (i <= (int) j) return NULL;
 
-	b = (_al_bstring) bstr__alloc (sizeof (struct _al_tagbstring));
+	b = bstr__new (i);
 	if (NULL == b) return NULL;
 	b->slen = (int) j;
-	if (NULL == (b->data = (unsigned char *) bstr__alloc (b->mlen = i))) {
-		bstr__free (b);
-		return NULL;
-	}
 
 	bstr__memcpy (b->data, str, j+1);
 	return b;
@@ -227,15 +303,11 @@ size_t j;
 	i = snapUpSize ((int) (j + (2 - (j != 0))));
 	if (i <= (int) j) return NULL;
 
-	b = (_al_bstring) bstr__alloc (sizeof (struct _al_tagbstring));
-	if (b == NULL) return NULL;
-	b->slen = (int) j;
 	if (i < mlen) i = mlen;
 
-	if (NULL == (b->data = (unsigned char *) bstr__alloc (b->mlen = i))) {
-		bstr__free (b);
-		return NULL;
-	}
+	b = bstr__new (i);
+	if (b == NULL) return NULL;
+	b->slen = (int) j;
 
 	bstr__memcpy (b->data, str, j+1);
 	return b;
@@ -251,20 +323,13 @@ _al_bstring b;
 int i;
 
 	if (blk == NULL || len < 0) return NULL;
-	b = (_al_bstring) bstr__alloc (sizeof (struct _al_tagbstring));
-	if (b == NULL) return NULL;
-	b->slen = len;
 
 	i = len + (2 - (len != 0));
 	i = snapUpSize (i);
 
-	b->mlen = i;
-
-	b->data = (unsigned char *) bstr__alloc ((size_t) b->mlen);
-	if (b->data == NULL) {
-		bstr__free (b);
-		return NULL;
-	}
+	b = bstr__new (i);
+	if (b == NULL) return NULL;
+	b->slen = len;
 
 	if (len > 0) bstr__memcpy (b->data, blk, (size_t) len);
 	b->data[len] = (unsigned char) '\0';
@@ -420,27 +485,18 @@ int i,j;
 	/* Attempted to copy an invalid string? */
 	if (b == NULL || b->slen < 0 || b->data == NULL) return NULL;
 
-	b0 = (_al_bstring) bstr__alloc (sizeof (struct _al_tagbstring));
-	if (b0 == NULL) {
-		/* Unable to allocate memory for string header */
-		return NULL;
-	}
-
 	i = b->slen;
 	j = snapUpSize (i + 1);
 
-	b0->data = (unsigned char *) bstr__alloc (j);
-	if (b0->data == NULL) {
-		j = i + 1;
-		b0->data = (unsigned char *) bstr__alloc (j);
-		if (b0->data == NULL) {
-			/* Unable to allocate memory for string data */
-			bstr__free (b0);
+	b0 = bstr__new (j);
+	if (b0 == NULL) {
+		b0 = bstr__new (i + 1);
+		if (b0 == NULL) {
+			/* Unable to allocate memory for string */
 			return NULL;
 		}
 	}
 
-	b0->mlen = j;
 	b0->slen = i;
 
 	if (i) bstr__memcpy ((char *) b0->data, (char *) b->data, i);
@@ -1003,7 +1059,14 @@ int _al_bdestroy (_al_bstring b) {
 	    b->data == NULL)
 		return _AL_BSTR_ERR;
 
-	bstr__free (b->data);
+	/* Strings from a scratch arena are released with the arena.  Their
+	   header must never reach the pool. */
+	if (bstr__isarena (b)) {
+		_al_ustr_arena_release (b);
+		return _AL_BSTR_OK;
+	}
+
+	if (!bstr__isinline (b)) bstr__free (b->data);
 
 	/* In case there is any stale usage, there is one more chance to 
 	   notice this error. */
@@ -1012,7 +1075,7 @@ int _al_bdestroy (_al_bstring b) {
 	b->mlen = -__LINE__;
 	b->data = NULL;
 
-	bstr__free (b);
+	bstr__freeheader (b);
 	return _AL_BSTR_OK;
 }
 
@@ -2253,15 +2316,9 @@ int i, c, v;
 
 	if (sep != NULL) c += (bl->qty - 1) * sep->slen;
 
-	b = (_al_bstring) bstr__alloc (sizeof (struct _al_tagbstring));
+	b = bstr__new (c);
 	if (NULL == b) return NULL; /* Out of memory */
-	b->data = (unsigned char *) bstr__alloc (c);
-	if (b->data == NULL) {
-		bstr__free (b);
-		return NULL;
-	}
 
-	b->mlen = c;
 	b->slen = c-1;
 
 	for (i = 0, c = 0; i < bl->qty; i++) {
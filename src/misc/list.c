@@ -26,6 +26,7 @@
 #include "allegro5/allegro.h"
 #include "allegro5/internal/aintern.h"
 #include "allegro5/internal/aintern_list.h"
+#include "allegro5/internal/aintern_memory.h"
 
 
 ALLEGRO_DEBUG_CHANNEL("list")
@@ -107,7 +108,8 @@ static _AL_LIST* list_do_create(size_t capacity, size_t extra_item_size)
     */
    memory_size = sizeof(_AL_LIST) + (capacity + 1) * (sizeof(_AL_LIST_ITEM) + extra_item_size);
 
-   memory_ptr = (uint8_t*)al_malloc(memory_size);
+   memory_ptr = (uint8_t*)_al_tagged_malloc(ALLEGRO_MEMORY_TAG_CONTAINERS,
+      memory_size);
    if (NULL == memory_ptr) {
       ALLEGRO_ERROR("Out of memory.");
       return NULL;
@@ -194,7 +196,8 @@ static _AL_LIST_ITEM* list_create_item(_AL_LIST* list)
    }
    else {
 
-      item = (_AL_LIST_ITEM*)al_malloc(list->item_size_with_extra);
+      item = (_AL_LIST_ITEM*)_al_pool_malloc(ALLEGRO_MEMORY_TAG_CONTAINERS,
+         list->item_size_with_extra);
 
       item->list = list;
    }
@@ -219,7 +222,8 @@ static void list_destroy_item(_AL_LIST* list, _AL_LIST_ITEM* item)
       list->next_free = item;
    }
    else
-      al_free(item);
+      _al_pool_free(ALLEGRO_MEMORY_TAG_CONTAINERS, item,
+         list->item_size_with_extra);
 }
 
 
@@ -268,7 +272,8 @@ void _al_list_destroy(_AL_LIST* list)
 
    _al_list_clear(list);
 
-   al_free(list);
+   _al_tagged_free(ALLEGRO_MEMORY_TAG_CONTAINERS, list, sizeof(_AL_LIST) +
+      (list->capacity + 1) * list->item_size_with_extra);
 }
 
 
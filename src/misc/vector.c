@@ -33,11 +33,13 @@
 
 #include "allegro5/allegro.h"
 #include "allegro5/internal/aintern.h"
+#include "allegro5/internal/aintern_memory.h"
 #include "allegro5/internal/aintern_vector.h"
 
 
 /* return the given item's starting address in the vector */
 #define ITEM_START(vec, idx)    (vec->_items + ((idx) * vec->_itemsize))
+#define CAPACITY_BYTES(vec)     ((vec->_size + vec->_unused) * vec->_itemsize)
 
 
 
@@ -125,7 +127,8 @@ bool _al_vector_append_array(_AL_VECTOR *vec, unsigned int num, const void *arr)
       ASSERT(vec->_size == 0);
       ASSERT(vec->_unused == 0);
 
-      vec->_items = al_malloc(vec->_itemsize * num);
+      vec->_items = _al_tagged_malloc(ALLEGRO_MEMORY_TAG_CONTAINERS,
+         vec->_itemsize * num);
       ASSERT(vec->_items);
       if (!vec->_items)
          return false;
@@ -134,7 +137,8 @@ bool _al_vector_append_array(_AL_VECTOR *vec, unsigned int num, const void *arr)
    }
    else if (vec->_unused < num) {
       char *new_items;
-      new_items = al_realloc(vec->_items, (vec->_size + num) * vec->_itemsize);
+      new_items = _al_tagged_realloc(ALLEGRO_MEMORY_TAG_CONTAINERS,
+         vec->_items, CAPACITY_BYTES(vec), (vec->_size + num) * vec->_itemsize);
       ASSERT(new_items);
       if (!new_items)
          return false;
@@ -177,7 +181,8 @@ void* _al_vector_alloc_back(_AL_VECTOR *vec)
          ASSERT(vec->_size == 0);
          ASSERT(vec->_unused == 0);
 
-         vec->_items = al_malloc(vec->_itemsize);
+         vec->_items = _al_tagged_malloc(ALLEGRO_MEMORY_TAG_CONTAINERS,
+            vec->_itemsize);
          ASSERT(vec->_items);
          if (!vec->_items)
             return NULL;
@@ -185,7 +190,8 @@ void* _al_vector_alloc_back(_AL_VECTOR *vec)
          vec->_unused = 1;
       }
       else if (vec->_unused == 0) {
-         char *new_items = al_realloc(vec->_items, 2 * vec->_size * vec->_itemsize);
+         char *new_items = _al_tagged_realloc(ALLEGRO_MEMORY_TAG_CONTAINERS,
+            vec->_items, CAPACITY_BYTES(vec), 2 * vec->_size * vec->_itemsize);
          ASSERT(new_items);
          if (!new_items)
             return NULL;
@@ -223,7 +229,8 @@ void* _al_vector_alloc_mid(_AL_VECTOR *vec, unsigned int index)
       }
 
       if (vec->_unused == 0) {
-         char *new_items = al_realloc(vec->_items, 2 * vec->_size * vec->_itemsize);
+         char *new_items = _al_tagged_realloc(ALLEGRO_MEMORY_TAG_CONTAINERS,
+            vec->_items, CAPACITY_BYTES(vec), 2 * vec->_size * vec->_itemsize);
          ASSERT(new_items);
          if (!new_items)
             return NULL;
@@ -345,7 +352,28 @@ void _al_vector_free(_AL_VECTOR *vec)
    ASSERT(vec);
 
    if (vec->_items != NULL) {
-      al_free(vec->_items);
+      _al_tagged_free(ALLEGRO_MEMORY_TAG_CONTAINERS, vec->_items,
+         CAPACITY_BYTES(vec));
+      vec->_items = NULL;
+   }
+   vec->_size = 0;
+   vec->_unused = 0;
+}
+
+
+
+/* Internal function: _al_vector_free_in_cache
+ *
+ *  Like _al_vector_free, but the free is counted in the given memory cache.
+ *  See _al_tagged_free_in_cache.
+ */
+void _al_vector_free_in_cache(_AL_VECTOR *vec, struct _AL_MEMORY_CACHE *cache)
+{
+   ASSERT(vec);
+
+   if (vec->_items != NULL) {
+      _al_tagged_free_in_cache(cache, ALLEGRO_MEMORY_TAG_CONTAINERS,
+         vec->_items, CAPACITY_BYTES(vec));
       vec->_items = NULL;
    }
    vec->_size = 0;
@@ -921,6 +921,13 @@ ALLEGRO_OGL_EXT_LIST *al_get_opengl_extension_list(void)
 
 void _al_ogl_unmanage_extensions(ALLEGRO_DISPLAY *gl_disp)
 {
+   if (gl_disp->ogl_extras->upload_pbos[0]) {
+      glDeleteBuffers(ALLEGRO_MAX_OPENGL_UPLOAD_PBOS,
+         gl_disp->ogl_extras->upload_pbos);
+      memset(gl_disp->ogl_extras->upload_pbos, 0,
+         sizeof(gl_disp->ogl_extras->upload_pbos));
+   }
+
    destroy_extension_api_table(gl_disp->ogl_extras->extension_api);
    destroy_extension_list(gl_disp->ogl_extras->extension_list);
    gl_disp->ogl_extras->extension_api = NULL;
@@ -214,6 +214,7 @@ static void draw_quad(ALLEGRO_BITMAP *bitmap,
    (void)flags;
 
    if (disp->num_cache_vertices != 0 && ogl_bitmap->texture != disp->cache_texture) {
+      disp->stats.batch_breaks_texture++;
       disp->vt->flush_vertex_cache(disp);
    }
    disp->cache_texture = ogl_bitmap->texture;
@@ -349,7 +350,7 @@ static void ogl_draw_bitmap_region(ALLEGRO_BITMAP *bitmap,
              * correct to ignore them here.
              */
 
-            glBindTexture(GL_TEXTURE_2D, ogl_target->texture);
+            _al_ogl_bind_texture(al_get_current_display(), ogl_target->texture);
             glCopyTexSubImage2D(GL_TEXTURE_2D, 0,
                 xtrans, target->h - ytrans - sh,
                 sx, bitmap->h - sy - sh,
@@ -413,7 +414,7 @@ static bool ogl_upload_bitmap(ALLEGRO_BITMAP *bitmap)
                     _al_format_name(bitmap->format));
       }
    }
-   glBindTexture(GL_TEXTURE_2D, ogl_bitmap->texture);
+   _al_ogl_bind_texture(al_get_current_display(), ogl_bitmap->texture);
    e = glGetError();
    if (e) {
       ALLEGRO_ERROR("glBindTexture for texture %d failed (%s).\n",
@@ -486,6 +487,9 @@ static bool ogl_upload_bitmap(ALLEGRO_BITMAP *bitmap)
          GL_ALPHA, GL_UNSIGNED_BYTE, buf);
       e = glGetError();
       al_free(buf);
+      bitmap->display->stats.texture_uploads++;
+      bitmap->display->stats.upload_bytes +=
+         (int64_t)ogl_bitmap->true_w * ogl_bitmap->true_h;
    }
    else {
       glTexImage2D(GL_TEXTURE_2D, 0, get_glformat(bitmap->format, 0),
@@ -506,6 +510,9 @@ static bool ogl_upload_bitmap(ALLEGRO_BITMAP *bitmap)
          get_glformat(bitmap->format, 2),
          get_glformat(bitmap->format, 1), buf);
       al_free(buf);
+      bitmap->display->stats.texture_uploads++;
+      bitmap->display->stats.upload_bytes +=
+         (int64_t)pix_size * ogl_bitmap->true_w * ogl_bitmap->true_h;
    }
 #endif
 
@@ -514,7 +521,7 @@ static bool ogl_upload_bitmap(ALLEGRO_BITMAP *bitmap)
          _al_format_name(bitmap->format),
          ogl_bitmap->true_w, ogl_bitmap->true_h,
          _al_gl_error_string(e));
-      glDeleteTextures(1, &ogl_bitmap->texture);
+      _al_ogl_delete_texture(al_get_current_display(), ogl_bitmap->texture);
       ogl_bitmap->texture = 0;
       // FIXME: Should we convert it into a memory bitmap? Or if the size is
       // the problem try to use multiple textures?
@@ -761,7 +768,7 @@ static ALLEGRO_LOCKED_REGION *ogl_lock_region_old(ALLEGRO_BITMAP *bitmap,
             pitch = ogl_pitch(ogl_bitmap->true_w, pixel_size);
             ogl_bitmap->lock_buffer = al_malloc(pitch * ogl_bitmap->true_h);
 
-            glBindTexture(GL_TEXTURE_2D, ogl_bitmap->texture);
+            _al_ogl_bind_texture(al_get_current_display(), ogl_bitmap->texture);
             glGetTexImage(GL_TEXTURE_2D, 0, get_glformat(format, 2),
                get_glformat(format, 1), ogl_bitmap->lock_buffer);
             e = glGetError();
@@ -867,6 +874,8 @@ static void ogl_unlock_region_old(ALLEGRO_BITMAP *bitmap)
       }
       glDisable(GL_TEXTURE_2D);
       glDisable(GL_BLEND);
+      _al_ogl_invalidate_state_cache(al_get_current_display(),
+         _AL_OGL_STATE_BLENDER | _AL_OGL_STATE_UNIFORMS);
       glDrawPixels(bitmap->lock_w, h,
          get_glformat(lock_format, 2),
          get_glformat(lock_format, 1),
@@ -922,7 +931,7 @@ static void ogl_unlock_region_old(ALLEGRO_BITMAP *bitmap)
 #else
       GLuint tmp_tex;
       glGenTextures(1, &tmp_tex);
-      glBindTexture(GL_TEXTURE_2D, tmp_tex);
+      _al_ogl_bind_texture(al_get_current_display(), tmp_tex);
       glTexImage2D(GL_TEXTURE_2D, 0, get_glformat(lock_format, 0), bitmap->lock_w, h,
                    0, get_glformat(lock_format, 2), get_glformat(lock_format, 1),
                    ogl_bitmap->lock_buffer);
@@ -937,7 +946,7 @@ static void ogl_unlock_region_old(ALLEGRO_BITMAP *bitmap)
          int printf(const char *, ...);
          printf("glDrawTexiOES failed: %d\n", e);
       }
-      glDeleteTextures(1, &tmp_tex);
+      _al_ogl_delete_texture(al_get_current_display(), tmp_tex);
 #endif	
    }
 #endif
@@ -953,7 +962,7 @@ static void ogl_unlock_region_old(ALLEGRO_BITMAP *bitmap)
       _al_android_set_curr_fbo(0);
 #endif
 
-      glBindTexture(GL_TEXTURE_2D, ogl_bitmap->texture);
+      _al_ogl_bind_texture(al_get_current_display(), ogl_bitmap->texture);
 
 #if defined ALLEGRO_ANDROID
       if (!(bitmap->lock_flags & ALLEGRO_LOCK_WRITEONLY)) {
@@ -1082,10 +1091,21 @@ static void ogl_destroy_bitmap(ALLEGRO_BITMAP *bitmap)
    al_remove_opengl_fbo(bitmap);
 
    if (ogl_bitmap->texture) {
-      glDeleteTextures(1, &ogl_bitmap->texture);
+      _al_ogl_delete_texture(bitmap->display, ogl_bitmap->texture);
       ogl_bitmap->texture = 0;
    }
 
+#if !defined ALLEGRO_CFG_OPENGLES
+   if (ogl_bitmap->readback_fence) {
+      glDeleteSync(ogl_bitmap->readback_fence);
+      ogl_bitmap->readback_fence = NULL;
+   }
+   if (ogl_bitmap->readback_pbo) {
+      glDeleteBuffers(1, &ogl_bitmap->readback_pbo);
+      ogl_bitmap->readback_pbo = 0;
+   }
+#endif
+
    if (old_disp) {
       _al_set_current_display_only(old_disp);
    }
@@ -1125,6 +1145,9 @@ static ALLEGRO_BITMAP_INTERFACE *ogl_bitmap_driver(void)
 #else
    glbmp_vt.lock_region = _al_ogl_lock_region_new;
    glbmp_vt.unlock_region = _al_ogl_unlock_region_new;
+   glbmp_vt.lock_region_async = _al_ogl_lock_region_async_new;
+   glbmp_vt.is_lock_ready = _al_ogl_is_lock_ready_new;
+   glbmp_vt.finish_lock = _al_ogl_finish_lock_new;
 #endif
 
    return &glbmp_vt;
@@ -479,6 +479,9 @@ void _al_ogl_set_target_bitmap(ALLEGRO_DISPLAY *display, ALLEGRO_BITMAP *bitmap)
    if (bitmap->parent)
       target = bitmap->parent;
 
+   /* The user may have made their own OpenGL calls since we last drew. */
+   _al_ogl_invalidate_state_cache(display, _AL_OGL_STATE_ALL);
+
    /* if either this bitmap or its parent (in the case of subbitmaps)
     * is locked then don't do anything
     */
@@ -700,7 +703,7 @@ void al_set_opengl_program_object(ALLEGRO_DISPLAY *display, GLuint program_objec
    
    display->ogl_extras->program_object = program_object;
 
-   glUseProgram(program_object);
+   _al_ogl_use_program(display, program_object);
       
    handle = glGetUniformLocation(program_object, "projview_matrix");
    if (handle >= 0) {
@@ -708,6 +711,8 @@ void al_set_opengl_program_object(ALLEGRO_DISPLAY *display, GLuint program_objec
       al_compose_transform(&t, &display->proj_transform);
       glUniformMatrix4fv(handle, 1, false, (float *)t.m);
    }
+   /* The shader's own uniforms may have been set in the meantime. */
+   _al_ogl_invalidate_state_cache(display, _AL_OGL_STATE_UNIFORMS);
 
    display->ogl_extras->pos_loc = glGetAttribLocation(program_object, "pos");
    display->ogl_extras->color_loc = glGetAttribLocation(program_object, "color");
@@ -13,10 +13,14 @@
  *      By Elias Pschernig.
  */
 
+#include <string.h>
+
 #include "allegro5/allegro.h"
 #include "allegro5/allegro_opengl.h"
 #include "allegro5/internal/aintern_display.h"
 #include "allegro5/internal/aintern_opengl.h"
+#include "allegro5/internal/aintern_profile.h"
+#include "allegro5/internal/aintern_system.h"
 
 #ifdef ALLEGRO_ANDROID
 #include "allegro5/internal/aintern_android.h"
@@ -24,8 +28,230 @@
 
 ALLEGRO_DEBUG_CHANNEL("opengl")
 
+
+/*
+ * State cache
+ *
+ * Every bitmap draw used to re-send the blender, and every flush queried
+ * the texture binding and re-sent uniforms.  We keep a copy of what we set
+ * last and skip calls that would not change anything.  Code which changes
+ * this state without going through these functions must call
+ * _al_ogl_invalidate_state_cache.
+ */
+
+void _al_ogl_invalidate_state_cache(ALLEGRO_DISPLAY *disp, int state)
+{
+   ALLEGRO_OGL_STATE_CACHE *c;
+
+   if (!disp || !(disp->flags & ALLEGRO_OPENGL) || !disp->ogl_extras)
+      return;
+   c = &disp->ogl_extras->state_cache;
+
+   if (state & _AL_OGL_STATE_PROGRAM)
+      state |= _AL_OGL_STATE_UNIFORMS;
+   if (state & _AL_OGL_STATE_TEXTURE)
+      c->tex_unit_set = false;
+   c->valid &= ~state;
+}
+
+
+/* Returns the cache with all uniforms marked unknown unless they are
+ * already known.
+ */
+static ALLEGRO_OGL_STATE_CACHE *uniform_cache(ALLEGRO_DISPLAY *disp)
+{
+   ALLEGRO_OGL_STATE_CACHE *c = &disp->ogl_extras->state_cache;
+
+   if (!(c->valid & _AL_OGL_STATE_UNIFORMS)) {
+      c->use_tex = -1;
+      c->use_tex_matrix = -1;
+      c->tex_unit_set = false;
+      c->projview_set = false;
+      c->valid |= _AL_OGL_STATE_UNIFORMS;
+   }
+   return c;
+}
+
+
+void _al_ogl_bind_texture(ALLEGRO_DISPLAY *disp, GLuint texture)
+{
+   ALLEGRO_OGL_STATE_CACHE *c;
+
+   if (!disp || !(disp->flags & ALLEGRO_OPENGL)) {
+      glBindTexture(GL_TEXTURE_2D, texture);
+      return;
+   }
+   c = &disp->ogl_extras->state_cache;
+
+   if ((c->valid & _AL_OGL_STATE_TEXTURE) && c->texture == texture) {
+      disp->stats.redundant_state_changes++;
+      return;
+   }
+
+   glBindTexture(GL_TEXTURE_2D, texture);
+   c->texture = texture;
+   c->valid |= _AL_OGL_STATE_TEXTURE;
+   disp->stats.state_changes++;
+}
+
+
+void _al_ogl_use_program(ALLEGRO_DISPLAY *disp, GLuint program)
+{
+#ifndef ALLEGRO_CFG_NO_GLES2
+   ALLEGRO_OGL_STATE_CACHE *c = &disp->ogl_extras->state_cache;
+
+   if ((c->valid & _AL_OGL_STATE_PROGRAM) && c->program == program) {
+      disp->stats.redundant_state_changes++;
+      return;
+   }
+
+   glUseProgram(program);
+   c->program = program;
+   c->projview_loc = -1;
+   if (program != 0)
+      c->projview_loc = glGetUniformLocation(program, "projview_matrix");
+   c->valid &= ~_AL_OGL_STATE_UNIFORMS;
+   c->valid |= _AL_OGL_STATE_PROGRAM;
+   disp->stats.state_changes++;
+#else
+   (void)disp;
+   (void)program;
+#endif
+}
+
+
+/* Deletes a texture.  GL may hand the name out again, so no cache may keep
+ * believing it is still bound.  With shared contexts another display can
+ * have the same name cached, so we check all of them.
+ */
+void _al_ogl_delete_texture(ALLEGRO_DISPLAY *disp, GLuint texture)
+{
+   ALLEGRO_SYSTEM *system = al_get_system_driver();
+   unsigned int i;
+
+   glDeleteTextures(1, &texture);
+
+   for (i = 0; i < _al_vector_size(&system->displays); i++) {
+      ALLEGRO_DISPLAY **d = _al_vector_ref(&system->displays, i);
+      if (!((*d)->flags & ALLEGRO_OPENGL))
+         continue;
+      if (*d != disp && !(*d)->ogl_extras->is_shared)
+         continue;
+      if ((*d)->ogl_extras->state_cache.texture == texture)
+         _al_ogl_invalidate_state_cache(*d, _AL_OGL_STATE_TEXTURE);
+   }
+}
+
+
+/* Deletes a program object, forgetting it if it is the cached program. */
+void _al_ogl_delete_program(ALLEGRO_DISPLAY *disp, GLuint program)
+{
+#ifndef ALLEGRO_CFG_NO_GLES2
+   glDeleteProgram(program);
+
+   if (!disp || !(disp->flags & ALLEGRO_OPENGL))
+      return;
+   if (disp->ogl_extras->state_cache.program == program)
+      _al_ogl_invalidate_state_cache(disp, _AL_OGL_STATE_PROGRAM);
+#else
+   (void)disp;
+   (void)program;
+#endif
+}
+
+
+/* Enables texturing: the use_tex uniform for shaders, GL_TEXTURE_2D for the
+ * fixed pipeline.
+ */
+static void set_use_tex(ALLEGRO_DISPLAY *disp, int use_tex)
+{
+   ALLEGRO_OGL_STATE_CACHE *c = uniform_cache(disp);
+
+   if (c->use_tex == use_tex) {
+      disp->stats.redundant_state_changes++;
+      return;
+   }
+
+   if (disp->flags & ALLEGRO_USE_PROGRAMMABLE_PIPELINE) {
+#ifndef ALLEGRO_CFG_NO_GLES2
+      if (disp->ogl_extras->use_tex_loc >= 0) {
+         glUniform1i(disp->ogl_extras->use_tex_loc, use_tex);
+      }
+#endif
+   }
+   else if (use_tex) {
+      glEnable(GL_TEXTURE_2D);
+   }
+   else {
+      glDisable(GL_TEXTURE_2D);
+   }
+
+   c->use_tex = use_tex;
+   disp->stats.state_changes++;
+}
+
+
+static void set_use_tex_matrix(ALLEGRO_DISPLAY *disp, int use_tex_matrix)
+{
+#ifndef ALLEGRO_CFG_NO_GLES2
+   ALLEGRO_OGL_STATE_CACHE *c = uniform_cache(disp);
+
+   if (c->use_tex_matrix == use_tex_matrix) {
+      disp->stats.redundant_state_changes++;
+      return;
+   }
+
+   if (disp->ogl_extras->use_tex_matrix_loc >= 0) {
+      glUniform1i(disp->ogl_extras->use_tex_matrix_loc, use_tex_matrix);
+   }
+   c->use_tex_matrix = use_tex_matrix;
+   disp->stats.state_changes++;
+#else
+   (void)disp;
+   (void)use_tex_matrix;
+#endif
+}
+
+
+static void set_projview(ALLEGRO_DISPLAY *disp, const ALLEGRO_TRANSFORM *t)
+{
+#ifndef ALLEGRO_CFG_NO_GLES2
+   ALLEGRO_OGL_STATE_CACHE *c = &disp->ogl_extras->state_cache;
+   GLuint program_object = disp->ogl_extras->program_object;
+
+   if (!(c->valid & _AL_OGL_STATE_PROGRAM) || c->program != program_object) {
+      /* We don't know the state of this program, do it the slow way. */
+      GLint handle = glGetUniformLocation(program_object, "projview_matrix");
+      if (handle >= 0) {
+         glUniformMatrix4fv(handle, 1, GL_FALSE, (float *)t->m);
+      }
+      disp->stats.state_changes++;
+      return;
+   }
+
+   c = uniform_cache(disp);
+   if (c->projview_loc < 0)
+      return;
+
+   if (c->projview_set && memcmp(&c->projview, t, sizeof(*t)) == 0) {
+      disp->stats.redundant_state_changes++;
+      return;
+   }
+
+   glUniformMatrix4fv(c->projview_loc, 1, GL_FALSE, (float *)t->m);
+   c->projview = *t;
+   c->projview_set = true;
+   disp->stats.state_changes++;
+#else
+   (void)disp;
+   (void)t;
+#endif
+}
+
+
 bool _al_opengl_set_blender(ALLEGRO_DISPLAY *ogl_disp)
 {
+   ALLEGRO_OGL_STATE_CACHE *c = &ogl_disp->ogl_extras->state_cache;
    int op, src_color, dst_color, op_alpha, src_alpha, dst_alpha;
    const int blend_modes[8] = {
       GL_ZERO, GL_ONE, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
@@ -36,10 +262,17 @@ bool _al_opengl_set_blender(ALLEGRO_DISPLAY *ogl_disp)
       GL_FUNC_ADD, GL_FUNC_SUBTRACT, GL_FUNC_REVERSE_SUBTRACT
    };
 
-   (void)ogl_disp;
-
    al_get_separate_blender(&op, &src_color, &dst_color,
       &op_alpha, &src_alpha, &dst_alpha);
+
+   if ((c->valid & _AL_OGL_STATE_BLENDER) &&
+         c->blender[0] == op && c->blender[1] == src_color &&
+         c->blender[2] == dst_color && c->blender[3] == op_alpha &&
+         c->blender[4] == src_alpha && c->blender[5] == dst_alpha) {
+      ogl_disp->stats.redundant_state_changes++;
+      return true;
+   }
+
    /* glBlendFuncSeparate was only included with OpenGL 1.4 */
    /* (And not in OpenGL ES) */
 #if !defined ALLEGRO_CFG_OPENGLES
@@ -70,6 +303,15 @@ bool _al_opengl_set_blender(ALLEGRO_DISPLAY *ogl_disp)
          return false;
       }
    }
+
+   c->blender[0] = op;
+   c->blender[1] = src_color;
+   c->blender[2] = dst_color;
+   c->blender[3] = op_alpha;
+   c->blender[4] = src_alpha;
+   c->blender[5] = dst_alpha;
+   c->valid |= _AL_OGL_STATE_BLENDER;
+   ogl_disp->stats.state_changes++;
    return true;
 }
 
@@ -228,9 +470,12 @@ static void ogl_clear(ALLEGRO_DISPLAY *d, ALLEGRO_COLOR *color)
       }
 
       glDisable(GL_TEXTURE_2D);
-      glBindTexture(GL_TEXTURE_2D, 0);
+      _al_ogl_invalidate_state_cache(d, _AL_OGL_STATE_UNIFORMS);
+      _al_ogl_bind_texture(d, 0);
 
       glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+      d->stats.draw_calls++;
+      d->stats.vertices += 4;
 
       vert_ptr_off(d);
       color_ptr_off(d);
@@ -286,6 +531,8 @@ static void ogl_draw_pixel(ALLEGRO_DISPLAY *d, float x, float y,
    }
 
    glDrawArrays(GL_POINTS, 0, 1);
+   d->stats.draw_calls++;
+   d->stats.vertices++;
 
    vert_ptr_off(d);
    color_ptr_off(d);
@@ -311,42 +558,34 @@ static void* ogl_prepare_vertex_cache(ALLEGRO_DISPLAY* disp,
 
 static void ogl_flush_vertex_cache(ALLEGRO_DISPLAY *disp)
 {
-   GLuint current_texture;
    ALLEGRO_OGL_EXTRAS *o = disp->ogl_extras;
-   (void)o; /* not used in all ports */
+   ALLEGRO_OGL_STATE_CACHE *c = &o->state_cache;
    
    if (!disp->vertex_cache)
       return;
    if (disp->num_cache_vertices == 0)
       return;
 
+   _AL_PROFILE_BEGIN("ogl_flush_vertex_cache");
+
+   set_use_tex(disp, 1);
    if (disp->flags & ALLEGRO_USE_PROGRAMMABLE_PIPELINE) {
-#ifndef ALLEGRO_CFG_NO_GLES2
-      if (disp->ogl_extras->use_tex_loc >= 0) {
-         glUniform1i(disp->ogl_extras->use_tex_loc, 1);
-      }
-      if (disp->ogl_extras->use_tex_matrix_loc >= 0) {
-         glUniform1i(disp->ogl_extras->use_tex_matrix_loc, 0);
-      }
-#endif
-   }
-   else {
-      glEnable(GL_TEXTURE_2D);
-   }
+      set_use_tex_matrix(disp, 0);
 
-   glGetIntegerv(GL_TEXTURE_BINDING_2D, (GLint*)&current_texture);
-   if (current_texture != disp->cache_texture) {
-      if (disp->flags & ALLEGRO_USE_PROGRAMMABLE_PIPELINE) {
 #ifndef ALLEGRO_CFG_NO_GLES2
-         /* Use texture unit 0 */
+      /* Use texture unit 0 */
+      if (!c->tex_unit_set) {
          glActiveTexture(GL_TEXTURE0);
-         if (disp->ogl_extras->tex_loc >= 0)
-            glUniform1i(disp->ogl_extras->tex_loc, 0);
-#endif
+         if (o->tex_loc >= 0)
+            glUniform1i(o->tex_loc, 0);
+         c->tex_unit_set = true;
+         disp->stats.state_changes++;
       }
-      glBindTexture(GL_TEXTURE_2D, disp->cache_texture);
+#endif
    }
 
+   _al_ogl_bind_texture(disp, disp->cache_texture);
+
 #if !defined ALLEGRO_CFG_OPENGLES && !defined ALLEGRO_MACOSX
    if (disp->flags & ALLEGRO_USE_PROGRAMMABLE_PIPELINE) {
       int stride = sizeof(ALLEGRO_OGL_BITMAP_VERTEX);
@@ -369,24 +608,45 @@ static void ogl_flush_vertex_cache(ALLEGRO_DISPLAY *disp)
       glBufferData(GL_ARRAY_BUFFER, bytes, disp->vertex_cache, GL_STREAM_DRAW);
 
       /* Finally set the "pos", "texccord" and "color" attributes used by our
-       * shader and enable them.
+       * shader and enable them.  This is VAO state, and only this code uses
+       * our VAO, so it only needs doing when the locations change.
        */
-      if (o->pos_loc >= 0)  {
-         glVertexAttribPointer(o->pos_loc, 2, GL_FLOAT, false, stride,
-            (void *)offsetof(ALLEGRO_OGL_BITMAP_VERTEX, x));
-         glEnableVertexAttribArray(o->pos_loc);
-      }
-
-      if (o->texcoord_loc >= 0) {
-         glVertexAttribPointer(o->texcoord_loc, 2, GL_FLOAT, false, stride,
-            (void *)offsetof(ALLEGRO_OGL_BITMAP_VERTEX, tx));
-         glEnableVertexAttribArray(o->texcoord_loc);
+      if (c->vao_set &&
+            c->vao_locs[0] == o->pos_loc &&
+            c->vao_locs[1] == o->texcoord_loc &&
+            c->vao_locs[2] == o->color_loc) {
+         disp->stats.redundant_state_changes++;
       }
-      
-      if (o->color_loc >= 0) {
-         glVertexAttribPointer(o->color_loc, 4, GL_FLOAT, false, stride,
-            (void *)offsetof(ALLEGRO_OGL_BITMAP_VERTEX, r));
-         glEnableVertexAttribArray(o->color_loc);
+      else {
+         int i;
+         for (i = 0; c->vao_set && i < 3; i++) {
+            if (c->vao_locs[i] >= 0)
+               glDisableVertexAttribArray(c->vao_locs[i]);
+         }
+
+         if (o->pos_loc >= 0)  {
+            glVertexAttribPointer(o->pos_loc, 2, GL_FLOAT, false, stride,
+               (void *)offsetof(ALLEGRO_OGL_BITMAP_VERTEX, x));
+            glEnableVertexAttribArray(o->pos_loc);
+         }
+
+         if (o->texcoord_loc >= 0) {
+            glVertexAttribPointer(o->texcoord_loc, 2, GL_FLOAT, false, stride,
+               (void *)offsetof(ALLEGRO_OGL_BITMAP_VERTEX, tx));
+            glEnableVertexAttribArray(o->texcoord_loc);
+         }
+         
+         if (o->color_loc >= 0) {
+            glVertexAttribPointer(o->color_loc, 4, GL_FLOAT, false, stride,
+               (void *)offsetof(ALLEGRO_OGL_BITMAP_VERTEX, r));
+            glEnableVertexAttribArray(o->color_loc);
+         }
+
+         c->vao_locs[0] = o->pos_loc;
+         c->vao_locs[1] = o->texcoord_loc;
+         c->vao_locs[2] = o->color_loc;
+         c->vao_set = true;
+         disp->stats.state_changes++;
       }
    }
    else
@@ -404,6 +664,8 @@ static void ogl_flush_vertex_cache(ALLEGRO_DISPLAY *disp)
    }
 
    glDrawArrays(GL_TRIANGLES, 0, disp->num_cache_vertices);
+   disp->stats.draw_calls++;
+   disp->stats.vertices += disp->num_cache_vertices;
 
 #ifdef DEBUGMODE
    {
@@ -416,9 +678,7 @@ static void ogl_flush_vertex_cache(ALLEGRO_DISPLAY *disp)
 
 #if !defined ALLEGRO_CFG_OPENGLES && !defined ALLEGRO_MACOSX
    if (disp->flags & ALLEGRO_USE_PROGRAMMABLE_PIPELINE) {
-      if (o->pos_loc >= 0) glDisableVertexAttribArray(o->pos_loc);
-      if (o->texcoord_loc >= 0) glDisableVertexAttribArray(o->texcoord_loc);
-      if (o->color_loc >= 0) glDisableVertexAttribArray(o->color_loc);
+      /* The attribute arrays stay enabled inside our VAO. */
       glBindBuffer(GL_ARRAY_BUFFER, 0);
       glBindVertexArray(0);
    }
@@ -432,15 +692,10 @@ static void ogl_flush_vertex_cache(ALLEGRO_DISPLAY *disp)
 
    disp->num_cache_vertices = 0;
 
-   if (disp->flags & ALLEGRO_USE_PROGRAMMABLE_PIPELINE) {
-#ifndef ALLEGRO_CFG_NO_GLES2
-      if (disp->ogl_extras->use_tex_loc >= 0)
-         glUniform1i(disp->ogl_extras->use_tex_loc, 0);
-#endif
-   }
-   else {
-      glDisable(GL_TEXTURE_2D);
-   }
+   _AL_PROFILE_END();
+
+   /* Other drawing code expects texturing to be off. */
+   set_use_tex(disp, 0);
 }
 
 static void ogl_update_transformation(ALLEGRO_DISPLAY* disp,
@@ -458,7 +713,6 @@ static void ogl_update_transformation(ALLEGRO_DISPLAY* disp,
    if (disp->flags & ALLEGRO_USE_PROGRAMMABLE_PIPELINE) {
 #ifndef ALLEGRO_CFG_NO_GLES2
       GLuint program_object = disp->ogl_extras->program_object;
-      GLint handle;
       
       // FIXME: In al_create_display we have no shader yet
       if (program_object == 0)
@@ -468,10 +722,7 @@ static void ogl_update_transformation(ALLEGRO_DISPLAY* disp,
 
       al_compose_transform(&tmp, &disp->proj_transform);
 
-      handle = glGetUniformLocation(program_object, "projview_matrix");
-      if (handle >= 0) {
-         glUniformMatrix4fv(handle, 1, GL_FALSE, (float *)tmp.m);
-      }
+      set_projview(disp, &tmp);
 #endif
    }
    else {
@@ -485,19 +736,15 @@ static void ogl_set_projection(ALLEGRO_DISPLAY *d)
    if (d->flags & ALLEGRO_USE_PROGRAMMABLE_PIPELINE) {
 #ifndef ALLEGRO_CFG_NO_GLES2
       GLuint program_object = d->ogl_extras->program_object;
-      GLint handle;
+      ALLEGRO_TRANSFORM t;
 
       // FIXME: In al_create_display we have no shader yet
       if (program_object == 0)
          return;
 
-      handle = glGetUniformLocation(program_object, "projview_matrix");
-      if (handle >= 0) {
-         ALLEGRO_TRANSFORM t;
-         al_copy_transform(&t, &d->view_transform);
-         al_compose_transform(&t, &d->proj_transform);
-         glUniformMatrix4fv(handle, 1, false, (float *)t.m);
-      }
+      al_copy_transform(&t, &d->view_transform);
+      al_compose_transform(&t, &d->proj_transform);
+      set_projview(d, &t);
 #endif
    }
    else {
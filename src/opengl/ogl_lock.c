@@ -13,6 +13,8 @@
  *      See LICENSE.txt for copyright information.
  */
 
+#include <string.h>
+
 #include "allegro5/allegro.h"
 #include "allegro5/allegro_opengl.h"
 #include "allegro5/internal/aintern.h"
@@ -32,6 +34,10 @@ ALLEGRO_DEBUG_CHANNEL("opengl")
 
 #define get_glformat(f, c) _al_ogl_get_glformat((f), (c))
 
+/* How long _al_ogl_finish_lock_new waits for an asynchronous readback. */
+#define FENCE_WAIT_NS      1000000000
+#define FENCE_WAIT_TRIES   5
+
 
 /*
  * Helpers - duplicates code in ogl_bitmap.c for now
@@ -68,6 +74,126 @@ static bool exactly_15bpp(int pixel_format)
       || pixel_format == ALLEGRO_PIXEL_FORMAT_BGR_555;
 }
 
+/* Make the context of the bitmap's display current if it is not usable
+ * already.  Returns the display to restore afterwards, or NULL.
+ */
+static ALLEGRO_DISPLAY *use_bitmap_context(ALLEGRO_BITMAP *bitmap)
+{
+   ALLEGRO_DISPLAY *disp = al_get_current_display();
+
+   if (!disp ||
+      (bitmap->display->ogl_extras->is_shared == false &&
+       bitmap->display != disp))
+   {
+      _al_set_current_display_only(bitmap->display);
+      return disp;
+   }
+   return NULL;
+}
+
+static bool has_pbo(ALLEGRO_BITMAP *bitmap)
+{
+   return bitmap->display->ogl_extras->extension_list
+      ->ALLEGRO_GL_ARB_pixel_buffer_object;
+}
+
+/* Allocate the buffer that a lock reads the pixels into.  If the lock is
+ * asynchronous the pixels go into the bitmap's pixel pack buffer instead,
+ * which glReadPixels and glGetTexImage address by offset, and NULL is
+ * returned.
+ */
+static unsigned char *alloc_lock_buffer(
+   ALLEGRO_BITMAP_EXTRA_OPENGL *ogl_bitmap, int size)
+{
+   ogl_bitmap->lock_size = size;
+
+   if (ogl_bitmap->lock_pbo) {
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, ogl_bitmap->lock_pbo);
+      glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+      ogl_bitmap->lock_buffer = NULL;
+   }
+   else {
+      ogl_bitmap->lock_buffer = al_malloc(size);
+   }
+
+   return ogl_bitmap->lock_buffer;
+}
+
+static void set_locked_region(ALLEGRO_BITMAP *bitmap,
+   ALLEGRO_BITMAP_EXTRA_OPENGL *ogl_bitmap, int offset, int format, int pitch)
+{
+   ogl_bitmap->lock_offset = offset;
+   if (ogl_bitmap->lock_buffer)
+      bitmap->locked_region.data = ogl_bitmap->lock_buffer + offset;
+   else
+      bitmap->locked_region.data = NULL;
+   bitmap->locked_region.format = format;
+   bitmap->locked_region.pitch = -pitch;
+   bitmap->locked_region.pixel_size = al_get_pixel_size(format);
+}
+
+/* Write-only locks in the texture's own format are written straight into a
+ * pixel unpack buffer so that the upload on unlock does not block.  The
+ * buffers come from a small per-display ring and are orphaned before being
+ * mapped, so we never wait for an earlier upload from the same buffer.
+ */
+static bool map_upload_pbo(ALLEGRO_BITMAP *bitmap,
+   ALLEGRO_BITMAP_EXTRA_OPENGL *ogl_bitmap, int format, int size)
+{
+   ALLEGRO_OGL_EXTRAS *extras = bitmap->display->ogl_extras;
+   GLuint pbo;
+   void *ptr;
+   int i;
+
+   if (!has_pbo(bitmap) || format != bitmap->format)
+      return false;
+
+   if (extras->upload_pbos[0] == 0) {
+      glGenBuffers(ALLEGRO_MAX_OPENGL_UPLOAD_PBOS, extras->upload_pbos);
+   }
+
+   /* Skip buffers still mapped by other locks. */
+   for (i = 0; i < ALLEGRO_MAX_OPENGL_UPLOAD_PBOS; i++) {
+      if (!(extras->upload_pbos_mapped & (1 << extras->next_upload_pbo)))
+         break;
+      extras->next_upload_pbo =
+         (extras->next_upload_pbo + 1) % ALLEGRO_MAX_OPENGL_UPLOAD_PBOS;
+   }
+   if (i == ALLEGRO_MAX_OPENGL_UPLOAD_PBOS)
+      return false;
+
+   i = extras->next_upload_pbo;
+   pbo = extras->upload_pbos[i];
+
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+   glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+   ptr = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+   if (!ptr) {
+      ALLEGRO_WARN("glMapBuffer failed (%s), not using a PBO.\n",
+         _al_gl_error_string(glGetError()));
+      return false;
+   }
+
+   extras->upload_pbos_mapped |= 1 << i;
+   extras->next_upload_pbo = (i + 1) % ALLEGRO_MAX_OPENGL_UPLOAD_PBOS;
+   ogl_bitmap->lock_buffer = ptr;
+   ogl_bitmap->lock_pbo = pbo;
+   ogl_bitmap->lock_size = size;
+   return true;
+}
+
+static void release_upload_pbo(ALLEGRO_BITMAP *bitmap, GLuint pbo)
+{
+   ALLEGRO_OGL_EXTRAS *extras = bitmap->display->ogl_extras;
+   int i;
+
+   for (i = 0; i < ALLEGRO_MAX_OPENGL_UPLOAD_PBOS; i++) {
+      if (extras->upload_pbos[i] == pbo)
+         extras->upload_pbos_mapped &= ~(1 << i);
+   }
+}
+
 
 
 /*
@@ -91,29 +217,32 @@ static void ogl_lock_region_nonbb_readwrite_nonfbo(
    int x, int gl_y, int w, int h, int format);
 
 
-ALLEGRO_LOCKED_REGION *_al_ogl_lock_region_new(ALLEGRO_BITMAP *bitmap,
-   int x, int y, int w, int h, int format, int flags)
+/* If async is true the pixels are read back into the bitmap's pixel pack
+ * buffer, followed by a fence, and the region is only available after
+ * _al_ogl_finish_lock_new.
+ */
+static void ogl_lock_region(ALLEGRO_BITMAP *bitmap,
+   int x, int y, int w, int h, int format, int flags, bool async)
 {
    ALLEGRO_BITMAP_EXTRA_OPENGL * const ogl_bitmap = bitmap->extra;
    const GLint gl_y = bitmap->h - y - h;
-   ALLEGRO_DISPLAY *disp;
-   ALLEGRO_DISPLAY *old_disp = NULL;
+   ALLEGRO_DISPLAY *old_disp;
    GLenum e;
 
    if (format == ALLEGRO_PIXEL_FORMAT_ANY) {
       format = bitmap->format;
    }
 
-   disp = al_get_current_display();
-   format = _al_get_real_pixel_format(disp, format);
+   format = _al_get_real_pixel_format(al_get_current_display(), format);
 
    /* Change OpenGL context if necessary. */
-   if (!disp ||
-      (bitmap->display->ogl_extras->is_shared == false &&
-       bitmap->display != disp))
-   {
-      old_disp = disp;
-      _al_set_current_display_only(bitmap->display);
+   old_disp = use_bitmap_context(bitmap);
+
+   ogl_bitmap->lock_pbo = 0;
+   if (async) {
+      if (ogl_bitmap->readback_pbo == 0)
+         glGenBuffers(1, &ogl_bitmap->readback_pbo);
+      ogl_bitmap->lock_pbo = ogl_bitmap->readback_pbo;
    }
 
    /* Set up the pixel store state.  We will need to match it when unlocking.
@@ -149,12 +278,138 @@ ALLEGRO_LOCKED_REGION *_al_ogl_lock_region_new(ALLEGRO_BITMAP *bitmap,
          x, gl_y, w, h, format);
    }
 
+   if (async) {
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+      if (bitmap->display->ogl_extras->extension_list->ALLEGRO_GL_ARB_sync) {
+         ogl_bitmap->readback_fence =
+            glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      }
+      /* Make sure the readback actually gets started. */
+      glFlush();
+   }
+
    glPopClientAttrib();
 
    if (old_disp != NULL) {
       _al_set_current_display_only(old_disp);
    }
+}
+
+
+ALLEGRO_LOCKED_REGION *_al_ogl_lock_region_new(ALLEGRO_BITMAP *bitmap,
+   int x, int y, int w, int h, int format, int flags)
+{
+   ogl_lock_region(bitmap, x, y, w, h, format, flags, false);
+   return &bitmap->locked_region;
+}
+
+
+bool _al_ogl_lock_region_async_new(ALLEGRO_BITMAP *bitmap,
+   int x, int y, int w, int h, int format, int flags)
+{
+   ASSERT(!(flags & ALLEGRO_LOCK_WRITEONLY));
+
+   if (!has_pbo(bitmap))
+      return false;
+
+   ogl_lock_region(bitmap, x, y, w, h, format, flags, true);
+   return true;
+}
+
+
+bool _al_ogl_is_lock_ready_new(ALLEGRO_BITMAP *bitmap)
+{
+   ALLEGRO_BITMAP_EXTRA_OPENGL * const ogl_bitmap = bitmap->extra;
+   ALLEGRO_DISPLAY *old_disp;
+   GLenum status;
+
+   /* Without fences there is nothing to query; mapping will wait. */
+   if (!ogl_bitmap->readback_fence)
+      return true;
+
+   old_disp = use_bitmap_context(bitmap);
+   status = glClientWaitSync(ogl_bitmap->readback_fence, 0, 0);
+   if (old_disp) {
+      _al_set_current_display_only(old_disp);
+   }
+
+   return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
 
+
+ALLEGRO_LOCKED_REGION *_al_ogl_finish_lock_new(ALLEGRO_BITMAP *bitmap)
+{
+   ALLEGRO_BITMAP_EXTRA_OPENGL * const ogl_bitmap = bitmap->extra;
+   ALLEGRO_DISPLAY *old_disp;
+   unsigned char *ptr;
+
+   old_disp = use_bitmap_context(bitmap);
+
+   if (ogl_bitmap->readback_fence) {
+      GLenum status = GL_TIMEOUT_EXPIRED;
+      int tries;
+
+      /* Give up on a readback which does not complete, e.g. after the
+       * context was lost, rather than hanging.
+       */
+      for (tries = 0; tries < FENCE_WAIT_TRIES; tries++) {
+         status = glClientWaitSync(ogl_bitmap->readback_fence,
+            GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_NS);
+         if (status != GL_TIMEOUT_EXPIRED)
+            break;
+      }
+      glDeleteSync(ogl_bitmap->readback_fence);
+      ogl_bitmap->readback_fence = NULL;
+
+      if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+         ogl_bitmap->lock_pbo = 0;
+         if (old_disp) {
+            _al_set_current_display_only(old_disp);
+         }
+         ALLEGRO_ERROR("Readback for the lock did not complete.\n");
+         return NULL;
+      }
+   }
+
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, ogl_bitmap->lock_pbo);
+   ptr = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+   if (ptr && !(bitmap->lock_flags & ALLEGRO_LOCK_READONLY)) {
+      /* The caller may modify the pixels, so they need a buffer of their
+       * own to be uploaded from when unlocking.
+       */
+      ogl_bitmap->lock_buffer = al_malloc(ogl_bitmap->lock_size);
+      if (ogl_bitmap->lock_buffer) {
+         memcpy(ogl_bitmap->lock_buffer, ptr, ogl_bitmap->lock_size);
+      }
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+      ogl_bitmap->lock_pbo = 0;
+   }
+   else {
+      ogl_bitmap->lock_buffer = ptr;
+   }
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+   if (old_disp) {
+      _al_set_current_display_only(old_disp);
+   }
+
+   if (ptr && !ogl_bitmap->lock_buffer) {
+      /* The caller unlocks the bitmap when we fail. */
+      ALLEGRO_ERROR("Out of memory for the locked region.\n");
+      al_set_errno(ENOMEM);
+      return NULL;
+   }
+
+   if (!ptr) {
+      ALLEGRO_WARN("Could not map the readback buffer, locking again.\n");
+      ogl_lock_region(bitmap, bitmap->lock_x, bitmap->lock_y,
+         bitmap->lock_w, bitmap->lock_h, bitmap->locked_region.format,
+         bitmap->lock_flags, false);
+      return &bitmap->locked_region;
+   }
+
+   bitmap->locked_region.data = ogl_bitmap->lock_buffer +
+      ogl_bitmap->lock_offset;
    return &bitmap->locked_region;
 }
 
@@ -165,15 +420,16 @@ static void ogl_lock_region_backbuffer(
 {
    const int pixel_size = al_get_pixel_size(format);
    const int pitch = ogl_pitch(w, pixel_size);
+   unsigned char *buf;
    GLenum e;
 
-   ogl_bitmap->lock_buffer = al_malloc(pitch * h);
+   buf = alloc_lock_buffer(ogl_bitmap, pitch * h);
 
    if (!(flags & ALLEGRO_LOCK_WRITEONLY)) {
       glReadPixels(x, gl_y, w, h,
          get_glformat(format, 2),
          get_glformat(format, 1),
-         ogl_bitmap->lock_buffer);
+         buf);
       e = glGetError();
       if (e) {
          ALLEGRO_ERROR("glReadPixels for format %s failed (%s).\n",
@@ -181,10 +437,7 @@ static void ogl_lock_region_backbuffer(
       }
    }
 
-   bitmap->locked_region.data = ogl_bitmap->lock_buffer + pitch * (h - 1);
-   bitmap->locked_region.format = format;
-   bitmap->locked_region.pitch = -pitch;
-   bitmap->locked_region.pixel_size = pixel_size;
+   set_locked_region(bitmap, ogl_bitmap, pitch * (h - 1), format, pitch);
 }
 
 
@@ -197,11 +450,10 @@ static void ogl_lock_region_nonbb_writeonly(
    (void) x;
    (void) gl_y;
 
-   ogl_bitmap->lock_buffer = al_malloc(pitch * h);
-   bitmap->locked_region.data = ogl_bitmap->lock_buffer + pitch * (h - 1);
-   bitmap->locked_region.format = format;
-   bitmap->locked_region.pitch = -pitch;
-   bitmap->locked_region.pixel_size = pixel_size;
+   if (!map_upload_pbo(bitmap, ogl_bitmap, format, pitch * h)) {
+      alloc_lock_buffer(ogl_bitmap, pitch * h);
+   }
+   set_locked_region(bitmap, ogl_bitmap, pitch * (h - 1), format, pitch);
 }
 
 
@@ -243,6 +495,7 @@ static void ogl_lock_region_nonbb_readwrite_fbo(
 {
    const int pixel_size = al_get_pixel_size(format);
    const int pitch = ogl_pitch(w, pixel_size);
+   unsigned char *buf;
    GLint old_fbo;
    GLenum e;
 
@@ -250,12 +503,12 @@ static void ogl_lock_region_nonbb_readwrite_fbo(
 
    glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, ogl_bitmap->fbo_info->fbo);
 
-   ogl_bitmap->lock_buffer = al_malloc(pitch * h);
+   buf = alloc_lock_buffer(ogl_bitmap, pitch * h);
 
    glReadPixels(x, gl_y, w, h,
       get_glformat(format, 2),
       get_glformat(format, 1),
-      ogl_bitmap->lock_buffer);
+      buf);
 
    e = glGetError();
    if (e) {
@@ -265,10 +518,7 @@ static void ogl_lock_region_nonbb_readwrite_fbo(
 
    glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, old_fbo);
 
-   bitmap->locked_region.data = ogl_bitmap->lock_buffer + pitch * (h - 1);
-   bitmap->locked_region.format = format;
-   bitmap->locked_region.pitch = -pitch;
-   bitmap->locked_region.pixel_size = pixel_size;
+   set_locked_region(bitmap, ogl_bitmap, pitch * (h - 1), format, pitch);
 }
 
 
@@ -279,16 +529,17 @@ static void ogl_lock_region_nonbb_readwrite_nonfbo(
    /* No FBO - fallback to reading the entire texture */
    const int pixel_size = al_get_pixel_size(format);
    const int pitch = ogl_pitch(ogl_bitmap->true_w, pixel_size);
+   unsigned char *buf;
    GLenum e;
    (void) w;
 
-   ogl_bitmap->lock_buffer = al_malloc(pitch * ogl_bitmap->true_h);
+   buf = alloc_lock_buffer(ogl_bitmap, pitch * ogl_bitmap->true_h);
 
-   glBindTexture(GL_TEXTURE_2D, ogl_bitmap->texture);
+   _al_ogl_bind_texture(al_get_current_display(), ogl_bitmap->texture);
    glGetTexImage(GL_TEXTURE_2D, 0,
       get_glformat(format, 2),
       get_glformat(format, 1),
-      ogl_bitmap->lock_buffer);
+      buf);
 
    e = glGetError();
    if (e) {
@@ -296,11 +547,8 @@ static void ogl_lock_region_nonbb_readwrite_nonfbo(
          _al_format_name(format), _al_gl_error_string(e));
    }
 
-   bitmap->locked_region.data = ogl_bitmap->lock_buffer +
-      pitch * (gl_y + h - 1) + pixel_size * x;
-   bitmap->locked_region.format = format;
-   bitmap->locked_region.pitch = -pitch;
-   bitmap->locked_region.pixel_size = pixel_size;
+   set_locked_region(bitmap, ogl_bitmap,
+      pitch * (gl_y + h - 1) + pixel_size * x, format, pitch);
 }
 
 
@@ -321,6 +569,8 @@ static void ogl_unlock_region_nonbb_fbo_readwrite(ALLEGRO_BITMAP *bitmap,
    ALLEGRO_BITMAP_EXTRA_OPENGL *ogl_bitmap, int gl_y);
 static void ogl_unlock_region_nonbb_nonfbo(ALLEGRO_BITMAP *bitmap,
    ALLEGRO_BITMAP_EXTRA_OPENGL *ogl_bitmap, int gl_y);
+static void ogl_unlock_region_nonbb_pbo(ALLEGRO_BITMAP *bitmap,
+   ALLEGRO_BITMAP_EXTRA_OPENGL *ogl_bitmap, int gl_y);
 
 
 void _al_ogl_unlock_region_new(ALLEGRO_BITMAP *bitmap)
@@ -329,12 +579,25 @@ void _al_ogl_unlock_region_new(ALLEGRO_BITMAP *bitmap)
 
    if (bitmap->lock_flags & ALLEGRO_LOCK_READONLY) {
       ALLEGRO_DEBUG("Unlocking non-backbuffer READONLY\n");
+      if (ogl_bitmap->lock_pbo) {
+         /* The readback buffer of an asynchronous lock is still mapped. */
+         ALLEGRO_DISPLAY *old_disp = use_bitmap_context(bitmap);
+         glBindBuffer(GL_PIXEL_PACK_BUFFER, ogl_bitmap->lock_pbo);
+         glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+         glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+         if (old_disp) {
+            _al_set_current_display_only(old_disp);
+         }
+      }
    }
    else {
       ogl_unlock_region_non_readonly(bitmap, ogl_bitmap);
    }
 
-   al_free(ogl_bitmap->lock_buffer);
+   if (ogl_bitmap->lock_pbo)
+      ogl_bitmap->lock_pbo = 0;
+   else
+      al_free(ogl_bitmap->lock_buffer);
    ogl_bitmap->lock_buffer = NULL;
 }
 
@@ -387,8 +650,12 @@ static void ogl_unlock_region_non_readonly(ALLEGRO_BITMAP *bitmap,
       ogl_unlock_region_backbuffer(bitmap, ogl_bitmap, gl_y);
    }
    else {
-      glBindTexture(GL_TEXTURE_2D, ogl_bitmap->texture);
-      if (ogl_bitmap->fbo_info) {
+      _al_ogl_bind_texture(al_get_current_display(), ogl_bitmap->texture);
+      if (ogl_bitmap->lock_pbo) {
+         ALLEGRO_DEBUG("Unlocking non-backbuffer (PBO)\n");
+         ogl_unlock_region_nonbb_pbo(bitmap, ogl_bitmap, gl_y);
+      }
+      else if (ogl_bitmap->fbo_info) {
          ALLEGRO_DEBUG("Unlocking non-backbuffer (FBO)\n");
          ogl_unlock_region_nonbb_fbo(bitmap, ogl_bitmap, gl_y, orig_format);
       }
@@ -439,7 +706,7 @@ static void ogl_unlock_region_backbuffer(ALLEGRO_BITMAP *bitmap,
       // separate OpenGL <= 2 (including OpenGL ES 1) and OpenGL >= 3 (including
       // OpenGL ES >= 2) drivers at some point.
       glGetIntegerv(GL_CURRENT_PROGRAM, &program);
-      glUseProgram(0);
+      _al_ogl_use_program(display, 0);
    }
 
    /* glWindowPos2i may not be available. */
@@ -463,6 +730,8 @@ static void ogl_unlock_region_backbuffer(ALLEGRO_BITMAP *bitmap,
 
    glDisable(GL_TEXTURE_2D);
    glDisable(GL_BLEND);
+   _al_ogl_invalidate_state_cache(display,
+      _AL_OGL_STATE_BLENDER | _AL_OGL_STATE_UNIFORMS);
    glDrawPixels(bitmap->lock_w, bitmap->lock_h,
       get_glformat(lock_format, 2),
       get_glformat(lock_format, 1),
@@ -478,7 +747,7 @@ static void ogl_unlock_region_backbuffer(ALLEGRO_BITMAP *bitmap,
    }
 
    if (program != 0) {
-      glUseProgram(program);
+      _al_ogl_use_program(display, program);
    }
 }
 
@@ -592,6 +861,35 @@ static void ogl_unlock_region_nonbb_nonfbo(ALLEGRO_BITMAP *bitmap,
 }
 
 
+
+static void ogl_unlock_region_nonbb_pbo(ALLEGRO_BITMAP *bitmap,
+   ALLEGRO_BITMAP_EXTRA_OPENGL *ogl_bitmap, int gl_y)
+{
+   const int lock_format = bitmap->locked_region.format;
+   GLenum e;
+
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ogl_bitmap->lock_pbo);
+   glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+   /* With an unpack buffer bound the pointer is an offset into it. */
+   glTexSubImage2D(GL_TEXTURE_2D, 0,
+      bitmap->lock_x, gl_y,
+      bitmap->lock_w, bitmap->lock_h,
+      get_glformat(lock_format, 2),
+      get_glformat(lock_format, 1),
+      NULL);
+
+   e = glGetError();
+   if (e) {
+      ALLEGRO_ERROR("glTexSubImage2D from PBO for format %s failed (%s).\n",
+         _al_format_name(lock_format), _al_gl_error_string(e));
+   }
+
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+   release_upload_pbo(bitmap, ogl_bitmap->lock_pbo);
+}
+
+
 #endif
 
 /* vim: set sts=3 sw=3 et: */
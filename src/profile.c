@@ -0,0 +1,464 @@
+/*         ______   ___    ___
+ *        /\  _  \ /\_ \  /\_ \
+ *        \ \ \L\ \\//\ \ \//\ \      __     __   _ __   ___
+ *         \ \  __ \ \ \ \  \ \ \   /'__`\ /'_ `\/\`'__\/ __`\
+ *          \ \ \/\ \ \_\ \_ \_\ \_/\  __//\ \L\ \ \ \//\ \L\ \
+ *           \ \_\ \_\/\____\/\____\ \____\ \____ \ \_\\ \____/
+ *            \/_/\/_/\/____/\/____/\/____/\/___L\ \/_/ \/___/
+ *                                           /\____/
+ *                                           \_/__/
+ *
+ *      Scope profiler, with export to the Chrome trace event format.
+ *
+ *      See readme.txt for copyright information.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "allegro5/allegro.h"
+#include "allegro5/internal/aintern.h"
+#include "allegro5/internal/aintern_profile.h"
+#include "allegro5/internal/aintern_thread.h"
+#include "allegro5/internal/aintern_tls.h"
+#include "allegro5/internal/aintern_vector.h"
+
+ALLEGRO_DEBUG_CHANNEL("profile")
+
+
+/* Non-zero while scopes are being recorded. */
+int _al_profiling = 0;
+
+
+#ifdef ALLEGRO_CFG_PROFILER
+
+#define PROFILE_MAX_DEPTH        64
+#define PROFILE_DEFAULT_EVENTS   16384
+
+
+typedef struct PROFILE_EVENT
+{
+   const char *name;
+   double start;
+   double duration;
+} PROFILE_EVENT;
+
+
+/* The recording for one thread.  Scopes are opened and closed by the
+ * owning thread only, without locking.  Closed scopes go into a ring of
+ * the most recent events, which the mutex guards against al_save_profile
+ * reading it from another thread.
+ */
+struct _AL_PROFILE_THREAD
+{
+   int id;
+   int epoch;
+
+   /* Open scopes.  `depth' keeps counting past the arrays so that the
+    * matching ends are still recognised.
+    */
+   const char *names[PROFILE_MAX_DEPTH];
+   double starts[PROFILE_MAX_DEPTH];
+   int depth;
+
+   _AL_MUTEX mutex;
+   PROFILE_EVENT *events;
+   int capacity;
+   uint64_t count;
+};
+
+
+static struct
+{
+   bool initialised;
+   _AL_MUTEX mutex;
+   /* struct _AL_PROFILE_THREAD * */
+   _AL_VECTOR threads;
+   /* Bumped whenever profiling is switched on, to discard scopes which
+    * were left open from an earlier run.
+    */
+   int epoch;
+   int capacity;
+   double origin;
+   ALLEGRO_USTR *save_file;
+} profile;
+
+
+
+/* The records are never freed, as other threads' TLS may still refer to
+ * them; only their events are released at shutdown.
+ */
+static struct _AL_PROFILE_THREAD *get_profile_thread(void)
+{
+   struct _AL_PROFILE_THREAD **ppt = _al_tls_get_profile_thread();
+   struct _AL_PROFILE_THREAD *pt;
+
+   if (!ppt)
+      return NULL;
+   if (*ppt)
+      return *ppt;
+
+   pt = al_calloc(1, sizeof *pt);
+   if (!pt)
+      return NULL;
+   _al_mutex_init(&pt->mutex);
+
+   _al_mutex_lock(&profile.mutex);
+   pt->epoch = profile.epoch;
+   pt->id = _al_vector_size(&profile.threads) + 1;
+   *(struct _AL_PROFILE_THREAD **)_al_vector_alloc_back(&profile.threads) = pt;
+   _al_mutex_unlock(&profile.mutex);
+
+   *ppt = pt;
+   return pt;
+}
+
+
+
+/* _al_profile_begin:
+ *  Opens a scope on the calling thread.
+ */
+void _al_profile_begin(const char *name)
+{
+   struct _AL_PROFILE_THREAD *pt = get_profile_thread();
+
+   if (!pt)
+      return;
+   if (pt->epoch != profile.epoch) {
+      pt->epoch = profile.epoch;
+      pt->depth = 0;
+   }
+
+   if (pt->depth < PROFILE_MAX_DEPTH) {
+      pt->names[pt->depth] = name;
+      pt->starts[pt->depth] = al_get_time();
+   }
+   pt->depth++;
+}
+
+
+
+/* _al_profile_end:
+ *  Closes the innermost scope opened on the calling thread and records it.
+ */
+void _al_profile_end(void)
+{
+   struct _AL_PROFILE_THREAD *pt = get_profile_thread();
+   PROFILE_EVENT *ev;
+   double now;
+
+   if (!pt)
+      return;
+   if (pt->epoch != profile.epoch) {
+      /* The scope was opened before profiling was last switched on. */
+      pt->epoch = profile.epoch;
+      pt->depth = 0;
+      return;
+   }
+   if (pt->depth == 0)
+      return;
+   if (--pt->depth >= PROFILE_MAX_DEPTH)
+      return;
+
+   now = al_get_time();
+
+   _al_mutex_lock(&pt->mutex);
+   if (!pt->events) {
+      pt->capacity = profile.capacity;
+      pt->events = al_malloc(pt->capacity * sizeof(PROFILE_EVENT));
+      pt->count = 0;
+   }
+   if (pt->events) {
+      ev = &pt->events[pt->count % pt->capacity];
+      ev->name = pt->names[pt->depth];
+      ev->start = pt->starts[pt->depth];
+      ev->duration = now - ev->start;
+      pt->count++;
+   }
+   _al_mutex_unlock(&pt->mutex);
+}
+
+
+
+static void write_json_string(ALLEGRO_FILE *f, const char *s)
+{
+   al_fputc(f, '"');
+   for (; *s; s++) {
+      unsigned char c = *s;
+      if (c == '"' || c == '\\') {
+         al_fputc(f, '\\');
+         al_fputc(f, c);
+      }
+      else if (c < 0x20) {
+         char buf[8];
+         snprintf(buf, sizeof(buf), "\\u%04x", c);
+         al_fputs(f, buf);
+      }
+      else {
+         al_fputc(f, c);
+      }
+   }
+   al_fputc(f, '"');
+}
+
+
+
+/* Writes one thread's events, oldest first.  They are copied out first so
+ * that the thread is not held up by the file writes.
+ */
+static void write_thread_events(ALLEGRO_FILE *f,
+   struct _AL_PROFILE_THREAD *pt)
+{
+   PROFILE_EVENT *copy = NULL;
+   uint64_t first;
+   int n = 0;
+   int i;
+   char buf[128];
+
+   _al_mutex_lock(&pt->mutex);
+   if (pt->events && pt->count > 0) {
+      n = pt->count < (uint64_t)pt->capacity ? (int)pt->count : pt->capacity;
+      copy = al_malloc(n * sizeof(PROFILE_EVENT));
+      if (copy) {
+         first = pt->count - n;
+         for (i = 0; i < n; i++)
+            copy[i] = pt->events[(first + i) % pt->capacity];
+      }
+   }
+   _al_mutex_unlock(&pt->mutex);
+
+   snprintf(buf, sizeof(buf), ",\n{\"name\":\"thread_name\",\"ph\":\"M\","
+      "\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+      pt->id, pt->id);
+   al_fputs(f, buf);
+
+   if (!copy)
+      return;
+
+   for (i = 0; i < n; i++) {
+      al_fputs(f, ",\n{\"name\":");
+      write_json_string(f, copy[i].name);
+      snprintf(buf, sizeof(buf), ",\"cat\":\"allegro\",\"ph\":\"X\","
+         "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+         (copy[i].start - profile.origin) * 1e6, copy[i].duration * 1e6,
+         pt->id);
+      al_fputs(f, buf);
+   }
+
+   al_free(copy);
+}
+
+
+
+static void shutdown_profiling(void)
+{
+   unsigned i;
+
+   if (profile.save_file) {
+      al_save_profile(al_cstr(profile.save_file));
+      al_ustr_free(profile.save_file);
+      profile.save_file = NULL;
+   }
+
+   _al_mutex_lock(&profile.mutex);
+   _al_profiling = 0;
+   profile.epoch++;
+   for (i = 0; i < _al_vector_size(&profile.threads); i++) {
+      struct _AL_PROFILE_THREAD **ppt = _al_vector_ref(&profile.threads, i);
+      struct _AL_PROFILE_THREAD *pt = *ppt;
+      _al_mutex_lock(&pt->mutex);
+      al_free(pt->events);
+      pt->events = NULL;
+      pt->count = 0;
+      _al_mutex_unlock(&pt->mutex);
+   }
+   _al_mutex_unlock(&profile.mutex);
+}
+
+
+
+/* _al_init_profiling:
+ *  Reads the [profile] section of the system configuration.
+ */
+void _al_init_profiling(void)
+{
+   ALLEGRO_CONFIG *config = al_get_system_config();
+   const char *v;
+
+   if (!profile.initialised) {
+      _al_mutex_init(&profile.mutex);
+      _al_vector_init(&profile.threads, sizeof(struct _AL_PROFILE_THREAD *));
+      profile.initialised = true;
+   }
+
+   profile.capacity = PROFILE_DEFAULT_EVENTS;
+   profile.origin = al_get_time();
+
+   v = al_get_config_value(config, "profile", "events");
+   if (v && atoi(v) > 0)
+      profile.capacity = atoi(v);
+
+   v = al_get_config_value(config, "profile", "file");
+   if (v && v[0])
+      profile.save_file = al_ustr_new(v);
+
+   v = al_get_config_value(config, "profile", "enabled");
+   if (v && strcmp(v, "0"))
+      al_set_profiling(true);
+
+   _al_add_exit_func(shutdown_profiling, "shutdown_profiling");
+}
+
+
+
+/* Function: al_set_profiling
+ */
+bool al_set_profiling(bool onoff)
+{
+   if (!profile.initialised)
+      return false;
+
+   _al_mutex_lock(&profile.mutex);
+   if (onoff && !_al_profiling)
+      profile.epoch++;
+   _al_profiling = onoff;
+   _al_mutex_unlock(&profile.mutex);
+
+   ALLEGRO_INFO("Profiling %s.\n", onoff ? "on" : "off");
+   return true;
+}
+
+
+
+/* Function: al_get_profiling
+ */
+bool al_get_profiling(void)
+{
+   return _al_profiling;
+}
+
+
+
+/* Function: al_profile_begin
+ */
+void al_profile_begin(const char *name)
+{
+   ASSERT(name);
+
+   if (_al_profiling)
+      _al_profile_begin(name);
+}
+
+
+
+/* Function: al_profile_end
+ */
+void al_profile_end(void)
+{
+   if (_al_profiling)
+      _al_profile_end();
+}
+
+
+
+/* Function: al_save_profile
+ */
+bool al_save_profile(const char *filename)
+{
+   ALLEGRO_FILE *f;
+   unsigned i;
+   bool ret;
+   ASSERT(filename);
+
+   if (!profile.initialised)
+      return false;
+
+   f = al_fopen(filename, "wb");
+   if (!f) {
+      ALLEGRO_ERROR("Unable to open %s for writing.\n", filename);
+      return false;
+   }
+
+   al_fputs(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+      "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+      "\"args\":{\"name\":\"Allegro\"}}");
+
+   _al_mutex_lock(&profile.mutex);
+   for (i = 0; i < _al_vector_size(&profile.threads); i++) {
+      struct _AL_PROFILE_THREAD **ppt = _al_vector_ref(&profile.threads, i);
+      write_thread_events(f, *ppt);
+   }
+   _al_mutex_unlock(&profile.mutex);
+
+   al_fputs(f, "\n]}\n");
+
+   ret = !al_ferror(f);
+   al_fclose(f);
+   return ret;
+}
+
+
+#else /* !ALLEGRO_CFG_PROFILER */
+
+
+void _al_profile_begin(const char *name)
+{
+   (void)name;
+}
+
+
+
+void _al_profile_end(void)
+{
+}
+
+
+
+void _al_init_profiling(void)
+{
+}
+
+
+
+/* The profiler was not compiled in, so the public API does nothing. */
+
+bool al_set_profiling(bool onoff)
+{
+   (void)onoff;
+   return false;
+}
+
+
+
+bool al_get_profiling(void)
+{
+   return false;
+}
+
+
+
+void al_profile_begin(const char *name)
+{
+   (void)name;
+}
+
+
+
+void al_profile_end(void)
+{
+}
+
+
+
+bool al_save_profile(const char *filename)
+{
+   (void)filename;
+   return false;
+}
+
+
+#endif /* ALLEGRO_CFG_PROFILER */
+
+
+/* vim: set sts=3 sw=3 et: */
@@ -23,9 +23,11 @@
 #include ALLEGRO_INTERNAL_HEADER
 #include "allegro5/internal/aintern_bitmap.h"
 #include "allegro5/internal/aintern_dtor.h"
+#include "allegro5/internal/aintern_memory.h"
 #include "allegro5/internal/aintern_system.h"
 #include "allegro5/internal/aintern_vector.h"
 #include "allegro5/internal/aintern_pixels.h"
+#include "allegro5/internal/aintern_profile.h"
 #include "allegro5/internal/aintern_thread.h"
 #include "allegro5/internal/aintern_timer.h"
 #include "allegro5/internal/aintern_tls.h"
@@ -234,6 +236,8 @@ bool al_install_system(int version, int (*atexit_ptr)(void (*)(void)))
 
    _al_tls_init_once();
 
+   _al_init_memory();
+
    _al_vector_init(&_al_system_interfaces, sizeof(ALLEGRO_SYSTEM_INTERFACE *));
 
    /* We want active_sysdrv->config to be available as soon as
@@ -289,6 +293,8 @@ bool al_install_system(int version, int (*atexit_ptr)(void (*)(void)))
 
    _al_init_timers();
 
+   _al_init_profiling();
+
    if (atexit_ptr && atexit_virgin) {
       atexit_ptr(al_uninstall_system);
       atexit_virgin = false;
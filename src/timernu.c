@@ -34,7 +34,11 @@
 
 /* forward declarations */
 static double timer_thread_handle_tick(double interval);
-static void timer_handle_tick(ALLEGRO_TIMER *timer);
+static void timer_handle_ticks(ALLEGRO_TIMER *timer);
+
+
+/* Maximum number of timer events emitted together. */
+#define TIMER_EVENT_BATCH  16
 
 
 struct ALLEGRO_TIMER
@@ -44,6 +48,7 @@ struct ALLEGRO_TIMER
    double speed_secs;
    int64_t count;
    double counter;		/* counts down to zero=blastoff */
+   _AL_LIST_ITEM *dtor_item;
 };
 
 
@@ -134,10 +139,8 @@ static double timer_thread_handle_tick(double interval)
 
       timer->counter -= interval;
 
-      while (timer->counter <= 0) {
-         timer_handle_tick(timer);
-         timer->counter += timer->speed_secs;
-      }
+      if (timer->counter <= 0)
+         timer_handle_ticks(timer);
 
       if ((timer->counter > 0) && (timer->counter < new_delay))
          new_delay = timer->counter;
@@ -188,7 +191,7 @@ ALLEGRO_TIMER *al_create_timer(double speed_secs)
          timer->speed_secs = speed_secs;
          timer->counter = 0;
 
-         _al_register_destructor(_al_dtor_list, timer,
+         timer->dtor_item = _al_register_destructor(_al_dtor_list, timer,
             (void (*)(void *)) al_destroy_timer);
       }
 
@@ -205,7 +208,7 @@ void al_destroy_timer(ALLEGRO_TIMER *timer)
    if (timer) {
       al_stop_timer(timer);
 
-      _al_unregister_destructor(_al_dtor_list, timer);
+      _al_unregister_destructor(_al_dtor_list, timer->dtor_item);
 
       _al_event_source_free(&timer->es);
       al_free(timer);
@@ -365,28 +368,45 @@ void al_add_timer_count(ALLEGRO_TIMER *timer, int64_t diff)
 
 
 
-/* timer_handle_tick: [timer thread]
- *  Handle a single tick.
+/* timer_handle_ticks: [timer thread]
+ *  Handle all ticks which are due for the timer, emitting their events in
+ *  batches.
  */
-static void timer_handle_tick(ALLEGRO_TIMER *timer)
+static void timer_handle_ticks(ALLEGRO_TIMER *timer)
 {
+   ALLEGRO_EVENT events[TIMER_EVENT_BATCH];
+   unsigned int num = 0;
+
    /* Lock out event source helper functions (e.g. the release hook
     * could be invoked simultaneously with this function).
     */
    _al_event_source_lock(&timer->es);
    {
-      /* Update the count.  */
-      timer->count++;
-
-      /* Generate an event, maybe.  */
-      if (_al_event_source_needs_to_generate_event(&timer->es)) {
-         ALLEGRO_EVENT event;
-         event.timer.type = ALLEGRO_EVENT_TIMER;
-         event.timer.timestamp = al_get_time();
-         event.timer.count = timer->count;
-         event.timer.error = -timer->counter;
-         _al_event_source_emit_event(&timer->es, &event);
+      bool generate = _al_event_source_needs_to_generate_event(&timer->es);
+
+      while (timer->counter <= 0) {
+         /* Update the count.  */
+         timer->count++;
+
+         /* Generate an event, maybe.  */
+         if (generate) {
+            ALLEGRO_EVENT *event = &events[num++];
+            event->timer.type = ALLEGRO_EVENT_TIMER;
+            event->timer.timestamp = al_get_time();
+            event->timer.count = timer->count;
+            event->timer.error = -timer->counter;
+
+            if (num == TIMER_EVENT_BATCH) {
+               _al_event_source_emit_events(&timer->es, events, num);
+               num = 0;
+            }
+         }
+
+         timer->counter += timer->speed_secs;
       }
+
+      if (num > 0)
+         _al_event_source_emit_events(&timer->es, events, num);
    }
    _al_event_source_unlock(&timer->es);
 }
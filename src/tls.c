@@ -42,12 +42,15 @@
 #include "allegro5/internal/aintern_display.h"
 #include "allegro5/internal/aintern_file.h"
 #include "allegro5/internal/aintern_fshook.h"
+#include "allegro5/internal/aintern_memory.h"
 #include "allegro5/internal/aintern_tls.h"
 
 #ifdef ALLEGRO_ANDROID
 #include "allegro5/internal/aintern_android.h"
 #endif
 
+ALLEGRO_DEBUG_CHANNEL("tls")
+
 #if defined(ALLEGRO_MINGW32) && !defined(ALLEGRO_CFG_DLL_TLS)
    /*
     * MinGW < 4.2.1 doesn't have builtin thread local storage, so we
@@ -99,6 +102,25 @@ typedef struct thread_local_state {
 
    /* Destructor ownership count */
    int dtor_owner_count;
+
+   /* Scratch arena for temporary strings */
+   struct _AL_USTR_ARENA *ustr_arena;
+
+   /* Message being formatted for the asynchronous trace ring */
+   char *trace_buffer;
+
+   /* Scope profiler recording for this thread */
+   struct _AL_PROFILE_THREAD *profile_thread;
+
+   /* Small object pool cache and memory statistics */
+   struct _AL_MEMORY_CACHE *memory_cache;
+
+   /* State stack for al_push_state/al_pop_state */
+   struct STATE_FRAME *state_stack;
+   int state_depth;
+   int state_size;
+   /* Lazy state groups which some frame on the stack has yet to save. */
+   int state_watch;
 } thread_local_state;
 
 
@@ -112,6 +134,23 @@ typedef struct INTERNAL_STATE {
 ALLEGRO_STATIC_ASSERT(tls, sizeof(ALLEGRO_STATE) > sizeof(INTERNAL_STATE));
 
 
+typedef struct STATE_FRAME {
+   INTERNAL_STATE state;
+   /* The groups in state.flags which have been saved so far. */
+   int saved;
+   /* Lazy groups this frame or any frame below it has yet to save. */
+   int watch;
+} STATE_FRAME;
+
+/* State which al_push_state only saves once a setter is about to change
+ * it.  The current display, target bitmap and transformation are cheap to
+ * save and can change behind our back, so they are always saved up front.
+ */
+#define LAZY_STATE (ALLEGRO_STATE_NEW_DISPLAY_PARAMETERS | \
+   ALLEGRO_STATE_NEW_BITMAP_PARAMETERS | ALLEGRO_STATE_BLENDER | \
+   ALLEGRO_STATE_NEW_FILE_INTERFACE)
+
+
 static void initialize_blender(ALLEGRO_BLENDER *b)
 {
    b->blend_op = ALLEGRO_ADD;
@@ -141,6 +180,32 @@ static void initialize_tls_values(thread_local_state *tls)
 }
 
 
+/* Frees what the thread has allocated for itself.  Called when a thread
+ * exits, where possible, so this must not use tls_get.  Nor may anything it
+ * calls look up the thread's memory cache; counted frees are given the
+ * cache explicitly, and it is destroyed last.
+ */
+static void release_tls_values(thread_local_state *tls)
+{
+   struct _AL_MEMORY_CACHE *cache = tls->memory_cache;
+
+   al_free(tls->state_stack);
+   tls->state_stack = NULL;
+   tls->state_depth = 0;
+   tls->state_size = 0;
+   tls->state_watch = 0;
+
+   _al_ustr_arena_destroy(tls->ustr_arena, cache);
+   tls->ustr_arena = NULL;
+
+   al_free(tls->trace_buffer);
+   tls->trace_buffer = NULL;
+
+   _al_memory_cache_destroy(cache);
+   tls->memory_cache = NULL;
+}
+
+
 // FIXME: The TLS implementation below only works for dynamic linking
 // right now - instead of using DllMain we should simply initialize
 // on first request.
@@ -157,12 +222,26 @@ static void initialize_tls_values(thread_local_state *tls)
 #endif
 
 
+static void store_groups(thread_local_state *tls, INTERNAL_STATE *stored,
+   int flags);
+static void save_pushed_state(thread_local_state *tls, int group);
+
+
+/* Must be called before a setter changes a lazy state group. */
+static void touch_state(thread_local_state *tls, int group)
+{
+   if (tls->state_watch & group)
+      save_pushed_state(tls, group);
+}
+
+
 
 void _al_set_new_display_settings(ALLEGRO_EXTRA_DISPLAY_SETTINGS *settings)
 {
    thread_local_state *tls;
    if ((tls = tls_get()) == NULL)
       return;
+   touch_state(tls, ALLEGRO_STATE_NEW_DISPLAY_PARAMETERS);
    memmove(&tls->new_display_settings, settings, sizeof(ALLEGRO_EXTRA_DISPLAY_SETTINGS));
 }
 
@@ -174,6 +253,8 @@ ALLEGRO_EXTRA_DISPLAY_SETTINGS *_al_get_new_display_settings(void)
 
    if ((tls = tls_get()) == NULL)
       return 0;
+   /* The caller may modify the settings through the returned pointer. */
+   touch_state(tls, ALLEGRO_STATE_NEW_DISPLAY_PARAMETERS);
    return &tls->new_display_settings;
 }
 
@@ -187,6 +268,7 @@ void al_set_new_display_flags(int flags)
 
    if ((tls = tls_get()) == NULL)
       return;
+   touch_state(tls, ALLEGRO_STATE_NEW_DISPLAY_PARAMETERS);
    tls->new_display_flags = flags;
 }
 
@@ -213,6 +295,7 @@ void al_set_new_display_refresh_rate(int refresh_rate)
 
    if ((tls = tls_get()) == NULL)
       return;
+   touch_state(tls, ALLEGRO_STATE_NEW_DISPLAY_PARAMETERS);
    tls->new_display_refresh_rate = refresh_rate;
 }
 
@@ -239,6 +322,7 @@ void al_set_new_display_adapter(int adapter)
 
    if ((tls = tls_get()) == NULL)
       return;
+   touch_state(tls, ALLEGRO_STATE_NEW_DISPLAY_PARAMETERS);
 
    if (adapter < 0) {
       tls->new_display_adapter = ALLEGRO_DEFAULT_DISPLAY_ADAPTER;
@@ -269,6 +353,7 @@ void al_set_new_window_position(int x, int y)
 
    if ((tls = tls_get()) == NULL)
       return;
+   touch_state(tls, ALLEGRO_STATE_NEW_DISPLAY_PARAMETERS);
    tls->new_window_x = x;
    tls->new_window_y = y;
 }
@@ -368,8 +453,10 @@ void al_set_target_bitmap(ALLEGRO_BITMAP *bitmap)
       new_display = NULL;
    }
    else if (bitmap->flags & ALLEGRO_MEMORY_BITMAP) {
-      /* Setting a memory bitmap doesn't change the rendering context. */
-      new_display = old_display;
+      /* Setting a memory bitmap doesn't change the rendering context,
+       * unless it is the backbuffer of a headless display.
+       */
+      new_display = bitmap->display ? bitmap->display : old_display;
    }
    else {
       new_display = bitmap->display;
@@ -449,6 +536,7 @@ void al_set_separate_blender(int op, int src, int dst,
 
    if ((tls = tls_get()) == NULL)
       return;
+   touch_state(tls, ALLEGRO_STATE_BLENDER);
 
    b = &tls->current_blender;
 
@@ -513,6 +601,7 @@ void al_set_new_bitmap_format(int format)
 
    if ((tls = tls_get()) == NULL)
       return;
+   touch_state(tls, ALLEGRO_STATE_NEW_BITMAP_PARAMETERS);
    tls->new_bitmap_format = format;
 }
 
@@ -526,6 +615,7 @@ void al_set_new_bitmap_flags(int flags)
 
    if ((tls = tls_get()) == NULL)
       return;
+   touch_state(tls, ALLEGRO_STATE_NEW_BITMAP_PARAMETERS);
 
    tls->new_bitmap_flags = flags;
 }
@@ -540,6 +630,7 @@ void al_add_new_bitmap_flag(int flag)
 
    if ((tls = tls_get()) == NULL)
       return;
+   touch_state(tls, ALLEGRO_STATE_NEW_BITMAP_PARAMETERS);
    tls->new_bitmap_flags |= flag;
 }
 
@@ -572,19 +663,9 @@ int al_get_new_bitmap_flags(void)
 
 
 #define _STORE(x) stored->tls.x = tls->x;
-/* Function: al_store_state
- */
-void al_store_state(ALLEGRO_STATE *state, int flags)
+static void store_groups(thread_local_state *tls, INTERNAL_STATE *stored,
+   int flags)
 {
-   thread_local_state *tls;
-   INTERNAL_STATE *stored;
-
-   if ((tls = tls_get()) == NULL)
-      return;
-
-   stored = (void *)state;
-   stored->flags = flags;
-
    if (flags & ALLEGRO_STATE_NEW_DISPLAY_PARAMETERS) {
       _STORE(new_display_flags);
       _STORE(new_display_refresh_rate);
@@ -617,7 +698,7 @@ void al_store_state(ALLEGRO_STATE *state, int flags)
    }
    
    if (flags & ALLEGRO_STATE_TRANSFORM) {
-      ALLEGRO_BITMAP *target = al_get_target_bitmap();
+      ALLEGRO_BITMAP *target = tls->target_bitmap;
       if (!target)
          al_identity_transform(&stored->stored_transform);
       else
@@ -629,19 +710,13 @@ void al_store_state(ALLEGRO_STATE *state, int flags)
 
 
 #define _STORE(x) tls->x = stored->tls.x;
-/* Function: al_restore_state
- */
-void al_restore_state(ALLEGRO_STATE const *state)
+static void restore_groups(thread_local_state *tls,
+   INTERNAL_STATE const *stored, int flags)
 {
-   thread_local_state *tls;
-   INTERNAL_STATE *stored;
-   int flags;
-
-   if ((tls = tls_get()) == NULL)
-      return;
-   
-   stored = (void *)state;
-   flags = stored->flags;
+   /* Pushed frames still waiting to save a lazy group must see the value
+    * from before it is overwritten here.
+    */
+   touch_state(tls, flags & LAZY_STATE);
 
    if (flags & ALLEGRO_STATE_NEW_DISPLAY_PARAMETERS) {
       _STORE(new_display_flags);
@@ -657,14 +732,19 @@ void al_restore_state(ALLEGRO_STATE const *state)
       _STORE(new_bitmap_flags);
    }
    
+   /* Switching contexts is expensive, so leave alone what is already
+    * current.  This means restoring the target bitmap it already is does
+    * not re-apply its transformations and shader; al_restore_state
+    * documents this.
+    */
    if (flags & ALLEGRO_STATE_DISPLAY) {
-      _STORE(current_display);
-      _al_set_current_display_only(tls->current_display);
+      if (tls->current_display != stored->tls.current_display)
+         _al_set_current_display_only(stored->tls.current_display);
    }
 
    if (flags & ALLEGRO_STATE_TARGET_BITMAP) {
-      _STORE(target_bitmap);
-      al_set_target_bitmap(tls->target_bitmap);
+      if (tls->target_bitmap != stored->tls.target_bitmap)
+         al_set_target_bitmap(stored->tls.target_bitmap);
    }
    
    if (flags & ALLEGRO_STATE_BLENDER) {
@@ -677,15 +757,133 @@ void al_restore_state(ALLEGRO_STATE const *state)
    }
    
    if (flags & ALLEGRO_STATE_TRANSFORM) {
-      ALLEGRO_BITMAP *bitmap = al_get_target_bitmap();
-      if (bitmap)
+      ALLEGRO_BITMAP *bitmap = tls->target_bitmap;
+      if (bitmap && memcmp(&bitmap->transform, &stored->stored_transform,
+            sizeof(ALLEGRO_TRANSFORM)) != 0) {
          al_use_transform(&stored->stored_transform);
+      }
    }
 }
 #undef _STORE
 
 
 
+/* Function: al_store_state
+ */
+void al_store_state(ALLEGRO_STATE *state, int flags)
+{
+   thread_local_state *tls;
+   INTERNAL_STATE *stored;
+
+   if ((tls = tls_get()) == NULL)
+      return;
+
+   stored = (void *)state;
+   stored->flags = flags;
+   store_groups(tls, stored, flags);
+}
+
+
+
+/* Function: al_restore_state
+ */
+void al_restore_state(ALLEGRO_STATE const *state)
+{
+   thread_local_state *tls;
+   INTERNAL_STATE const *stored;
+
+   if ((tls = tls_get()) == NULL)
+      return;
+   
+   stored = (void const *)state;
+   restore_groups(tls, stored, stored->flags);
+}
+
+
+
+/* Save the current value of a lazy state group into every frame on the
+ * stack which asked for it and has not saved it yet.  Frames are pushed
+ * in order, so all of them are still looking at the value they started
+ * with.
+ */
+static void save_pushed_state(thread_local_state *tls, int group)
+{
+   int i;
+
+   for (i = 0; i < tls->state_depth; i++) {
+      STATE_FRAME *frame = &tls->state_stack[i];
+      int pending = frame->state.flags & ~frame->saved & group;
+
+      if (pending) {
+         store_groups(tls, &frame->state, pending);
+         frame->saved |= pending;
+      }
+      frame->watch &= ~group;
+   }
+
+   tls->state_watch &= ~group;
+}
+
+
+
+/* Function: al_push_state
+ */
+void al_push_state(int flags)
+{
+   thread_local_state *tls;
+   STATE_FRAME *frame;
+
+   if ((tls = tls_get()) == NULL)
+      return;
+
+   if (tls->state_depth == tls->state_size) {
+      int size = _ALLEGRO_MAX(16, tls->state_size * 2);
+      STATE_FRAME *stack = al_realloc(tls->state_stack, size * sizeof *stack);
+      if (!stack) {
+         ALLEGRO_ERROR("Out of memory for the state stack.\n");
+         return;
+      }
+      tls->state_stack = stack;
+      tls->state_size = size;
+   }
+
+   frame = &tls->state_stack[tls->state_depth++];
+   frame->state.flags = flags;
+   frame->saved = flags & ~LAZY_STATE;
+   store_groups(tls, &frame->state, frame->saved);
+
+   tls->state_watch |= flags & LAZY_STATE;
+   frame->watch = tls->state_watch;
+}
+
+
+
+/* Function: al_pop_state
+ */
+void al_pop_state(void)
+{
+   thread_local_state *tls;
+   STATE_FRAME *frame;
+
+   if ((tls = tls_get()) == NULL)
+      return;
+
+   ASSERT(tls->state_depth > 0);
+   if (tls->state_depth == 0)
+      return;
+
+   /* Pop the frame first so restoring cannot save into it again.  The
+    * frame itself stays valid until the next push.
+    */
+   frame = &tls->state_stack[--tls->state_depth];
+   tls->state_watch = tls->state_depth > 0 ?
+      tls->state_stack[tls->state_depth - 1].watch : 0;
+
+   restore_groups(tls, &frame->state, frame->saved);
+}
+
+
+
 /* Function: al_get_new_file_interface
  * FIXME: added a work-around for the situation where TLS has not yet been
  * initialised when this function is called. This may happen if Allegro
@@ -719,6 +917,7 @@ void al_set_new_file_interface(const ALLEGRO_FILE_INTERFACE *file_interface)
 
    if ((tls = tls_get()) == NULL)
       return;
+   touch_state(tls, ALLEGRO_STATE_NEW_FILE_INTERFACE);
    tls->new_file_interface = file_interface;
 }
 
@@ -749,6 +948,7 @@ void al_set_fs_interface(const ALLEGRO_FS_INTERFACE *fs_interface)
 
    if ((tls = tls_get()) == NULL)
       return;
+   touch_state(tls, ALLEGRO_STATE_NEW_FILE_INTERFACE);
    tls->fs_interface = fs_interface;
 }
 
@@ -825,4 +1025,69 @@ int *_al_tls_get_dtor_owner_count(void)
 
 
 
+/* Returns the blender of the calling thread.  The pointer stays valid for
+ * the lifetime of the thread, so software drawing code can look it up once
+ * per operation instead of calling al_get_separate_blender per span or
+ * pixel.  Never returns NULL: without thread local storage the default
+ * blender is returned.
+ */
+const ALLEGRO_BLENDER *_al_tls_get_blender(void)
+{
+   static const ALLEGRO_BLENDER default_blender = {
+      ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_INVERSE_ALPHA,
+      ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_INVERSE_ALPHA
+   };
+   thread_local_state *tls;
+
+   if ((tls = tls_get()) == NULL)
+      return &default_blender;
+   return &tls->current_blender;
+}
+
+
+
+struct _AL_USTR_ARENA **_al_tls_get_ustr_arena(void)
+{
+   thread_local_state *tls;
+
+   if ((tls = tls_get()) == NULL)
+      return NULL;
+   return &tls->ustr_arena;
+}
+
+
+
+char **_al_tls_get_trace_buffer(void)
+{
+   thread_local_state *tls;
+
+   if ((tls = tls_get()) == NULL)
+      return NULL;
+   return &tls->trace_buffer;
+}
+
+
+
+struct _AL_PROFILE_THREAD **_al_tls_get_profile_thread(void)
+{
+   thread_local_state *tls;
+
+   if ((tls = tls_get()) == NULL)
+      return NULL;
+   return &tls->profile_thread;
+}
+
+
+
+struct _AL_MEMORY_CACHE **_al_tls_get_memory_cache(void)
+{
+   thread_local_state *tls;
+
+   if ((tls = tls_get()) == NULL)
+      return NULL;
+   return &tls->memory_cache;
+}
+
+
+
 /* vim: set sts=3 sw=3 et: */
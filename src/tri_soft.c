@@ -21,7 +21,9 @@
 #include "allegro5/internal/aintern.h"
 #include "allegro5/internal/aintern_bitmap.h"
 #include "allegro5/internal/aintern_blend.h"
+#include "allegro5/internal/aintern_display.h"
 #include "allegro5/internal/aintern_pixels.h"
+#include "allegro5/internal/aintern_tls.h"
 #include "allegro5/internal/aintern_tri_soft.h"
 #include <math.h>
 
@@ -37,6 +39,7 @@ typedef void (*shader_step)(uintptr_t, int);
 
 typedef struct {
    ALLEGRO_BITMAP *target;
+   const ALLEGRO_BLENDER *blender;
    ALLEGRO_COLOR cur_color;
 } state_solid_any_2d;
 
@@ -207,6 +210,7 @@ static void shader_grad_any_step(uintptr_t state, int minor)
 
 typedef struct {
    ALLEGRO_BITMAP *target;
+   const ALLEGRO_BLENDER *blender;
    ALLEGRO_COLOR cur_color;
 
    float du_dx, du_dy, u_const;
@@ -525,13 +529,15 @@ static void triangle_stepper(uintptr_t state,
       */
       left_first = ceilf((left_error) / left_y_delta);
       /*
-      Introduce a tiny bias into the calculation, a problem with the floorf implementation
-      because it does not have a properly defined 0 point. I think this is a hack,
-      however, so if anyone has a better idea of how to fix this, by all means implement it.
+      The right edge excludes pixels which lie exactly on it, which the left edge of
+      a neighbouring triangle includes, so we want the last step strictly before the
+      edge.  A bias subtracted before flooring does not do this once the quotient is
+      large enough for the bias to round away, and then pixels on an edge shared by
+      two triangles are drawn by both.
 
-      N.B. the same offset in the bottom segment as well
+      N.B. the same in the bottom segment as well
       */
-      right_first = floorf((right_error) / right_y_delta - 0.000001f);
+      right_first = ceilf((right_error) / right_y_delta) - 1;
 
       /*
       Calculate the normal steps
@@ -627,7 +633,7 @@ static void triangle_stepper(uintptr_t state,
       }
 
       left_first = ceilf((left_error) / left_y_delta);
-      right_first = floorf((right_error) / right_y_delta - 0.000001f);
+      right_first = ceilf((right_error) / right_y_delta) - 1;
 
       left_step = ceilf(left_x_delta / left_y_delta);
       left_d_er = -(float)left_step * left_y_delta;
@@ -692,13 +698,15 @@ void _al_triangle_2d(ALLEGRO_BITMAP* texture, ALLEGRO_VERTEX* v1, ALLEGRO_VERTEX
    int shade = 1;
    int grad = 1;
    int op, src_mode, dst_mode, op_alpha, src_alpha, dst_alpha;
+   /* Looked up once here; the scanline drawers read it from the state. */
+   const ALLEGRO_BLENDER *blender = _al_tls_get_blender();
    ALLEGRO_COLOR v1c, v2c, v3c;
 
    v1c = v1->color;
    v2c = v2->color;
    v3c = v3->color;
 
-   al_get_separate_blender(&op, &src_mode, &dst_mode, &op_alpha, &src_alpha, &dst_alpha);
+   _AL_LOAD_BLENDER(blender);
    if (_AL_DEST_IS_ZERO && _AL_SRC_NOT_MODIFIED) {
       shade = 0;
    }
@@ -714,6 +722,7 @@ void _al_triangle_2d(ALLEGRO_BITMAP* texture, ALLEGRO_VERTEX* v1, ALLEGRO_VERTEX
       if (grad) {
          state_texture_grad_any_2d state;
          state.solid.texture = texture;
+         state.solid.blender = blender;
 
          if (shade) {
             _al_draw_soft_triangle(v1, v2, v3, (uintptr_t)&state, shader_texture_grad_any_init, shader_texture_grad_any_first, shader_texture_grad_any_step, shader_texture_grad_any_draw_shade);
@@ -728,6 +737,7 @@ void _al_triangle_2d(ALLEGRO_BITMAP* texture, ALLEGRO_VERTEX* v1, ALLEGRO_VERTEX
             white = 1;
          }
          state.texture = texture;
+         state.blender = blender;
          if (shade) {
             if (white) {
                _al_draw_soft_triangle(v1, v2, v3, (uintptr_t)&state, shader_texture_solid_any_init, shader_texture_solid_any_first, shader_texture_solid_any_step, shader_texture_solid_any_draw_shade_white);
@@ -745,6 +755,7 @@ void _al_triangle_2d(ALLEGRO_BITMAP* texture, ALLEGRO_VERTEX* v1, ALLEGRO_VERTEX
    } else {
       if (grad) {
          state_grad_any_2d state;
+         state.solid.blender = blender;
          if (shade) {
             _al_draw_soft_triangle(v1, v2, v3, (uintptr_t)&state, shader_grad_any_init, shader_grad_any_first, shader_grad_any_step, shader_grad_any_draw_shade);
          } else {
@@ -752,6 +763,7 @@ void _al_triangle_2d(ALLEGRO_BITMAP* texture, ALLEGRO_VERTEX* v1, ALLEGRO_VERTEX
          }
       } else {
          state_solid_any_2d state;
+         state.blender = blender;
          if (shade) {
             _al_draw_soft_triangle(v1, v2, v3, (uintptr_t)&state, shader_solid_any_init, shader_solid_any_first, shader_solid_any_step, shader_solid_any_draw_shade);
          } else {
@@ -18,6 +18,7 @@
 #include "allegro5/allegro.h"
 #include "allegro5/internal/aintern.h"
 #include "allegro5/internal/aintern_bitmap.h"
+#include "allegro5/internal/aintern_headless.h"
 #include "allegro5/internal/aintern_system.h"
 
 #if defined ALLEGRO_WITH_XWINDOWS
@@ -138,5 +139,9 @@ void _al_register_system_interfaces(void)
    add = _al_vector_alloc_back(&_al_system_interfaces);
    *add = _al_system_raspberrypi_driver();
 #endif
+
+   /* Without a window system we can still draw offscreen. */
+   add = _al_vector_alloc_back(&_al_system_interfaces);
+   *add = _al_system_headless_driver();
 }
 
@@ -0,0 +1,117 @@
+/*         ______   ___    ___
+ *        /\  _  \ /\_ \  /\_ \
+ *        \ \ \L\ \\//\ \ \//\ \      __     __   _ __   ___
+ *         \ \  __ \ \ \ \  \ \ \   /'__`\ /'_ `\/\`'__\/ __`\
+ *          \ \ \/\ \ \_\ \_ \_\ \_/\  __//\ \L\ \ \ \//\ \L\ \
+ *           \ \_\ \_\/\____\/\____\ \____\ \____ \ \_\\ \____/
+ *            \/_/\/_/\/____/\/____/\/____/\/___L\ \/_/ \/___/
+ *                                           /\____/
+ *                                           \_/__/
+ *
+ *      Headless system driver for Unixy platforms, used when no window
+ *      system is available.  Displays are created by the headless
+ *      display driver; there is no keyboard, mouse or joystick.
+ *
+ *      See readme.txt for copyright information.
+ */
+
+
+#include "allegro5/allegro.h"
+#include "allegro5/internal/aintern.h"
+#include "allegro5/internal/aintern_headless.h"
+#include "allegro5/internal/aintern_system.h"
+#include "allegro5/platform/aintunix.h"
+
+ALLEGRO_DEBUG_CHANNEL("system")
+
+static ALLEGRO_SYSTEM_INTERFACE *headless_vt;
+
+
+
+static ALLEGRO_SYSTEM *headless_initialize(int flags)
+{
+   ALLEGRO_SYSTEM *s;
+   (void)flags;
+
+   _al_unix_init_time();
+
+   s = al_calloc(1, sizeof *s);
+   if (!s)
+      return NULL;
+
+   _al_vector_init(&s->displays, sizeof (ALLEGRO_DISPLAY *));
+   s->vt = headless_vt;
+
+   ALLEGRO_INFO("Headless system driver initialised.\n");
+   return s;
+}
+
+
+
+static void headless_shutdown_system(void)
+{
+   ALLEGRO_SYSTEM *s = al_get_system_driver();
+
+   ALLEGRO_INFO("shutting down.\n");
+
+   /* The headless displays have been destroyed by now. */
+   _al_vector_free(&s->displays);
+   al_free(s);
+}
+
+
+
+static int headless_get_num_display_modes(void)
+{
+   return 0;
+}
+
+
+
+static ALLEGRO_DISPLAY_MODE *headless_get_display_mode(int mode,
+   ALLEGRO_DISPLAY_MODE *dm)
+{
+   (void)mode;
+   (void)dm;
+   return NULL;
+}
+
+
+
+static int headless_get_num_video_adapters(void)
+{
+   return 0;
+}
+
+
+
+static bool headless_inhibit_screensaver(bool inhibit)
+{
+   (void)inhibit;
+   return true;
+}
+
+
+
+/* Internal function to get a reference to this driver. */
+ALLEGRO_SYSTEM_INTERFACE *_al_system_headless_driver(void)
+{
+   if (headless_vt)
+      return headless_vt;
+
+   headless_vt = al_calloc(1, sizeof *headless_vt);
+
+   headless_vt->initialize = headless_initialize;
+   headless_vt->get_display_driver = _al_display_headless_driver;
+   headless_vt->get_num_display_modes = headless_get_num_display_modes;
+   headless_vt->get_display_mode = headless_get_display_mode;
+   headless_vt->shutdown_system = headless_shutdown_system;
+   headless_vt->get_num_video_adapters = headless_get_num_video_adapters;
+   headless_vt->get_path = _al_unix_get_path;
+   headless_vt->inhibit_screensaver = headless_inhibit_screensaver;
+
+   return headless_vt;
+}
+
+
+/* vim: set sts=3 sw=3 et: */
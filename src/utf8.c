@@ -21,6 +21,8 @@
 #include "allegro5/utf8.h"
 #include "allegro5/internal/bstrlib.h"
 #include "allegro5/internal/aintern.h"
+#include "allegro5/internal/aintern_tls.h"
+#include "allegro5/internal/aintern_vector.h"
 
 ALLEGRO_STATIC_ASSERT(utf8,
    sizeof(ALLEGRO_USTR_INFO) >= sizeof(struct _al_tagbstring));
@@ -42,18 +44,150 @@ ALLEGRO_STATIC_ASSERT(utf8,
 #define IS_TRAIL_BYTE(c)   (((unsigned)(c) & 0xC0) == 0x80)
 
 
+/* A "boundary" is a byte at which al_ustr_next() stops, i.e. a single byte
+ * or a lead byte.  The scanning helpers below process a whole block of bytes
+ * per step, using SSE2 where available and word-at-a-time tests otherwise.
+ */
+#define IS_BOUNDARY(c)     (IS_SINGLE_BYTE(c) || IS_LEAD_BYTE(c))
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+   (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+   #define USE_SSE2
+   #include <emmintrin.h>
+   #define SCAN_BLOCK   16
+#else
+   #define SCAN_BLOCK   ((int)sizeof(size_t))
+#endif
+
+
+#ifdef USE_SSE2
+static int popcount16(unsigned x)
+{
+   x = x - ((x >> 1) & 0x5555);
+   x = (x & 0x3333) + ((x >> 2) & 0x3333);
+   x = (x + (x >> 4)) & 0x0F0F;
+   return (x + (x >> 8)) & 0x1F;
+}
+
+
+/* Return a 16-bit mask with a bit set for each ASCII byte in the block. */
+static unsigned block_ascii_mask(const unsigned char *p)
+{
+   __m128i v = _mm_loadu_si128((const __m128i *)p);
+   return ~_mm_movemask_epi8(v) & 0xFFFF;
+}
+
+
+/* Return a 16-bit mask with a bit set for each boundary byte in the block.
+ * As signed bytes, single bytes are >= 0 and lead bytes (0xC0..0xFD) lie in
+ * [-64, -3].
+ */
+static unsigned block_boundary_mask(const unsigned char *p)
+{
+   __m128i v = _mm_loadu_si128((const __m128i *)p);
+   __m128i ge_lead = _mm_cmpgt_epi8(v, _mm_set1_epi8(-65));
+   __m128i fe_ff = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(-3)),
+      _mm_cmplt_epi8(v, _mm_setzero_si128()));
+   return _mm_movemask_epi8(_mm_andnot_si128(fe_ff, ge_lead));
+}
+#else
+static bool block_is_ascii(const unsigned char *p)
+{
+   size_t w;
+   memcpy(&w, p, sizeof(w));
+   return (w & ((size_t)-1 / 0xFF * 0x80)) == 0;
+}
+#endif
+
+
+/* Return the number of leading ASCII bytes in [data, data + size). */
+static int ascii_prefix(const unsigned char *data, int size)
+{
+   int i = 0;
+
+#ifdef USE_SSE2
+   for (; i + SCAN_BLOCK <= size; i += SCAN_BLOCK) {
+      unsigned mask = block_ascii_mask(data + i);
+      if (mask != 0xFFFF) {
+         while (mask & 1) {
+            mask >>= 1;
+            i++;
+         }
+         return i;
+      }
+   }
+#else
+   for (; i + SCAN_BLOCK <= size; i += SCAN_BLOCK) {
+      if (!block_is_ascii(data + i))
+         break;
+   }
+#endif
+
+   while (i < size && IS_SINGLE_BYTE(data[i]))
+      i++;
+   return i;
+}
+
+
+/* Return the number of boundary bytes in [data + start, data + end). */
+static int count_boundaries(const unsigned char *data, int start, int end)
+{
+   int i = start;
+   int n = 0;
+
+   for (; i + SCAN_BLOCK <= end; i += SCAN_BLOCK) {
+#ifdef USE_SSE2
+      n += popcount16(block_boundary_mask(data + i));
+#else
+      if (block_is_ascii(data + i)) {
+         n += SCAN_BLOCK;
+      }
+      else {
+         int j;
+         for (j = 0; j < SCAN_BLOCK; j++) {
+            if (IS_BOUNDARY(data[i + j]))
+               n++;
+         }
+      }
+#endif
+   }
+
+   for (; i < end; i++) {
+      if (IS_BOUNDARY(data[i]))
+         n++;
+   }
+   return n;
+}
+
+
+/* Return the position of the n-th boundary byte (n >= 1) at or after
+ * data + start, or end if there are fewer than n.
+ */
+static int find_boundary(const unsigned char *data, int start, int end, int n)
+{
+   int i = start;
+
+   for (; i + SCAN_BLOCK <= end; i += SCAN_BLOCK) {
+      int c = count_boundaries(data, i, i + SCAN_BLOCK);
+      if (c >= n)
+         break;
+      n -= c;
+   }
+
+   for (; i < end; i++) {
+      if (IS_BOUNDARY(data[i]) && --n == 0)
+         return i;
+   }
+   return end;
+}
+
+
 static bool all_ascii(const ALLEGRO_USTR *us)
 {
    const unsigned char *data = (const unsigned char *) _al_bdata(us);
    int size = _al_blength(us);
 
-   while (size-- > 0) {
-      if (*data > 127)
-         return false;
-      data++;
-   }
-
-   return true;
+   return ascii_prefix(data, size) == size;
 }
 
 
@@ -146,6 +280,374 @@ ALLEGRO_USTR *al_ustr_dup_substr(const ALLEGRO_USTR *us, int start_pos,
 }
 
 
+/* Scratch arenas.
+ *
+ * Strings made by al_ustr_arena_new() and friends are carved, tag, header
+ * and buffer together, out of per-thread blocks which are released in bulk
+ * by al_ustr_arena_end().  The tag records the arena and the scope the
+ * string was made in, which is how _al_bdestroy() recognises arena strings
+ * without asking the current thread.
+ *
+ * A string that outgrows its buffer has its contents moved to the heap by
+ * _al_balloc().  Such strings are remembered together with the depth of the
+ * scope that made them, so the heap buffer is freed when that scope ends,
+ * not when whichever scope it happened to grow in does.
+ *
+ * The arena and its first block are kept when the outermost scope ends so
+ * that the next one can reuse them, and are freed when the thread exits.
+ * Scopes nest as deeply as memory allows; a begin that cannot record its
+ * mark is only counted, so that its end does not close an outer scope.
+ */
+
+#define ARENA_BLOCK_SIZE   4096
+#define ARENA_ALIGN(n)     (((n) + 15) & ~(size_t)15)
+
+typedef struct ARENA_BLOCK ARENA_BLOCK;
+
+struct ARENA_BLOCK {
+   ARENA_BLOCK *prev;
+   size_t size;
+   size_t used;
+};
+
+#define ARENA_BLOCK_HEADER ARENA_ALIGN(sizeof(ARENA_BLOCK))
+#define ARENA_BLOCK_DATA(blk) ((char *)(blk) + ARENA_BLOCK_HEADER)
+
+typedef struct ARENA_MARK {
+   ARENA_BLOCK *block;
+   size_t used;
+   size_t scope;
+} ARENA_MARK;
+
+typedef struct ARENA_ESCAPED {
+   ALLEGRO_USTR *us;
+   int depth;
+} ARENA_ESCAPED;
+
+typedef struct _AL_USTR_ARENA {
+   ARENA_BLOCK *block;
+   int depth;
+   int lost_marks;         /* Begins beyond depth that had no room */
+   size_t scope_count;
+   _AL_VECTOR marks;       /* ARENA_MARK, depth of them */
+   _AL_VECTOR escaped;     /* ARENA_ESCAPED */
+} _AL_USTR_ARENA;
+
+
+static _AL_USTR_ARENA *arena_get(void)
+{
+   _AL_USTR_ARENA **pa = _al_tls_get_ustr_arena();
+   if (!pa)
+      return NULL;
+   return *pa;
+}
+
+
+/* Returns the depth of the scope the string was made in, or -1 if it does
+ * not belong to a live scope of this thread's arena.
+ */
+static int arena_scope_depth(const _AL_USTR_ARENA *arena,
+   const ALLEGRO_USTR *us)
+{
+   const _al_bstrtag *tag = _al_bstrtag_of(us);
+   int i;
+
+   if (!arena || tag->arena != arena)
+      return -1;
+
+   for (i = arena->depth - 1; i >= 0; i--) {
+      const ARENA_MARK *mark = _al_vector_ref(&arena->marks, i);
+      if (mark->scope == tag->scope)
+         return i;
+   }
+   return -1;
+}
+
+
+static void *arena_alloc(_AL_USTR_ARENA *arena, size_t size)
+{
+   ARENA_BLOCK *blk = arena->block;
+   void *p;
+
+   size = ARENA_ALIGN(size);
+
+   if (!blk || blk->used + size > blk->size) {
+      size_t block_size = _ALLEGRO_MAX(size, ARENA_BLOCK_SIZE);
+      blk = al_malloc(ARENA_BLOCK_HEADER + block_size);
+      if (!blk)
+         return NULL;
+      blk->prev = arena->block;
+      blk->size = block_size;
+      blk->used = 0;
+      arena->block = blk;
+   }
+
+   p = ARENA_BLOCK_DATA(blk) + blk->used;
+   blk->used += size;
+   return p;
+}
+
+
+static ALLEGRO_USTR *arena_new_ustr(const char *s, size_t size)
+{
+   _AL_USTR_ARENA *arena = arena_get();
+   _al_bstrtag *tag;
+   ALLEGRO_USTR *us;
+   size_t mlen;
+
+   if (!arena || arena->depth == 0)
+      return NULL;
+
+   mlen = _ALLEGRO_MAX(size + 1, _AL_BSTR_INLINE_SIZE);
+   tag = arena_alloc(arena, sizeof(*tag) + sizeof(ALLEGRO_USTR) + mlen);
+   if (!tag)
+      return NULL;
+
+   tag->arena = arena;
+   tag->scope = ((ARENA_MARK *)_al_vector_ref_back(&arena->marks))->scope;
+   tag->escaped = 0;
+   us = (ALLEGRO_USTR *)(tag + 1);
+   us->mlen = mlen;
+   us->slen = size;
+   us->data = (unsigned char *)(us + 1);
+   if (size > 0)
+      memcpy(us->data, s, size);
+   us->data[size] = '\0';
+   return us;
+}
+
+
+static void arena_free_escaped(ALLEGRO_USTR *us)
+{
+   if (us->data != (unsigned char *)(us + 1)) {
+      al_free(us->data);
+      us->data = (unsigned char *)(us + 1);
+   }
+   _al_bstrtag_of(us)->escaped = 0;
+}
+
+
+/* Moves an entry of the escaped list to index i, keeping its tag in step. */
+static void arena_move_escaped(_AL_USTR_ARENA *arena, unsigned int i,
+   const ARENA_ESCAPED *e)
+{
+   ARENA_ESCAPED *dest = _al_vector_ref(&arena->escaped, i);
+   *dest = *e;
+   _al_bstrtag_of(dest->us)->escaped = i + 1;
+}
+
+
+/* Called by _al_bdestroy for strings tagged as belonging to an arena.  Only
+ * an escaped heap buffer is freed, and only if the string belongs to a live
+ * scope of this thread.  A string from another thread is left for its own
+ * arena to release.
+ */
+void _al_ustr_arena_release(ALLEGRO_USTR *us)
+{
+   _AL_USTR_ARENA *arena = arena_get();
+   size_t escaped = _al_bstrtag_of(us)->escaped;
+
+   if (arena_scope_depth(arena, us) < 0)
+      return;
+
+   if (escaped > 0) {
+      /* Fill the hole with the last entry. */
+      unsigned int last = _al_vector_size(&arena->escaped) - 1;
+      arena_free_escaped(us);
+      if (escaped - 1 != last) {
+         arena_move_escaped(arena, escaped - 1,
+            _al_vector_ref(&arena->escaped, last));
+      }
+      _al_vector_delete_at(&arena->escaped, last);
+   }
+   us->slen = -1;
+}
+
+
+/* Called by _al_balloc when an arena string's inline buffer is about to be
+ * replaced with a heap buffer.
+ */
+void _al_ustr_arena_adopt(ALLEGRO_USTR *us)
+{
+   _AL_USTR_ARENA *arena = arena_get();
+   ARENA_ESCAPED *e;
+   int depth;
+
+   if ((depth = arena_scope_depth(arena, us)) < 0)
+      return;
+
+   e = _al_vector_alloc_back(&arena->escaped);
+   if (e) {
+      e->us = us;
+      e->depth = depth;
+      _al_bstrtag_of(us)->escaped = _al_vector_size(&arena->escaped);
+   }
+}
+
+
+/* Called when the thread exits, with the memory cache of the thread, which
+ * can no longer be looked up.
+ */
+void _al_ustr_arena_destroy(_AL_USTR_ARENA *arena,
+   struct _AL_MEMORY_CACHE *cache)
+{
+   unsigned int i;
+
+   if (!arena)
+      return;
+
+   for (i = 0; i < _al_vector_size(&arena->escaped); i++) {
+      ARENA_ESCAPED *e = _al_vector_ref(&arena->escaped, i);
+      arena_free_escaped(e->us);
+   }
+   _al_vector_free_in_cache(&arena->escaped, cache);
+   _al_vector_free_in_cache(&arena->marks, cache);
+
+   while (arena->block) {
+      ARENA_BLOCK *prev = arena->block->prev;
+      al_free(arena->block);
+      arena->block = prev;
+   }
+   al_free(arena);
+}
+
+
+/* Function: al_ustr_arena_begin
+ */
+void al_ustr_arena_begin(void)
+{
+   _AL_USTR_ARENA **pa = _al_tls_get_ustr_arena();
+   _AL_USTR_ARENA *arena;
+   ARENA_MARK *mark;
+
+   if (!pa)
+      return;
+
+   arena = *pa;
+   if (!arena) {
+      arena = al_calloc(1, sizeof(*arena));
+      if (!arena)
+         return;
+      _al_vector_init(&arena->marks, sizeof(ARENA_MARK));
+      _al_vector_init(&arena->escaped, sizeof(ARENA_ESCAPED));
+      *pa = arena;
+   }
+
+   /* Strings made while marks are lost belong to the innermost scope that
+    * has one, which is no worse than not nesting at all.
+    */
+   mark = arena->lost_marks ? NULL : _al_vector_alloc_back(&arena->marks);
+   if (!mark) {
+      arena->lost_marks++;
+      return;
+   }
+
+   arena->depth++;
+   mark->block = arena->block;
+   mark->used = arena->block ? arena->block->used : 0;
+   mark->scope = ++arena->scope_count;
+}
+
+
+/* Function: al_ustr_arena_end
+ */
+void al_ustr_arena_end(void)
+{
+   _AL_USTR_ARENA *arena = arena_get();
+   ARENA_MARK mark;
+   unsigned int i, j;
+
+   if (!arena)
+      return;
+
+   if (arena->lost_marks > 0) {
+      arena->lost_marks--;
+      return;
+   }
+
+   ASSERT(arena->depth > 0);
+   if (arena->depth == 0)
+      return;
+
+   mark = *(ARENA_MARK *)_al_vector_ref_back(&arena->marks);
+   _al_vector_delete_at(&arena->marks, --arena->depth);
+
+   /* Strings from outer scopes may have escaped after this scope began, so
+    * go by the depth recorded with each one.  The survivors are packed to
+    * the front in one pass and the rest dropped from the back.
+    */
+   j = 0;
+   for (i = 0; i < _al_vector_size(&arena->escaped); i++) {
+      ARENA_ESCAPED *e = _al_vector_ref(&arena->escaped, i);
+      if (e->depth >= arena->depth) {
+         arena_free_escaped(e->us);
+         continue;
+      }
+      if (i != j)
+         arena_move_escaped(arena, j, e);
+      j++;
+   }
+   for (i = _al_vector_size(&arena->escaped); i > j; i--)
+      _al_vector_delete_at(&arena->escaped, i - 1);
+
+   /* Free the blocks this scope added, keeping one ordinary block around
+    * for the next outermost scope.
+    */
+   while (arena->block != mark.block) {
+      ARENA_BLOCK *prev = arena->block->prev;
+      if (!prev && arena->depth == 0 && arena->block->size == ARENA_BLOCK_SIZE)
+         break;
+      al_free(arena->block);
+      arena->block = prev;
+   }
+   if (arena->block)
+      arena->block->used = (arena->block == mark.block) ? mark.used : 0;
+}
+
+
+/* Function: al_ustr_arena_new
+ */
+ALLEGRO_USTR *al_ustr_arena_new(const char *s)
+{
+   ASSERT(s);
+   return arena_new_ustr(s, strlen(s));
+}
+
+
+/* Function: al_ustr_arena_new_from_buffer
+ */
+ALLEGRO_USTR *al_ustr_arena_new_from_buffer(const char *s, size_t size)
+{
+   ASSERT(s);
+   return arena_new_ustr(s, size);
+}
+
+
+/* Function: al_ustr_arena_newf
+ */
+ALLEGRO_USTR *al_ustr_arena_newf(const char *fmt, ...)
+{
+   ALLEGRO_USTR *us;
+   va_list ap;
+
+   us = arena_new_ustr("", 0);
+   if (!us)
+      return NULL;
+   va_start(ap, fmt);
+   al_ustr_vappendf(us, fmt, ap);
+   va_end(ap);
+   return us;
+}
+
+
+/* Function: al_ustr_arena_dup
+ */
+ALLEGRO_USTR *al_ustr_arena_dup(const ALLEGRO_USTR *us)
+{
+   return arena_new_ustr(_al_bdata(us), _al_blength(us));
+}
+
+
 /* Function: al_ustr_empty_string
  */
 const ALLEGRO_USTR *al_ustr_empty_string(void)
@@ -204,13 +706,14 @@ size_t al_ustr_size(const ALLEGRO_USTR *us)
  */
 size_t al_ustr_length(const ALLEGRO_USTR *us)
 {
-   int pos = 0;
-   int c = 0;
+   const unsigned char *data = (const unsigned char *) _al_bdata(us);
+   int size = _al_blength(us);
 
-   while (al_ustr_next(us, &pos))
-      c++;
+   if (size <= 0)
+      return 0;
 
-   return c;
+   /* The first byte always starts a code point, even if it is malformed. */
+   return 1 + count_boundaries(data, 1, size);
 }
 
 
@@ -218,17 +721,25 @@ size_t al_ustr_length(const ALLEGRO_USTR *us)
  */
 int al_ustr_offset(const ALLEGRO_USTR *us, int index)
 {
-   int pos = 0;
+   const unsigned char *data = (const unsigned char *) _al_bdata(us);
+   int size = _al_blength(us);
+   int ascii;
+   int start;
 
    if (index < 0)
       index += al_ustr_length(us);
 
-   while (index-- > 0) {
-      if (!al_ustr_next(us, &pos))
-         return pos;
-   }
+   if (index <= 0 || size <= 0)
+      return 0;
+
+   /* Within a leading run of ASCII, byte and code point offsets agree. */
+   ascii = ascii_prefix(data, _ALLEGRO_MIN(size, index + 1));
+   if (index < ascii)
+      return index;
 
-   return pos;
+   /* Bytes 1 .. start-1 are all boundaries already passed. */
+   start = _ALLEGRO_MAX(ascii, 1);
+   return find_boundary(data, start, size, index - start + 1);
 }
 
 
@@ -364,7 +875,18 @@ int32_t al_ustr_get(const ALLEGRO_USTR *ub, int pos)
  */
 int32_t al_ustr_get_next(const ALLEGRO_USTR *us, int *pos)
 {
-   int32_t c = al_ustr_get(us, *pos);
+   int32_t c;
+
+   /* Fast path for ASCII. */
+   if (*pos >= 0 && *pos < _al_blength(us)) {
+      c = ((const unsigned char *) _al_bdata(us))[*pos];
+      if (IS_SINGLE_BYTE(c)) {
+         (*pos)++;
+         return c;
+      }
+   }
+
+   c = al_ustr_get(us, *pos);
 
    if (c >= 0) {
       (*pos) += al_utf8_width(c);
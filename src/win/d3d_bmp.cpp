@@ -87,6 +87,7 @@ static void d3d_draw_textured_quad(
    ALLEGRO_DISPLAY* aldisp = (ALLEGRO_DISPLAY*)disp;
 
    if (aldisp->num_cache_vertices != 0 && (uintptr_t)bmp != aldisp->cache_texture) {
+      aldisp->stats.batch_breaks_texture++;
       aldisp->vt->flush_vertex_cache(aldisp);
    }
    aldisp->cache_texture = (uintptr_t)bmp;
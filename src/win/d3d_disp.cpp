@@ -2331,7 +2331,7 @@ static bool d3d_resize_display(ALLEGRO_DISPLAY *d, int width, int height)
 ALLEGRO_BITMAP *_al_d3d_create_bitmap(ALLEGRO_DISPLAY *d,
    int w, int h)
 {
-   ALLEGRO_BITMAP *bitmap = (ALLEGRO_BITMAP *)al_malloc(sizeof *bitmap);
+   ALLEGRO_BITMAP *bitmap = (ALLEGRO_BITMAP *)al_calloc(1, sizeof *bitmap);
    ALLEGRO_BITMAP_EXTRA_D3D *extra;
    int format;
    int flags;
@@ -2719,6 +2719,8 @@ static void d3d_flush_vertex_cache(ALLEGRO_DISPLAY* disp)
       }
    }
 
+   disp->stats.draw_calls++;
+   disp->stats.vertices += disp->num_cache_vertices;
    disp->num_cache_vertices = 0;
 #ifdef ALLEGRO_CFG_SHADER_HLSL
    if (disp->flags & ALLEGRO_USE_PROGRAMMABLE_PIPELINE) {
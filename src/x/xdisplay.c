@@ -519,12 +519,7 @@ static void transfer_display_bitmaps_to_any_other_display(
 
    ALLEGRO_DEBUG("transferring display bitmaps to other display.\n");
 
-   for (i = 0; i < d->bitmaps._size; i++) {
-      ALLEGRO_BITMAP **add = _al_vector_alloc_back(&(living->bitmaps));
-      ALLEGRO_BITMAP **ref = _al_vector_ref(&d->bitmaps, i);
-      *add = *ref;
-      (*add)->display = living;
-   }
+   _al_transfer_display_bitmaps(d, living);
 }
 
 
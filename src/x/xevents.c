@@ -199,8 +199,14 @@ void _al_xwin_background_thread(_AL_THREAD *self, void *arg)
 
       while (XEventsQueued(s->x11display, QueuedAfterFlush)) {
          XNextEvent(s->x11display, &event);
+         /* Mouse motion is batched; emit it before anything else so that
+          * events from different sources stay in order.
+          */
+         if (event.type != MotionNotify)
+            _al_xwin_mouse_flush_events();
          process_x11_event(s, event);
       }
+      _al_xwin_mouse_flush_events();
 
       /* The Xlib manual is particularly useless about the XResetScreenSaver()
        * function.  Nevertheless, this does seem to work to inhibit the native
@@ -40,12 +40,19 @@
 
 ALLEGRO_DEBUG_CHANNEL("mouse")
 
+#define MOTION_BATCH  32
+
 typedef struct ALLEGRO_MOUSE_XWIN
 {
    ALLEGRO_MOUSE parent;
    ALLEGRO_MOUSE_STATE state;
    int min_x, min_y;
    int max_x, max_y;
+   /* Motion events are collected here while the background thread drains
+    * the X event queue, then emitted together.
+    */
+   ALLEGRO_EVENT pending[MOTION_BATCH];
+   unsigned int num_pending;
 } ALLEGRO_MOUSE_XWIN;
 
 
@@ -69,6 +76,7 @@ static void xmouse_get_state(ALLEGRO_MOUSE_STATE *ret_state);
 
 static void wheel_motion_handler(int x_button, ALLEGRO_DISPLAY *display);
 static unsigned int x_button_to_al_button(unsigned int x_button);
+static void flush_pending_events(void);
 static void generate_mouse_event(unsigned int type,
    int x, int y, int z, int w,
    int dx, int dy, int dz, int dw,
@@ -457,18 +465,64 @@ void _al_xwin_mouse_motion_notify_handler(int x, int y,
    the_mouse.state.y = y;
    the_mouse.state.display = display;
 
-   generate_mouse_event(
-      event_type,
-      the_mouse.state.x, the_mouse.state.y, the_mouse.state.z,
-      the_mouse.state.w,
-      dx, dy, 0, 0,
-      0, display);
+   if (_al_event_source_needs_to_generate_event(&the_mouse.parent.es)) {
+      ALLEGRO_EVENT *event;
+
+      if (the_mouse.num_pending == MOTION_BATCH)
+         flush_pending_events();
+
+      event = &the_mouse.pending[the_mouse.num_pending++];
+      event->mouse.type = event_type;
+      event->mouse.timestamp = al_get_time();
+      event->mouse.display = display;
+      event->mouse.x = the_mouse.state.x;
+      event->mouse.y = the_mouse.state.y;
+      event->mouse.z = the_mouse.state.z;
+      event->mouse.w = the_mouse.state.w;
+      event->mouse.dx = dx;
+      event->mouse.dy = dy;
+      event->mouse.dz = 0;
+      event->mouse.dw = 0;
+      event->mouse.button = 0;
+      event->mouse.pressure = 0.0; /* TODO */
+   }
 
    _al_event_source_unlock(&the_mouse.parent.es);
 }
 
 
 
+/* _al_xwin_mouse_flush_events: [bgman thread]
+ *  Emit any motion events collected by _al_xwin_mouse_motion_notify_handler.
+ *  Called once the X event queue has been drained, and before any other
+ *  event is processed so that the order of events is preserved.
+ */
+void _al_xwin_mouse_flush_events(void)
+{
+   if (!xmouse_installed)
+      return;
+
+   _al_event_source_lock(&the_mouse.parent.es);
+   flush_pending_events();
+   _al_event_source_unlock(&the_mouse.parent.es);
+}
+
+
+
+/* flush_pending_events: [bgman thread]
+ *  Emit the pending motion events.  The mouse must be locked.
+ */
+static void flush_pending_events(void)
+{
+   if (the_mouse.num_pending > 0) {
+      _al_event_source_emit_events(&the_mouse.parent.es, the_mouse.pending,
+         the_mouse.num_pending);
+      the_mouse.num_pending = 0;
+   }
+}
+
+
+
 /* x_button_to_al_button: [bgman thread]
  *  Map a X button number to an Allegro button number.
  */
@@ -508,6 +562,8 @@ static void generate_mouse_event(unsigned int type,
 {
    ALLEGRO_EVENT event;
 
+   flush_pending_events();
+
    if (!_al_event_source_needs_to_generate_event(&the_mouse.parent.es))
       return;
 
@@ -6,6 +6,7 @@ extern int _Xdebug; /* part of Xlib */
 
 #include "allegro5/allegro.h"
 #include "allegro5/internal/aintern_bitmap.h"
+#include "allegro5/internal/aintern_headless.h"
 #include "allegro5/internal/aintern_x.h"
 #include "allegro5/internal/aintern_xcursor.h"
 #include "allegro5/internal/aintern_xembed.h"
@@ -136,6 +137,11 @@ static ALLEGRO_DISPLAY_INTERFACE *xglx_get_display_driver(void)
 {
    ALLEGRO_SYSTEM_XGLX *system = (ALLEGRO_SYSTEM_XGLX *)al_get_system_driver();
 
+   /* Without an X server we can only draw offscreen. */
+   if (!system->x11display) {
+      return _al_display_headless_driver();
+   }
+
    /* Look up the toggle_mouse_grab_key binding.  This isn't such a great place
     * to do it, but the config file is not available until after the system driver
     * is initialised.
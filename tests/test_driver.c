@@ -22,7 +22,8 @@
 #define MAX_BITMAPS  128
 #define MAX_TRANS    8
 #define MAX_FONTS    16
-#define MAX_VERTICES 100
+#define MAX_VERTICES 1000
+#define MAX_HOLES 32
 
 typedef struct {
    ALLEGRO_USTR   *name;
@@ -63,6 +64,8 @@ NamedFont         fonts[MAX_FONTS];
 ALLEGRO_VERTEX    vertices[MAX_VERTICES];
 float             simple_vertices[2 * MAX_VERTICES];
 int               num_simple_vertices;
+ALLEGRO_PRIM_BATCH *prim_batch;
+ALLEGRO_TEXT_LAYOUT *text_layout;
 int               num_global_bitmaps;
 float             delay = 0.0;
 bool              save_outputs = false;
@@ -483,6 +486,14 @@ static int get_font_align(char const *value)
       : atoi(value);
 }
 
+/* Tests have a single text layout, made by al_create_text_layout. */
+static ALLEGRO_TEXT_LAYOUT *get_text_layout(char const *name)
+{
+   if (!streq(name, "layout") || !text_layout)
+      error("undefined text layout: %s", name);
+   return text_layout;
+}
+
 static void set_config_int(ALLEGRO_CONFIG *cfg, char const *section,
    char const *var, int value)
 {
@@ -551,6 +562,34 @@ static void fill_simple_vertices(ALLEGRO_CONFIG const *cfg, char const *name)
 #undef MAXBUF
 }
 
+static int get_holes(char const *value, int *holes)
+{
+   int n = 0;
+
+   while (n < MAX_HOLES) {
+      char *end;
+      long h = strtol(value, &end, 10);
+      if (end == value)
+         break;
+      holes[n++] = h;
+      value = end;
+      while (*value == ',' || *value == ' ')
+         value++;
+   }
+
+   return n;
+}
+
+/* Tests have a single batch, created when first used. */
+static ALLEGRO_PRIM_BATCH *get_batch(char const *name)
+{
+   if (!streq(name, "batch"))
+      error("unknown batch: %s", name);
+   if (!prim_batch)
+      prim_batch = al_create_prim_batch();
+   return prim_batch;
+}
+
 static int get_prim_type(char const *value)
 {
    return streq(value, "ALLEGRO_PRIM_POINT_LIST") ? ALLEGRO_PRIM_POINT_LIST
@@ -1165,6 +1204,29 @@ static void do_test(ALLEGRO_CONFIG *cfg, char const *testname,
          continue;
       }
 
+      if (SCAN("al_create_text_layout", 1)) {
+         al_destroy_text_layout(text_layout);
+         text_layout = al_create_text_layout(get_font(V(0)));
+         continue;
+      }
+      if (SCAN("al_append_text_layout_text", 2)) {
+         al_append_text_layout_text(get_text_layout(V(0)), V(1));
+         continue;
+      }
+      if (SCAN("al_set_text_layout_line", 3)) {
+         al_set_text_layout_line(get_text_layout(V(0)), I(1), V(2));
+         continue;
+      }
+      if (SCAN("al_remove_text_layout_lines", 3)) {
+         al_remove_text_layout_lines(get_text_layout(V(0)), I(1), I(2));
+         continue;
+      }
+      if (SCAN("al_draw_text_layout", 5)) {
+         al_draw_text_layout(get_text_layout(V(0)), C(1), F(2), F(3),
+            get_font_align(V(4)));
+         continue;
+      }
+
       /* Primitives */
       if (SCAN("al_draw_line", 6)) {
          al_draw_line(F(0), F(1), F(2), F(3), C(4), F(5));
@@ -1221,6 +1283,12 @@ static void do_test(ALLEGRO_CONFIG *cfg, char const *testname,
          al_draw_filled_circle(F(0), F(1), F(2), C(3));
          continue;
       }
+      if (SCAN("al_draw_filled_circles", 3)) {
+         fill_simple_vertices(cfg, V(0));
+         al_draw_filled_circles(simple_vertices, 2 * sizeof(float),
+            num_simple_vertices, F(1), C(2));
+         continue;
+      }
       if (SCAN("al_draw_arc", 7)) {
          al_draw_arc(F(0), F(1), F(2), F(3), F(4), C(5), F(6));
          continue;
@@ -1264,10 +1332,66 @@ static void do_test(ALLEGRO_CONFIG *cfg, char const *testname,
          al_draw_filled_polygon(simple_vertices, num_simple_vertices, C(1));
          continue;
       }
+      if (SCAN("al_draw_filled_polygon_with_holes", 3)) {
+         int holes[MAX_HOLES];
+         int num_holes = get_holes(V(1), holes);
+         fill_simple_vertices(cfg, V(0));
+         al_draw_filled_polygon_with_holes(simple_vertices, num_simple_vertices,
+            holes, num_holes, C(2));
+         continue;
+      }
+
+      if (SCAN("al_batch_prim", 5)) {
+         fill_vertices(cfg, V(1));
+         al_batch_prim(get_batch(V(0)), vertices, B(2), I(3),
+            get_prim_type(V(4)));
+         continue;
+      }
+      if (SCAN("al_batch_line", 7)) {
+         al_batch_line(get_batch(V(0)), F(1), F(2), F(3), F(4), C(5), F(6));
+         continue;
+      }
+      if (SCAN("al_batch_filled_triangle", 8)) {
+         al_batch_filled_triangle(get_batch(V(0)), F(1), F(2), F(3), F(4),
+            F(5), F(6), C(7));
+         continue;
+      }
+      if (SCAN("al_batch_rectangle", 7)) {
+         al_batch_rectangle(get_batch(V(0)), F(1), F(2), F(3), F(4), C(5),
+            F(6));
+         continue;
+      }
+      if (SCAN("al_batch_filled_rectangle", 6)) {
+         al_batch_filled_rectangle(get_batch(V(0)), F(1), F(2), F(3), F(4),
+            C(5));
+         continue;
+      }
+      if (SCAN("al_batch_circle", 6)) {
+         al_batch_circle(get_batch(V(0)), F(1), F(2), F(3), C(4), F(5));
+         continue;
+      }
+      if (SCAN("al_batch_filled_circle", 5)) {
+         al_batch_filled_circle(get_batch(V(0)), F(1), F(2), F(3), C(4));
+         continue;
+      }
+      if (SCAN("al_flush_prim_batch", 1)) {
+         al_flush_prim_batch(get_batch(V(0)));
+         continue;
+      }
 
       error("statement didn't scan: %s", stmt);
    }
 
+   if (text_layout) {
+      al_destroy_text_layout(text_layout);
+      text_layout = NULL;
+   }
+
+   if (prim_batch) {
+      al_destroy_prim_batch(prim_batch);
+      prim_batch = NULL;
+   }
+
    al_set_new_bitmap_format(ALLEGRO_PIXEL_FORMAT_ANY_WITH_ALPHA);
 
    if (bmp_type == SW) {
@@ -1515,6 +1639,9 @@ int main(int _argc, char *_argv[])
          want_display = false;
          quiet = true;
       }
+      else if (streq(opt, "--headless")) {
+         al_set_new_display_flags(ALLEGRO_HEADLESS);
+      }
       else if (streq(opt, "-v") || streq(opt, "--verbose")) {
          verbose++;
       }